@@ -623,6 +623,9 @@ EOF])
          AC_MSG_RESULT([yes])],
         [AC_MSG_RESULT([no])])
 
+      # Linux inotify support for watching cgroup changes
+      AC_CHECK_HEADERS([sys/inotify.h])
+
       # Linux libudev support
       if test "x$enable_libudev" != xno; then
         AC_CHECK_HEADERS([libudev.h], [
@@ -1213,6 +1216,23 @@ return clGetDeviceIDs(0, 0, 0, NULL, NULL);
     AS_IF([test "x$hwloc_pthread_mutex_happy" = "xyes"],
       [AC_DEFINE([HWLOC_HAVE_PTHREAD_MUTEX], 1, [Define to 1 if pthread mutexes are available])])
 
+    # Concurrent discovery phases require pthread_create, see if it needs -lpthread
+    hwloc_pthread_create_happy=no
+    AC_CHECK_FUNC([pthread_create],
+      [hwloc_pthread_create_happy=yes],
+      [AC_MSG_CHECKING([for pthread_create with -lpthread])
+       tmp_save_LIBS=$LIBS
+       LIBS="$LIBS -lpthread"
+       AC_LINK_IFELSE([AC_LANG_CALL([], [pthread_create])],
+         [hwloc_pthread_create_happy=yes
+          HWLOC_LIBS="$HWLOC_LIBS -lpthread"
+         ])
+       AC_MSG_RESULT([$hwloc_pthread_create_happy])
+       LIBS="$tmp_save_LIBS"
+      ])
+    AS_IF([test "x$hwloc_pthread_create_happy" = "xyes" -a "x$hwloc_windows" != xyes],
+      [AC_DEFINE([HWLOC_HAVE_PTHREAD_CREATE], 1, [Define to 1 if threads may be created with pthread_create])])
+
     AS_IF([test "x$hwloc_pthread_mutex_happy" != xyes -a "x$hwloc_windows" != xyes],
       [AC_MSG_WARN([pthread_mutex_lock not available, required for thread-safe initialization on non-Windows platforms.])
        AC_MSG_WARN([Please report this to the hwloc-devel mailing list.])
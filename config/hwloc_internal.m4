@@ -275,6 +275,12 @@ EOF
 
     if test "x$hwloc_cairo_happy" = "xyes"; then
         AC_DEFINE([HWLOC_HAVE_CAIRO], [1], [Define to 1 if you have the `cairo' library.])
+
+        # libpng lets lstopo stream huge PNG outputs band by band
+        HWLOC_PKG_CHECK_MODULES([LIBPNG], [libpng], [png_write_row], [png.h],
+                                [AC_DEFINE([HWLOC_HAVE_LIBPNG], [1], [Define to 1 if you have the `libpng' library.])],
+                                [:])
+
         AC_MSG_CHECKING([whether lstopo Cairo/X11 interactive graphical output is supported])
         if test "x$hwloc_x11_keysym_happy" = xyes; then
           save_CPPFLAGS="$CPPFLAGS"
@@ -317,6 +323,10 @@ EOF
     AC_CHECK_HEADERS([langinfo.h], [
       AC_CHECK_FUNCS([nl_langinfo])
     ])
+    AC_CHECK_HEADERS([termios.h])
+    AC_CHECK_HEADERS([sys/wait.h])
+    AC_CHECK_FUNCS([fork])
+    AC_CHECK_FUNCS([open_memstream])
     hwloc_old_LIBS="$LIBS"
     chosen_curses=""
     for curses in ncurses curses
@@ -377,6 +387,7 @@ EOF
 
         hwloc_config_prefix[netloc/Makefile]
         hwloc_config_prefix[utils/netloc/infiniband/Makefile]
+        hwloc_config_prefix[utils/netloc/convert/Makefile]
         hwloc_config_prefix[utils/netloc/draw/Makefile]
         hwloc_config_prefix[utils/netloc/scotch/Makefile]
         hwloc_config_prefix[utils/netloc/mpi/Makefile]
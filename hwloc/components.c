@@ -940,6 +940,8 @@ hwloc_backend_alloc(struct hwloc_topology *topology,
   backend->flags = 0;
   backend->discover = NULL;
   backend->get_pci_busid_cpuset = NULL;
+  backend->gather_phases = 0;
+  backend->gather = NULL;
   backend->disable = NULL;
   backend->is_thissystem = -1;
   backend->next = NULL;
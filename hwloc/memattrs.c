@@ -349,6 +349,8 @@ to_internal_location(struct hwloc_internal_location_s *iloc,
     }
     iloc->location.object.gp_index = location->location.object->gp_index;
     iloc->location.object.type = location->location.object->type;
+    /* cache the object until the next refresh, it may be returned by get_best_initiator() */
+    iloc->location.object.obj = location->location.object;
     return 0;
   default:
     errno = EINVAL;
@@ -932,6 +934,9 @@ hwloc_memattr_set_value(hwloc_topology_t topology,
     ilocp = NULL;
   }
 
+  /* invalidate cached strings of the target */
+  hwloc__obj_modified(target_node);
+
   return hwloc__internal_memattr_set_value(topology, id, target_node->type, target_node->gp_index, target_node->os_index, ilocp, value);
 }
 
@@ -1194,3 +1199,226 @@ hwloc_get_local_numanode_objs(hwloc_topology_t topology,
   *nrp = i;
   return 0;
 }
+
+
+/****************************
+ * PCI paths to NUMA nodes
+ */
+
+/* return the bottleneck linkspeed (0 if unknown) and the number of PCI links up to the host bridge */
+static int
+hwloc__pci_path_to_hostbridge(hwloc_obj_t obj, float *linkspeedp, unsigned *hopsp, hwloc_obj_t *localityp)
+{
+  float linkspeed = 0.f;
+  unsigned hops = 0;
+
+  /* OS devices use the link of their PCI parent */
+  while (obj && obj->type == HWLOC_OBJ_OS_DEVICE)
+    obj = obj->parent;
+  if (!obj
+      || (obj->type != HWLOC_OBJ_PCI_DEVICE
+          && (obj->type != HWLOC_OBJ_BRIDGE || obj->attr->bridge.upstream_type != HWLOC_OBJ_BRIDGE_PCI)))
+    return -1;
+
+  while (obj && !obj->cpuset) {
+    float objspeed;
+    if (obj->type == HWLOC_OBJ_PCI_DEVICE)
+      objspeed = obj->attr->pcidev.linkspeed;
+    else if (obj->type == HWLOC_OBJ_BRIDGE && obj->attr->bridge.upstream_type == HWLOC_OBJ_BRIDGE_PCI)
+      objspeed = obj->attr->bridge.upstream.pci.linkspeed;
+    else {
+      /* host bridge */
+      obj = obj->parent;
+      continue;
+    }
+    hops++;
+    if (objspeed > 0.f && (linkspeed == 0.f || objspeed < linkspeed))
+      linkspeed = objspeed;
+    obj = obj->parent;
+  }
+
+  *linkspeedp = linkspeed;
+  *hopsp = hops;
+  *localityp = obj;
+  return 0;
+}
+
+/* scale the bandwidth by the latency ratio between the closest local node and the remote target */
+static hwloc_uint64_t
+hwloc__pci_path_scale_remote(hwloc_topology_t topology, struct hwloc_distances_s *distances,
+                             hwloc_obj_t locality, hwloc_obj_t node, hwloc_uint64_t bandwidth)
+{
+  hwloc_uint64_t best_local = 0, best_remote = 0;
+  hwloc_obj_t local;
+  int t;
+
+  if (!distances)
+    return bandwidth;
+  t = hwloc_distances_obj_index(distances, node);
+  if (t < 0)
+    return bandwidth;
+
+  for(local = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, 0);
+      local;
+      local = local->next_cousin) {
+    int l;
+    if (!hwloc_bitmap_intersects(local->cpuset, locality->cpuset))
+      continue;
+    l = hwloc_distances_obj_index(distances, local);
+    if (l < 0)
+      continue;
+    if (!best_remote || distances->values[l*distances->nbobjs+t] < best_remote) {
+      best_remote = distances->values[l*distances->nbobjs+t];
+      best_local = distances->values[l*distances->nbobjs+l];
+    }
+  }
+
+  if (!best_local || best_remote <= best_local)
+    return bandwidth;
+  return bandwidth * best_local / best_remote;
+}
+
+static int
+hwloc__get_pci_path_to_numanode(hwloc_topology_t topology, struct hwloc_distances_s *distances,
+                                hwloc_obj_t ioobj, hwloc_obj_t node,
+                                hwloc_uint64_t *bandwidthp, unsigned *hopsp)
+{
+  hwloc_obj_t locality;
+  hwloc_uint64_t bandwidth;
+  unsigned hops;
+  float linkspeed;
+
+  if (hwloc__pci_path_to_hostbridge(ioobj, &linkspeed, &hops, &locality) < 0 || !locality) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (linkspeed == 0.f) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  /* linkspeed is in GB/s */
+  bandwidth = (hwloc_uint64_t) (linkspeed * 1000000000. / 1048576);
+
+  if (!hwloc_bitmap_intersects(node->cpuset, locality->cpuset)) {
+    hops++;
+    bandwidth = hwloc__pci_path_scale_remote(topology, distances, locality, node, bandwidth);
+  }
+
+  if (bandwidthp)
+    *bandwidthp = bandwidth;
+  if (hopsp)
+    *hopsp = hops;
+  return 0;
+}
+
+static struct hwloc_distances_s *
+hwloc__pci_path_get_numa_latencies(hwloc_topology_t topology)
+{
+  struct hwloc_distances_s *distances;
+  unsigned nr = 1;
+  if (hwloc_distances_get_by_type(topology, HWLOC_OBJ_NUMANODE, &nr, &distances,
+                                  HWLOC_DISTANCES_KIND_MEANS_LATENCY, 0) < 0
+      || !nr)
+    return NULL;
+  return distances;
+}
+
+int
+hwloc_get_pci_path_to_numanode(hwloc_topology_t topology,
+                               hwloc_obj_t ioobj, hwloc_obj_t node,
+                               unsigned long flags,
+                               hwloc_uint64_t *bandwidth, unsigned *hops)
+{
+  struct hwloc_distances_s *distances;
+  int err;
+
+  if (flags || !ioobj || !node || node->type != HWLOC_OBJ_NUMANODE) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  distances = hwloc__pci_path_get_numa_latencies(topology);
+  err = hwloc__get_pci_path_to_numanode(topology, distances, ioobj, node, bandwidth, hops);
+  if (distances)
+    hwloc_distances_release(topology, distances);
+  return err;
+}
+
+static int
+hwloc__memattr_get_or_register(hwloc_topology_t topology, const char *name,
+                               unsigned long flags, hwloc_memattr_id_t *id)
+{
+  unsigned long gotflags;
+  if (!hwloc_memattr_get_by_name(topology, name, id)) {
+    /* reuse the existing attribute (registered by a previous call or imported from XML) */
+    if (hwloc_memattr_get_flags(topology, *id, &gotflags) < 0 || gotflags != flags) {
+      errno = EINVAL;
+      return -1;
+    }
+    return 0;
+  }
+  return hwloc_memattr_register(topology, name, flags, id);
+}
+
+int
+hwloc_memattr_register_pci_paths(hwloc_topology_t topology,
+                                 unsigned long flags,
+                                 hwloc_memattr_id_t *bandwidth_idp, hwloc_memattr_id_t *hops_idp)
+{
+  struct hwloc_distances_s *distances;
+  hwloc_memattr_id_t bandwidth_id, hops_id;
+  hwloc_obj_t pcidev, node;
+  int err = 0;
+
+  if (flags) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (hwloc__memattr_get_or_register(topology, "PCIBandwidth",
+                                     HWLOC_MEMATTR_FLAG_HIGHER_FIRST|HWLOC_MEMATTR_FLAG_NEED_INITIATOR,
+                                     &bandwidth_id) < 0)
+    return -1;
+  if (hwloc__memattr_get_or_register(topology, "PCIHops",
+                                     HWLOC_MEMATTR_FLAG_LOWER_FIRST|HWLOC_MEMATTR_FLAG_NEED_INITIATOR,
+                                     &hops_id) < 0)
+    return -1;
+
+  distances = hwloc__pci_path_get_numa_latencies(topology);
+
+  for(pcidev = hwloc_get_next_pcidev(topology, NULL);
+      pcidev;
+      pcidev = hwloc_get_next_pcidev(topology, pcidev)) {
+    struct hwloc_location initiator;
+    initiator.type = HWLOC_LOCATION_TYPE_OBJECT;
+    initiator.location.object = pcidev;
+
+    for(node = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, 0);
+        node;
+        node = node->next_cousin) {
+      hwloc_uint64_t bandwidth;
+      unsigned hops;
+
+      if (hwloc__get_pci_path_to_numanode(topology, distances, pcidev, node, &bandwidth, &hops) < 0)
+        /* no PCI link speed along this path, the other nodes won't work either */
+        break;
+
+      err = hwloc_memattr_set_value(topology, bandwidth_id, node, &initiator, 0, bandwidth);
+      if (!err)
+        err = hwloc_memattr_set_value(topology, hops_id, node, &initiator, 0, hops);
+      if (err < 0)
+        goto out;
+    }
+  }
+
+  if (bandwidth_idp)
+    *bandwidth_idp = bandwidth_id;
+  if (hops_idp)
+    *hops_idp = hops_id;
+
+ out:
+  if (distances)
+    hwloc_distances_release(topology, distances);
+  return err;
+}
@@ -634,6 +634,110 @@ hwloc_pcidisc_tree_attach(struct hwloc_topology *topology, struct hwloc_obj *tre
 }
 
 
+/******************************
+ * Sorted index of PCI busids
+ */
+
+static __hwloc_inline uint64_t
+hwloc_pci_busid_key(unsigned domain, unsigned bus, unsigned dev, unsigned func)
+{
+  return ((uint64_t) domain << 20) | ((uint64_t) (bus & 0xff) << 12) | ((dev & 0xff) << 4) | (func & 0xf);
+}
+
+static __hwloc_inline uint64_t
+hwloc_pci_obj_busid_key(hwloc_obj_t obj)
+{
+  return hwloc_pci_busid_key(obj->attr->pcidev.domain, obj->attr->pcidev.bus,
+			     obj->attr->pcidev.dev, obj->attr->pcidev.func);
+}
+
+static int
+hwloc_pci_compare_busid_index(const void *_a, const void *_b)
+{
+  uint64_t a = hwloc_pci_obj_busid_key(*(hwloc_obj_t *) _a);
+  uint64_t b = hwloc_pci_obj_busid_key(*(hwloc_obj_t *) _b);
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+void
+hwloc_pci_clear_busid_index(struct hwloc_topology *topology)
+{
+  free(topology->pcidev_busid_index);
+  topology->pcidev_busid_index = NULL;
+  topology->nr_pcidev_busid_index = 0;
+}
+
+void
+hwloc_pci_build_busid_index(struct hwloc_topology *topology)
+{
+  struct hwloc_special_level_s *slevel = &topology->slevels[HWLOC_SLEVEL_PCIDEV];
+  hwloc_obj_t *index;
+  unsigned i;
+
+  hwloc_pci_clear_busid_index(topology);
+  if (!slevel->nbobjs)
+    return;
+
+  index = malloc(slevel->nbobjs * sizeof(*index));
+  if (!index)
+    return;
+  memcpy(index, slevel->objs, slevel->nbobjs * sizeof(*index));
+
+  /* the level is usually sorted already since bus ids are sorted within each PCI tree */
+  for(i=1; i<slevel->nbobjs; i++)
+    if (hwloc_pci_compare_busid_index(&index[i-1], &index[i]) > 0)
+      break;
+  if (i < slevel->nbobjs)
+    qsort(index, slevel->nbobjs, sizeof(*index), hwloc_pci_compare_busid_index);
+
+  topology->pcidev_busid_index = index;
+  topology->nr_pcidev_busid_index = slevel->nbobjs;
+}
+
+static hwloc_obj_t
+hwloc_pci_find_in_busid_index(struct hwloc_topology *topology,
+			      unsigned domain, unsigned bus, unsigned dev, unsigned func)
+{
+  hwloc_obj_t *index = topology->pcidev_busid_index;
+  uint64_t key = hwloc_pci_busid_key(domain, bus, dev, func);
+  unsigned lo = 0, hi = topology->nr_pcidev_busid_index;
+
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo) / 2;
+    uint64_t midkey = hwloc_pci_obj_busid_key(index[mid]);
+    if (midkey == key)
+      return index[mid];
+    if (midkey < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return NULL;
+}
+
+hwloc_obj_t
+hwloc_get_pcidev_by_busid(hwloc_topology_t topology,
+			  unsigned domain, unsigned bus, unsigned dev, unsigned func)
+{
+  struct hwloc_special_level_s *slevel = &topology->slevels[HWLOC_SLEVEL_PCIDEV];
+  unsigned i;
+
+  if (topology->pcidev_busid_index || !slevel->nbobjs)
+    return hwloc_pci_find_in_busid_index(topology, domain, bus, dev, func);
+
+  /* failed to allocate the index, walk the level */
+  for(i=0; i<slevel->nbobjs; i++) {
+    hwloc_obj_t obj = slevel->objs[i];
+    if (obj->attr->pcidev.domain == domain
+	&& obj->attr->pcidev.bus == bus
+	&& obj->attr->pcidev.dev == dev
+	&& obj->attr->pcidev.func == func)
+      return obj;
+  }
+  return NULL;
+}
+
+
 /*********************************
  * Finding PCI objects or parents
  */
@@ -712,6 +816,14 @@ hwloc_pci_find_by_busid(struct hwloc_topology *topology,
   hwloc_obj_t parent = NULL;
 
   hwloc_debug("pcidisc looking for bus id %04x:%02x:%02x.%01x\n", domain, bus, dev, func);
+
+  /* exact PCI device match from the sorted index if already built */
+  parent = hwloc_pci_find_in_busid_index(topology, domain, bus, dev, func);
+  if (parent) {
+    hwloc_debug("  found busid %04x:%02x:%02x.%01x in index\n", domain, bus, dev, func);
+    return parent;
+  }
+
   loc = topology->first_pci_locality;
   while (loc) {
     if (loc->domain == domain && loc->bus_min <= bus && loc->bus_max >= bus) {
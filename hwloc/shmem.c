@@ -210,6 +210,8 @@ hwloc_shmem_topology_adopt(hwloc_topology_t *topologyp,
   new->adopted_shmem_addr = mmap_address;
   new->adopted_shmem_length = length;
   new->topology_abi = HWLOC_TOPOLOGY_ABI;
+  /* cached strings are process-local */
+  new->obj_strings = NULL;
   /* setting binding hooks will touch support arrays, so duplicate them too.
    * could avoid that by requesting a R/W mmap
    */
@@ -254,6 +256,7 @@ hwloc__topology_disadopt(hwloc_topology_t topology)
 {
   hwloc_components_fini();
   munmap(topology->adopted_shmem_addr, topology->adopted_shmem_length);
+  hwloc_internal_obj_strings_destroy(topology);
   free(topology->support.discovery);
   free(topology->support.cpubind);
   free(topology->support.membind);
@@ -0,0 +1,368 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ * See COPYING in top-level directory.
+ */
+
+#include "private/autogen/config.h"
+#include "hwloc.h"
+#include "private/private.h"
+#include "private/misc.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+
+/*********************************
+ ******** JSON export ************
+ *********************************/
+
+/* the export either streams to a file or appends to a growing buffer,
+ * it never keeps more than one line of the document in memory when streaming.
+ */
+typedef struct hwloc__json_export_state_s {
+  FILE *file;
+  char *buffer;
+  size_t length, size;
+  int failed;
+} * hwloc__json_export_state_t;
+
+static void
+hwloc__json_write(hwloc__json_export_state_t state, const char *string, size_t length)
+{
+  if (state->failed || !length)
+    return;
+
+  if (state->file) {
+    if (fwrite(string, length, 1, state->file) != 1)
+      state->failed = 1;
+    return;
+  }
+
+  if (state->length + length + 1 > state->size) {
+    size_t newsize = state->size ? state->size : 4096;
+    char *tmp;
+    while (state->length + length + 1 > newsize)
+      newsize *= 2;
+    tmp = realloc(state->buffer, newsize);
+    if (!tmp) {
+      state->failed = 1;
+      return;
+    }
+    state->buffer = tmp;
+    state->size = newsize;
+  }
+  memcpy(state->buffer + state->length, string, length);
+  state->length += length;
+  state->buffer[state->length] = '\0';
+}
+
+static void
+hwloc__json_puts(hwloc__json_export_state_t state, const char *string)
+{
+  hwloc__json_write(state, string, strlen(string));
+}
+
+static void
+hwloc__json_printf(hwloc__json_export_state_t state, const char *format, ...)
+{
+  char tmp[256];
+  va_list ap;
+  int ret;
+
+  va_start(ap, format);
+  ret = vsnprintf(tmp, sizeof(tmp), format, ap);
+  va_end(ap);
+
+  if (ret < 0 || (size_t) ret >= sizeof(tmp)) {
+    /* only used for keys and numbers, strings go through hwloc__json_string() */
+    state->failed = 1;
+    return;
+  }
+  hwloc__json_write(state, tmp, ret);
+}
+
+/* write a quoted and escaped string */
+static void
+hwloc__json_string(hwloc__json_export_state_t state, const char *string)
+{
+  const char *start = string;
+  const char *cur;
+
+  hwloc__json_puts(state, "\"");
+  for(cur = string; *cur; cur++) {
+    unsigned char c = (unsigned char) *cur;
+    char escaped[8];
+    if (c != '"' && c != '\\' && c >= 0x20)
+      continue;
+    hwloc__json_write(state, start, cur - start);
+    if (c == '"' || c == '\\') {
+      escaped[0] = '\\';
+      escaped[1] = c;
+      hwloc__json_write(state, escaped, 2);
+    } else {
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      hwloc__json_write(state, escaped, 6);
+    }
+    start = cur+1;
+  }
+  hwloc__json_write(state, start, cur - start);
+  hwloc__json_puts(state, "\"");
+}
+
+static void
+hwloc__json_key_string(hwloc__json_export_state_t state, const char *key, const char *value)
+{
+  hwloc__json_printf(state, ",\"%s\":", key);
+  hwloc__json_string(state, value);
+}
+
+/* bitmaps are exported in the compact list format, e.g. "0-3,8" */
+static void
+hwloc__json_key_bitmap(hwloc__json_export_state_t state, const char *key, hwloc_const_bitmap_t set)
+{
+  char *string;
+
+  if (!set)
+    return;
+  if (hwloc_bitmap_list_asprintf(&string, set) < 0) {
+    state->failed = 1;
+    return;
+  }
+  hwloc__json_key_string(state, key, string);
+  free(string);
+}
+
+static void
+hwloc__json_pci_attrs(hwloc__json_export_state_t state, struct hwloc_pcidev_attr_s *pcidev)
+{
+  hwloc__json_printf(state, ",\"busid\":\"%04x:%02x:%02x.%01x\"",
+		     pcidev->domain, pcidev->bus, pcidev->dev, pcidev->func);
+  hwloc__json_printf(state, ",\"class_id\":%u,\"vendor_id\":%u,\"device_id\":%u,\"subvendor_id\":%u,\"subdevice_id\":%u,\"revision\":%u",
+		     pcidev->class_id, pcidev->vendor_id, pcidev->device_id,
+		     pcidev->subvendor_id, pcidev->subdevice_id, pcidev->revision);
+  hwloc__json_printf(state, ",\"linkspeed\":%f", pcidev->linkspeed);
+}
+
+static void
+hwloc__json_export_obj(hwloc__json_export_state_t state, hwloc_obj_t obj)
+{
+  unsigned i;
+
+  hwloc__json_printf(state, "{\"type\":\"%s\"", hwloc_obj_type_string(obj->type));
+  if (obj->subtype)
+    hwloc__json_key_string(state, "subtype", obj->subtype);
+  if (obj->name)
+    hwloc__json_key_string(state, "name", obj->name);
+  hwloc__json_printf(state, ",\"depth\":%d,\"logical_index\":%u", obj->depth, obj->logical_index);
+  if (obj->os_index != HWLOC_UNKNOWN_INDEX)
+    hwloc__json_printf(state, ",\"os_index\":%u", obj->os_index);
+  hwloc__json_printf(state, ",\"gp_index\":%llu", (unsigned long long) obj->gp_index);
+  if (obj->parent)
+    hwloc__json_printf(state, ",\"parent\":%llu", (unsigned long long) obj->parent->gp_index);
+
+  hwloc__json_key_bitmap(state, "cpuset", obj->cpuset);
+  hwloc__json_key_bitmap(state, "complete_cpuset", obj->complete_cpuset);
+  hwloc__json_key_bitmap(state, "nodeset", obj->nodeset);
+  hwloc__json_key_bitmap(state, "complete_nodeset", obj->complete_nodeset);
+  if (obj->total_memory)
+    hwloc__json_printf(state, ",\"total_memory\":%llu", (unsigned long long) obj->total_memory);
+
+  switch (obj->type) {
+  case HWLOC_OBJ_NUMANODE:
+    hwloc__json_printf(state, ",\"local_memory\":%llu", (unsigned long long) obj->attr->numanode.local_memory);
+    if (obj->attr->numanode.page_types_len) {
+      hwloc__json_puts(state, ",\"page_types\":[");
+      for(i=0; i<obj->attr->numanode.page_types_len; i++)
+	hwloc__json_printf(state, "%s{\"size\":%llu,\"count\":%llu}", i ? "," : "",
+			   (unsigned long long) obj->attr->numanode.page_types[i].size,
+			   (unsigned long long) obj->attr->numanode.page_types[i].count);
+      hwloc__json_puts(state, "]");
+    }
+    break;
+  case HWLOC_OBJ_L1CACHE:
+  case HWLOC_OBJ_L2CACHE:
+  case HWLOC_OBJ_L3CACHE:
+  case HWLOC_OBJ_L4CACHE:
+  case HWLOC_OBJ_L5CACHE:
+  case HWLOC_OBJ_L1ICACHE:
+  case HWLOC_OBJ_L2ICACHE:
+  case HWLOC_OBJ_L3ICACHE:
+  case HWLOC_OBJ_MEMCACHE:
+    hwloc__json_printf(state, ",\"cache_size\":%llu,\"cache_depth\":%u,\"cache_linesize\":%u,\"cache_associativity\":%d,\"cache_type\":\"%s\"",
+		       (unsigned long long) obj->attr->cache.size,
+		       obj->attr->cache.depth,
+		       obj->attr->cache.linesize,
+		       obj->attr->cache.associativity,
+		       obj->attr->cache.type == HWLOC_OBJ_CACHE_DATA ? "Data"
+		       : obj->attr->cache.type == HWLOC_OBJ_CACHE_INSTRUCTION ? "Instruction" : "Unified");
+    break;
+  case HWLOC_OBJ_GROUP:
+    hwloc__json_printf(state, ",\"group_kind\":%u,\"group_subkind\":%u",
+		       obj->attr->group.kind, obj->attr->group.subkind);
+    if (obj->attr->group.dont_merge)
+      hwloc__json_puts(state, ",\"group_dont_merge\":true");
+    break;
+  case HWLOC_OBJ_PCI_DEVICE:
+    hwloc__json_pci_attrs(state, &obj->attr->pcidev);
+    break;
+  case HWLOC_OBJ_BRIDGE:
+    hwloc__json_printf(state, ",\"bridge_depth\":%u,\"upstream_type\":\"%s\"",
+		       obj->attr->bridge.depth,
+		       obj->attr->bridge.upstream_type == HWLOC_OBJ_BRIDGE_PCI ? "PCI" : "Host");
+    if (obj->attr->bridge.upstream_type == HWLOC_OBJ_BRIDGE_PCI)
+      hwloc__json_pci_attrs(state, &obj->attr->bridge.upstream.pci);
+    if (obj->attr->bridge.downstream_type == HWLOC_OBJ_BRIDGE_PCI)
+      hwloc__json_printf(state, ",\"downstream_type\":\"PCI\",\"downstream_busid\":\"%04x:[%02x-%02x]\"",
+			 obj->attr->bridge.downstream.pci.domain,
+			 obj->attr->bridge.downstream.pci.secondary_bus,
+			 obj->attr->bridge.downstream.pci.subordinate_bus);
+    break;
+  case HWLOC_OBJ_OS_DEVICE: {
+    char osdevtype[64];
+    hwloc_obj_type_snprintf(osdevtype, sizeof(osdevtype), obj, 1);
+    hwloc__json_key_string(state, "osdev_type", osdevtype);
+    break;
+  }
+  default:
+    break;
+  }
+
+  if (obj->infos_count) {
+    /* infos may contain the same name several times, hence an array of pairs */
+    hwloc__json_puts(state, ",\"infos\":[");
+    for(i=0; i<obj->infos_count; i++) {
+      hwloc__json_puts(state, i ? ",[" : "[");
+      hwloc__json_string(state, obj->infos[i].name);
+      hwloc__json_puts(state, ",");
+      hwloc__json_string(state, obj->infos[i].value);
+      hwloc__json_puts(state, "]");
+    }
+    hwloc__json_puts(state, "]");
+  }
+
+  hwloc__json_puts(state, "}");
+}
+
+static void
+hwloc__json_export_level(hwloc__json_export_state_t state, hwloc_topology_t topology, int depth, int *first_level)
+{
+  hwloc_obj_t obj = hwloc_get_obj_by_depth(topology, depth, 0);
+
+  if (!obj)
+    /* special levels may be empty */
+    return;
+
+  hwloc__json_printf(state, "%s\n {\"depth\":%d,\"type\":\"%s\",\"objects\":[",
+		     *first_level ? "" : ",", depth, hwloc_obj_type_string(obj->type));
+  *first_level = 0;
+
+  for( ; obj; obj = obj->next_cousin) {
+    hwloc__json_puts(state, obj->logical_index ? ",\n  " : "\n  ");
+    hwloc__json_export_obj(state, obj);
+  }
+
+  hwloc__json_puts(state, "]}");
+}
+
+static int
+hwloc__json_export(hwloc__json_export_state_t state, hwloc_topology_t topology)
+{
+  static const int special_depths[] = {
+    HWLOC_TYPE_DEPTH_NUMANODE,
+    HWLOC_TYPE_DEPTH_MEMCACHE,
+    HWLOC_TYPE_DEPTH_BRIDGE,
+    HWLOC_TYPE_DEPTH_PCI_DEVICE,
+    HWLOC_TYPE_DEPTH_OS_DEVICE,
+    HWLOC_TYPE_DEPTH_MISC
+  };
+  int first_level = 1;
+  int depth, topodepth;
+  unsigned i;
+  hwloc_localeswitch_declare;
+
+  hwloc_localeswitch_init();
+
+  topodepth = hwloc_topology_get_depth(topology);
+  hwloc__json_printf(state, "{\"hwloc_version\":\"%s\",\"depth\":%d", HWLOC_VERSION, topodepth);
+  hwloc__json_key_bitmap(state, "allowed_cpuset", hwloc_topology_get_allowed_cpuset(topology));
+  hwloc__json_key_bitmap(state, "allowed_nodeset", hwloc_topology_get_allowed_nodeset(topology));
+  hwloc__json_puts(state, ",\"levels\":[");
+
+  /* normal levels from the root, then special levels */
+  for(depth = 0; depth < topodepth; depth++)
+    hwloc__json_export_level(state, topology, depth, &first_level);
+  for(i = 0; i < sizeof(special_depths)/sizeof(*special_depths); i++)
+    hwloc__json_export_level(state, topology, special_depths[i], &first_level);
+
+  hwloc__json_puts(state, "\n]}\n");
+
+  hwloc_localeswitch_fini();
+
+  if (state->failed) {
+    if (!errno)
+      errno = ENOMEM;
+    return -1;
+  }
+  return 0;
+}
+
+int
+hwloc_topology_export_json(hwloc_topology_t topology, const char *filename, unsigned long flags)
+{
+  struct hwloc__json_export_state_s state;
+  int ret;
+
+  if (!topology->is_loaded || flags) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memset(&state, 0, sizeof(state));
+  if (!strcmp(filename, "-")) {
+    state.file = stdout;
+  } else {
+    state.file = fopen(filename, "w");
+    if (!state.file)
+      return -1;
+  }
+
+  errno = 0;
+  ret = hwloc__json_export(&state, topology);
+
+  if (state.file == stdout) {
+    if (fflush(stdout))
+      ret = -1;
+  } else {
+    if (fclose(state.file))
+      ret = -1;
+  }
+  return ret;
+}
+
+int
+hwloc_topology_export_jsonbuffer(hwloc_topology_t topology, char **jsonbuffer, int *buflen, unsigned long flags)
+{
+  struct hwloc__json_export_state_s state;
+
+  if (!topology->is_loaded || flags) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memset(&state, 0, sizeof(state));
+  errno = 0;
+  if (hwloc__json_export(&state, topology) < 0) {
+    free(state.buffer);
+    return -1;
+  }
+
+  *jsonbuffer = state.buffer;
+  *buflen = (int) state.length + 1;
+  return 0;
+}
+
+void
+hwloc_free_jsonbuffer(hwloc_topology_t topology __hwloc_attribute_unused, char *jsonbuffer)
+{
+  free(jsonbuffer);
+}
@@ -30,6 +30,9 @@
 #ifdef HWLOC_HAVE_LIBUDEV
 #include <libudev.h>
 #endif
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sched.h>
@@ -62,6 +65,18 @@ struct hwloc_linux_backend_data_s {
   struct utsname utsname; /* fields contain \0 when unknown */
   int fallback_nbprocessors; /* only used in hwloc_linux_fallback_pu_level(), maybe be <= 0 (error) earlier */
   unsigned pagesize;
+#ifdef HWLOC_HAVE_LINUXPCI
+  /* PCI devices read from sysfs by gather(), before being inserted during the PCI phase */
+  int pci_gathered;
+  unsigned nr_pci_records;
+  struct hwloc_linux_pci_record_s *pci_records;
+  /* SR-IOV VFs ignored by the gathering when HWLOC_TOPOLOGY_FLAG_COLLAPSE_PCI_VFS is set */
+  unsigned nr_pci_vf_records;
+  struct hwloc_linux_pci_vf_record_s *pci_vf_records;
+  /* PCI objects inserted during the PCI phase, indexed by busid for finding OS device parents */
+  unsigned pci_busid_hash_size; /* power of 2, or 0 */
+  struct hwloc_linux_pci_busid_slot_s *pci_busid_hash;
+#endif
 };
 
 
@@ -2128,8 +2143,7 @@ static int hwloc_linux_get_allowed_resources_hook(hwloc_topology_t topology)
 
   hwloc_linux__get_allowed_resources(topology, fsroot_path, root_fd, &cpuset_name);
   if (cpuset_name) {
-    hwloc__add_info_nodup(&topology->levels[0][0]->infos, &topology->levels[0][0]->infos_count,
-			  "LinuxCgroup", cpuset_name, 1 /* replace */);
+    hwloc__obj_add_info_nodup(topology->levels[0][0], "LinuxCgroup", cpuset_name, 1 /* replace */);
     free(cpuset_name);
   }
   if (root_fd != -1)
@@ -2200,8 +2214,12 @@ enum hwloc_linux_cgroup_type_e {
       HWLOC_LINUX_CPUSET
 };
 
+/* Call fn on each mount entry whose type is fstype (or on all entries if fstype is NULL),
+ * until fn returns non-zero.
+ */
 static void
-hwloc_find_linux_cgroup_mntpnt(enum hwloc_linux_cgroup_type_e *cgtype, char **mntpnt, const char *root_path, int fsroot_fd)
+hwloc_linux_foreach_mntent(const char *root_path, const char *fstype,
+			   int (*fn)(struct mntent *mntent, void *arg), void *arg)
 {
   char *mount_path;
   struct mntent mntent;
@@ -2210,8 +2228,6 @@ hwloc_find_linux_cgroup_mntpnt(enum hwloc_linux_cgroup_type_e *cgtype, char **mn
   int err;
   size_t bufsize;
 
-  *mntpnt = NULL;
-
   if (root_path) {
     /* setmntent() doesn't support openat(), so use the root_path directly */
     err = asprintf(&mount_path, "%s/proc/mounts", root_path);
@@ -2241,75 +2257,107 @@ hwloc_find_linux_cgroup_mntpnt(enum hwloc_linux_cgroup_type_e *cgtype, char **mn
   }
 
   while (getmntent_r(fd, &mntent, buf, bufsize)) {
+    if (fstype && strcmp(mntent.mnt_type, fstype))
+      continue;
+    if (fn(&mntent, arg))
+      break;
+  }
 
-    if (!strcmp(mntent.mnt_type, "cgroup2")) {
-      char ctrls[1024]; /* there are about ten controllers with 10-char names */
-      char ctrlpath[256];
-      hwloc_debug("Found cgroup2 mount point on %s\n", mntent.mnt_dir);
-      /* read controllers */
-      snprintf(ctrlpath, sizeof(ctrlpath), "%s/cgroup.controllers", mntent.mnt_dir);
-      err = hwloc_read_path_by_length(ctrlpath, ctrls, sizeof(ctrls), fsroot_fd);
-      if (!err) {
-	/* look for cpuset separated by spaces */
-	char *ctrl, *_ctrls = ctrls;
-	char *tmp;
-	int cpuset_ctrl = 0;
-	tmp = strchr(ctrls, '\n');
-	if (tmp)
-	  *tmp = '\0';
-	hwloc_debug("Looking for `cpuset' controller in list `%s'\n", ctrls);
-	while ((ctrl = strsep(&_ctrls, " ")) != NULL) {
-	  if (!strcmp(ctrl, "cpuset")) {
-	    cpuset_ctrl = 1;
-	    break;
-	  }
-	}
-	if (cpuset_ctrl) {
-	  hwloc_debug("Found cgroup2/cpuset mount point on %s\n", mntent.mnt_dir);
-	  *cgtype = HWLOC_LINUX_CGROUP2;
-	  *mntpnt = strdup(mntent.mnt_dir);
-	  break;
-	}
-      } else {
-	hwloc_debug("Failed to read cgroup2 controllers from `%s'\n", ctrlpath);
-      }
+  endmntent(fd);
+  free(buf);
+}
 
-    } else if (!strcmp(mntent.mnt_type, "cpuset")) {
-      hwloc_debug("Found cpuset mount point on %s\n", mntent.mnt_dir);
-      *cgtype = HWLOC_LINUX_CPUSET;
-      *mntpnt = strdup(mntent.mnt_dir);
-      break;
+struct hwloc_linux_cgroup_mntpnt_s {
+  enum hwloc_linux_cgroup_type_e *cgtype;
+  char **mntpnt;
+  int fsroot_fd;
+};
 
-    } else if (!strcmp(mntent.mnt_type, "cgroup")) {
-      /* found a cgroup mntpnt */
-      char *opt, *opts = mntent.mnt_opts;
-      int cpuset_opt = 0;
-      int noprefix_opt = 0;
-      /* look at options */
-      while ((opt = strsep(&opts, ",")) != NULL) {
-	if (!strcmp(opt, "cpuset"))
-	  cpuset_opt = 1;
-	else if (!strcmp(opt, "noprefix"))
-	  noprefix_opt = 1;
+static int
+hwloc_linux_cgroup_mntent_cb(struct mntent *mntent, void *_arg)
+{
+  struct hwloc_linux_cgroup_mntpnt_s *arg = _arg;
+  int err;
+
+  if (!strcmp(mntent->mnt_type, "cgroup2")) {
+    char ctrls[1024]; /* there are about ten controllers with 10-char names */
+    char ctrlpath[256];
+    hwloc_debug("Found cgroup2 mount point on %s\n", mntent->mnt_dir);
+    /* read controllers */
+    snprintf(ctrlpath, sizeof(ctrlpath), "%s/cgroup.controllers", mntent->mnt_dir);
+    err = hwloc_read_path_by_length(ctrlpath, ctrls, sizeof(ctrls), arg->fsroot_fd);
+    if (!err) {
+      /* look for cpuset separated by spaces */
+      char *ctrl, *_ctrls = ctrls;
+      char *tmp;
+      int cpuset_ctrl = 0;
+      tmp = strchr(ctrls, '\n');
+      if (tmp)
+	*tmp = '\0';
+      hwloc_debug("Looking for `cpuset' controller in list `%s'\n", ctrls);
+      while ((ctrl = strsep(&_ctrls, " ")) != NULL) {
+	if (!strcmp(ctrl, "cpuset")) {
+	  cpuset_ctrl = 1;
+	  break;
+	}
       }
-      if (!cpuset_opt)
-	continue;
-      if (noprefix_opt) {
-	hwloc_debug("Found cgroup1 emulating a cpuset mount point on %s\n", mntent.mnt_dir);
-	*cgtype = HWLOC_LINUX_CPUSET;
-	*mntpnt = strdup(mntent.mnt_dir);
-	break;
-      } else {
-	hwloc_debug("Found cgroup1/cpuset mount point on %s\n", mntent.mnt_dir);
-	*cgtype = HWLOC_LINUX_CGROUP1;
-	*mntpnt = strdup(mntent.mnt_dir);
-	break;
+      if (cpuset_ctrl) {
+	hwloc_debug("Found cgroup2/cpuset mount point on %s\n", mntent->mnt_dir);
+	*arg->cgtype = HWLOC_LINUX_CGROUP2;
+	*arg->mntpnt = strdup(mntent->mnt_dir);
+	return 1;
       }
+    } else {
+      hwloc_debug("Failed to read cgroup2 controllers from `%s'\n", ctrlpath);
+    }
+
+  } else if (!strcmp(mntent->mnt_type, "cpuset")) {
+    hwloc_debug("Found cpuset mount point on %s\n", mntent->mnt_dir);
+    *arg->cgtype = HWLOC_LINUX_CPUSET;
+    *arg->mntpnt = strdup(mntent->mnt_dir);
+    return 1;
+
+  } else if (!strcmp(mntent->mnt_type, "cgroup")) {
+    /* found a cgroup mntpnt */
+    char *opt, *opts = mntent->mnt_opts;
+    int cpuset_opt = 0;
+    int noprefix_opt = 0;
+    /* look at options */
+    while ((opt = strsep(&opts, ",")) != NULL) {
+      if (!strcmp(opt, "cpuset"))
+	cpuset_opt = 1;
+      else if (!strcmp(opt, "noprefix"))
+	noprefix_opt = 1;
+    }
+    if (!cpuset_opt)
+      return 0;
+    if (noprefix_opt) {
+      hwloc_debug("Found cgroup1 emulating a cpuset mount point on %s\n", mntent->mnt_dir);
+      *arg->cgtype = HWLOC_LINUX_CPUSET;
+      *arg->mntpnt = strdup(mntent->mnt_dir);
+      return 1;
+    } else {
+      hwloc_debug("Found cgroup1/cpuset mount point on %s\n", mntent->mnt_dir);
+      *arg->cgtype = HWLOC_LINUX_CGROUP1;
+      *arg->mntpnt = strdup(mntent->mnt_dir);
+      return 1;
     }
   }
 
-  endmntent(fd);
-  free(buf);
+  return 0;
+}
+
+static void
+hwloc_find_linux_cgroup_mntpnt(enum hwloc_linux_cgroup_type_e *cgtype, char **mntpnt, const char *root_path, int fsroot_fd)
+{
+  struct hwloc_linux_cgroup_mntpnt_s arg;
+
+  *mntpnt = NULL;
+
+  arg.cgtype = cgtype;
+  arg.mntpnt = mntpnt;
+  arg.fsroot_fd = fsroot_fd;
+  hwloc_linux_foreach_mntent(root_path, NULL, hwloc_linux_cgroup_mntent_cb, &arg);
 }
 
 /*
@@ -2423,6 +2471,124 @@ hwloc_admin_disable_set_from_cgroup(int root_fd,
   hwloc_debug_bitmap("cpuset includes %s\n", admin_enabled_set);
 }
 
+int
+hwloc_linux_open_allowed_resources_notifier(hwloc_topology_t topology)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+  /* watch both the configured and effective sets since writes to the former are notified */
+  static const char *cgroup2_files[] = { "cpuset.cpus", "cpuset.cpus.effective", "cpuset.mems", "cpuset.mems.effective", NULL };
+  static const char *cgroup1_files[] = { "cpuset.cpus", "cpuset.effective_cpus", "cpuset.mems", "cpuset.effective_mems", NULL };
+  static const char *cpuset_files[] = { "cpus", "mems", NULL };
+  enum hwloc_linux_cgroup_type_e cgtype;
+  const char **files;
+  const char *fsroot_path;
+  char *mntpnt, *cgroup_name;
+  int root_fd = -1;
+  int fd = -1;
+  unsigned i, nr = 0;
+
+  if (!topology->is_loaded || !topology->is_thissystem) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  fsroot_path = getenv("HWLOC_FSROOT");
+  if (!fsroot_path)
+    fsroot_path = "/";
+
+  if (strcmp(fsroot_path, "/")) {
+#ifdef HAVE_OPENAT
+    root_fd = open(fsroot_path, O_RDONLY | O_DIRECTORY);
+    if (root_fd < 0)
+      return -1;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+  }
+
+  hwloc_find_linux_cgroup_mntpnt(&cgtype, &mntpnt, fsroot_path, root_fd);
+  if (!mntpnt) {
+    errno = ENOENT;
+    goto out;
+  }
+  cgroup_name = hwloc_read_linux_cgroup_name(root_fd, topology->pid);
+  if (!cgroup_name) {
+    errno = ENOENT;
+    goto out_with_mntpnt;
+  }
+
+  switch (cgtype) {
+  case HWLOC_LINUX_CGROUP2: files = cgroup2_files; break;
+  case HWLOC_LINUX_CGROUP1: files = cgroup1_files; break;
+  default: files = cpuset_files; break;
+  }
+
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+    goto out_with_name;
+
+  for(i=0; files[i]; i++) {
+    char path[512];
+    int err;
+    /* inotify doesn't support openat(), so use the fsroot path directly */
+    err = snprintf(path, sizeof(path), "%s%s%s/%s", strcmp(fsroot_path, "/") ? fsroot_path : "", mntpnt, cgroup_name, files[i]);
+    if ((size_t) err >= sizeof(path))
+      continue;
+    if (inotify_add_watch(fd, path, IN_MODIFY) >= 0) {
+      hwloc_debug("Watching cgroup file <%s> for allowed resources changes\n", path);
+      nr++;
+    }
+  }
+  if (!nr) {
+    close(fd);
+    fd = -1;
+    errno = ENOENT;
+  }
+
+ out_with_name:
+  free(cgroup_name);
+ out_with_mntpnt:
+  free(mntpnt);
+ out:
+  if (root_fd != -1)
+    close(root_fd);
+  return fd;
+#else /* !HAVE_SYS_INOTIFY_H */
+  errno = ENOSYS;
+  return -1;
+#endif /* !HAVE_SYS_INOTIFY_H */
+}
+
+int
+hwloc_linux_update_allowed_resources(hwloc_topology_t topology, int fd)
+{
+  hwloc_bitmap_t oldcpuset, oldnodeset;
+  int changed = -1;
+
+  if (fd >= 0) {
+    /* drain pending notifications, we're going to read the current state anyway */
+    char buffer[4096];
+    while (read(fd, buffer, sizeof(buffer)) > 0);
+  }
+
+  oldcpuset = hwloc_bitmap_dup(topology->allowed_cpuset);
+  oldnodeset = hwloc_bitmap_dup(topology->allowed_nodeset);
+  if (!oldcpuset || !oldnodeset)
+    goto out;
+
+  if (hwloc_topology_allow(topology, NULL, NULL, HWLOC_ALLOW_FLAG_LOCAL_RESTRICTIONS) < 0)
+    goto out;
+
+  changed = !hwloc_bitmap_isequal(oldcpuset, topology->allowed_cpuset)
+    || !hwloc_bitmap_isequal(oldnodeset, topology->allowed_nodeset);
+
+ out:
+  hwloc_bitmap_free(oldcpuset);
+  hwloc_bitmap_free(oldnodeset);
+  return changed;
+}
+
 static void
 hwloc_parse_meminfo_info(struct hwloc_linux_backend_data_s *data,
 			 const char *path,
@@ -3565,6 +3731,128 @@ read_node_local_memattrs(struct hwloc_topology *topology,
   return 0;
 }
 
+/* add CXLDevice infos to a NUMA node exposed by a DAX device of a CXL region */
+static void
+read_node_cxl_devices(struct hwloc_linux_backend_data_s *data,
+		      hwloc_obj_t node,
+		      const char *daxname)
+{
+  char path[300], link[1024];
+  const char *region;
+  unsigned regionid, k;
+  int found = 0;
+  int err;
+
+  /* the DAX device of a CXL region is below .../decoderX.Y/region<N>/dax_region<N>/ */
+  snprintf(path, sizeof(path), "/sys/bus/dax/devices/%s", daxname);
+  err = hwloc_readlink(path, link, sizeof(link)-1, data->root_fd);
+  if (err < 0)
+    return;
+  link[err] = '\0';
+  region = strstr(link, "/region");
+  if (!region || sscanf(region, "/region%u/", &regionid) != 1)
+    return;
+
+  /* each region target is an endpoint decoder whose port uport points to the CXL memdev below the PCI device */
+  for(k=0; ; k++) {
+    char decoder[64], *eol, *busid;
+    unsigned domain, bus, dev, func;
+
+    snprintf(path, sizeof(path), "/sys/bus/cxl/devices/region%u/target%u", regionid, k);
+    if (hwloc_read_path_by_length(path, decoder, sizeof(decoder), data->root_fd) < 0)
+      break;
+    eol = strchr(decoder, '\n');
+    if (eol)
+      *eol = '\0';
+    if (!*decoder)
+      /* target not configured yet */
+      continue;
+
+    snprintf(path, sizeof(path), "/sys/bus/cxl/devices/%s/../uport", decoder);
+    err = hwloc_readlink(path, link, sizeof(link)-1, data->root_fd);
+    if (err < 0)
+      continue;
+    link[err] = '\0';
+    /* remove the trailing memdev name, the PCI busid is before it */
+    busid = strrchr(link, '/');
+    if (!busid)
+      continue;
+    *busid = '\0';
+    busid = strrchr(link, '/');
+    busid = busid ? busid+1 : link;
+    if (sscanf(busid, "%x:%x:%x.%x", &domain, &bus, &dev, &func) != 4)
+      continue;
+
+    hwloc_debug("os node %u is CXL memory from region%u target %s PCI %s\n",
+		node->os_index, regionid, decoder, busid);
+    hwloc_obj_add_info(node, "CXLDevice", busid);
+    found = 1;
+  }
+
+  if (found && !node->subtype)
+    node->subtype = strdup("CXLMemory");
+}
+
+/* add MemoryTier infos to NUMA nodes and expose the tier order as a memattr */
+static void
+read_node_memory_tiers(struct hwloc_topology *topology,
+		       struct hwloc_linux_backend_data_s *data,
+		       unsigned nbnodes, hwloc_obj_t *nodes)
+{
+  DIR *dir;
+  struct dirent *dirent;
+  hwloc_bitmap_t tiernodes;
+  hwloc_memattr_id_t id;
+  int registered = 0;
+
+  dir = hwloc_opendir("/sys/devices/virtual/memory_tiering", data->root_fd);
+  if (!dir)
+    return;
+
+  tiernodes = hwloc_bitmap_alloc();
+  if (!tiernodes) {
+    closedir(dir);
+    return;
+  }
+
+  while ((dirent = readdir(dir)) != NULL) {
+    char path[sizeof("/sys/devices/virtual/memory_tiering//nodelist")+sizeof(dirent->d_name)], tierstr[11];
+    unsigned tier, i;
+    int err;
+
+    if (sscanf(dirent->d_name, "memory_tier%u", &tier) != 1)
+      continue;
+    err = snprintf(path, sizeof(path), "/sys/devices/virtual/memory_tiering/%s/nodelist", dirent->d_name);
+    if ((size_t) err >= sizeof(path))
+      continue;
+    if (hwloc__read_path_as_cpulist(path, tiernodes, data->root_fd) < 0)
+      continue;
+    snprintf(tierstr, sizeof(tierstr), "%u", tier);
+
+    for(i=0; i<nbnodes; i++) {
+      hwloc_obj_t node = nodes[i];
+      if (!node || !hwloc_bitmap_isset(tiernodes, node->os_index))
+	continue;
+      hwloc_debug("os node %u is in memory tier %u\n", node->os_index, tier);
+      hwloc_obj_add_info(node, "MemoryTier", tierstr);
+
+      if (!registered) {
+	/* lower tiers are the faster ones, they don't depend on initiators */
+	if (!hwloc_memattr_get_by_name(topology, "MemoryTier", &id)
+	    || !hwloc_memattr_register(topology, "MemoryTier", HWLOC_MEMATTR_FLAG_LOWER_FIRST, &id))
+	  registered = 1;
+	else
+	  registered = -1;
+      }
+      if (registered > 0)
+	hwloc_internal_memattr_set_value(topology, id, HWLOC_OBJ_NUMANODE, (hwloc_uint64_t)-1, node->os_index, NULL, tier);
+    }
+  }
+
+  hwloc_bitmap_free(tiernodes);
+  closedir(dir);
+}
+
 /* return -1 if the kernel doesn't support mscache,
  * or update tree (containing only the node on input) with caches (if any)
  */
@@ -3938,14 +4226,20 @@ look_sysfsnode(struct hwloc_topology *topology,
 	    osnode = (unsigned) tmp;
 	    for(i=0; i<nbnodes; i++) {
 	      hwloc_obj_t node = nodes[i];
-	      if (node && node->os_index == osnode)
+	      if (node && node->os_index == osnode) {
 		hwloc_obj_add_info(node, "DAXDevice", dirent->d_name);
+		/* DAX devices of CXL regions also tell us which CXL devices back this node */
+		read_node_cxl_devices(data, node, dirent->d_name);
+	      }
 	    }
 	  }
 	}
 	closedir(dir);
       }
 
+      /* find which memory tier each node belongs to */
+      read_node_memory_tiers(topology, data, nbnodes, nodes);
+
       topology->support.discovery->numa = 1;
       topology->support.discovery->numa_memory = 1;
       topology->support.discovery->disallowed_numa = 1;
@@ -5230,81 +5524,623 @@ hwloc_linux_backend_get_pci_busid_cpuset(struct hwloc_backend *backend,
 
 
 
-#ifdef HWLOC_HAVE_LINUXIO
-
-/***********************************
- ******* Linux I/O discovery *******
- ***********************************/
+static struct hwloc_disc_component hwloc_linux_disc_component;
 
-#define HWLOC_LINUXFS_OSDEV_FLAG_FIND_VIRTUAL (1U<<0)
-#define HWLOC_LINUXFS_OSDEV_FLAG_FIND_USB (1U<<1)
-#define HWLOC_LINUXFS_OSDEV_FLAG_BLOCK_WITH_SECTORS (1U<<2)
-#define HWLOC_LINUXFS_OSDEV_FLAG_UNDER_BUS (1U<<31)
+/* Return the filesystem root the Linux backend of this topology browsed,
+ * or -1 (the current root) if the topology wasn't discovered by that backend.
+ */
+static int
+hwloc_linux_get_root_fd(hwloc_topology_t topology)
+{
+  struct hwloc_backend *backend;
+  for(backend = topology->backends; backend; backend = backend->next)
+    if (backend->component == &hwloc_linux_disc_component) {
+      struct hwloc_linux_backend_data_s *data = backend->private_data;
+      return data->root_fd;
+    }
+  return -1;
+}
 
-static hwloc_obj_t
-hwloc_linuxfs_find_osdev_parent(struct hwloc_backend *backend, int root_fd,
-				const char *osdevpath, unsigned osdev_flags)
+int
+hwloc_linux_get_pci_vf(hwloc_topology_t topology, hwloc_obj_t pf, unsigned idx,
+		       struct hwloc_pcidev_attr_s *attr, char *netdev, size_t netdevlen)
 {
-  struct hwloc_topology *topology = backend->topology;
-  char path[256], buf[10];
-  int fd;
-  int foundpci;
-  unsigned pcidomain = 0, pcibus = 0, pcidev = 0, pcifunc = 0;
-  unsigned _pcidomain, _pcibus, _pcidev, _pcifunc;
-  hwloc_bitmap_t cpuset;
-  const char *tmp;
-  hwloc_obj_t parent;
-  const char *devicesubdir;
+  char path[256], link[128], value[16];
+  unsigned domain, bus, dev, func;
+  const char *name;
+  int root_fd;
   int err;
 
-  if (osdev_flags & HWLOC_LINUXFS_OSDEV_FLAG_UNDER_BUS)
-    devicesubdir = "..";
-  else
-    devicesubdir = "device";
+  if (!pf || pf->type != HWLOC_OBJ_PCI_DEVICE) {
+    errno = EINVAL;
+    return -1;
+  }
+  root_fd = hwloc_linux_get_root_fd(topology);
 
-  err = hwloc_readlink(osdevpath, path, sizeof(path), root_fd);
+  snprintf(path, sizeof(path), "/sys/bus/pci/devices/%04x:%02x:%02x.%01x/virtfn%u",
+	   pf->attr->pcidev.domain, pf->attr->pcidev.bus,
+	   pf->attr->pcidev.dev, pf->attr->pcidev.func, idx);
+  err = hwloc_readlink(path, link, sizeof(link)-1, root_fd);
   if (err < 0) {
-    /* /sys/class/<class>/<name> is a directory instead of a symlink on old kernels (at least around 2.6.18 and 2.6.25).
-     * The link to parse can be found in /sys/class/<class>/<name>/device instead, at least for "/pci..."
-     */
-    char olddevpath[256];
-    snprintf(olddevpath, sizeof(olddevpath), "%s/device", osdevpath);
-    err = hwloc_readlink(olddevpath, path, sizeof(path), root_fd);
-    if (err < 0)
-      return NULL;
+    errno = ENOENT;
+    return -1;
   }
-  path[err] = '\0';
-
-  if (!(osdev_flags & HWLOC_LINUXFS_OSDEV_FLAG_FIND_VIRTUAL)) {
-    if (strstr(path, "/virtual/"))
-      return NULL;
+  link[err] = '\0';
+  name = strrchr(link, '/');
+  name = name ? name+1 : link;
+  if (sscanf(name, "%x:%02x:%02x.%01x", &domain, &bus, &dev, &func) != 4) {
+    errno = ENOENT;
+    return -1;
   }
 
-  if (!(osdev_flags & HWLOC_LINUXFS_OSDEV_FLAG_FIND_USB)) {
-    if (strstr(path, "/usb"))
-      return NULL;
+  memset(attr, 0, sizeof(*attr));
+  attr->domain = domain;
+  attr->bus = bus;
+  attr->dev = dev;
+  attr->func = func;
+
+  snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/vendor", name);
+  if (!hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    attr->vendor_id = strtoul(value, NULL, 16);
+  snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/device", name);
+  if (!hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    attr->device_id = strtoul(value, NULL, 16);
+  snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/class", name);
+  if (!hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    attr->class_id = strtoul(value, NULL, 16) >> 8;
+  snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/subsystem_vendor", name);
+  if (!hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    attr->subvendor_id = strtoul(value, NULL, 16);
+  snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/subsystem_device", name);
+  if (!hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    attr->subdevice_id = strtoul(value, NULL, 16);
+  snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/revision", name);
+  if (!hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    attr->revision = strtoul(value, NULL, 16);
+  /* VFs share the link of their PF */
+  attr->linkspeed = pf->attr->pcidev.linkspeed;
+
+  if (netdev && netdevlen) {
+    DIR *dir;
+    struct dirent *dirent;
+    netdev[0] = '\0';
+    snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/net", name);
+    dir = hwloc_opendir(path, root_fd);
+    if (dir) {
+      while ((dirent = readdir(dir)) != NULL) {
+	if (dirent->d_name[0] == '.')
+	  continue;
+	snprintf(netdev, netdevlen, "%s", dirent->d_name);
+	break;
+      }
+      closedir(dir);
+    }
   }
 
-  tmp = strstr(path, "/pci");
-  if (!tmp)
-    goto nopci;
-  tmp = strchr(tmp+4, '/');
-  if (!tmp)
-    goto nopci;
-  tmp++;
+  return 0;
+}
 
-  /* iterate through busid to find the last one (previous ones are bridges) */
-  foundpci = 0;
- nextpci:
-  /* tmp points to a PCI [domain:]bus:device.function */
-  if (sscanf(tmp, "%x:%x:%x.%x", &_pcidomain, &_pcibus, &_pcidev, &_pcifunc) == 4) {
-    foundpci = 1;
-    pcidomain = _pcidomain;
-    pcibus = _pcibus;
-    pcidev = _pcidev;
-    pcifunc = _pcifunc;
-    tmp = strchr(tmp+4, ':')+9; /* tmp points to at least 4 digits for domain, then a ':' */
-    goto nextpci;
+int
+hwloc_linux_get_net_queue_by_cpuset(hwloc_topology_t topology __hwloc_attribute_unused, hwloc_obj_t osdev,
+				    hwloc_const_cpuset_t set, unsigned *queue)
+{
+  hwloc_bitmap_t qset;
+  const char *value;
+  unsigned nr, i;
+  int best_included = 0, best_weight = 0, found = 0;
+
+  if (!osdev || osdev->type != HWLOC_OBJ_OS_DEVICE || osdev->attr->osdev.type != HWLOC_OBJ_OSDEV_NETWORK) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  value = hwloc_obj_get_info_by_name(osdev, "TXQueues");
+  nr = value ? (unsigned) strtoul(value, NULL, 10) : 0;
+  value = hwloc_obj_get_info_by_name(osdev, "RXQueues");
+  if (value && (unsigned) strtoul(value, NULL, 10) > nr)
+    nr = (unsigned) strtoul(value, NULL, 10);
+
+  qset = hwloc_bitmap_alloc();
+  if (!qset)
+    return -1;
+
+  for(i=0; i<nr; i++) {
+    char name[64];
+    int included, weight;
+
+    snprintf(name, sizeof(name), "TXQueue%uXPSCPUSet", i);
+    value = hwloc_obj_get_info_by_name(osdev, name);
+    if (!value) {
+      snprintf(name, sizeof(name), "Queue%uIRQCPUSet", i);
+      value = hwloc_obj_get_info_by_name(osdev, name);
+    }
+    if (!value || hwloc_bitmap_sscanf(qset, value) < 0)
+      continue;
+
+    included = hwloc_bitmap_isincluded(set, qset);
+    if (included) {
+      /* prefer the queue whose affinity is the closest to set */
+      weight = - hwloc_bitmap_weight(qset);
+    } else {
+      hwloc_bitmap_and(qset, qset, set);
+      weight = hwloc_bitmap_weight(qset);
+      if (!weight)
+	continue;
+    }
+
+    if (!found
+	|| (included && !best_included)
+	|| (included == best_included && weight > best_weight)) {
+      found = 1;
+      best_included = included;
+      best_weight = weight;
+      *queue = i;
+    }
+  }
+
+  hwloc_bitmap_free(qset);
+  if (!found) {
+    errno = ENOENT;
+    return -1;
+  }
+  return 0;
+}
+
+
+
+/**************************************************
+ ****** Linux resctrl cache/memory allocation *****
+ **************************************************/
+
+struct hwloc_linux_resctrl_mntpnt_s {
+  char *mntpnt;
+  int mba_mbps; /* memory bandwidth is given in MBps instead of percents */
+};
+
+static int
+hwloc_linux_resctrl_mntent_cb(struct mntent *mntent, void *_arg)
+{
+  struct hwloc_linux_resctrl_mntpnt_s *arg = _arg;
+  char *opt, *opts = mntent->mnt_opts;
+  hwloc_debug("Found resctrl mount point on %s\n", mntent->mnt_dir);
+  arg->mba_mbps = 0;
+  while ((opt = strsep(&opts, ",")) != NULL)
+    if (!strcmp(opt, "mba_MBps"))
+      arg->mba_mbps = 1;
+  arg->mntpnt = strdup(mntent->mnt_dir);
+  return 1;
+}
+
+/* return the Linux id of the cache of given level and type that contains the given CPU,
+ * resctrl domain ids are those cache ids.
+ */
+static int
+hwloc_linux_get_cache_id(int root_fd, unsigned cpu, unsigned level, hwloc_obj_cache_type_t ctype, unsigned *id)
+{
+  unsigned j;
+  for(j=0; j<10; j++) {
+    char path[128], str[20];
+    unsigned depth;
+    hwloc_obj_cache_type_t type = HWLOC_OBJ_CACHE_UNIFIED; /* default */
+
+    sprintf(path, "/sys/devices/system/cpu/cpu%u/cache/index%u/level", cpu, j);
+    if (hwloc_read_path_as_uint(path, &depth, root_fd) < 0)
+      continue;
+    if (depth != level)
+      continue;
+    sprintf(path, "/sys/devices/system/cpu/cpu%u/cache/index%u/type", cpu, j);
+    if (hwloc_read_path_by_length(path, str, sizeof(str), root_fd) == 0) {
+      if (!strncmp(str, "Data", 4))
+	type = HWLOC_OBJ_CACHE_DATA;
+      else if (!strncmp(str, "Instruction", 11))
+	type = HWLOC_OBJ_CACHE_INSTRUCTION;
+    }
+    if (type != ctype)
+      continue;
+    sprintf(path, "/sys/devices/system/cpu/cpu%u/cache/index%u/id", cpu, j);
+    return hwloc_read_path_as_uint(path, id, root_fd);
+  }
+  return -1;
+}
+
+/* Linux ids of the unified and data caches, read once before walking resctrl domains */
+struct hwloc_linux_cache_ids_s {
+  unsigned nr;
+  struct hwloc_linux_cache_id_s {
+    hwloc_obj_t cache;
+    unsigned level;
+    unsigned id;
+  } *caches;
+};
+
+static void
+hwloc_linux_read_cache_ids(struct hwloc_topology *topology, int root_fd, struct hwloc_linux_cache_ids_s *ids)
+{
+  hwloc_obj_type_t type;
+  unsigned allocated = 0;
+
+  ids->nr = 0;
+  ids->caches = NULL;
+
+  /* resctrl doesn't allocate instruction caches */
+  for(type = HWLOC_OBJ_L1CACHE; type <= HWLOC_OBJ_L5CACHE; type++) {
+    hwloc_obj_t cache = NULL;
+    while ((cache = hwloc_get_next_obj_by_type(topology, type, cache)) != NULL) {
+      int cpu = hwloc_bitmap_first(cache->cpuset);
+      unsigned id;
+      if (cpu < 0
+	  || hwloc_linux_get_cache_id(root_fd, (unsigned) cpu, cache->attr->cache.depth, cache->attr->cache.type, &id) < 0)
+	continue;
+      if (ids->nr == allocated) {
+	unsigned new_allocated = allocated ? 2*allocated : 16;
+	struct hwloc_linux_cache_id_s *tmp = realloc(ids->caches, new_allocated * sizeof(*tmp));
+	if (!tmp)
+	  return;
+	ids->caches = tmp;
+	allocated = new_allocated;
+      }
+      ids->caches[ids->nr].cache = cache;
+      ids->caches[ids->nr].level = cache->attr->cache.depth;
+      ids->caches[ids->nr].id = id;
+      ids->nr++;
+    }
+  }
+}
+
+/* find the unified or data cache objects of the given level whose Linux id is domain, and call fn on them */
+static void
+hwloc_linux_resctrl_foreach_cache(struct hwloc_linux_cache_ids_s *ids,
+				  unsigned level, unsigned domain,
+				  void (*fn)(hwloc_obj_t cache, void *arg), void *arg)
+{
+  unsigned i;
+  for(i=0; i<ids->nr; i++)
+    if (ids->caches[i].level == level && ids->caches[i].id == domain)
+      fn(ids->caches[i].cache, arg);
+}
+
+struct hwloc_linux_resctrl_cat_s {
+  unsigned long cbm;
+  unsigned total_ways;
+};
+
+static void
+hwloc_linux_resctrl_set_cat(hwloc_obj_t cache, void *_arg)
+{
+  struct hwloc_linux_resctrl_cat_s *arg = _arg;
+  char value[32];
+  unsigned ways = hwloc_weight_long(arg->cbm);
+
+  snprintf(value, sizeof(value), "%lx", arg->cbm);
+  hwloc_obj_add_info(cache, "ResctrlCBM", value);
+  snprintf(value, sizeof(value), "%u", ways);
+  hwloc_obj_add_info(cache, "ResctrlWays", value);
+  snprintf(value, sizeof(value), "%llu",
+	   (unsigned long long) (cache->attr->cache.size * ways / arg->total_ways));
+  hwloc_obj_add_info(cache, "ResctrlSize", value);
+}
+
+struct hwloc_linux_resctrl_mba_s {
+  const char *name;
+  unsigned long value;
+};
+
+static void
+hwloc_linux_resctrl_set_mba(hwloc_obj_t cache, void *_arg)
+{
+  struct hwloc_linux_resctrl_mba_s *arg = _arg;
+  char value[21];
+  snprintf(value, sizeof(value), "%lu", arg->value);
+  hwloc_obj_add_info(cache, arg->name, value);
+}
+
+/* annotate caches with the cache ways and memory bandwidth
+ * that resctrl (Intel RDT, AMD PQoS) allocates to the current process group
+ */
+static void
+hwloc_linuxfs_look_resctrl(struct hwloc_backend *backend)
+{
+  struct hwloc_linux_backend_data_s *data = backend->private_data;
+  struct hwloc_topology *topology = backend->topology;
+  int root_fd = data->root_fd;
+  struct hwloc_linux_resctrl_mntpnt_s mnt;
+  struct hwloc_linux_cache_ids_s cache_ids;
+  char *mntpnt, *schemata = NULL, *line, *next;
+  char group[256], path[512];
+  size_t size;
+  int mba_mbps;
+  int fd, err;
+
+  mnt.mntpnt = NULL;
+  mnt.mba_mbps = 0;
+  hwloc_linux_foreach_mntent(data->root_path, "resctrl", hwloc_linux_resctrl_mntent_cb, &mnt);
+  mntpnt = mnt.mntpnt;
+  mba_mbps = mnt.mba_mbps;
+  if (!mntpnt)
+    return;
+
+  /* find the resource group of the target process, or assume the default one if the kernel doesn't tell */
+  strcpy(group, "/");
+  if (!topology->pid)
+    err = hwloc_read_path_by_length("/proc/self/cpu_resctrl_groups", path, sizeof(path), root_fd);
+  else {
+    char pidpath[] = "/proc/XXXXXXXXXXX/cpu_resctrl_groups";
+    snprintf(pidpath, sizeof(pidpath), "/proc/%d/cpu_resctrl_groups", topology->pid);
+    err = hwloc_read_path_by_length(pidpath, path, sizeof(path), root_fd);
+  }
+  if (!err) {
+    char *res = strstr(path, "res:");
+    if (res) {
+      char *eol = strchr(res, '\n');
+      if (eol)
+	*eol = '\0';
+      if (res[4] == '/' && strlen(res+4) < sizeof(group))
+	strcpy(group, res+4);
+    }
+  }
+  hwloc_debug("Using resctrl group %s in %s\n", group, mntpnt);
+
+  snprintf(path, sizeof(path), "%s%s%sschemata", mntpnt, group, group[strlen(group)-1] == '/' ? "" : "/");
+  fd = hwloc_open(path, root_fd);
+  if (fd < 0)
+    goto out;
+  size = 4096;
+  err = hwloc__read_fd(fd, &schemata, &size);
+  close(fd);
+  if (err < 0)
+    goto out;
+
+  hwloc_obj_add_info(hwloc_get_root_obj(topology), "LinuxResctrlGroup", group);
+
+  hwloc_linux_read_cache_ids(topology, root_fd, &cache_ids);
+
+  /* lines are "<resource>:<domain>=<value>;<domain>=<value>..." */
+  for(line = schemata; line && *line; line = next) {
+    char *resource, *domains, *domain;
+    unsigned level;
+
+    next = strchr(line, '\n');
+    if (next)
+      *next++ = '\0';
+    while (*line == ' ' || *line == '\t')
+      line++;
+    domains = strchr(line, ':');
+    if (!domains)
+      continue;
+    *domains++ = '\0';
+    resource = line;
+
+    if (!strcmp(resource, "MB")) {
+      /* memory bandwidth allocation domains are L3 domains */
+      struct hwloc_linux_resctrl_mba_s arg;
+      arg.name = mba_mbps ? "ResctrlMBAMBps" : "ResctrlMBAPercent";
+      while ((domain = strsep(&domains, ";")) != NULL) {
+	char *value = strchr(domain, '=');
+	if (!value)
+	  continue;
+	*value++ = '\0';
+	/* the kernel pads values with spaces */
+	arg.value = strtoul(value, NULL, 10);
+	hwloc_linux_resctrl_foreach_cache(&cache_ids, 3, (unsigned) strtoul(domain, NULL, 10),
+					  hwloc_linux_resctrl_set_mba, &arg);
+      }
+
+    } else if (resource[0] == 'L' && sscanf(resource+1, "%u", &level) == 1) {
+      /* cache allocation, skip the code part when Code/Data Prioritization is enabled */
+      struct hwloc_linux_resctrl_cat_s arg;
+      char cbm_mask[32];
+      if (resource[2] && strcmp(resource+2, "DATA"))
+	continue;
+      snprintf(path, sizeof(path), "%s/info/%s/cbm_mask", mntpnt, resource);
+      if (hwloc_read_path_by_length(path, cbm_mask, sizeof(cbm_mask), root_fd) < 0)
+	continue;
+      arg.total_ways = hwloc_weight_long(strtoul(cbm_mask, NULL, 16));
+      if (!arg.total_ways)
+	continue;
+      while ((domain = strsep(&domains, ";")) != NULL) {
+	char *value = strchr(domain, '=');
+	if (!value)
+	  continue;
+	*value++ = '\0';
+	arg.cbm = strtoul(value, NULL, 16);
+	hwloc_linux_resctrl_foreach_cache(&cache_ids, level, (unsigned) strtoul(domain, NULL, 10),
+					  hwloc_linux_resctrl_set_cat, &arg);
+      }
+    }
+  }
+
+  free(cache_ids.caches);
+ out:
+  free(schemata);
+  free(mntpnt);
+}
+
+
+
+#ifdef HWLOC_HAVE_LINUXIO
+
+/***********************************
+ ******* Linux I/O discovery *******
+ ***********************************/
+
+#ifdef HWLOC_HAVE_LINUXPCI
+struct hwloc_linux_pci_busid_slot_s {
+  uint64_t busid; /* 0 if unused, otherwise domain:bus:dev.func+1 */
+  hwloc_obj_t obj; /* NULL for collapsed SR-IOV VFs */
+};
+
+struct hwloc_linux_pci_vf_record_s {
+  uint64_t pf, vf; /* busid hash keys */
+  unsigned domain, bus, dev, func; /* VF busid */
+};
+
+static __hwloc_inline uint64_t
+hwloc_linux_pci_busid_key(unsigned domain, unsigned bus, unsigned dev, unsigned func)
+{
+  return (((uint64_t) domain << 16) | (bus << 8) | (dev << 3) | func) + 1;
+}
+
+static __hwloc_inline unsigned
+hwloc_linux_pci_busid_hashfn(uint64_t key, unsigned size)
+{
+  /* Fibonacci hashing, size is a power of 2 */
+  return (unsigned) ((key * 0x9e3779b97f4a7c15ULL) >> 32) & (size-1);
+}
+
+static void
+hwloc_linux_pci_busid_hash_insert(struct hwloc_linux_backend_data_s *data, uint64_t key, hwloc_obj_t obj)
+{
+  unsigned i = hwloc_linux_pci_busid_hashfn(key, data->pci_busid_hash_size);
+  while (data->pci_busid_hash[i].busid && data->pci_busid_hash[i].busid != key)
+    i = (i+1) & (data->pci_busid_hash_size-1);
+  data->pci_busid_hash[i].busid = key;
+  data->pci_busid_hash[i].obj = obj;
+}
+
+static void
+hwloc_linux_pci_busid_hash_add_tree(struct hwloc_linux_backend_data_s *data, hwloc_obj_t obj)
+{
+  for( ; obj; obj = obj->next_sibling) {
+    if (obj->type == HWLOC_OBJ_PCI_DEVICE
+	|| (obj->type == HWLOC_OBJ_BRIDGE && obj->attr->bridge.upstream_type == HWLOC_OBJ_BRIDGE_PCI))
+      hwloc_linux_pci_busid_hash_insert(data,
+					hwloc_linux_pci_busid_key(obj->attr->pcidev.domain, obj->attr->pcidev.bus,
+								  obj->attr->pcidev.dev, obj->attr->pcidev.func),
+					obj);
+    hwloc_linux_pci_busid_hash_add_tree(data, obj->io_first_child);
+  }
+}
+
+/* Index all PCI objects of the tree by busid.
+ * Must be called before attaching because duplicates are removed during insertion
+ * and the tree is easy to walk before being spread below CPU objects.
+ * nr is the maximal number of busids that will be inserted.
+ */
+static void
+hwloc_linux_pci_busid_hash_build(struct hwloc_linux_backend_data_s *data, hwloc_obj_t tree, unsigned nr)
+{
+  unsigned size = 16;
+  while (size < 2*nr)
+    size *= 2;
+  data->pci_busid_hash = calloc(size, sizeof(*data->pci_busid_hash));
+  if (!data->pci_busid_hash)
+    return;
+  data->pci_busid_hash_size = size;
+  hwloc_linux_pci_busid_hash_add_tree(data, tree);
+}
+
+/* Returns the slot of a busid that we inserted (with a NULL object for collapsed SR-IOV VFs),
+ * or NULL if unknown.
+ */
+static struct hwloc_linux_pci_busid_slot_s *
+hwloc_linux_pci_busid_hash_find_key(struct hwloc_linux_backend_data_s *data, uint64_t key)
+{
+  unsigned i;
+
+  if (!data->pci_busid_hash_size)
+    return NULL;
+
+  i = hwloc_linux_pci_busid_hashfn(key, data->pci_busid_hash_size);
+  while (data->pci_busid_hash[i].busid) {
+    if (data->pci_busid_hash[i].busid == key)
+      return &data->pci_busid_hash[i];
+    i = (i+1) & (data->pci_busid_hash_size-1);
+  }
+  return NULL;
+}
+
+static __hwloc_inline struct hwloc_linux_pci_busid_slot_s *
+hwloc_linux_pci_busid_hash_find(struct hwloc_linux_backend_data_s *data,
+				unsigned domain, unsigned bus, unsigned dev, unsigned func)
+{
+  return hwloc_linux_pci_busid_hash_find_key(data, hwloc_linux_pci_busid_key(domain, bus, dev, func));
+}
+
+/* Returns 1 if the busid is a collapsed SR-IOV VF that couldn't be inserted in the hash.
+ * VF records are only kept for this linear search when the hash allocation failed.
+ */
+static int
+hwloc_linux_pci_busid_is_unhashed_vf(struct hwloc_linux_backend_data_s *data,
+				     unsigned domain, unsigned bus, unsigned dev, unsigned func)
+{
+  uint64_t key = hwloc_linux_pci_busid_key(domain, bus, dev, func);
+  unsigned i;
+  for(i=0; i<data->nr_pci_vf_records; i++)
+    if (data->pci_vf_records[i].vf == key)
+      return 1;
+  return 0;
+}
+#endif /* HWLOC_HAVE_LINUXPCI */
+
+#define HWLOC_LINUXFS_OSDEV_FLAG_FIND_VIRTUAL (1U<<0)
+#define HWLOC_LINUXFS_OSDEV_FLAG_FIND_USB (1U<<1)
+#define HWLOC_LINUXFS_OSDEV_FLAG_BLOCK_WITH_SECTORS (1U<<2)
+#define HWLOC_LINUXFS_OSDEV_FLAG_UNDER_BUS (1U<<31)
+
+static hwloc_obj_t
+hwloc_linuxfs_find_osdev_parent(struct hwloc_backend *backend, int root_fd,
+				const char *osdevpath, unsigned osdev_flags)
+{
+  struct hwloc_topology *topology = backend->topology;
+  char path[256], buf[10];
+  int fd;
+  int foundpci;
+  unsigned pcidomain = 0, pcibus = 0, pcidev = 0, pcifunc = 0;
+  unsigned _pcidomain, _pcibus, _pcidev, _pcifunc;
+  hwloc_bitmap_t cpuset;
+  const char *tmp;
+  hwloc_obj_t parent;
+  const char *devicesubdir;
+  int err;
+
+  if (osdev_flags & HWLOC_LINUXFS_OSDEV_FLAG_UNDER_BUS)
+    devicesubdir = "..";
+  else
+    devicesubdir = "device";
+
+  err = hwloc_readlink(osdevpath, path, sizeof(path), root_fd);
+  if (err < 0) {
+    /* /sys/class/<class>/<name> is a directory instead of a symlink on old kernels (at least around 2.6.18 and 2.6.25).
+     * The link to parse can be found in /sys/class/<class>/<name>/device instead, at least for "/pci..."
+     */
+    char olddevpath[256];
+    snprintf(olddevpath, sizeof(olddevpath), "%s/device", osdevpath);
+    err = hwloc_readlink(olddevpath, path, sizeof(path), root_fd);
+    if (err < 0)
+      return NULL;
+  }
+  path[err] = '\0';
+
+  if (!(osdev_flags & HWLOC_LINUXFS_OSDEV_FLAG_FIND_VIRTUAL)) {
+    if (strstr(path, "/virtual/"))
+      return NULL;
+  }
+
+  if (!(osdev_flags & HWLOC_LINUXFS_OSDEV_FLAG_FIND_USB)) {
+    if (strstr(path, "/usb"))
+      return NULL;
+  }
+
+  tmp = strstr(path, "/pci");
+  if (!tmp)
+    goto nopci;
+  tmp = strchr(tmp+4, '/');
+  if (!tmp)
+    goto nopci;
+  tmp++;
+
+  /* iterate through busid to find the last one (previous ones are bridges) */
+  foundpci = 0;
+ nextpci:
+  /* tmp points to a PCI [domain:]bus:device.function */
+  if (sscanf(tmp, "%x:%x:%x.%x", &_pcidomain, &_pcibus, &_pcidev, &_pcifunc) == 4) {
+    foundpci = 1;
+    pcidomain = _pcidomain;
+    pcibus = _pcibus;
+    pcidev = _pcidev;
+    pcifunc = _pcifunc;
+    tmp = strchr(tmp+4, ':')+9; /* tmp points to at least 4 digits for domain, then a ':' */
+    goto nextpci;
   }
   if (sscanf(tmp, "%x:%x.%x", &_pcibus, &_pcidev, &_pcifunc) == 3) {
     foundpci = 1;
@@ -5317,6 +6153,16 @@ hwloc_linuxfs_find_osdev_parent(struct hwloc_backend *backend, int root_fd,
   }
 
   if (foundpci) {
+#ifdef HWLOC_HAVE_LINUXPCI
+    /* fast path for PCI objects that we inserted ourself */
+    struct hwloc_linux_pci_busid_slot_s *slot;
+    slot = hwloc_linux_pci_busid_hash_find(backend->private_data, pcidomain, pcibus, pcidev, pcifunc);
+    if (slot)
+      /* OS devices of collapsed SR-IOV VFs are ignored */
+      return slot->obj;
+    if (hwloc_linux_pci_busid_is_unhashed_vf(backend->private_data, pcidomain, pcibus, pcidev, pcifunc))
+      return NULL;
+#endif
     /* attach to a PCI parent or to a normal (non-I/O) parent found by PCI affinity */
     parent = hwloc_pci_find_parent_by_busid(topology, pcidomain, pcibus, pcidev, pcifunc);
     if (parent)
@@ -5378,6 +6224,78 @@ hwloc_linux_add_os_device(struct hwloc_backend *backend, struct hwloc_obj *pcide
   return obj;
 }
 
+/* NVMe namespaces are named nvme<controller>n<namespace> */
+static void
+hwloc_linuxfs_block_nvme_fillinfos(int root_fd, struct hwloc_obj *obj, const char *osdevpath)
+{
+  char path[296]; /* osdevpath <= 256 */
+  char line[64];
+  unsigned ctrl, ns;
+  char *tmp;
+
+  if (sscanf(obj->name, "nvme%un%u", &ctrl, &ns) != 2)
+    return;
+
+  snprintf(line, sizeof(line), "nvme%u", ctrl);
+  hwloc_obj_add_info(obj, "NVMeController", line);
+
+  /* the namespace ID may differ from the index in the name, only trust sysfs */
+  snprintf(path, sizeof(path), "%s/nsid", osdevpath);
+  if (!hwloc_read_path_by_length(path, line, sizeof(line), root_fd)) {
+    tmp = strchr(line, '\n');
+    if (tmp)
+      *tmp = '\0';
+    hwloc_obj_add_info(obj, "NVMeNamespaceID", line);
+  }
+}
+
+/* blk-mq devices have one mq/<N> directory per hardware queue with the CPUs that submit to it */
+static void
+hwloc_linuxfs_block_mq_fillinfos(int root_fd, struct hwloc_obj *obj, const char *osdevpath)
+{
+  char path[296]; /* osdevpath <= 256 */
+  char name[32];
+  DIR *dir;
+  struct dirent *dirent;
+  hwloc_bitmap_t set;
+  unsigned nr = 0, i;
+
+  snprintf(path, sizeof(path), "%s/mq", osdevpath);
+  dir = hwloc_opendir(path, root_fd);
+  if (!dir)
+    return;
+  while ((dirent = readdir(dir)) != NULL) {
+    char *end;
+    unsigned long idx = strtoul(dirent->d_name, &end, 10);
+    if (end == dirent->d_name || *end)
+      continue;
+    if (idx+1 > nr)
+      nr = idx+1;
+  }
+  closedir(dir);
+  if (!nr)
+    return;
+
+  snprintf(name, sizeof(name), "%u", nr);
+  hwloc_obj_add_info(obj, "HWQueues", name);
+
+  set = hwloc_bitmap_alloc();
+  if (!set)
+    return;
+  for(i=0; i<nr; i++) {
+    char *setstr;
+    snprintf(path, sizeof(path), "%s/mq/%u/cpu_list", osdevpath, i);
+    if (hwloc__read_path_as_cpulist(path, set, root_fd) < 0)
+      continue;
+    if (hwloc_bitmap_asprintf(&setstr, set) < 0)
+      continue;
+    snprintf(name, sizeof(name), "HWQueue%uCPUSet", i);
+    hwloc_obj_add_info(obj, name, setstr);
+    free(setstr);
+  }
+  hwloc_bitmap_free(set);
+}
+
 static void
 hwloc_linuxfs_block_class_fillinfos(struct hwloc_backend *backend __hwloc_attribute_unused, int root_fd,
 				    struct hwloc_obj *obj, const char *osdevpath, unsigned osdev_flags)
@@ -5438,6 +6356,10 @@ hwloc_linuxfs_block_class_fillinfos(struct hwloc_backend *backend __hwloc_attrib
     hwloc_obj_add_info(obj, "SectorSize", line);
   }
 
+  if (!strncmp(obj->name, "nvme", 4))
+    hwloc_linuxfs_block_nvme_fillinfos(root_fd, obj, osdevpath);
+  hwloc_linuxfs_block_mq_fillinfos(root_fd, obj, osdevpath);
+
   snprintf(path, sizeof(path), "%s/dev", osdevpath);
   if (hwloc_read_path_by_length(path, line, sizeof(line), root_fd) < 0)
     goto done;
@@ -5684,13 +6606,203 @@ hwloc_linuxfs_lookup_dax_class(struct hwloc_backend *backend, unsigned osdev_fla
   return 0;
 }
 
+/* count queues/<prefix><N> directories of a network interface */
+static unsigned
+hwloc_linuxfs_net_count_queues(int root_fd, const char *osdevpath, const char *prefix)
+{
+  char path[296]; /* osdevpath <= 256 */
+  DIR *dir;
+  struct dirent *dirent;
+  size_t len = strlen(prefix);
+  unsigned nr = 0;
+
+  snprintf(path, sizeof(path), "%s/queues", osdevpath);
+  dir = hwloc_opendir(path, root_fd);
+  if (!dir)
+    return 0;
+  while ((dirent = readdir(dir)) != NULL) {
+    char *end;
+    unsigned long idx;
+    if (strncmp(dirent->d_name, prefix, len))
+      continue;
+    idx = strtoul(dirent->d_name+len, &end, 10);
+    if (end == dirent->d_name+len || *end)
+      continue;
+    if (idx+1 > nr)
+      nr = idx+1;
+  }
+  closedir(dir);
+  return nr;
+}
+
+/* add info <prefix><N><suffix> with the cpumask of queues/<dir><N>/<file> unless empty */
+static void
+hwloc_linuxfs_net_queue_cpumask_fillinfos(int root_fd, struct hwloc_obj *obj, const char *osdevpath,
+					  unsigned nr, const char *dir, const char *file,
+					  const char *prefix, const char *suffix)
+{
+  char path[320]; /* osdevpath <= 256 */
+  char name[64];
+  hwloc_bitmap_t set;
+  unsigned i;
+
+  set = hwloc_bitmap_alloc();
+  if (!set)
+    return;
+  for(i=0; i<nr; i++) {
+    char *setstr;
+    snprintf(path, sizeof(path), "%s/queues/%s%u/%s", osdevpath, dir, i, file);
+    /* RPS and XPS are disabled (zero) by default */
+    if (hwloc__read_path_as_cpumask(path, set, root_fd) < 0 || hwloc_bitmap_iszero(set))
+      continue;
+    if (hwloc_bitmap_asprintf(&setstr, set) < 0)
+      continue;
+    snprintf(name, sizeof(name), "%s%u%s", prefix, i, suffix);
+    hwloc_obj_add_info(obj, name, setstr);
+    free(setstr);
+  }
+  hwloc_bitmap_free(set);
+}
+
+/* IRQs whose action name ends with -<queue>, as listed in /proc/interrupts */
+struct hwloc_linux_irq_names_s {
+  char *buffer; /* contents of /proc/interrupts, names point inside */
+  unsigned nr;
+  struct hwloc_linux_irq_name_s {
+    unsigned long irq;
+    unsigned long queue;
+    const char *name; /* action name without its -<queue> suffix */
+  } *names;
+};
+
+/* parse /proc/interrupts once for all interfaces */
+static void
+hwloc_linuxfs_read_irq_names(int root_fd, struct hwloc_linux_irq_names_s *irqs)
+{
+  char *line, *eol;
+  unsigned allocated = 0;
+  size_t size = 65536;
+  int fd;
+
+  irqs->buffer = NULL;
+  irqs->nr = 0;
+  irqs->names = NULL;
+
+  fd = hwloc_open("/proc/interrupts", root_fd);
+  if (fd < 0)
+    return;
+  if (hwloc__read_fd(fd, &irqs->buffer, &size) < 0)
+    irqs->buffer = NULL;
+  close(fd);
+
+  for(line = irqs->buffer; line && *line; line = eol ? eol+1 : NULL) {
+    char *end, *action, *queue, *tmp;
+    unsigned long irq;
+
+    eol = strchr(line, '\n');
+    end = eol ? eol : line + strlen(line);
+
+    irq = strtoul(line, &tmp, 10);
+    if (tmp == line || *tmp != ':')
+      continue;
+
+    /* the action name is the last field of the line */
+    action = end;
+    while (action > tmp && action[-1] != ' ' && action[-1] != '\t')
+      action--;
+    if (action == end)
+      continue;
+
+    /* the queue number ends the action name */
+    queue = end;
+    while (queue > action && queue[-1] >= '0' && queue[-1] <= '9')
+      queue--;
+    if (queue == end || queue-1 <= action || queue[-1] != '-')
+      continue;
+
+    if (irqs->nr == allocated) {
+      unsigned newallocated = allocated ? 2*allocated : 64;
+      struct hwloc_linux_irq_name_s *tmpnames = realloc(irqs->names, newallocated * sizeof(*tmpnames));
+      if (!tmpnames)
+	break;
+      irqs->names = tmpnames;
+      allocated = newallocated;
+    }
+    irqs->names[irqs->nr].irq = irq;
+    irqs->names[irqs->nr].queue = strtoul(queue, NULL, 10);
+    irqs->names[irqs->nr].name = action;
+    irqs->nr++;
+    queue[-1] = '\0';
+  }
+}
+
+static void
+hwloc_linuxfs_free_irq_names(struct hwloc_linux_irq_names_s *irqs)
+{
+  free(irqs->names);
+  free(irqs->buffer);
+}
+
+/* find IRQs named <...-><ifname>-<...>-<queue>, and their affinity */
+static void
+hwloc_linuxfs_net_irqs_fillinfos(int root_fd, struct hwloc_obj *obj, const struct hwloc_linux_irq_names_s *irqs, unsigned nr)
+{
+  size_t namelen = strlen(obj->name);
+  char *found;
+  hwloc_bitmap_t set;
+  unsigned i;
+
+  found = calloc(nr, 1);
+  set = hwloc_bitmap_alloc();
+  if (!found || !set)
+    goto out;
+
+  for(i=0; i<irqs->nr; i++) {
+    const struct hwloc_linux_irq_name_s *irq = &irqs->names[i];
+    unsigned long idx = irq->queue;
+    const char *match;
+    char path[64], name[64], value[21];
+    char *setstr;
+
+    if (idx >= nr || found[idx])
+      continue;
+
+    /* the interface name must be a whole dash-separated component */
+    for(match = irq->name; (match = strstr(match, obj->name)) != NULL; match++)
+      if ((match == irq->name || match[-1] == '-')
+	  && (match[namelen] == '-' || match[namelen] == '\0'))
+	break;
+    if (!match)
+      continue;
+
+    found[idx] = 1;
+    snprintf(name, sizeof(name), "Queue%luIRQ", idx);
+    snprintf(value, sizeof(value), "%lu", irq->irq);
+    hwloc_obj_add_info(obj, name, value);
+    snprintf(path, sizeof(path), "/proc/irq/%lu/smp_affinity", irq->irq);
+    if (!hwloc__read_path_as_cpumask(path, set, root_fd)
+	&& !hwloc_bitmap_iszero(set)
+	&& hwloc_bitmap_asprintf(&setstr, set) >= 0) {
+      snprintf(name, sizeof(name), "Queue%luIRQCPUSet", idx);
+      hwloc_obj_add_info(obj, name, setstr);
+      free(setstr);
+    }
+  }
+
+ out:
+  hwloc_bitmap_free(set);
+  free(found);
+}
+
 static void
 hwloc_linuxfs_net_class_fillinfos(int root_fd,
-				  struct hwloc_obj *obj, const char *osdevpath)
+				  struct hwloc_obj *obj, const char *osdevpath,
+				  const struct hwloc_linux_irq_names_s *irqs)
 {
   struct stat st;
   char path[296]; /* osdevpath <= 256 */
   char address[128];
+  unsigned nr_rx, nr_tx;
   int err;
   snprintf(path, sizeof(path), "%s/address", osdevpath);
   if (!hwloc_read_path_by_length(path, address, sizeof(address), root_fd)) {
@@ -5720,6 +6832,21 @@ hwloc_linuxfs_net_class_fillinfos(int root_fd,
       }
     }
   }
+
+  nr_rx = hwloc_linuxfs_net_count_queues(root_fd, osdevpath, "rx-");
+  nr_tx = hwloc_linuxfs_net_count_queues(root_fd, osdevpath, "tx-");
+  if (nr_rx) {
+    snprintf(address, sizeof(address), "%u", nr_rx);
+    hwloc_obj_add_info(obj, "RXQueues", address);
+  }
+  if (nr_tx) {
+    snprintf(address, sizeof(address), "%u", nr_tx);
+    hwloc_obj_add_info(obj, "TXQueues", address);
+  }
+  hwloc_linuxfs_net_queue_cpumask_fillinfos(root_fd, obj, osdevpath, nr_rx, "rx-", "rps_cpus", "RXQueue", "RPSCPUSet");
+  hwloc_linuxfs_net_queue_cpumask_fillinfos(root_fd, obj, osdevpath, nr_tx, "tx-", "xps_cpus", "TXQueue", "XPSCPUSet");
+  if (irqs->nr && (nr_rx || nr_tx))
+    hwloc_linuxfs_net_irqs_fillinfos(root_fd, obj, irqs, nr_rx > nr_tx ? nr_rx : nr_tx);
 }
 
 static int
@@ -5729,11 +6856,15 @@ hwloc_linuxfs_lookup_net_class(struct hwloc_backend *backend, unsigned osdev_fla
   int root_fd = data->root_fd;
   DIR *dir;
   struct dirent *dirent;
+  struct hwloc_linux_irq_names_s irqs;
 
   dir = hwloc_opendir("/sys/class/net", root_fd);
   if (!dir)
     return 0;
 
+  /* queue IRQs are found by name */
+  hwloc_linuxfs_read_irq_names(root_fd, &irqs);
+
   while ((dirent = readdir(dir)) != NULL) {
     char path[256];
     hwloc_obj_t obj, parent;
@@ -5751,10 +6882,11 @@ hwloc_linuxfs_lookup_net_class(struct hwloc_backend *backend, unsigned osdev_fla
 
     obj = hwloc_linux_add_os_device(backend, parent, HWLOC_OBJ_OSDEV_NETWORK, dirent->d_name);
 
-    hwloc_linuxfs_net_class_fillinfos(root_fd, obj, path);
+    hwloc_linuxfs_net_class_fillinfos(root_fd, obj, path, &irqs);
   }
 
   closedir(dir);
+  hwloc_linuxfs_free_irq_names(&irqs);
 
   return 0;
 }
@@ -6157,16 +7289,99 @@ hwloc__get_firmware_dmi_memory_info(struct hwloc_topology *topology,
 #define HWLOC_PCI_CAP_ID_EXP 0x10
 #define HWLOC_PCI_CLASS_NOT_DEFINED 0x0000
 
+/* Open a device directory found in an opened sysfs directory,
+ * so that its attribute files may be read without resolving the entire path again.
+ * Returns -1 if openat() isn't available, callers must use full paths then.
+ */
 static int
-hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
+hwloc_linux_open_devdir(DIR *dir __hwloc_attribute_unused, const char *name __hwloc_attribute_unused)
+{
+#ifdef HAVE_OPENAT
+  return openat(dirfd(dir), name, O_RDONLY | O_DIRECTORY);
+#else
+  return -1;
+#endif
+}
+
+static int
+hwloc_linux_open_devattr(int dev_fd, const char *devpath, const char *attrname, int root_fd)
+{
+  char path[128];
+  int err;
+#ifdef HAVE_OPENAT
+  if (dev_fd >= 0)
+    return openat(dev_fd, attrname, O_RDONLY);
+#endif
+  err = snprintf(path, sizeof(path), "%s/%s", devpath, attrname);
+  if ((size_t) err >= sizeof(path))
+    return -1;
+  return hwloc_open(path, root_fd);
+}
+
+static int
+hwloc_linux_read_devattr(int dev_fd, const char *devpath, const char *attrname,
+			 char *string, size_t length, int root_fd)
+{
+  int fd, ret;
+
+  fd = hwloc_linux_open_devattr(dev_fd, devpath, attrname, root_fd);
+  if (fd < 0)
+    return -1;
+
+  ret = read(fd, string, length-1); /* read -1 to put the ending \0 */
+  close(fd);
+
+  if (ret <= 0)
+    return -1;
+
+  string[ret] = 0;
+
+  return 0;
+}
+
+static int
+hwloc_linux_readlink_devattr(int dev_fd, const char *devpath, const char *attrname,
+			     char *buf, size_t buflen, int root_fd)
+{
+  char path[128];
+  int err;
+#ifdef HAVE_OPENAT
+  if (dev_fd >= 0)
+    return readlinkat(dev_fd, attrname, buf, buflen);
+#endif
+  err = snprintf(path, sizeof(path), "%s/%s", devpath, attrname);
+  if ((size_t) err >= sizeof(path))
+    return -1;
+  return hwloc_readlink(path, buf, buflen, root_fd);
+}
+
+struct hwloc_linux_pci_record_s {
+  hwloc_obj_type_t type;
+  struct hwloc_pcidev_attr_s attr;
+  unsigned secondary_bus, subordinate_bus; /* only for bridges */
+};
+
+/* Read PCI devices from sysfs without touching the topology.
+ * May run on a helper thread during the CPU and MEMORY phases.
+ */
+static int
+hwloc_linuxfs_pci_gather_pcidevices(struct hwloc_backend *backend)
 {
   struct hwloc_linux_backend_data_s *data = backend->private_data;
   struct hwloc_topology *topology = backend->topology;
-  hwloc_obj_t tree = NULL;
+  struct hwloc_linux_pci_record_s *records = NULL;
+  unsigned nr_records = 0, max_records = 0;
+  struct hwloc_linux_pci_vf_record_s *vf_records = NULL;
+  unsigned nr_vf_records = 0, max_vf_records = 0;
+  int collapse_vfs = !!(topology->flags & HWLOC_TOPOLOGY_FLAG_COLLAPSE_PCI_VFS);
+  enum hwloc_type_filter_e pfilter, bfilter;
   int root_fd = data->root_fd;
   DIR *dir;
   struct dirent *dirent;
 
+  hwloc_topology_get_type_filter(topology, HWLOC_OBJ_PCI_DEVICE, &pfilter);
+  hwloc_topology_get_type_filter(topology, HWLOC_OBJ_BRIDGE, &bfilter);
+
   /* We could lookup /sys/devices/pci.../.../busid1/.../busid2 recursively
    * to build the hierarchy of bridges/devices directly.
    * But that would require readdirs in all bridge sysfs subdirectories.
@@ -6175,7 +7390,7 @@ hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
    */
   dir = hwloc_opendir("/sys/bus/pci/devices/", root_fd);
   if (!dir)
-    return 0;
+    goto out;
 
   while ((dirent = readdir(dir)) != NULL) {
 #define CONFIG_SPACE_CACHESIZE 256
@@ -6184,13 +7399,13 @@ hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
     unsigned secondary_bus, subordinate_bus;
     unsigned short class_id;
     hwloc_obj_type_t type;
-    hwloc_obj_t obj;
+    struct hwloc_linux_pci_record_s *record;
     struct hwloc_pcidev_attr_s *attr;
     unsigned offset;
-    char path[64];
+    char devpath[64];
     char value[16];
     size_t ret;
-    int fd, err;
+    int dev_fd, fd, err;
 
     if (sscanf(dirent->d_name, "%x:%02x:%02x.%01x", &domain, &bus, &dev, &func) != 4)
       continue;
@@ -6205,23 +7420,24 @@ hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
     }
 #endif
 
+    err = snprintf(devpath, sizeof(devpath), "/sys/bus/pci/devices/%s", dirent->d_name);
+    if ((size_t) err >= sizeof(devpath))
+      continue;
+    /* read all attribute files relative to the device directory */
+    dev_fd = hwloc_linux_open_devdir(dir, dirent->d_name);
+
     /* initialize the config space in case we fail to read it (missing permissions, etc). */
     memset(config_space_cache, 0xff, CONFIG_SPACE_CACHESIZE);
-    err = snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/config", dirent->d_name);
-    if ((size_t) err < sizeof(path)) {
-      /* don't use hwloc_read_path_by_length() because we don't want the ending \0 */
-      fd = hwloc_open(path, root_fd);
-      if (fd >= 0) {
-	ret = read(fd, config_space_cache, CONFIG_SPACE_CACHESIZE);
-	(void) ret; /* we initialized config_space_cache in case we don't read enough, ignore the read length */
-	close(fd);
-      }
+    /* don't use hwloc_read_path_by_length() because we don't want the ending \0 */
+    fd = hwloc_linux_open_devattr(dev_fd, devpath, "config", root_fd);
+    if (fd >= 0) {
+      ret = read(fd, config_space_cache, CONFIG_SPACE_CACHESIZE);
+      (void) ret; /* we initialized config_space_cache in case we don't read enough, ignore the read length */
+      close(fd);
     }
 
     class_id = HWLOC_PCI_CLASS_NOT_DEFINED;
-    err = snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/class", dirent->d_name);
-    if ((size_t) err < sizeof(path)
-	&& !hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    if (!hwloc_linux_read_devattr(dev_fd, devpath, "class", value, sizeof(value), root_fd))
       class_id = strtoul(value, NULL, 16) >> 8;
 
     type = hwloc_pcidisc_check_bridge_type(class_id, config_space_cache);
@@ -6233,30 +7449,67 @@ hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
       if (hwloc_pcidisc_find_bridge_buses(domain, bus, dev, func,
 					  &secondary_bus, &subordinate_bus,
 					  config_space_cache) < 0)
-	continue;
+	goto next;
+    }
+
+    /* SR-IOV VF to collapse into its PF? */
+    if (collapse_vfs && type == HWLOC_OBJ_PCI_DEVICE) {
+      char link[128];
+      unsigned pfdomain, pfbus, pfdev, pffunc;
+      const char *pfname;
+      err = hwloc_linux_readlink_devattr(dev_fd, devpath, "physfn", link, sizeof(link)-1, root_fd);
+      if (err > 0) {
+	link[err] = '\0';
+	pfname = strrchr(link, '/');
+	pfname = pfname ? pfname+1 : link;
+	if (sscanf(pfname, "%x:%02x:%02x.%01x", &pfdomain, &pfbus, &pfdev, &pffunc) == 4) {
+	  if (nr_vf_records == max_vf_records) {
+	    unsigned new_max = max_vf_records ? 2*max_vf_records : 64;
+	    struct hwloc_linux_pci_vf_record_s *tmp = realloc(vf_records, new_max * sizeof(*vf_records));
+	    if (!tmp)
+	      goto next;
+	    vf_records = tmp;
+	    max_vf_records = new_max;
+	  }
+	  vf_records[nr_vf_records].pf = hwloc_linux_pci_busid_key(pfdomain, pfbus, pfdev, pffunc);
+	  vf_records[nr_vf_records].vf = hwloc_linux_pci_busid_key(domain, bus, dev, func);
+	  vf_records[nr_vf_records].domain = domain;
+	  vf_records[nr_vf_records].bus = bus;
+	  vf_records[nr_vf_records].dev = dev;
+	  vf_records[nr_vf_records].func = func;
+	  nr_vf_records++;
+	  goto next;
+	}
+      }
     }
 
     /* filtered? */
     if (type == HWLOC_OBJ_PCI_DEVICE) {
-      enum hwloc_type_filter_e filter;
-      hwloc_topology_get_type_filter(topology, HWLOC_OBJ_PCI_DEVICE, &filter);
-      if (filter == HWLOC_TYPE_FILTER_KEEP_NONE)
-	continue;
-      if (filter == HWLOC_TYPE_FILTER_KEEP_IMPORTANT
+      if (pfilter == HWLOC_TYPE_FILTER_KEEP_NONE)
+	goto next;
+      if (pfilter == HWLOC_TYPE_FILTER_KEEP_IMPORTANT
 	  && !hwloc_filter_check_pcidev_subtype_important(class_id))
-	continue;
+	goto next;
     } else if (type == HWLOC_OBJ_BRIDGE) {
-      enum hwloc_type_filter_e filter;
-      hwloc_topology_get_type_filter(topology, HWLOC_OBJ_BRIDGE, &filter);
-      if (filter == HWLOC_TYPE_FILTER_KEEP_NONE)
-	continue;
+      if (bfilter == HWLOC_TYPE_FILTER_KEEP_NONE)
+	goto next;
       /* HWLOC_TYPE_FILTER_KEEP_IMPORTANT filtered later in the core */
     }
 
-    obj = hwloc_alloc_setup_object(topology, type, HWLOC_UNKNOWN_INDEX);
-    if (!obj)
-      break;
-    attr = &obj->attr->pcidev;
+    if (nr_records == max_records) {
+      unsigned new_max = max_records ? 2*max_records : 64;
+      struct hwloc_linux_pci_record_s *tmp = realloc(records, new_max * sizeof(*records));
+      if (!tmp) {
+	if (dev_fd >= 0)
+	  close(dev_fd);
+	break;
+      }
+      records = tmp;
+      max_records = new_max;
+    }
+    record = &records[nr_records];
+    record->type = type;
+    attr = &record->attr;
 
     attr->domain = domain;
     attr->bus = bus;
@@ -6265,12 +7518,8 @@ hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
 
     /* bridge specific attributes */
     if (type == HWLOC_OBJ_BRIDGE) {
-      struct hwloc_bridge_attr_s *battr = &obj->attr->bridge;
-      battr->upstream_type = HWLOC_OBJ_BRIDGE_PCI;
-      battr->downstream_type = HWLOC_OBJ_BRIDGE_PCI;
-      battr->downstream.pci.domain = domain;
-      battr->downstream.pci.secondary_bus = secondary_bus;
-      battr->downstream.pci.subordinate_bus = subordinate_bus;
+      record->secondary_bus = secondary_bus;
+      record->subordinate_bus = subordinate_bus;
     }
 
     /* default (unknown) values */
@@ -6282,24 +7531,16 @@ hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
     attr->subdevice_id = 0;
     attr->linkspeed = 0;
 
-    err = snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/vendor", dirent->d_name);
-    if ((size_t) err < sizeof(path)
-	&& !hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    if (!hwloc_linux_read_devattr(dev_fd, devpath, "vendor", value, sizeof(value), root_fd))
       attr->vendor_id = strtoul(value, NULL, 16);
 
-    err = snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/device", dirent->d_name);
-    if ((size_t) err < sizeof(path)
-	&& !hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    if (!hwloc_linux_read_devattr(dev_fd, devpath, "device", value, sizeof(value), root_fd))
       attr->device_id = strtoul(value, NULL, 16);
 
-    err = snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/subsystem_vendor", dirent->d_name);
-    if ((size_t) err < sizeof(path)
-	&& !hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    if (!hwloc_linux_read_devattr(dev_fd, devpath, "subsystem_vendor", value, sizeof(value), root_fd))
       attr->subvendor_id = strtoul(value, NULL, 16);
 
-    err = snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/subsystem_device", dirent->d_name);
-    if ((size_t) err < sizeof(path)
-	&& !hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+    if (!hwloc_linux_read_devattr(dev_fd, devpath, "subsystem_device", value, sizeof(value), root_fd))
       attr->subdevice_id = strtoul(value, NULL, 16);
 
     /* get the revision */
@@ -6313,22 +7554,153 @@ hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
       /* if not available from config-space (extended part is root-only), look in sysfs files added in 4.13 */
       float speed = 0.f;
       unsigned width = 0;
-      err = snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/current_link_speed", dirent->d_name);
-      if ((size_t) err < sizeof(path)
-	  && !hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+      if (!hwloc_linux_read_devattr(dev_fd, devpath, "current_link_speed", value, sizeof(value), root_fd))
 	speed = hwloc_linux_pci_link_speed_from_string(value);
-      err = snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/current_link_width", dirent->d_name);
-      if ((size_t) err < sizeof(path)
-	  && !hwloc_read_path_by_length(path, value, sizeof(value), root_fd))
+      if (!hwloc_linux_read_devattr(dev_fd, devpath, "current_link_width", value, sizeof(value), root_fd))
 	width = atoi(value);
       attr->linkspeed = speed*width/8;
     }
 
-    hwloc_pcidisc_tree_insert_by_busid(&tree, obj);
+    nr_records++;
+
+  next:
+    if (dev_fd >= 0)
+      close(dev_fd);
   }
 
   closedir(dir);
 
+ out:
+  data->pci_records = records;
+  data->nr_pci_records = nr_records;
+  data->pci_vf_records = vf_records;
+  data->nr_pci_vf_records = nr_vf_records;
+  data->pci_gathered = 1;
+  return 0;
+}
+
+static int
+hwloc_linux_pci_vf_record_compare(const void *_a, const void *_b)
+{
+  const struct hwloc_linux_pci_vf_record_s *a = _a, *b = _b;
+  if (a->pf != b->pf)
+    return a->pf < b->pf ? -1 : 1;
+  if (a->vf != b->vf)
+    return a->vf < b->vf ? -1 : 1;
+  return 0;
+}
+
+/* Find a PCI object of the not-yet-attached tree by busid, when the hash isn't available */
+static hwloc_obj_t
+hwloc_linux_pci_tree_find_key(hwloc_obj_t obj, uint64_t key)
+{
+  for( ; obj; obj = obj->next_sibling) {
+    hwloc_obj_t found;
+    if ((obj->type == HWLOC_OBJ_PCI_DEVICE
+	 || (obj->type == HWLOC_OBJ_BRIDGE && obj->attr->bridge.upstream_type == HWLOC_OBJ_BRIDGE_PCI))
+	&& hwloc_linux_pci_busid_key(obj->attr->pcidev.domain, obj->attr->pcidev.bus,
+				     obj->attr->pcidev.dev, obj->attr->pcidev.func) == key)
+      return obj;
+    found = hwloc_linux_pci_tree_find_key(obj->io_first_child, key);
+    if (found)
+      return found;
+  }
+  return NULL;
+}
+
+/* Summarize gathered SR-IOV VFs in their PF object,
+ * and mark their busids so that their OS devices are ignored.
+ * Without the busid hash, PFs are searched in the tree,
+ * and VF records are kept for hwloc_linux_pci_busid_is_unhashed_vf().
+ */
+static void
+hwloc_linux_pci_collapse_vfs(struct hwloc_linux_backend_data_s *data, hwloc_obj_t tree)
+{
+  struct hwloc_linux_pci_vf_record_s *records = data->pci_vf_records;
+  unsigned nr = data->nr_pci_vf_records;
+  unsigned i, j;
+
+  if (!nr)
+    return;
+
+  qsort(records, nr, sizeof(*records), hwloc_linux_pci_vf_record_compare);
+
+  for(i=0; i<nr; i=j) {
+    struct hwloc_linux_pci_busid_slot_s *slot;
+    hwloc_obj_t pf = NULL;
+
+    for(j=i; j<nr && records[j].pf == records[i].pf; j++);
+
+    /* find the PF before inserting VF keys */
+    if (data->pci_busid_hash_size) {
+      slot = hwloc_linux_pci_busid_hash_find_key(data, records[i].pf);
+      if (slot)
+	pf = slot->obj;
+    } else {
+      pf = hwloc_linux_pci_tree_find_key(tree, records[i].pf);
+    }
+
+    if (pf) {
+      char tmp[64];
+      snprintf(tmp, sizeof(tmp), "%u", j-i);
+      hwloc_obj_add_info(pf, "SRIOVCollapsedVFs", tmp);
+      snprintf(tmp, sizeof(tmp), "%04x:%02x:%02x.%01x-%04x:%02x:%02x.%01x",
+	       records[i].domain, records[i].bus, records[i].dev, records[i].func,
+	       records[j-1].domain, records[j-1].bus, records[j-1].dev, records[j-1].func);
+      hwloc_obj_add_info(pf, "SRIOVVFBusIDs", tmp);
+    }
+  }
+
+  if (data->pci_busid_hash_size) {
+    for(i=0; i<nr; i++)
+      hwloc_linux_pci_busid_hash_insert(data, records[i].vf, NULL);
+    free(data->pci_vf_records);
+    data->pci_vf_records = NULL;
+    data->nr_pci_vf_records = 0;
+  }
+}
+
+static int
+hwloc_linuxfs_pci_look_pcidevices(struct hwloc_backend *backend)
+{
+  struct hwloc_linux_backend_data_s *data = backend->private_data;
+  struct hwloc_topology *topology = backend->topology;
+  hwloc_obj_t tree = NULL;
+  unsigned i;
+
+  /* gather now if it wasn't done on a helper thread earlier */
+  if (!data->pci_gathered)
+    hwloc_linuxfs_pci_gather_pcidevices(backend);
+
+  for(i=0; i<data->nr_pci_records; i++) {
+    struct hwloc_linux_pci_record_s *record = &data->pci_records[i];
+    hwloc_obj_t obj;
+
+    obj = hwloc_alloc_setup_object(topology, record->type, HWLOC_UNKNOWN_INDEX);
+    if (!obj)
+      break;
+    obj->attr->pcidev = record->attr;
+
+    /* bridge specific attributes */
+    if (record->type == HWLOC_OBJ_BRIDGE) {
+      struct hwloc_bridge_attr_s *battr = &obj->attr->bridge;
+      battr->upstream_type = HWLOC_OBJ_BRIDGE_PCI;
+      battr->downstream_type = HWLOC_OBJ_BRIDGE_PCI;
+      battr->downstream.pci.domain = record->attr.domain;
+      battr->downstream.pci.secondary_bus = record->secondary_bus;
+      battr->downstream.pci.subordinate_bus = record->subordinate_bus;
+    }
+
+    hwloc_pcidisc_tree_insert_by_busid(&tree, obj);
+  }
+
+  hwloc_linux_pci_busid_hash_build(data, tree, data->nr_pci_records + data->nr_pci_vf_records);
+  hwloc_linux_pci_collapse_vfs(data, tree);
+
+  free(data->pci_records);
+  data->pci_records = NULL;
+  data->nr_pci_records = 0;
+
   hwloc_pcidisc_tree_attach(backend->topology, tree);
   return 0;
 }
@@ -6357,7 +7729,10 @@ hwloc_linuxfs_pci_look_pcislots(struct hwloc_backend *backend)
 	  && !hwloc_read_path_by_length(path, buf, sizeof(buf), root_fd)
 	  && sscanf(buf, "%x:%x:%x", &domain, &bus, &dev) == 3) {
 	/* may also be %x:%x without a device number but that's only for hotplug when nothing is plugged, ignore those */
-	hwloc_obj_t obj = hwloc_pci_find_by_busid(topology, domain, bus, dev, 0);
+	struct hwloc_linux_pci_busid_slot_s *slot = hwloc_linux_pci_busid_hash_find(data, domain, bus, dev, 0);
+	hwloc_obj_t obj = slot ? slot->obj : NULL;
+	if (!obj)
+	  obj = hwloc_pci_find_by_busid(topology, domain, bus, dev, 0);
 	/* obj may be higher in the hierarchy that requested (if that exact bus didn't exist),
 	 * we'll check below whether the bus ID is correct.
 	 */
@@ -6384,9 +7759,54 @@ hwloc_linuxfs_pci_look_pcislots(struct hwloc_backend *backend)
 
   return 0;
 }
+
+/* link CXL PCI devices back to the NUMA nodes that expose their memory */
+static int
+hwloc_linuxfs_pci_look_cxl_memory(struct hwloc_backend *backend)
+{
+  struct hwloc_topology *topology = backend->topology;
+  hwloc_obj_t node = NULL;
+
+  while ((node = hwloc_get_next_obj_by_type(topology, HWLOC_OBJ_NUMANODE, node)) != NULL) {
+    char nodestr[11];
+    unsigned i;
+
+    snprintf(nodestr, sizeof(nodestr), "%u", node->os_index);
+    for(i=0; i<node->infos_count; i++) {
+      struct hwloc_info_s *info = &node->infos[i];
+      unsigned domain, bus, dev, func;
+      hwloc_obj_t obj;
+
+      if (strcmp(info->name, "CXLDevice")
+	  || sscanf(info->value, "%x:%x:%x.%x", &domain, &bus, &dev, &func) != 4)
+	continue;
+      obj = hwloc_pci_find_by_busid(topology, domain, bus, dev, func);
+      if (!obj || obj->type != HWLOC_OBJ_PCI_DEVICE
+	  || obj->attr->pcidev.domain != domain
+	  || obj->attr->pcidev.bus != bus
+	  || obj->attr->pcidev.dev != dev
+	  || obj->attr->pcidev.func != func)
+	continue;
+
+      hwloc_obj_add_info(obj, "CXLNUMANode", nodestr);
+    }
+  }
+
+  return 0;
+}
 #endif /* HWLOC_HAVE_LINUXPCI */
 #endif /* HWLOC_HAVE_LINUXIO */
 
+#ifdef HWLOC_HAVE_LINUXPCI
+static int
+hwloc_linux_backend_gather(struct hwloc_backend *backend, unsigned phases)
+{
+  if (phases & HWLOC_DISC_PHASE_PCI)
+    hwloc_linuxfs_pci_gather_pcidevices(backend);
+  return 0;
+}
+#endif /* HWLOC_HAVE_LINUXPCI */
+
 static int
 hwloc_look_linuxfs(struct hwloc_backend *backend, struct hwloc_disc_status *dstatus)
 {
@@ -6405,6 +7825,9 @@ hwloc_look_linuxfs(struct hwloc_backend *backend, struct hwloc_disc_status *dsta
     return 0;
   }
 
+  if (dstatus->phase == HWLOC_DISC_PHASE_ANNOTATE)
+    hwloc_linuxfs_look_resctrl(backend);
+
 #ifdef HWLOC_HAVE_LINUXIO
   hwloc_topology_get_type_filter(topology, HWLOC_OBJ_PCI_DEVICE, &pfilter);
   hwloc_topology_get_type_filter(topology, HWLOC_OBJ_BRIDGE, &bfilter);
@@ -6426,6 +7849,7 @@ hwloc_look_linuxfs(struct hwloc_backend *backend, struct hwloc_disc_status *dsta
 	  || pfilter != HWLOC_TYPE_FILTER_KEEP_NONE)) {
 #ifdef HWLOC_HAVE_LINUXPCI
     hwloc_linuxfs_pci_look_pcislots(backend);
+    hwloc_linuxfs_pci_look_cxl_memory(backend);
 #endif /* HWLOC_HAVE_LINUXPCI */
   }
 
@@ -6473,6 +7897,12 @@ hwloc_linux_backend_disable(struct hwloc_backend *backend)
 #ifdef HWLOC_HAVE_LIBUDEV
   if (data->udev)
     udev_unref(data->udev);
+#endif
+#ifdef HWLOC_HAVE_LINUXPCI
+  /* gathered but the PCI phase didn't run */
+  free(data->pci_records);
+  free(data->pci_vf_records);
+  free(data->pci_busid_hash);
 #endif
   free(data);
 }
@@ -6505,6 +7935,11 @@ hwloc_linux_component_instantiate(struct hwloc_topology *topology,
   backend->discover = hwloc_look_linuxfs;
   backend->get_pci_busid_cpuset = hwloc_linux_backend_get_pci_busid_cpuset;
   backend->disable = hwloc_linux_backend_disable;
+#ifdef HWLOC_HAVE_LINUXPCI
+  /* reading PCI devices from sysfs doesn't need CPU objects */
+  backend->gather_phases = HWLOC_DISC_PHASE_PCI & backend->phases;
+  backend->gather = hwloc_linux_backend_gather;
+#endif
 
   /* default values */
   data->arch = HWLOC_LINUX_ARCH_UNKNOWN;
@@ -6512,6 +7947,15 @@ hwloc_linux_component_instantiate(struct hwloc_topology *topology,
   data->is_amd_with_CU = 0;
   data->is_real_fsroot = 1;
   data->root_path = NULL;
+#ifdef HWLOC_HAVE_LINUXPCI
+  data->pci_gathered = 0;
+  data->nr_pci_records = 0;
+  data->pci_records = NULL;
+  data->nr_pci_vf_records = 0;
+  data->pci_vf_records = NULL;
+  data->pci_busid_hash_size = 0;
+  data->pci_busid_hash = NULL;
+#endif
   fsroot_path = getenv("HWLOC_FSROOT");
   if (!fsroot_path)
     fsroot_path = "/";
@@ -52,6 +52,11 @@
 #include <windows.h>
 #endif
 
+#ifdef HWLOC_HAVE_PTHREAD_CREATE
+#include <pthread.h>
+#include <signal.h>
+#endif
+
 unsigned hwloc_get_api_version(void)
 {
   return HWLOC_API_VERSION;
@@ -489,11 +494,7 @@ int hwloc__move_infos(struct hwloc_info_s **dst_infosp, unsigned *dst_countp,
 
  drop:
   /* drop src infos, don't modify dst_infos at all */
-  for(i=0; i<src_count; i++) {
-    free(src_infos[i].name);
-    free(src_infos[i].value);
-  }
-  free(src_infos);
+  hwloc__free_infos(src_infos, src_count);
   *src_infosp = NULL;
   *src_countp = 0;
   return -1;
@@ -501,7 +502,39 @@ int hwloc__move_infos(struct hwloc_info_s **dst_infosp, unsigned *dst_countp,
 
 int hwloc_obj_add_info(hwloc_obj_t obj, const char *name, const char *value)
 {
-  return hwloc__add_info(&obj->infos, &obj->infos_count, name, value);
+  int err = hwloc__add_info(&obj->infos, &obj->infos_count, name, value);
+  hwloc__obj_modified(obj);
+  return err;
+}
+
+int hwloc__obj_add_info_nodup(hwloc_obj_t obj, const char *name, const char *value, int replace)
+{
+  int err = hwloc__add_info_nodup(&obj->infos, &obj->infos_count, name, value, replace);
+  hwloc__obj_modified(obj);
+  return err;
+}
+
+int hwloc_obj_remove_infos(hwloc_obj_t obj, const char *name)
+{
+  unsigned i, j;
+  for(i=0, j=0; i<obj->infos_count; i++) {
+    struct hwloc_info_s *info = &obj->infos[i];
+    if (!name || !strcmp(info->name, name)) {
+      free(info->name);
+      free(info->value);
+    } else {
+      if (i != j)
+	obj->infos[j] = *info;
+      j++;
+    }
+  }
+  obj->infos_count = j;
+  if (!j) {
+    free(obj->infos);
+    obj->infos = NULL;
+  }
+  hwloc__obj_modified(obj);
+  return 0;
 }
 
 /* This function may be called with topology->tma set, it cannot free() or realloc() */
@@ -523,8 +556,8 @@ static int hwloc__tma_dup_infos(struct hwloc_tma *tma, hwloc_obj_t new, hwloc_ob
  failed:
   assert(!tma || !tma->dontfree); /* this tma cannot fail to allocate */
   for(j=0; j<=i; j++) {
-    free(new->infos[i].name);
-    free(new->infos[i].value);
+    free(new->infos[j].name);
+    free(new->infos[j].value);
   }
   free(new->infos);
   new->infos = NULL;
@@ -1038,6 +1071,16 @@ hwloc__topology_dup(hwloc_topology_t *newp,
   if (err < 0)
     goto out_with_topology;
 
+  /* the busid index points to PCI devices, find the new ones by logical index */
+  if (old->pcidev_busid_index) {
+    new->pcidev_busid_index = hwloc_tma_malloc(tma, old->nr_pcidev_busid_index * sizeof(*new->pcidev_busid_index));
+    if (!new->pcidev_busid_index)
+      goto out_with_topology;
+    for(i=0; i<old->nr_pcidev_busid_index; i++)
+      new->pcidev_busid_index[i] = new->slevels[HWLOC_SLEVEL_PCIDEV].objs[old->pcidev_busid_index[i]->logical_index];
+    new->nr_pcidev_busid_index = old->nr_pcidev_busid_index;
+  }
+
   err = hwloc_internal_distances_dup(new, old);
   if (err < 0)
     goto out_with_topology;
@@ -1813,10 +1856,11 @@ hwloc_obj_t
 hwloc_alloc_setup_object(hwloc_topology_t topology,
 			 hwloc_obj_type_t type, unsigned os_index)
 {
-  struct hwloc_obj *obj = hwloc_tma_malloc(topology->tma, sizeof(*obj));
-  if (!obj)
+  struct hwloc_obj_private_s *priv = hwloc_tma_malloc(topology->tma, sizeof(*priv));
+  struct hwloc_obj *obj = &priv->obj;
+  if (!priv)
     return NULL;
-  memset(obj, 0, sizeof(*obj));
+  memset(priv, 0, sizeof(*priv));
   obj->type = type;
   obj->os_index = os_index;
   obj->gp_index = topology->next_gp_index++;
@@ -2910,6 +2954,8 @@ hwloc_connect_io_misc_levels(hwloc_topology_t topology)
       return -1;
   }
 
+  hwloc_pci_build_busid_index(topology);
+
   return 0;
 }
 
@@ -3112,6 +3158,9 @@ hwloc_topology_reconnect(struct hwloc_topology *topology, unsigned long flags)
   if (!topology->modified)
     return 0;
 
+  /* objects may have been removed or modified, cached strings are obsolete */
+  hwloc_internal_obj_strings_destroy(topology);
+
   hwloc_connect_children(topology->levels[0][0]);
 
   if (hwloc_connect_levels(topology) < 0)
@@ -3221,11 +3270,94 @@ hwloc_discover_by_phase(struct hwloc_topology *topology,
   }
 }
 
+/* Early gathering of PCI/IO data by backends that support it,
+ * on a helper thread while the CPU and MEMORY phases run.
+ * Backends insert what they gathered during the actual phase,
+ * or gather synchronously if the helper thread wasn't started.
+ */
+struct hwloc_disc_gather_s {
+  struct hwloc_topology *topology;
+  unsigned phases;
+#ifdef HWLOC_HAVE_PTHREAD_CREATE
+  int started;
+  pthread_t thread;
+#endif
+};
+
+#ifdef HWLOC_HAVE_PTHREAD_CREATE
+static void *
+hwloc_disc_gather_thread(void *_gather)
+{
+  struct hwloc_disc_gather_s *gather = _gather;
+  struct hwloc_backend *backend;
+  for(backend = gather->topology->backends; backend; backend = backend->next) {
+    unsigned phases = backend->gather_phases & backend->phases & gather->phases;
+    if (!phases || !backend->gather)
+      continue;
+    hwloc_debug("Gathering phases 0x%x in component %s...\n", phases, backend->component->name);
+    backend->gather(backend, phases);
+  }
+  return NULL;
+}
+#endif
+
+static void
+hwloc_disc_gather_start(struct hwloc_topology *topology,
+			struct hwloc_disc_status *dstatus,
+			struct hwloc_disc_gather_s *gather)
+{
+  struct hwloc_backend *backend;
+  const char *env;
+
+  gather->topology = topology;
+  gather->phases = 0;
+#ifdef HWLOC_HAVE_PTHREAD_CREATE
+  gather->started = 0;
+#endif
+
+  for(backend = topology->backends; backend; backend = backend->next)
+    if (backend->gather)
+      gather->phases |= backend->gather_phases & backend->phases;
+  gather->phases &= (HWLOC_DISC_PHASE_PCI|HWLOC_DISC_PHASE_IO) & ~dstatus->excluded_phases;
+  if (!gather->phases)
+    return;
+
+  env = getenv("HWLOC_ASYNC_DISCOVERY");
+  if (env && !atoi(env))
+    return;
+
+#ifdef HWLOC_HAVE_PTHREAD_CREATE
+  {
+    sigset_t allsigs, oldsigs;
+    /* don't let the helper thread receive application signals */
+    sigfillset(&allsigs);
+    pthread_sigmask(SIG_SETMASK, &allsigs, &oldsigs);
+    if (!pthread_create(&gather->thread, NULL, hwloc_disc_gather_thread, gather)) {
+      hwloc_debug("Started helper thread for gathering phases 0x%x\n", gather->phases);
+      gather->started = 1;
+    }
+    pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+  }
+#endif
+}
+
+static void
+hwloc_disc_gather_finish(struct hwloc_disc_gather_s *gather __hwloc_attribute_unused)
+{
+#ifdef HWLOC_HAVE_PTHREAD_CREATE
+  if (gather->started) {
+    pthread_join(gather->thread, NULL);
+    gather->started = 0;
+  }
+#endif
+}
+
 /* Main discovery loop */
 static int
 hwloc_discover(struct hwloc_topology *topology,
 	       struct hwloc_disc_status *dstatus)
 {
+  struct hwloc_disc_gather_s gather;
   const char *env;
 
   topology->modified = 0; /* no need to reconnect yet */
@@ -3291,6 +3423,9 @@ hwloc_discover(struct hwloc_topology *topology,
    * Except if annotating global components is explicitly requested.
    */
 
+  /* PCI/IO gathering doesn't need CPU/MEMORY objects, start it now */
+  hwloc_disc_gather_start(topology, dstatus, &gather);
+
   if (topology->backend_phases & HWLOC_DISC_PHASE_CPU) {
     /*
      * Discover CPUs first
@@ -3309,6 +3444,7 @@ hwloc_discover(struct hwloc_topology *topology,
    */
   if (!topology->levels[0][0]->cpuset || hwloc_bitmap_iszero(topology->levels[0][0]->cpuset)) {
     hwloc_debug("%s", "No PU added by any CPU or GLOBAL component phase\n");
+    hwloc_disc_gather_finish(&gather);
     errno = EINVAL;
     return -1;
   }
@@ -3406,16 +3542,24 @@ hwloc_discover(struct hwloc_topology *topology,
 
   /* Now connect handy pointers to make remaining discovery easier. */
   hwloc_debug("%s", "\nOk, finished tweaking, now connect\n");
-  if (hwloc_topology_reconnect(topology, 0) < 0)
+  if (hwloc_topology_reconnect(topology, 0) < 0) {
+    hwloc_disc_gather_finish(&gather);
     return -1;
+  }
   hwloc_debug_print_objects(0, topology->levels[0][0]);
 
+  /* Gathered PCI/IO data must be ready before attaching it */
+  hwloc_disc_gather_finish(&gather);
+
   /*
    * Additional discovery
    */
   if (topology->backend_phases & HWLOC_DISC_PHASE_PCI) {
     dstatus->phase = HWLOC_DISC_PHASE_PCI;
     hwloc_discover_by_phase(topology, dstatus, "PCI");
+    /* Reconnect so that IO backends find PCI devices in the busid index */
+    if (hwloc_topology_reconnect(topology, 0) < 0)
+      return -1;
   }
   if (topology->backend_phases & HWLOC_DISC_PHASE_IO) {
     dstatus->phase = HWLOC_DISC_PHASE_IO;
@@ -3435,6 +3579,9 @@ hwloc_discover(struct hwloc_topology *topology,
 
   /* Remove some stuff */
 
+  /* PCI devices may be removed below, the index will be rebuilt by the next reconnect */
+  hwloc_pci_clear_busid_index(topology);
+
   hwloc_debug("%s", "\nRemoving bridge objects if needed\n");
   hwloc_filter_bridges(topology, topology->levels[0][0]);
   hwloc_debug_print_objects(0, topology->levels[0][0]);
@@ -3526,6 +3673,9 @@ hwloc_topology_setup_defaults(struct hwloc_topology *topology)
 
   /* NULLify other special levels */
   memset(&topology->slevels, 0, sizeof(topology->slevels));
+  topology->pcidev_busid_index = NULL;
+  topology->nr_pcidev_busid_index = 0;
+  topology->obj_strings = NULL;
   /* assert the indexes of special levels */
   HWLOC_BUILD_ASSERT(HWLOC_SLEVEL_NUMANODE == HWLOC_SLEVEL_FROM_DEPTH(HWLOC_TYPE_DEPTH_NUMANODE));
   HWLOC_BUILD_ASSERT(HWLOC_SLEVEL_MISC == HWLOC_SLEVEL_FROM_DEPTH(HWLOC_TYPE_DEPTH_MISC));
@@ -3687,7 +3837,7 @@ hwloc_topology_set_flags (struct hwloc_topology *topology, unsigned long flags)
     return -1;
   }
 
-  if (flags & ~(HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED|HWLOC_TOPOLOGY_FLAG_IS_THISSYSTEM|HWLOC_TOPOLOGY_FLAG_THISSYSTEM_ALLOWED_RESOURCES|HWLOC_TOPOLOGY_FLAG_IMPORT_SUPPORT)) {
+  if (flags & ~(HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED|HWLOC_TOPOLOGY_FLAG_IS_THISSYSTEM|HWLOC_TOPOLOGY_FLAG_THISSYSTEM_ALLOWED_RESOURCES|HWLOC_TOPOLOGY_FLAG_IMPORT_SUPPORT|HWLOC_TOPOLOGY_FLAG_COLLAPSE_PCI_VFS)) {
     errno = EINVAL;
     return -1;
   }
@@ -3832,6 +3982,8 @@ hwloc_topology_clear (struct hwloc_topology *topology)
     free(topology->levels[l]);
   for(l=0; l<HWLOC_NR_SLEVELS; l++)
     free(topology->slevels[l].objs);
+  free(topology->pcidev_busid_index);
+  hwloc_internal_obj_strings_destroy(topology);
   free(topology->machine_memory.page_types);
 }
 
@@ -4961,6 +5113,27 @@ hwloc_topology_check(struct hwloc_topology *topology)
   for(j=0; j<HWLOC_NR_SLEVELS; j++)
     hwloc__check_level(topology, HWLOC_SLEVEL_TO_DEPTH(j), topology->slevels[j].first, topology->slevels[j].last);
 
+  /* check the busid index */
+  if (topology->pcidev_busid_index) {
+    struct hwloc_special_level_s *slevel = &topology->slevels[HWLOC_SLEVEL_PCIDEV];
+    assert(topology->nr_pcidev_busid_index == slevel->nbobjs);
+    for(i=0; i<topology->nr_pcidev_busid_index; i++) {
+      hwloc_obj_t pcidev = topology->pcidev_busid_index[i];
+      assert(pcidev->type == HWLOC_OBJ_PCI_DEVICE);
+      assert(slevel->objs[pcidev->logical_index] == pcidev);
+      if (i) {
+	struct hwloc_pcidev_attr_s *prev = &topology->pcidev_busid_index[i-1]->attr->pcidev;
+	struct hwloc_pcidev_attr_s *cur = &pcidev->attr->pcidev;
+	assert(prev->domain < cur->domain
+	       || (prev->domain == cur->domain
+		   && (prev->bus < cur->bus
+		       || (prev->bus == cur->bus
+			   && (prev->dev < cur->dev
+			       || (prev->dev == cur->dev && prev->func <= cur->func))))));
+      }
+    }
+  }
+
   /* recurse and check the tree of children, and type-specific checks */
   gp_indexes = hwloc_bitmap_alloc(); /* TODO prealloc to topology->next_gp_index */
   hwloc__check_object(topology, gp_indexes, obj);
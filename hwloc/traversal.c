@@ -709,6 +709,320 @@ hwloc_obj_attr_snprintf(char * __hwloc_restrict string, size_t size, hwloc_obj_t
   return ret;
 }
 
+/* Cache of object type and attribute strings.
+ * Entries are found by object pointer and checked against the gp_index
+ * so that an object allocated at the address of a freed one never matches.
+ * Attribute strings are regenerated when the object generation changed.
+ * Strings are interned and refcounted in a separate pool so that identical strings
+ * (such as "Core" or "L2") are only stored once per topology,
+ * and strings that aren't used by any entry anymore are freed.
+ * Everything is dropped at once by hwloc_internal_obj_strings_destroy().
+ *
+ * hwloc_obj_get_type/attr_string() are read-only from the application point of view,
+ * hence the cache is protected by a lock.
+ */
+#ifdef HWLOC_WIN_SYS
+#include <windows.h>
+static LONG hwloc_obj_strings_mutex = 0;
+#define HWLOC_OBJ_STRINGS_LOCK() do {						\
+  while (InterlockedCompareExchange(&hwloc_obj_strings_mutex, 1, 0) != 0)	\
+    SwitchToThread();								\
+} while (0)
+#define HWLOC_OBJ_STRINGS_UNLOCK() do {						\
+  assert(hwloc_obj_strings_mutex == 1);						\
+  hwloc_obj_strings_mutex = 0;							\
+} while (0)
+
+#elif defined HWLOC_HAVE_PTHREAD_MUTEX
+#include <pthread.h>
+static pthread_mutex_t hwloc_obj_strings_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define HWLOC_OBJ_STRINGS_LOCK() pthread_mutex_lock(&hwloc_obj_strings_mutex)
+#define HWLOC_OBJ_STRINGS_UNLOCK() pthread_mutex_unlock(&hwloc_obj_strings_mutex)
+
+#else /* HWLOC_WIN_SYS || HWLOC_HAVE_PTHREAD_MUTEX */
+#error No mutex implementation available
+#endif
+
+struct hwloc_obj_string_entry_s {
+  hwloc_obj_t obj; /* NULL if unused */
+  hwloc_uint64_t gp_index;
+  int verbose;
+  const char *separator; /* interned, NULL for type strings */
+  unsigned long generation; /* attribute strings are regenerated if the object generation changed */
+  const char *string; /* interned */
+};
+
+struct hwloc_obj_strings_s {
+  unsigned nr_entries, allocated_entries; /* allocated is 0 or a power of 2 */
+  struct hwloc_obj_string_entry_s *entries;
+  unsigned nr_strings, allocated_strings; /* allocated is 0 or a power of 2 */
+  struct hwloc_obj_string_s {
+    char *string; /* NULL if unused */
+    unsigned refcount; /* number of entries using this string as their string or separator */
+  } *strings;
+};
+
+#define HWLOC_OBJ_STRINGS_INITIAL_SIZE 64
+
+static unsigned
+hwloc__obj_strings_hash_string(const char *string)
+{
+  /* FNV-1a */
+  unsigned hash = 2166136261U;
+  while (*string) {
+    hash ^= (unsigned char) *(string++);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static unsigned
+hwloc__obj_strings_hash_entry(hwloc_obj_t obj, const char *separator, int verbose)
+{
+  unsigned long hash = ((unsigned long) (size_t) obj) >> 3;
+  hash ^= ((unsigned long) (size_t) separator) >> 3;
+  hash = hash * 2654435761UL + (unsigned) verbose;
+  return (unsigned) (hash ^ (hash >> 16));
+}
+
+/* Return the slot of the interned copy of string, or NULL on allocation failure.
+ * The caller must increase the refcount if it stores the string in an entry.
+ */
+static struct hwloc_obj_string_s *
+hwloc__obj_strings_intern(struct hwloc_obj_strings_s *cache, const char *string)
+{
+  unsigned mask, i;
+  char *copy;
+
+  /* keep the load factor below 1/2 */
+  if (2*(cache->nr_strings+1) > cache->allocated_strings) {
+    unsigned new_allocated = cache->allocated_strings ? 2*cache->allocated_strings : HWLOC_OBJ_STRINGS_INITIAL_SIZE;
+    struct hwloc_obj_string_s *new_strings = calloc(new_allocated, sizeof(*new_strings));
+    if (!new_strings)
+      return NULL;
+    for(i=0; i<cache->allocated_strings; i++) {
+      unsigned j;
+      if (!cache->strings[i].string)
+	continue;
+      for(j = hwloc__obj_strings_hash_string(cache->strings[i].string) & (new_allocated-1);
+	  new_strings[j].string;
+	  j = (j+1) & (new_allocated-1));
+      new_strings[j] = cache->strings[i];
+    }
+    free(cache->strings);
+    cache->strings = new_strings;
+    cache->allocated_strings = new_allocated;
+  }
+
+  mask = cache->allocated_strings-1;
+  for(i = hwloc__obj_strings_hash_string(string) & mask; cache->strings[i].string; i = (i+1) & mask)
+    if (!strcmp(cache->strings[i].string, string))
+      return &cache->strings[i];
+
+  copy = strdup(string);
+  if (!copy)
+    return NULL;
+  cache->strings[i].string = copy;
+  cache->strings[i].refcount = 0;
+  cache->nr_strings++;
+  return &cache->strings[i];
+}
+
+/* Return the slot of an already interned string */
+static struct hwloc_obj_string_s *
+hwloc__obj_strings_lookup(struct hwloc_obj_strings_s *cache, const char *string)
+{
+  unsigned mask = cache->allocated_strings-1;
+  unsigned i;
+  for(i = hwloc__obj_strings_hash_string(string) & mask; cache->strings[i].string != string; i = (i+1) & mask)
+    assert(cache->strings[i].string);
+  return &cache->strings[i];
+}
+
+/* Drop a reference on an interned string, and free it if it isn't used anymore */
+static void
+hwloc__obj_strings_put(struct hwloc_obj_strings_s *cache, const char *string)
+{
+  unsigned mask = cache->allocated_strings-1;
+  unsigned i, j;
+
+  i = (unsigned) (hwloc__obj_strings_lookup(cache, string) - cache->strings);
+  assert(cache->strings[i].refcount);
+  if (--cache->strings[i].refcount)
+    return;
+
+  free(cache->strings[i].string);
+  cache->nr_strings--;
+  /* shift back following entries of the probe sequence that may not be found anymore */
+  for(j = (i+1) & mask; cache->strings[j].string; j = (j+1) & mask) {
+    unsigned k = hwloc__obj_strings_hash_string(cache->strings[j].string) & mask;
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+      /* the expected slot of this entry is between the hole and itself, it's still reachable */
+      continue;
+    cache->strings[i] = cache->strings[j];
+    i = j;
+  }
+  cache->strings[i].string = NULL;
+  cache->strings[i].refcount = 0;
+}
+
+/* Return the entry matching this key, or the empty slot where it should be inserted.
+ * Return NULL on allocation failure.
+ */
+static struct hwloc_obj_string_entry_s *
+hwloc__obj_strings_find(struct hwloc_obj_strings_s *cache, hwloc_obj_t obj, const char *separator, int verbose)
+{
+  unsigned mask, i;
+
+  /* keep the load factor below 1/2 */
+  if (2*(cache->nr_entries+1) > cache->allocated_entries) {
+    unsigned new_allocated = cache->allocated_entries ? 2*cache->allocated_entries : HWLOC_OBJ_STRINGS_INITIAL_SIZE;
+    struct hwloc_obj_string_entry_s *new_entries = calloc(new_allocated, sizeof(*new_entries));
+    if (!new_entries)
+      return NULL;
+    for(i=0; i<cache->allocated_entries; i++) {
+      struct hwloc_obj_string_entry_s *entry = &cache->entries[i];
+      unsigned j;
+      if (!entry->obj)
+	continue;
+      for(j = hwloc__obj_strings_hash_entry(entry->obj, entry->separator, entry->verbose) & (new_allocated-1);
+	  new_entries[j].obj;
+	  j = (j+1) & (new_allocated-1));
+      new_entries[j] = *entry;
+    }
+    free(cache->entries);
+    cache->entries = new_entries;
+    cache->allocated_entries = new_allocated;
+  }
+
+  mask = cache->allocated_entries-1;
+  for(i = hwloc__obj_strings_hash_entry(obj, separator, verbose) & mask; cache->entries[i].obj; i = (i+1) & mask) {
+    struct hwloc_obj_string_entry_s *entry = &cache->entries[i];
+    if (entry->obj == obj && entry->separator == separator && entry->verbose == verbose)
+      return entry;
+  }
+  return &cache->entries[i];
+}
+
+/* Return the cached type string if separator is NULL, the cached attribute string otherwise.
+ * Must be called with the lock held.
+ */
+static const char *
+hwloc__obj_get_string_locked(hwloc_topology_t topology, hwloc_obj_t obj, const char *separator, int verbose)
+{
+  struct hwloc_obj_strings_s *cache = topology->obj_strings;
+  struct hwloc_obj_string_entry_s *entry;
+  struct hwloc_obj_string_s *interned;
+  unsigned long generation = HWLOC_OBJ_PRIVATE(obj)->generation;
+  const char *string;
+  char buffer[256];
+  char *tmp = buffer;
+  int len;
+
+  if (!cache) {
+    cache = calloc(1, sizeof(*cache));
+    if (!cache)
+      return NULL;
+    topology->obj_strings = cache;
+  }
+
+  if (separator) {
+    interned = hwloc__obj_strings_intern(cache, separator);
+    if (!interned)
+      return NULL;
+    separator = interned->string;
+  }
+
+  entry = hwloc__obj_strings_find(cache, obj, separator, verbose);
+  if (!entry)
+    return NULL;
+
+  if (entry->obj
+      && entry->gp_index == obj->gp_index
+      && entry->generation == generation)
+    return entry->string;
+
+  /* (re)generate the string */
+  if (separator)
+    len = hwloc_obj_attr_snprintf(buffer, sizeof(buffer), obj, separator, verbose);
+  else
+    len = hwloc_obj_type_snprintf(buffer, sizeof(buffer), obj, verbose);
+  if (len < 0)
+    return NULL;
+  if ((size_t) len >= sizeof(buffer)) {
+    tmp = malloc(len+1);
+    if (!tmp)
+      return NULL;
+    if (separator)
+      hwloc_obj_attr_snprintf(tmp, len+1, obj, separator, verbose);
+    else
+      hwloc_obj_type_snprintf(tmp, len+1, obj, verbose);
+  }
+  interned = hwloc__obj_strings_intern(cache, tmp);
+  if (tmp != buffer)
+    free(tmp);
+  if (!interned)
+    return NULL;
+  interned->refcount++;
+  /* put() and lookup() below may move slots, only keep the string */
+  string = interned->string;
+
+  if (entry->obj) {
+    /* replacing an obsolete entry, only the string changes */
+    hwloc__obj_strings_put(cache, entry->string);
+  } else {
+    cache->nr_entries++;
+    if (separator)
+      /* the intern() above may have moved the separator slot, find it again */
+      hwloc__obj_strings_lookup(cache, separator)->refcount++;
+  }
+  entry->obj = obj;
+  entry->gp_index = obj->gp_index;
+  entry->verbose = verbose;
+  entry->separator = separator;
+  entry->generation = generation;
+  entry->string = string;
+  return string;
+}
+
+static const char *
+hwloc__obj_get_string(hwloc_topology_t topology, hwloc_obj_t obj, const char *separator, int verbose)
+{
+  const char *string;
+  HWLOC_OBJ_STRINGS_LOCK();
+  string = hwloc__obj_get_string_locked(topology, obj, separator, verbose);
+  HWLOC_OBJ_STRINGS_UNLOCK();
+  return string;
+}
+
+const char *
+hwloc_obj_get_type_string(hwloc_topology_t topology, hwloc_obj_t obj, int verbose)
+{
+  return hwloc__obj_get_string(topology, obj, NULL, verbose);
+}
+
+const char *
+hwloc_obj_get_attr_string(hwloc_topology_t topology, hwloc_obj_t obj, const char * __hwloc_restrict separator, int verbose)
+{
+  return hwloc__obj_get_string(topology, obj, separator, verbose);
+}
+
+void
+hwloc_internal_obj_strings_destroy(hwloc_topology_t topology)
+{
+  struct hwloc_obj_strings_s *cache = topology->obj_strings;
+  unsigned i;
+
+  if (!cache)
+    return;
+  for(i=0; i<cache->allocated_strings; i++)
+    free(cache->strings[i].string);
+  free(cache->strings);
+  free(cache->entries);
+  free(cache);
+  topology->obj_strings = NULL;
+}
+
 int hwloc_bitmap_singlify_per_core(hwloc_topology_t topology, hwloc_bitmap_t cpuset, unsigned which)
 {
   hwloc_obj_t core = NULL;
@@ -992,6 +992,44 @@ HWLOC_DECLSPEC int hwloc_obj_attr_snprintf(char * __hwloc_restrict string, size_
 					   hwloc_obj_t obj, const char * __hwloc_restrict separator,
 					   int verbose);
 
+/** \brief Return the cached stringified type of a given topology object.
+ *
+ * This is equivalent to hwloc_obj_type_snprintf() except that the output
+ * is stored in the topology and does not need any caller buffer.
+ * The string is generated on first call and reused by later calls
+ * for the same object, identical strings being shared between objects.
+ *
+ * The returned string belongs to the topology and must not be freed.
+ * It remains valid until the topology structure is modified (for instance by hwloc_topology_restrict()
+ * or by inserting objects), reloaded or destroyed.
+ *
+ * The cache is protected by a lock, hence this function may be called
+ * concurrently from different threads like other read-only functions.
+ *
+ * \return \c NULL on allocation failure.
+ */
+HWLOC_DECLSPEC const char * hwloc_obj_get_type_string(hwloc_topology_t topology, hwloc_obj_t obj, int verbose);
+
+/** \brief Return the cached stringified attributes of a given topology object.
+ *
+ * This is equivalent to hwloc_obj_attr_snprintf() except that the output
+ * is stored in the topology and does not need any caller buffer.
+ * The string is regenerated if object infos or memory attributes were modified
+ * with hwloc_obj_add_info(), hwloc_obj_remove_infos() or hwloc_memattr_set_value() since.
+ *
+ * The returned string belongs to the topology and must not be freed.
+ * It remains valid under the same conditions as for hwloc_obj_get_type_string(),
+ * and until the object is modified as above.
+ *
+ * This function may be called concurrently from different threads
+ * like other read-only functions.
+ *
+ * \return \c NULL on allocation failure.
+ */
+HWLOC_DECLSPEC const char * hwloc_obj_get_attr_string(hwloc_topology_t topology, hwloc_obj_t obj,
+						      const char * __hwloc_restrict separator,
+						      int verbose);
+
 /** \brief Return an object type and attributes from a type string.
  *
  * Convert strings such as "Package" or "L1iCache" into the corresponding types.
@@ -1080,6 +1118,18 @@ hwloc_obj_get_info_by_name(hwloc_obj_t obj, const char *name) __hwloc_attribute_
  */
 HWLOC_DECLSPEC int hwloc_obj_add_info(hwloc_obj_t obj, const char *name, const char *value);
 
+/** \brief Remove info attributes from the given object.
+ *
+ * Remove all infos whose name is \p name, or all infos if \p name is \c NULL.
+ *
+ * This is equivalent to freeing the names and values of these infos
+ * and removing them from the infos array, but it also invalidates
+ * the string cached by hwloc_obj_get_attr_string() for this object.
+ *
+ * \return \c 0 on success.
+ */
+HWLOC_DECLSPEC int hwloc_obj_remove_infos(hwloc_obj_t obj, const char *name);
+
 /** @} */
 
 
@@ -1966,7 +2016,25 @@ enum hwloc_topology_flags_e {
    * hwloc and machine support.
    *
    */
-  HWLOC_TOPOLOGY_FLAG_IMPORT_SUPPORT = (1UL<<3)
+  HWLOC_TOPOLOGY_FLAG_IMPORT_SUPPORT = (1UL<<3),
+
+  /** \brief Collapse PCI SR-IOV Virtual Functions into their Physical Function.
+   *
+   * By default, each SR-IOV Virtual Function is exposed as a PCI device
+   * object, with its own OS devices (e.g. network interfaces).
+   * NICs may expose hundreds of those, which makes the topology much larger.
+   *
+   * When this flag is set, Virtual Functions and their OS devices are not
+   * inserted in the topology. Their Physical Function PCI object receives
+   * info attributes \p SRIOVCollapsedVFs (number of Virtual Functions)
+   * and \p SRIOVVFBusIDs (range of their bus IDs) instead.
+   * On Linux, hwloc_linux_get_pci_vf() may be used to retrieve details
+   * about each Virtual Function later.
+   *
+   * This flag is currently only supported by the Linux backend.
+   * \hideinitializer
+   */
+  HWLOC_TOPOLOGY_FLAG_COLLAPSE_PCI_VFS = (1UL<<4)
 };
 
 /** \brief Set OR'ed flags to non-yet-loaded topology.
@@ -2166,7 +2234,7 @@ enum hwloc_type_filter_e {
    * It is only useful for I/O object types.
    * For ::HWLOC_OBJ_PCI_DEVICE and ::HWLOC_OBJ_OS_DEVICE, it means that only objects
    * of major/common kinds are kept (storage, network, OpenFabrics, CUDA,
-   * OpenCL, RSMI, NVML, and displays).
+   * OpenCL, RSMI, NVML, CXL memory, and displays).
    * Also, only OS devices directly attached on PCI (e.g. no USB) are reported.
    * For ::HWLOC_OBJ_BRIDGE, it means that bridges are kept only if they have children.
    *
@@ -6,7 +6,7 @@
  */
 
 /** \file
- * \brief Exporting Topologies to XML or to Synthetic strings.
+ * \brief Exporting Topologies to XML, to Synthetic strings or to JSON.
  */
 
 #ifndef HWLOC_EXPORT_H
@@ -270,6 +270,59 @@ enum hwloc_topology_export_synthetic_flags_e {
 
 
 
+/** \defgroup hwlocality_jsonexport Exporting Topologies to JSON
+ * @{
+ */
+
+/** \brief Export the topology into a JSON file.
+ *
+ * The JSON document contains the topology depth, allowed cpuset and nodeset,
+ * and an array of levels. Normal levels are listed from the root,
+ * followed by special levels (NUMA nodes, Memory-side caches, Bridges,
+ * PCI devices, OS devices and Misc objects).
+ * Each level is an array of its objects in logical index order.
+ * Each object contains its type, indexes, parent \p gp_index,
+ * cpusets and nodesets as lists (e.g. \c "0-3,8"),
+ * type-specific attributes and info attributes.
+ *
+ * The document is written while traversing the topology,
+ * hence it may be streamed to a pipe without being stored in memory first.
+ *
+ * \p flags must be \c 0 for now.
+ *
+ * \return -1 if a failure occured.
+ *
+ * \note JSON cannot be imported back into hwloc, use XML for that.
+ *
+ * \note Object userdata and distances are not exported.
+ *
+ * \note If \p filename is "-", the JSON output is sent to the standard output.
+ */
+HWLOC_DECLSPEC int hwloc_topology_export_json(hwloc_topology_t topology, const char *filename, unsigned long flags);
+
+/** \brief Export the topology into a newly-allocated JSON memory buffer.
+ *
+ * \p jsonbuffer is allocated by the callee and should be freed with
+ * hwloc_free_jsonbuffer() later in the caller.
+ *
+ * The returned buffer ends with a \0 that is included in the returned
+ * length.
+ *
+ * See hwloc_topology_export_json() for details about the format.
+ *
+ * \p flags must be \c 0 for now.
+ *
+ * \return -1 if a failure occured.
+ */
+HWLOC_DECLSPEC int hwloc_topology_export_jsonbuffer(hwloc_topology_t topology, char **jsonbuffer, int *buflen, unsigned long flags);
+
+/** \brief Free a buffer allocated by hwloc_topology_export_jsonbuffer() */
+HWLOC_DECLSPEC void hwloc_free_jsonbuffer(hwloc_topology_t topology, char *jsonbuffer);
+
+/** @} */
+
+
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
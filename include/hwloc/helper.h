@@ -1109,21 +1109,15 @@ hwloc_get_next_pcidev(hwloc_topology_t topology, hwloc_obj_t prev)
 
 /** \brief Find the PCI device object matching the PCI bus id
  * given domain, bus device and function PCI bus id.
+ *
+ * PCI devices are indexed by bus id when the topology is loaded
+ * (or modified), hence this lookup is logarithmic in the number of PCI devices.
+ *
+ * \return \c NULL if there is no such PCI device in the topology.
  */
-static __hwloc_inline hwloc_obj_t
+HWLOC_DECLSPEC hwloc_obj_t
 hwloc_get_pcidev_by_busid(hwloc_topology_t topology,
-			  unsigned domain, unsigned bus, unsigned dev, unsigned func)
-{
-  hwloc_obj_t obj = NULL;
-  while ((obj = hwloc_get_next_pcidev(topology, obj)) != NULL) {
-    if (obj->attr->pcidev.domain == domain
-	&& obj->attr->pcidev.bus == bus
-	&& obj->attr->pcidev.dev == dev
-	&& obj->attr->pcidev.func == func)
-      return obj;
-  }
-  return NULL;
-}
+			  unsigned domain, unsigned bus, unsigned dev, unsigned func);
 
 /** \brief Find the PCI device object matching the PCI bus id
  * given as a string xxxx:yy:zz.t or yy:zz.t.
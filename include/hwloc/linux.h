@@ -69,6 +69,97 @@ HWLOC_DECLSPEC int hwloc_linux_get_tid_last_cpu_location(hwloc_topology_t topolo
  */
 HWLOC_DECLSPEC int hwloc_linux_read_path_as_cpumask(const char *path, hwloc_bitmap_t set);
 
+/** \brief Get information about a SR-IOV Virtual Function of PCI device \p pf.
+ *
+ * When ::HWLOC_TOPOLOGY_FLAG_COLLAPSE_PCI_VFS is set, Virtual Functions
+ * are not exposed as objects in the topology.
+ * This function reads the bus ID, vendor, device and class IDs of the
+ * \p idx -th Virtual Function of Physical Function \p pf from sysfs
+ * and stores them in \p attr.
+ * If \p netdev is not \c NULL, the name of the first network interface
+ * of that Virtual Function is stored there (or an empty string if none).
+ *
+ * \return 0 on success.
+ * \return -1 with errno set to \c ENOENT if \p pf has no such Virtual Function.
+ * \return -1 with errno set to \c EINVAL if \p pf is not a PCI device.
+ *
+ * \note This function reads sysfs under the filesystem root that the
+ * Linux backend used for discovering \p topology (see HWLOC_FSROOT).
+ * If \p topology was not discovered by the Linux backend (e.g. loaded
+ * from XML or duplicated), the current system is used.
+ */
+HWLOC_DECLSPEC int hwloc_linux_get_pci_vf(hwloc_topology_t topology, hwloc_obj_t pf, unsigned idx,
+					  struct hwloc_pcidev_attr_s *attr, char *netdev, size_t netdevlen);
+
+/** \brief Find the transmit queue of network OS device \p osdev that best matches CPU set \p set.
+ *
+ * The affinity of each transmit queue is read from the \c TXQueue<N>XPSCPUSet
+ * info attribute of \p osdev if any, or from the \c Queue<N>IRQCPUSet info
+ * attribute otherwise (see \ref attributes_info_osdev).
+ * The best queue is the one whose affinity includes \p set with the
+ * smallest number of CPUs. If no queue affinity includes \p set,
+ * the queue whose affinity intersects \p set the most is returned.
+ *
+ * The index of the queue is stored in \p queue.
+ *
+ * \return 0 on success.
+ * \return -1 with errno set to \c ENOENT if no queue has any known affinity
+ * or if no affinity intersects \p set.
+ * \return -1 with errno set to \c EINVAL if \p osdev is not a network OS device.
+ *
+ * \note This function only uses info attributes and therefore also works
+ * on topologies loaded from XML.
+ */
+HWLOC_DECLSPEC int hwloc_linux_get_net_queue_by_cpuset(hwloc_topology_t topology, hwloc_obj_t osdev,
+						       hwloc_const_cpuset_t set, unsigned *queue);
+
+/** \brief Return a file descriptor that notifies changes of the allowed CPUs and NUMA nodes.
+ *
+ * The returned descriptor watches the Linux cgroup cpuset files that define
+ * the resources allowed to the process whose topology was loaded
+ * (see hwloc_topology_set_pid()).
+ * It becomes readable in \c poll(), \c select() or \c epoll when these
+ * files are written, for instance when a container runtime or the Kubernetes
+ * CPU Manager changes the cpuset of the current container.
+ * hwloc_linux_update_allowed_resources() should then be called.
+ *
+ * The caller should \c close() the descriptor when done.
+ *
+ * \return A non-negative file descriptor on success.
+ * \return -1 with errno set to \c EINVAL if the topology is not loaded or
+ * not from this system.
+ * \return -1 with errno set to \c ENOENT if no cgroup cpuset could be found.
+ * \return -1 with errno set to \c ENOSYS if inotify is not supported.
+ *
+ * \note Linux does not notify changes of effective sets caused by
+ * modifications of parent cgroups. Callers that must also catch these
+ * should call hwloc_linux_update_allowed_resources() periodically.
+ */
+HWLOC_DECLSPEC int hwloc_linux_open_allowed_resources_notifier(hwloc_topology_t topology);
+
+/** \brief Update the allowed CPUs and NUMA nodes of the topology from Linux cgroups.
+ *
+ * Re-read the cpuset of the cgroup of the process whose topology was loaded
+ * and update the sets returned by hwloc_topology_get_allowed_cpuset()
+ * and hwloc_topology_get_allowed_nodeset() in place,
+ * just like hwloc_topology_allow() with ::HWLOC_ALLOW_FLAG_LOCAL_RESTRICTIONS.
+ *
+ * If \p fd is a descriptor returned by hwloc_linux_open_allowed_resources_notifier(),
+ * its pending notifications are consumed first. Otherwise \p fd should be -1.
+ *
+ * The topology must have been loaded with ::HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED
+ * so that resources that become allowed are already in the topology.
+ *
+ * \return 1 if the allowed sets changed, 0 if they did not.
+ * \return -1 on error, for instance with errno set to \c EINVAL
+ * if the topology was not loaded from this system with
+ * ::HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED.
+ *
+ * \note This function modifies the topology, it must not be called
+ * concurrently with other hwloc functions on the same topology.
+ */
+HWLOC_DECLSPEC int hwloc_linux_update_allowed_resources(hwloc_topology_t topology, int fd);
+
 /** @} */
 
 
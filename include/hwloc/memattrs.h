@@ -261,6 +261,57 @@ hwloc_memattr_get_best_initiator(hwloc_topology_t topology,
                                  unsigned long flags,
                                  struct hwloc_location *best_initiator, hwloc_uint64_t *value);
 
+/** \brief Return the bandwidth and number of hops of the PCI path between an I/O object and a NUMA node.
+ *
+ * The path starts at the PCI device or bridge \p ioobj, or at the closest
+ * PCI ancestor if \p ioobj is an OS device. It goes up through PCI bridges
+ * to the host bridge, and then to the target NUMA node \p node.
+ *
+ * The bandwidth returned in \p bandwidth is the bottleneck PCI link speed
+ * along this path (see the \c linkspeed field of PCI attributes), in MiB/s.
+ * The number of hops returned in \p hops is the number of PCI links
+ * between \p ioobj and the host bridge.
+ *
+ * If \p node is not local to the host bridge, one more hop is added.
+ * If a NUMA latency matrix is available (see hwloc_distances_get_by_type()),
+ * the bandwidth is also scaled down by the ratio between the latency from
+ * the closest local NUMA node to itself and to \p node.
+ *
+ * \p flags must be \c 0 for now.
+ *
+ * \return -1 with \p errno set to \c EINVAL if \p ioobj is not a PCI object
+ * (or an OS device below one), or if \p node is not a NUMA node.
+ * \return -1 with \p errno set to \c ENOENT if no PCI link speed is known along the path.
+ */
+HWLOC_DECLSPEC int
+hwloc_get_pci_path_to_numanode(hwloc_topology_t topology,
+                               hwloc_obj_t ioobj, hwloc_obj_t node,
+                               unsigned long flags,
+                               hwloc_uint64_t *bandwidth, unsigned *hops);
+
+/** \brief Store PCI path bandwidths and hops as memory attributes.
+ *
+ * Register memory attributes \c PCIBandwidth (in MiB/s, higher is better)
+ * and \c PCIHops (lower is better) if they do not exist yet, and set their
+ * values as returned by hwloc_get_pci_path_to_numanode() for each PCI device
+ * (as an initiator of type ::HWLOC_LOCATION_TYPE_OBJECT) and each NUMA node.
+ * PCI devices without any known link speed along their path are ignored.
+ *
+ * hwloc_memattr_get_best_target() may then report the best NUMA node
+ * for a given PCI device, and hwloc_memattr_get_best_initiator()
+ * the best PCI device for a given NUMA node.
+ * OS devices are not used as initiators, their PCI parent should be used instead.
+ *
+ * The identifiers of these attributes are returned in \p bandwidth_id
+ * and \p hops_id if they are not \c NULL.
+ *
+ * \p flags must be \c 0 for now.
+ */
+HWLOC_DECLSPEC int
+hwloc_memattr_register_pci_paths(hwloc_topology_t topology,
+                                 unsigned long flags,
+                                 hwloc_memattr_id_t *bandwidth_id, hwloc_memattr_id_t *hops_id);
+
 /** @} */
 
 
@@ -225,6 +225,28 @@ struct hwloc_backend {
    * May be NULL.
    */
   int (*get_pci_busid_cpuset)(struct hwloc_backend *backend, struct hwloc_pcidev_attr_s *busid, hwloc_bitmap_t cpuset);
+
+  /** \brief Discovery phases whose data may be gathered early.
+   * OR'ed set of ::hwloc_disc_phase_t, must be a subset of \p phases.
+   *
+   * Gathering data for these phases does not depend on objects discovered
+   * by other phases, hence the core may call gather() on a helper thread
+   * while the CPU and MEMORY phases run.
+   * The actual insertion of objects is still performed by discover()
+   * during the corresponding phase.
+   * Only ::HWLOC_DISC_PHASE_PCI and ::HWLOC_DISC_PHASE_IO are currently supported.
+   */
+  unsigned gather_phases;
+
+  /** \brief Callback for gathering data ahead of discovery.
+   * \p phases is the subset of gather_phases that will actually be discovered.
+   * This callback must not modify the topology (not even allocate objects),
+   * it should only store what it gathered in private_data so that
+   * discover() uses it later (and disable() frees it if discover() never ran).
+   * It may run concurrently with discover() for other phases.
+   * May be NULL.
+   */
+  int (*gather)(struct hwloc_backend *backend, unsigned phases);
 };
 
 /** \brief Allocate a backend structure, set good default values, initialize backend->component and topology, etc.
@@ -470,6 +492,7 @@ hwloc_filter_check_pcidev_subtype_important(unsigned classid)
 	  || baseclass == 0x02 /* PCI_BASE_CLASS_NETWORK */
 	  || baseclass == 0x01 /* PCI_BASE_CLASS_STORAGE */
 	  || baseclass == 0x0b /* PCI_BASE_CLASS_PROCESSOR */
+	  || classid == 0x0502 /* PCI_CLASS_MEMORY_CXL */
 	  || classid == 0x0c04 /* PCI_CLASS_SERIAL_FIBER */
 	  || classid == 0x0c06 /* PCI_CLASS_SERIAL_INFINIBAND */
 	  || baseclass == 0x12 /* Processing Accelerators */);
@@ -120,6 +120,7 @@ extern "C" {
 #define HWLOC_TOPOLOGY_FLAG_IS_THISSYSTEM HWLOC_NAME_CAPS(TOPOLOGY_FLAG_IS_THISSYSTEM)
 #define HWLOC_TOPOLOGY_FLAG_THISSYSTEM_ALLOWED_RESOURCES HWLOC_NAME_CAPS(TOPOLOGY_FLAG_THISSYSTEM_ALLOWED_RESOURCES)
 #define HWLOC_TOPOLOGY_FLAG_IMPORT_SUPPORT HWLOC_NAME_CAPS(TOPOLOGY_FLAG_IMPORT_SUPPORT)
+#define HWLOC_TOPOLOGY_FLAG_COLLAPSE_PCI_VFS HWLOC_NAME_CAPS(TOPOLOGY_FLAG_COLLAPSE_PCI_VFS)
 
 #define hwloc_topology_set_pid HWLOC_NAME(topology_set_pid)
 #define hwloc_topology_set_synthetic HWLOC_NAME(topology_set_synthetic)
@@ -197,11 +198,14 @@ extern "C" {
 #define hwloc_obj_type_string HWLOC_NAME(obj_type_string )
 #define hwloc_obj_type_snprintf HWLOC_NAME(obj_type_snprintf )
 #define hwloc_obj_attr_snprintf HWLOC_NAME(obj_attr_snprintf )
+#define hwloc_obj_get_type_string HWLOC_NAME(obj_get_type_string)
+#define hwloc_obj_get_attr_string HWLOC_NAME(obj_get_attr_string)
 #define hwloc_type_sscanf HWLOC_NAME(type_sscanf)
 #define hwloc_type_sscanf_as_depth HWLOC_NAME(type_sscanf_as_depth)
 
 #define hwloc_obj_get_info_by_name HWLOC_NAME(obj_get_info_by_name)
 #define hwloc_obj_add_info HWLOC_NAME(obj_add_info)
+#define hwloc_obj_remove_infos HWLOC_NAME(obj_remove_infos)
 
 #define HWLOC_CPUBIND_PROCESS HWLOC_NAME_CAPS(CPUBIND_PROCESS)
 #define HWLOC_CPUBIND_THREAD HWLOC_NAME_CAPS(CPUBIND_THREAD)
@@ -395,6 +399,8 @@ extern "C" {
 #define HWLOC_LOCAL_NUMANODE_FLAG_SMALLER_LOCALITY HWLOC_NAME_CAPS(LOCAL_NUMANODE_FLAG_SMALLER_LOCALITY)
 #define HWLOC_LOCAL_NUMANODE_FLAG_ALL HWLOC_NAME_CAPS(LOCAL_NUMANODE_FLAG_ALL)
 #define hwloc_get_local_numanode_objs HWLOC_NAME(get_local_numanode_objs)
+#define hwloc_get_pci_path_to_numanode HWLOC_NAME(get_pci_path_to_numanode)
+#define hwloc_memattr_register_pci_paths HWLOC_NAME(memattr_register_pci_paths)
 
 #define hwloc_memattr_get_name HWLOC_NAME(memattr_get_name)
 #define hwloc_memattr_get_flags HWLOC_NAME(memattr_get_flags)
@@ -426,6 +432,10 @@ extern "C" {
 #define HWLOC_TOPOLOGY_EXPORT_SYNTHETIC_FLAG_IGNORE_MEMORY HWLOC_NAME_CAPS(TOPOLOGY_EXPORT_SYNTHETIC_FLAG_IGNORE_MEMORY)
 #define hwloc_topology_export_synthetic HWLOC_NAME(topology_export_synthetic)
 
+#define hwloc_topology_export_json HWLOC_NAME(topology_export_json)
+#define hwloc_topology_export_jsonbuffer HWLOC_NAME(topology_export_jsonbuffer)
+#define hwloc_free_jsonbuffer HWLOC_NAME(free_jsonbuffer)
+
 /* distances.h */
 
 #define hwloc_distances_s HWLOC_NAME(distances_s)
@@ -514,6 +524,10 @@ extern "C" {
 #define hwloc_linux_get_tid_cpubind HWLOC_NAME(linux_get_tid_cpubind)
 #define hwloc_linux_get_tid_last_cpu_location HWLOC_NAME(linux_get_tid_last_cpu_location)
 #define hwloc_linux_read_path_as_cpumask HWLOC_NAME(linux_read_file_cpumask)
+#define hwloc_linux_get_pci_vf HWLOC_NAME(linux_get_pci_vf)
+#define hwloc_linux_get_net_queue_by_cpuset HWLOC_NAME(linux_get_net_queue_by_cpuset)
+#define hwloc_linux_open_allowed_resources_notifier HWLOC_NAME(linux_open_allowed_resources_notifier)
+#define hwloc_linux_update_allowed_resources HWLOC_NAME(linux_update_allowed_resources)
 
 /* openfabrics-verbs.h */
 
@@ -769,6 +783,7 @@ extern "C" {
 
 #define hwloc__add_info HWLOC_NAME(_add_info)
 #define hwloc__add_info_nodup HWLOC_NAME(_add_info_nodup)
+#define hwloc__obj_add_info_nodup HWLOC_NAME(_obj_add_info_nodup)
 #define hwloc__move_infos HWLOC_NAME(_move_infos)
 #define hwloc__free_infos HWLOC_NAME(_free_infos)
 
@@ -822,6 +837,8 @@ extern "C" {
 #define hwloc_internal_memattrs_need_refresh HWLOC_NAME(internal_memattrs_need_refresh)
 #define hwloc_internal_memattrs_refresh HWLOC_NAME(internal_memattrs_refresh)
 
+#define hwloc_internal_obj_strings_destroy HWLOC_NAME(internal_obj_strings_destroy)
+
 #define hwloc_encode_to_base64 HWLOC_NAME(encode_to_base64)
 #define hwloc_decode_from_base64 HWLOC_NAME(decode_from_base64)
 
@@ -39,6 +39,10 @@ typedef struct {
 /**
  * \brief Build the Scotch architecture representing the all machine
  *
+ * Tree networks give a tleaf architecture. Other networks give a
+ * decomposition-defined architecture built from the graph of the network,
+ * whose terminals are the nodes.
+ *
  * \param arch Pointer to the Scotch arch that will be built.
  *
  * \returns 0 on success
@@ -21,7 +21,11 @@
 #include <netloc/utarray.h>
 #include <private/autogen/config.h>
 
-#define NETLOCFILE_VERSION 1
+#define NETLOCFILE_VERSION 2
+
+/* First bytes of binary topology files, see netloc_topology_write_binary() */
+#define NETLOC_BINARY_MAGIC "NETLOCB\n"
+#define NETLOC_BINARY_VERSION 1
 
 #ifdef NETLOC_SCOTCH
 #include <stdint.h>
@@ -86,6 +90,7 @@ typedef enum {
 
 typedef enum {
     NETLOC_ARCH_TREE    =  0,  /* Fat tree */
+    NETLOC_ARCH_GRAPH   =  1,  /* Any other network, as a graph */
 } netloc_arch_type_t;
 
 
@@ -99,11 +104,14 @@ struct netloc_edge_t;
 typedef struct netloc_edge_t netloc_edge_t;
 struct netloc_physical_link_t;
 typedef struct netloc_physical_link_t netloc_physical_link_t;
-struct netloc_path_t;
-typedef struct netloc_path_t netloc_path_t;
+
+struct netloc_distance_t;
+typedef struct netloc_distance_t netloc_distance_t;
 
 struct netloc_arch_tree_t;
 typedef struct netloc_arch_tree_t netloc_arch_tree_t;
+struct netloc_arch_graph_t;
+typedef struct netloc_arch_graph_t netloc_arch_graph_t;
 struct netloc_arch_node_t;
 typedef struct netloc_arch_node_t netloc_arch_node_t;
 struct netloc_arch_node_slot_t;
@@ -112,6 +120,9 @@ struct netloc_arch_t;
 typedef struct netloc_arch_t netloc_arch_t;
 /** \endcond */
 
+/* Marks the hwloc topologies that could not be loaded, so that they are tried once */
+#define NETLOC_HWLOC_TOPO_FAILED ((hwloc_topology_t) -1)
+
 /**
  * \struct netloc_topology_t
  * \brief Netloc Topology Context
@@ -138,10 +149,25 @@ struct netloc_topology_t {
     /** Hwloc topology List */
     char *hwlocpath;
     UT_array *topos;
-    hwloc_topology_t *hwloc_topos;
+    hwloc_topology_t *hwloc_topos; /* by index in topos, NULL until loaded,
+                                    * NETLOC_HWLOC_TOPO_FAILED if loading failed */
 
     /** Type of the graph */
     netloc_topology_type_t type;
+
+    /** Hosts in the order of the file, indexing the forwarding tables */
+    netloc_node_t **hosts;
+    int num_hosts;
+
+    /** Storage of the forwarding tables of the nodes */
+    unsigned char *lfts;
+
+    /** Mapping of a binary topology file (if any) */
+    void *mapping;
+    size_t mapping_size;
+
+    /** Distances from each host to the others, computed on demand */
+    netloc_distance_t **distances;
 };
 
 /**
@@ -181,7 +207,15 @@ struct netloc_node_t {
 
     UT_array *subnodes; /* the group of nodes for the virtual nodes */
 
-    netloc_path_t *paths;
+    /** Index in the hosts of the topology (-1 if not a host) */
+    int host_idx;
+
+    /** Forwarding table: output port toward each host (0 if none) */
+    unsigned char *lft;
+
+    /** Physical links by port - 1, for following the forwarding tables */
+    netloc_physical_link_t **port_links;
+    unsigned int num_ports;
 
     char *hostname;
 
@@ -255,10 +289,15 @@ struct netloc_physical_link_t {
     char *description;
 };
 
-struct netloc_path_t {
-    UT_hash_handle hh;       /* makes this structure hashable */
-    char dest_id[20];
-    UT_array *links;
+
+/**
+ * \brief Distance from a host to another one
+ */
+struct netloc_distance_t {
+    /** Number of links of the route, -1 if there is none */
+    int hops;
+    /** Bandwidth of the slowest link of the route */
+    float gbits;
 };
 
 
@@ -271,6 +310,15 @@ struct netloc_arch_tree_t {
     NETLOC_int *cost;
 };
 
+/* Graph of the network, in the compressed format of Scotch */
+struct netloc_arch_graph_t {
+    NETLOC_int num_vertices; /* hosts first, then switches */
+    NETLOC_int num_hosts;
+    NETLOC_int *verttab; /* index of the first edge of each vertex [num_vertices+1] */
+    NETLOC_int *edgetab; /* destination vertex of each edge */
+    NETLOC_int *edlotab; /* cost of each edge, from the bandwidth of its links */
+};
+
 struct netloc_arch_node_t {
     UT_hash_handle hh;       /* makes this structure hashable */
     char *name; /* Hash key */
@@ -298,6 +346,7 @@ struct netloc_arch_t {
         netloc_arch_tree_t *node_tree;
         netloc_arch_tree_t *global_tree;
     } arch;
+    netloc_arch_graph_t *graph; /* if type is NETLOC_ARCH_GRAPH, instead of arch */
     netloc_arch_node_t *nodes_by_name;
     netloc_arch_node_slot_t *node_slot_by_idx; /* node_slot by index in complete topo */
     NETLOC_int num_current_hosts; /* if has_slots, host is a slot, else host is a node */
@@ -320,6 +369,45 @@ struct netloc_arch_t {
  */
 netloc_topology_t *netloc_topology_construct(char *path);
 
+/** Do not merge similar nodes into virtual nodes */
+#define NETLOC_TOPOLOGY_LOAD_FLAG_RAW (1UL<<0)
+
+/**
+ * Load a topology from a text or binary file
+ *
+ * The format is detected from the first bytes of the file.
+ * \ref netloc_topology_construct is the same as flags 0.
+ *
+ * \param path The path of the file, owned by the topology on success
+ * \param flags A OR'ed set of NETLOC_TOPOLOGY_LOAD_FLAG_*
+ *
+ * \returns A newly allocated topology, NULL upon an error
+ */
+netloc_topology_t *netloc_topology_load(char *path, unsigned long flags);
+
+/**
+ * Write a topology into a binary file
+ *
+ * The binary file has fixed-size records and string tables that are mapped
+ * when loading it, and stores the reverse edges and similar nodes so that
+ * they do not have to be found again.
+ *
+ * \param topology A topology loaded with NETLOC_TOPOLOGY_LOAD_FLAG_RAW
+ * \param path The path of the output file
+ *
+ * \returns NETLOC_SUCCESS on success
+ * \returns NETLOC_ERROR upon an error.
+ */
+int netloc_topology_write_binary(netloc_topology_t *topology, const char *path);
+
+/* Internal functions for loading topologies */
+netloc_topology_t *netloc_topology_alloc(char *path, char *subnet,
+        char *hwlocpath, int num_nodes);
+netloc_topology_t *netloc_topology_read_binary(char *path, int **similar);
+void netloc_topology_unmap_binary(netloc_topology_t *topology);
+int netloc_topology_get_similar_nodes(netloc_node_t **nodes, int num_nodes,
+        int *similar);
+
 /**
  * Destruct a topology handle
  *
@@ -336,6 +424,19 @@ int netloc_topology_find_partition_idx(netloc_topology_t *topology, char *partit
 int netloc_topology_read_hwloc(netloc_topology_t *topology, int num_nodes,
         netloc_node_t **node_list);
 
+/**
+ * Get the hwloc topology of a host, loading it on first use
+ *
+ * The nodes are associated with their hwloc reference by \ref
+ * netloc_topology_read_hwloc. Hosts with the same reference share the same
+ * hwloc topology, owned by the netloc topology.
+ *
+ * Returns
+ *   The hwloc topology, or NULL if it cannot be loaded
+ */
+hwloc_topology_t netloc_topology_get_node_hwloc(netloc_topology_t *topology,
+        netloc_node_t *node);
+
 #define netloc_topology_iter_partitions(topology,partition) \
     for ((partition) = (char **)utarray_front(topology->partitions); \
             (partition) != NULL; \
@@ -381,6 +482,9 @@ int netloc_node_destruct(netloc_node_t *node);
 
 char *netloc_node_pretty_print(netloc_node_t* node);
 
+/* Index the physical links of a node by port, for following forwarding tables */
+int netloc_node_index_ports(netloc_node_t *node);
+
 #define netloc_node_get_num_subnodes(node) \
     utarray_len((node)->subnodes)
 
@@ -396,18 +500,12 @@ char *netloc_node_pretty_print(netloc_node_t* node);
 #define netloc_node_iter_edges(node,edge,_tmp) \
     HASH_ITER(hh, node->edges, edge, _tmp)
 
-#define netloc_node_iter_paths(node,path,_tmp) \
-    HASH_ITER(hh, node->paths, path, _tmp)
-
 #define netloc_node_is_host(node) \
     (node->type == NETLOC_NODE_TYPE_HOST)
 
 #define netloc_node_is_switch(node) \
     (node->type == NETLOC_NODE_TYPE_SWITCH)
 
-#define netloc_node_iter_paths(node, path,_tmp) \
-    HASH_ITER(hh, node->paths, path, _tmp)
-
 int netloc_node_is_in_partition(netloc_node_t *node, int partition);
 
 /*************************************************/
@@ -476,11 +574,73 @@ int netloc_physical_link_destruct(netloc_physical_link_t *link);
 
 char * netloc_link_pretty_print(netloc_physical_link_t* link);
 
+int netloc_link_is_in_partition(netloc_physical_link_t *link, int partition);
+
 /*************************************************/
 
 
-netloc_path_t *netloc_path_construct(void);
-int netloc_path_destruct(netloc_path_t *path);
+/**
+ * Build the path from a host to another one by following the forwarding
+ * tables of the switches
+ *
+ * \param src The source host
+ * \param dest The destination host
+ * \param links An array of netloc_physical_link_t pointers, replaced with the
+ * links of the path
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR_NOT_FOUND if there is no complete route
+ */
+int netloc_path_build(netloc_node_t *src, netloc_node_t *dest, UT_array *links);
+
+/**
+ * Get the distances from a host to all hosts of the topology
+ *
+ * Routes are taken from the forwarding tables of the switches. For the hosts
+ * without a complete route, the shortest path in the graph of physical links
+ * is used instead. The distances are computed once by source host and cached
+ * in the topology.
+ *
+ * \param topology The topology
+ * \param src The source host
+ * \param pdistances Set to an array of distances indexed by the \c host_idx of
+ * the destinations, owned by the topology
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR_NOT_FOUND if src is not a host of the topology
+ *   NETLOC_ERROR on error
+ */
+int netloc_topology_get_distances(netloc_topology_t *topology,
+        netloc_node_t *src, netloc_distance_t **pdistances);
+
+/**
+ * Get the distance from a host to another one
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR_NOT_FOUND if there is no route
+ *   NETLOC_ERROR on error
+ */
+int netloc_topology_get_distance(netloc_topology_t *topology,
+        netloc_node_t *src, netloc_node_t *dest, netloc_distance_t *distance);
+
+/**
+ * Fill a dense matrix with the distances between the given hosts
+ *
+ * \param matrix Array of num_nodes*num_nodes elements, the distance from
+ * nodes[i] to nodes[j] is stored at index i*num_nodes+j
+ *
+ * Returns
+ *   NETLOC_SUCCESS on success
+ *   NETLOC_ERROR_NOT_FOUND if a node is not a host of the topology
+ *   NETLOC_ERROR on error
+ */
+int netloc_topology_get_distance_matrix(netloc_topology_t *topology,
+        int num_nodes, netloc_node_t **nodes, netloc_distance_t *matrix);
+
+void netloc_topology_free_distances(netloc_topology_t *topology);
 
 
 /**********************************************************************
@@ -497,7 +657,8 @@ int netloc_arch_set_current_resources(netloc_arch_t *arch);
 
 int netloc_arch_set_global_resources(netloc_arch_t *arch);
 
-int netloc_arch_node_get_hwloc_info(netloc_arch_node_t *arch);
+int netloc_arch_node_get_hwloc_info(netloc_topology_t *topology,
+        netloc_arch_node_t *arch);
 
 void netloc_arch_tree_complete(netloc_arch_tree_t *tree, UT_array **down_degrees_by_level,
         int num_hosts, int **parch_idx);
@@ -516,11 +677,6 @@ NETLOC_int netloc_arch_tree_num_leaves(netloc_arch_tree_t *tree);
     (*(int *)utarray_eltptr((object)->partitions, (i)))
 
 
-#define netloc_path_iter_links(path,link) \
-    for ((link) = (netloc_physical_link_t **)utarray_front(path->links); \
-            (link) != NULL; \
-            (link) = (netloc_physical_link_t **)utarray_next(path->links, link))
-
 /**********************************************************************
  *        Misc functions
  **********************************************************************/
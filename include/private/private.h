@@ -40,7 +40,7 @@
 #endif
 #include <string.h>
 
-#define HWLOC_TOPOLOGY_ABI 0x20300 /* version of the layout of struct topology */
+#define HWLOC_TOPOLOGY_ABI 0x20302 /* version of the layout of struct topology */
 
 struct hwloc_internal_location_s {
   enum hwloc_location_type_e type;
@@ -95,6 +95,9 @@ struct hwloc_topology {
     struct hwloc_obj **objs;
     struct hwloc_obj *first, *last; /* Temporarily used while listing object before building the objs array */
   } slevels[HWLOC_NR_SLEVELS];
+  /* PCI devices sorted by busid, rebuilt with special levels, for O(log n) lookups by busid */
+  unsigned nr_pcidev_busid_index;
+  struct hwloc_obj **pcidev_busid_index;
 
   hwloc_bitmap_t allowed_cpuset;
   hwloc_bitmap_t allowed_nodeset;
@@ -262,7 +265,21 @@ struct hwloc_topology {
     hwloc_obj_t parent;
     struct hwloc_pci_locality_s *prev, *next;
   } *first_pci_locality, *last_pci_locality;
+
+  /* lazily-filled cache of object type and attribute strings, see hwloc_obj_get_type_string().
+   * private to each process, dropped when the topology is modified.
+   */
+  struct hwloc_obj_strings_s *obj_strings;
+};
+
+/* Objects are allocated with some private fields after the public structure */
+struct hwloc_obj_private_s {
+  struct hwloc_obj obj; /* must be first */
+  /* bumped when infos or memory attributes are modified, invalidates cached attribute strings */
+  unsigned long generation;
 };
+#define HWLOC_OBJ_PRIVATE(obj) ((struct hwloc_obj_private_s *)(obj))
+#define hwloc__obj_modified(obj) (HWLOC_OBJ_PRIVATE(obj)->generation++)
 
 extern void hwloc_alloc_root_sets(hwloc_obj_t root);
 extern void hwloc_setup_pu_level(struct hwloc_topology *topology, unsigned nb_pus);
@@ -296,6 +313,13 @@ extern void hwloc_pci_discovery_exit(struct hwloc_topology *topology);
  */
 extern struct hwloc_obj * hwloc_pci_find_by_busid(struct hwloc_topology *topology, unsigned domain, unsigned bus, unsigned dev, unsigned func);
 
+/* (Re)build the sorted busid index from the PCI device special level.
+ * The index is dropped (and lookups fall back to walking the tree) on allocation failure.
+ */
+extern void hwloc_pci_build_busid_index(struct hwloc_topology *topology);
+/* Drop the busid index before PCI objects may be freed outside of a reconnect */
+extern void hwloc_pci_clear_busid_index(struct hwloc_topology *topology);
+
 /* Look for an object matching complete cpuset exactly, or insert one.
  * Return NULL on failure.
  * Return a good fallback (object above) on failure to insert.
@@ -304,6 +328,8 @@ extern hwloc_obj_t hwloc_find_insert_io_parent_by_complete_cpuset(struct hwloc_t
 
 extern int hwloc__add_info(struct hwloc_info_s **infosp, unsigned *countp, const char *name, const char *value);
 extern int hwloc__add_info_nodup(struct hwloc_info_s **infosp, unsigned *countp, const char *name, const char *value, int replace);
+/* same as above for object infos, keeps the object infos index and generation up to date */
+extern int hwloc__obj_add_info_nodup(hwloc_obj_t obj, const char *name, const char *value, int replace);
 extern int hwloc__move_infos(struct hwloc_info_s **dst_infosp, unsigned *dst_countp, struct hwloc_info_s **src_infosp, unsigned *src_countp);
 extern void hwloc__free_infos(struct hwloc_info_s *infos, unsigned count);
 
@@ -404,6 +430,9 @@ extern void hwloc_internal_memattrs_destroy(hwloc_topology_t topology);
 extern void hwloc_internal_memattrs_need_refresh(hwloc_topology_t topology);
 extern void hwloc_internal_memattrs_refresh(hwloc_topology_t topology);
 extern int hwloc_internal_memattrs_dup(hwloc_topology_t new, hwloc_topology_t old);
+
+/* Drop all cached object strings, called when objects may be freed or modified */
+extern void hwloc_internal_obj_strings_destroy(hwloc_topology_t topology);
 extern int hwloc_internal_memattr_set_value(hwloc_topology_t topology, hwloc_memattr_id_t id, hwloc_obj_type_t target_type, hwloc_uint64_t target_gp_index, unsigned target_os_index, struct hwloc_internal_location_s *initiator, hwloc_uint64_t value);
 
 /* encode src buffer into target buffer.
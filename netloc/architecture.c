@@ -13,17 +13,42 @@
 #include <private/netloc.h>
 #include <netloc.h>
 
+/* Number of hosts used to measure the costs of the levels of a tree */
+#define NETLOC_ARCH_COST_MAX_SOURCES 16
+
 typedef struct netloc_analysis_data_t {
     int level;
     void *userdata;
 } netloc_analysis_data;
 
+/* Index of a node, in a hash table by node */
+typedef struct {
+    UT_hash_handle hh;
+    netloc_node_t *node;
+    int idx;
+} node_idx_t;
+
+/* Edge of a graph being built, with the bandwidth of all its links */
+typedef struct {
+    NETLOC_int dest;
+    float gbits;
+} graph_edge_t;
+
+static UT_icd graph_edge_icd = {sizeof(graph_edge_t), NULL, NULL, NULL};
+
 
+static int partition_is_tree(netloc_topology_t *topology, int partition);
 static int partition_topology_to_tleaf(netloc_topology_t *topology,
         int partition, int num_cores, netloc_arch_t *arch);
+static int partition_topology_to_graph(netloc_topology_t *topology,
+        int partition, netloc_arch_t *arch);
+static int netloc_arch_graph_destruct(netloc_arch_graph_t *graph);
 static netloc_arch_tree_t *tree_merge(netloc_arch_tree_t *main,
         netloc_arch_tree_t *sub);
 static int netloc_arch_tree_destruct(netloc_arch_tree_t *tree);
+static void tree_set_cost_from_distances(netloc_topology_t *topology,
+        netloc_arch_tree_t *tree, int num_nodes, netloc_node_t **nodes,
+        int *arch_idx);
 static int netloc_arch_node_destruct(netloc_arch_node_t *arch_node);
 static netloc_arch_node_t *netloc_arch_node_construct(void);
 
@@ -238,7 +263,7 @@ int netloc_arch_set_current_resources(netloc_arch_t *arch)
     for (int n = 0; n < num_nodes; n++) {
         netloc_arch_node_t *node = arch_node_list[n];
 
-        ret = netloc_arch_node_get_hwloc_info(node);
+        ret = netloc_arch_node_get_hwloc_info(arch->topology, node);
         if (ret != NETLOC_SUCCESS)
             goto ERROR;
 
@@ -284,7 +309,9 @@ int netloc_arch_set_current_resources(netloc_arch_t *arch)
         arch->arch.global_tree = arch->arch.node_tree;
 
         /* Build nodes_by_idx */
-        NETLOC_int tree_size = netloc_arch_tree_num_leaves(arch->arch.node_tree);
+        NETLOC_int tree_size = arch->type == NETLOC_ARCH_TREE ?
+            netloc_arch_tree_num_leaves(arch->arch.node_tree):
+            arch->graph->num_hosts;
         netloc_arch_node_slot_t *nodes_by_idx = (netloc_arch_node_slot_t *)
             malloc(sizeof(netloc_arch_node_slot_t[tree_size]));
         for (int n = 0; n < num_nodes; n++) {
@@ -381,7 +408,7 @@ int netloc_arch_set_global_resources(netloc_arch_t *arch)
     int current_idx = 0;
     netloc_arch_node_t *node, *node_tmp;
     HASH_ITER(hh, arch->nodes_by_name, node, node_tmp) {
-        ret = netloc_arch_node_get_hwloc_info(node);
+        ret = netloc_arch_node_get_hwloc_info(arch->topology, node);
         if (ret != NETLOC_SUCCESS)
             goto ERROR;
 
@@ -417,7 +444,9 @@ int netloc_arch_set_global_resources(netloc_arch_t *arch)
         arch->arch.global_tree = arch->arch.node_tree;
 
         /* Build nodes_by_idx */
-        int tree_size = netloc_arch_tree_num_leaves(arch->arch.node_tree);
+        int tree_size = arch->type == NETLOC_ARCH_TREE ?
+            netloc_arch_tree_num_leaves(arch->arch.node_tree):
+            arch->graph->num_hosts;
         netloc_arch_node_slot_t *nodes_by_idx = (netloc_arch_node_slot_t *)
             malloc(sizeof(netloc_arch_node_slot_t[tree_size]));
         netloc_arch_node_t *node, *node_tmp;
@@ -622,7 +651,16 @@ int partition_topology_to_tleaf(netloc_topology_t *topology,
 
     UT_array *down_edges = NULL;
     utarray_new(down_edges, &ut_ptr_icd);
-    netloc_edge_t *up_edge = current_node->edges;
+    netloc_edge_t *up_edge = NULL;
+    {
+        netloc_edge_t *edge, *edge_tmp;
+        netloc_node_iter_edges(current_node, edge, edge_tmp) {
+            if (netloc_edge_is_in_partition(edge, partition)) {
+                up_edge = edge;
+                break;
+            }
+        }
+    }
     utarray_push_back(ordered_name_array, &current_node);
     while (1) {
         if (utarray_len(down_edges)) {
@@ -711,6 +749,8 @@ int partition_topology_to_tleaf(netloc_topology_t *topology,
     netloc_arch_tree_complete(tree, down_degrees_by_level, num_nodes, &arch_idx);
 
     netloc_node_t **ordered_nodes = (netloc_node_t **)ordered_name_array->d;
+    tree_set_cost_from_distances(topology, tree, num_nodes, ordered_nodes, arch_idx);
+
     netloc_arch_node_t *named_nodes = NULL;
     for (int i = 0; i < num_nodes; i++) {
         netloc_arch_node_t *node = netloc_arch_node_construct();
@@ -762,6 +802,358 @@ end:
     return ret;
 }
 
+/* Replace the costs of the levels by the distances measured on the fabric:
+ * the number of hops, weighted by the bandwidth of the slowest link. A few
+ * hosts are used as sources, until each level has a measure. Levels without
+ * measures get the cost of the level below plus two hops. Costs are relative
+ * to the lowest level, whose cost stays 1 like in the default costs. */
+static void tree_set_cost_from_distances(netloc_topology_t *topology,
+        netloc_arch_tree_t *tree, int num_nodes, netloc_node_t **nodes,
+        int *arch_idx)
+{
+    int num_levels = tree->num_levels;
+    int num_sources = num_nodes < NETLOC_ARCH_COST_MAX_SOURCES ?
+        num_nodes: NETLOC_ARCH_COST_MAX_SOURCES;
+    netloc_distance_t **distances;
+    float max_gbits = 0;
+
+    if (num_nodes < 2 || num_levels < 1)
+        return;
+
+    /* On allocation failure, keep the default costs */
+    distances = (netloc_distance_t **)
+        malloc(num_sources*sizeof(netloc_distance_t *));
+    if (!distances)
+        return;
+    for (int s = 0; s < num_sources; s++) {
+        if (netloc_topology_get_distances(topology, nodes[s], &distances[s])
+                != NETLOC_SUCCESS) {
+            free(distances);
+            return;
+        }
+        for (int n = 0; n < num_nodes; n++) {
+            netloc_distance_t *distance = &distances[s][nodes[n]->host_idx];
+            if (distance->hops > 0 && distance->gbits > max_gbits)
+                max_gbits = distance->gbits;
+        }
+    }
+
+    double *measured_cost = (double *)calloc(num_levels, sizeof(double));
+    if (!measured_cost) {
+        free(distances);
+        return;
+    }
+    int num_measured_levels = 0;
+    for (int s = 0; s < num_sources && num_measured_levels < num_levels; s++) {
+        for (int n = s+1; n < num_nodes; n++) {
+            netloc_distance_t *distance = &distances[s][nodes[n]->host_idx];
+            if (distance->hops <= 0)
+                continue;
+
+            /* Level of the common ancestor in the complete tree */
+            int level = num_levels-1;
+            int idx1 = arch_idx[s]/tree->degrees[level];
+            int idx2 = arch_idx[n]/tree->degrees[level];
+            while (idx1 != idx2 && level > 0) {
+                level--;
+                idx1 /= tree->degrees[level];
+                idx2 /= tree->degrees[level];
+            }
+
+            double cost = distance->hops;
+            if (distance->gbits > 0)
+                cost *= max_gbits/distance->gbits;
+            if (!measured_cost[level])
+                num_measured_levels++;
+            if (cost > measured_cost[level])
+                measured_cost[level] = cost;
+        }
+    }
+
+    for (int l = num_levels-1; l >= 0; l--) {
+        double lower_cost = l < num_levels-1 ? measured_cost[l+1]: 0;
+        if (measured_cost[l] <= 0)
+            measured_cost[l] = lower_cost+2;
+        /* Going through a higher level cannot be cheaper */
+        if (measured_cost[l] < lower_cost)
+            measured_cost[l] = lower_cost;
+    }
+
+    double unit = measured_cost[num_levels-1];
+    for (int l = num_levels-1; l >= 0; l--) {
+        NETLOC_int lower_cost = l < num_levels-1 ? tree->cost[l+1]: 1;
+        tree->cost[l] = (NETLOC_int)(measured_cost[l]/unit+0.5);
+        if (tree->cost[l] < lower_cost)
+            tree->cost[l] = lower_cost;
+    }
+
+    free(measured_cost);
+    free(distances);
+}
+
+/* Check that the network of the partition is a tree that can be represented
+ * by a tleaf: from the hosts, each node must have a single neighbour at the
+ * upper level and none at its own level, and there must be at least one
+ * switch. Similar switches, like the top switches of fat trees, are already
+ * merged into virtual nodes. */
+static int partition_is_tree(netloc_topology_t *topology, int partition)
+{
+    node_idx_t *levels = NULL;
+    node_idx_t *node_level, *node_level_tmp;
+    UT_array *queue;
+    int is_tree = 1;
+    int max_level = 0;
+    unsigned int num_nodes = 0;
+
+    utarray_new(queue, &ut_ptr_icd);
+
+    netloc_node_t *node, *node_tmp;
+    netloc_topology_iter_nodes(topology, node, node_tmp) {
+        if (!netloc_node_is_in_partition(node, partition))
+            continue;
+        num_nodes++;
+        if (!netloc_node_is_host(node))
+            continue;
+        node_level = (node_idx_t *)malloc(sizeof(node_idx_t));
+        node_level->node = node;
+        node_level->idx = 0;
+        HASH_ADD_PTR(levels, node, node_level);
+        utarray_push_back(queue, &node_level);
+    }
+
+    for (unsigned int q = 0; is_tree && q < utarray_len(queue); q++) {
+        node_idx_t *cur = *(node_idx_t **)utarray_eltptr(queue, q);
+        int num_up_edges = 0;
+
+        netloc_edge_t *edge, *edge_tmp;
+        netloc_node_iter_edges(cur->node, edge, edge_tmp) {
+            if (!netloc_edge_is_in_partition(edge, partition))
+                continue;
+
+            HASH_FIND_PTR(levels, &edge->dest, node_level);
+            if (!node_level) {
+                node_level = (node_idx_t *)malloc(sizeof(node_idx_t));
+                node_level->node = edge->dest;
+                node_level->idx = cur->idx+1;
+                HASH_ADD_PTR(levels, node, node_level);
+                utarray_push_back(queue, &node_level);
+                if (node_level->idx > max_level)
+                    max_level = node_level->idx;
+            }
+
+            if (node_level->idx == cur->idx+1)
+                num_up_edges++;
+            else if (node_level->idx != cur->idx-1)
+                is_tree = 0;
+        }
+        if (num_up_edges > 1)
+            is_tree = 0;
+    }
+
+    if (!max_level || HASH_COUNT(levels) != num_nodes)
+        is_tree = 0;
+
+    HASH_ITER(hh, levels, node_level, node_level_tmp) {
+        HASH_DEL(levels, node_level);
+        free(node_level);
+    }
+    utarray_free(queue);
+
+    return is_tree;
+}
+
+static void graph_add_vertex(UT_array *vertices, node_idx_t **idx_by_node,
+        netloc_node_t *node)
+{
+    node_idx_t *node_idx = (node_idx_t *)malloc(sizeof(node_idx_t));
+    node_idx->node = node;
+    node_idx->idx = utarray_len(vertices);
+    HASH_ADD_PTR(*idx_by_node, node, node_idx);
+    utarray_push_back(vertices, &node);
+}
+
+static void graph_add_edge(UT_array *edges, NETLOC_int dest, float gbits)
+{
+    graph_edge_t *edge;
+    for (edge = (graph_edge_t *)utarray_front(edges); edge;
+            edge = (graph_edge_t *)utarray_next(edges, edge)) {
+        if (edge->dest == dest) {
+            edge->gbits += gbits;
+            return;
+        }
+    }
+    graph_edge_t new_edge = { dest, gbits };
+    utarray_push_back(edges, &new_edge);
+}
+
+/* Build the graph of the physical nodes of the partition, for the networks
+ * that are not trees. Parallel links are merged into a single edge, and the
+ * cost of an edge is the ratio between the largest bandwidth of the edges
+ * and its bandwidth. */
+static int partition_topology_to_graph(netloc_topology_t *topology,
+        int partition, netloc_arch_t *arch)
+{
+    int ret = NETLOC_ERROR;
+    node_idx_t *idx_by_node = NULL;
+    node_idx_t *node_idx, *node_idx_tmp;
+    UT_array *vertices;
+    UT_array **edges = NULL;
+    netloc_arch_graph_t *graph = NULL;
+    char *reached = NULL;
+    NETLOC_int *queue = NULL;
+
+    utarray_new(vertices, &ut_ptr_icd);
+
+    /* Hosts first, in the order of the topology */
+    for (int h = 0; h < topology->num_hosts; h++) {
+        netloc_node_t *node = topology->hosts[h];
+        if (netloc_node_is_in_partition(node, partition))
+            graph_add_vertex(vertices, &idx_by_node, node);
+    }
+    int num_hosts = utarray_len(vertices);
+
+    /* Then the switches, with the physical nodes of the virtual ones */
+    netloc_node_t *node, *node_tmp;
+    netloc_topology_iter_nodes(topology, node, node_tmp) {
+        if (netloc_node_is_host(node))
+            continue;
+        unsigned int num_subnodes = netloc_node_get_num_subnodes(node);
+        if (!num_subnodes) {
+            if (netloc_node_is_in_partition(node, partition))
+                graph_add_vertex(vertices, &idx_by_node, node);
+            continue;
+        }
+        for (unsigned int s = 0; s < num_subnodes; s++) {
+            netloc_node_t *subnode = netloc_node_get_subnode(node, s);
+            if (netloc_node_is_in_partition(subnode, partition))
+                graph_add_vertex(vertices, &idx_by_node, subnode);
+        }
+    }
+    int num_vertices = utarray_len(vertices);
+
+    if (!num_hosts) {
+        fprintf(stderr, "Error: no host in the partition\n");
+        goto end;
+    }
+
+    /* Edges in both directions, with the bandwidth of the links */
+    edges = (UT_array **)malloc(num_vertices*sizeof(UT_array *));
+    for (int v = 0; v < num_vertices; v++) {
+        utarray_new(edges[v], &graph_edge_icd);
+    }
+    for (int v = 0; v < num_vertices; v++) {
+        netloc_node_t *node = *(netloc_node_t **)utarray_eltptr(vertices, v);
+        for (unsigned int l = 0; l < utarray_len(node->physical_links); l++) {
+            netloc_physical_link_t *link = *(netloc_physical_link_t **)
+                utarray_eltptr(node->physical_links, l);
+            if (!netloc_link_is_in_partition(link, partition))
+                continue;
+            HASH_FIND_PTR(idx_by_node, &link->dest, node_idx);
+            if (!node_idx || node_idx->idx == v)
+                continue;
+            graph_add_edge(edges[v], node_idx->idx, link->gbits);
+            graph_add_edge(edges[node_idx->idx], v, link->gbits);
+        }
+    }
+
+    graph = (netloc_arch_graph_t *)malloc(sizeof(netloc_arch_graph_t));
+    graph->num_vertices = num_vertices;
+    graph->num_hosts = num_hosts;
+    graph->verttab = (NETLOC_int *)malloc((num_vertices+1)*sizeof(NETLOC_int));
+    graph->verttab[0] = 0;
+    float max_gbits = 0;
+    for (int v = 0; v < num_vertices; v++) {
+        graph->verttab[v+1] = graph->verttab[v]+utarray_len(edges[v]);
+        graph_edge_t *edge;
+        for (edge = (graph_edge_t *)utarray_front(edges[v]); edge;
+                edge = (graph_edge_t *)utarray_next(edges[v], edge)) {
+            if (edge->gbits > max_gbits)
+                max_gbits = edge->gbits;
+        }
+    }
+
+    NETLOC_int num_edges = graph->verttab[num_vertices];
+    graph->edgetab = (NETLOC_int *)malloc(num_edges*sizeof(NETLOC_int));
+    graph->edlotab = (NETLOC_int *)malloc(num_edges*sizeof(NETLOC_int));
+    for (int v = 0; v < num_vertices; v++) {
+        NETLOC_int e = graph->verttab[v];
+        graph_edge_t *edge;
+        for (edge = (graph_edge_t *)utarray_front(edges[v]); edge;
+                edge = (graph_edge_t *)utarray_next(edges[v], edge)) {
+            NETLOC_int cost = 1;
+            if (edge->gbits > 0)
+                cost = (NETLOC_int)(max_gbits/edge->gbits+0.5);
+            graph->edgetab[e] = edge->dest;
+            graph->edlotab[e] = cost > 0 ? cost: 1;
+            e++;
+        }
+    }
+
+    /* Scotch needs a connected graph */
+    reached = (char *)calloc(num_vertices, sizeof(char));
+    queue = (NETLOC_int *)malloc(num_vertices*sizeof(NETLOC_int));
+    int num_reached = 1;
+    reached[0] = 1;
+    queue[0] = 0;
+    for (int q = 0; q < num_reached; q++) {
+        NETLOC_int v = queue[q];
+        for (NETLOC_int e = graph->verttab[v]; e < graph->verttab[v+1]; e++) {
+            NETLOC_int dest = graph->edgetab[e];
+            if (!reached[dest]) {
+                reached[dest] = 1;
+                queue[num_reached++] = dest;
+            }
+        }
+    }
+    if (num_reached != num_vertices) {
+        fprintf(stderr, "Error: the network of the partition is not connected\n");
+        netloc_arch_graph_destruct(graph);
+        goto end;
+    }
+
+    netloc_arch_node_t *named_nodes = NULL;
+    for (int h = 0; h < num_hosts; h++) {
+        netloc_node_t *host = *(netloc_node_t **)utarray_eltptr(vertices, h);
+        netloc_arch_node_t *arch_node = netloc_arch_node_construct();
+        arch_node->node = host;
+        arch_node->name = host->hostname;
+        arch_node->idx_in_topo = h;
+        HASH_ADD_KEYPTR(hh, named_nodes, arch_node->name, strlen(arch_node->name), arch_node);
+    }
+
+    arch->type = NETLOC_ARCH_GRAPH;
+    arch->graph = graph;
+    arch->nodes_by_name = named_nodes;
+    ret = NETLOC_SUCCESS;
+
+end:
+    if (edges) {
+        for (int v = 0; v < num_vertices; v++) {
+            utarray_free(edges[v]);
+        }
+        free(edges);
+    }
+    HASH_ITER(hh, idx_by_node, node_idx, node_idx_tmp) {
+        HASH_DEL(idx_by_node, node_idx);
+        free(node_idx);
+    }
+    utarray_free(vertices);
+    free(reached);
+    free(queue);
+
+    return ret;
+}
+
+static int netloc_arch_graph_destruct(netloc_arch_graph_t *graph)
+{
+    free(graph->verttab);
+    free(graph->edgetab);
+    free(graph->edlotab);
+    free(graph);
+
+    return NETLOC_SUCCESS;
+}
+
 int netloc_arch_build(netloc_arch_t *arch, int add_slots)
 {
     char *partition_name = getenv("NETLOC_PARTITION");
@@ -796,8 +1188,24 @@ int netloc_arch_build(netloc_arch_t *arch, int add_slots)
 
     int partition =
         netloc_topology_find_partition_idx(topology, partition_name);
+    if (partition < 0) {
+        fprintf(stderr, "Error: partition %s not found\n", partition_name);
+        return NETLOC_ERROR;
+    }
 
-    partition_topology_to_tleaf(topology, partition, 1, arch);
+    if (partition_is_tree(topology, partition)) {
+        if (partition_topology_to_tleaf(topology, partition, 1, arch) != 0)
+            return NETLOC_ERROR;
+    } else {
+        /* Processes are mapped to the nodes of the graph, and then to the
+         * slots with the tree of each node */
+        if (add_slots)
+            fprintf(stderr, "Warning: the network of partition %s is not a tree, "
+                    "processes are mapped to nodes before slots\n", partition_name);
+        arch->has_slots = 0;
+        if (partition_topology_to_graph(topology, partition, arch) != NETLOC_SUCCESS)
+            return NETLOC_ERROR;
+    }
 
     return NETLOC_SUCCESS;
 }
@@ -819,9 +1227,13 @@ int netloc_arch_destruct(netloc_arch_t *arch)
         netloc_arch_node_destruct(node);
     }
 
-    free(arch->arch.node_tree->degrees);
-    free(arch->arch.node_tree->cost);
-    free(arch->arch.node_tree);
+    if (arch->type == NETLOC_ARCH_GRAPH) {
+        netloc_arch_graph_destruct(arch->graph);
+    } else if (arch->arch.node_tree) {
+        free(arch->arch.node_tree->degrees);
+        free(arch->arch.node_tree->cost);
+        free(arch->arch.node_tree);
+    }
     free(arch->current_hosts);
     free(arch->node_slot_by_idx);
 
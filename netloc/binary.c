@@ -0,0 +1,799 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+/*
+ * Binary topology files.
+ *
+ * The file is made of a header followed by sections of fixed-size records
+ * (nodes, edges, links), a pool of integers (partition lists and links of
+ * edges), the forwarding tables and a table of NUL-terminated strings.
+ * Records refer to each other by index and to strings by offset in the
+ * string table. The file is mapped when loading, and the forwarding tables
+ * are used directly from the mapping.
+ *
+ * Records are stored in the native byte order, files are rejected on hosts
+ * with a different one.
+ */
+
+#define _GNU_SOURCE         /* See feature_test_macros(7) */
+#include <private/autogen/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include <private/netloc.h>
+
+#define NETLOC_BINARY_BYTE_ORDER 0x01020304
+#define NETLOC_BINARY_NONE UINT32_MAX
+
+struct netloc_binary_header {
+    char magic[8];              /* NETLOC_BINARY_MAGIC */
+    uint32_t version;           /* NETLOC_BINARY_VERSION */
+    uint32_t byte_order;        /* NETLOC_BINARY_BYTE_ORDER */
+    uint32_t subnet;            /* string */
+    uint32_t hwlocpath;         /* string or NETLOC_BINARY_NONE */
+    uint32_t num_nodes;
+    uint32_t num_edges;
+    uint32_t num_links;
+    uint32_t num_partitions;
+    uint32_t num_ints;
+    uint32_t num_hosts;
+    uint32_t num_lfts;
+    uint32_t flags;             /* unused, 0 */
+    uint64_t nodes_offset;
+    uint64_t edges_offset;
+    uint64_t links_offset;
+    uint64_t partitions_offset; /* strings of partition names */
+    uint64_t ints_offset;
+    uint64_t lfts_offset;       /* num_lfts tables of num_hosts ports */
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+
+struct netloc_binary_node {
+    char physical_id[20];
+    int32_t logical_id;
+    int32_t type;
+    uint32_t description;       /* string */
+    uint32_t hostname;          /* string */
+    uint32_t partitions;        /* in the integer pool */
+    uint32_t num_partitions;
+    uint32_t first_link;        /* links of the node are consecutive */
+    uint32_t num_links;
+    int32_t similar;            /* first similar node, -1 if none */
+    int32_t lft;                /* forwarding table, -1 if none */
+};
+
+struct netloc_binary_edge {
+    uint32_t id;                /* relative to the first edge */
+    uint32_t node;
+    uint32_t dest;
+    uint32_t reverse;           /* edge, NETLOC_BINARY_NONE if none */
+    float total_gbits;
+    uint32_t partitions;        /* in the integer pool */
+    uint32_t num_partitions;
+    uint32_t links;             /* link indexes in the integer pool */
+    uint32_t num_links;
+};
+
+struct netloc_binary_link {
+    int32_t id;
+    uint32_t src;
+    uint32_t dest;
+    int32_t ports[2];
+    uint32_t width;             /* string */
+    uint32_t speed;             /* string */
+    uint32_t description;       /* string */
+    float gbits;
+    int32_t other_way_id;
+    uint32_t partitions;        /* in the integer pool */
+    uint32_t num_partitions;
+};
+
+/**********************************************************************
+ *        Writing
+ **********************************************************************/
+
+/* Pointer to index tables for nodes, edges and links */
+typedef struct {
+    UT_hash_handle hh;
+    void *ptr;
+    uint32_t idx;
+} binary_index_t;
+
+/* String table with duplicates removed */
+typedef struct {
+    UT_hash_handle hh;
+    char *string; /* points in the table */
+    uint32_t offset;
+} binary_string_t;
+
+typedef struct {
+    binary_index_t *indexes;
+    binary_string_t *strings;
+    char *string_table;
+    size_t strings_size, strings_allocated;
+    uint32_t *ints;
+    uint32_t num_ints, ints_allocated;
+    int failed;
+} binary_writer_t;
+
+static void writer_set_index(binary_writer_t *writer, void *ptr, uint32_t idx)
+{
+    binary_index_t *index = (binary_index_t *)malloc(sizeof(*index));
+    if (!index) {
+        writer->failed = 1;
+        return;
+    }
+    index->ptr = ptr;
+    index->idx = idx;
+    HASH_ADD_PTR(writer->indexes, ptr, index);
+}
+
+static uint32_t writer_get_index(binary_writer_t *writer, void *ptr)
+{
+    binary_index_t *index;
+    HASH_FIND_PTR(writer->indexes, &ptr, index);
+    if (!index) {
+        writer->failed = 1;
+        return NETLOC_BINARY_NONE;
+    }
+    return index->idx;
+}
+
+static uint32_t writer_add_string(binary_writer_t *writer, const char *string)
+{
+    binary_string_t *entry;
+    size_t len;
+
+    if (!string)
+        return NETLOC_BINARY_NONE;
+
+    HASH_FIND_STR(writer->strings, string, entry);
+    if (entry)
+        return entry->offset;
+
+    len = strlen(string)+1;
+    if (writer->strings_size+len > writer->strings_allocated) {
+        size_t allocated = writer->strings_allocated ? 2*writer->strings_allocated : 4096;
+        while (allocated < writer->strings_size+len)
+            allocated *= 2;
+        char *table = (char *)realloc(writer->string_table, allocated);
+        if (!table) {
+            writer->failed = 1;
+            return NETLOC_BINARY_NONE;
+        }
+        /* Entries point in the table */
+        binary_string_t *cur, *tmp;
+        HASH_ITER(hh, writer->strings, cur, tmp) {
+            cur->string = table+cur->offset;
+        }
+        /* Keys moved, the hash table must be rebuilt */
+        binary_string_t *strings = writer->strings;
+        writer->strings = NULL;
+        HASH_ITER(hh, strings, cur, tmp) {
+            HASH_DEL(strings, cur);
+            HASH_ADD_KEYPTR(hh, writer->strings, cur->string, strlen(cur->string), cur);
+        }
+        writer->string_table = table;
+        writer->strings_allocated = allocated;
+    }
+
+    entry = (binary_string_t *)malloc(sizeof(*entry));
+    if (!entry || writer->strings_size > UINT32_MAX-len) {
+        free(entry);
+        writer->failed = 1;
+        return NETLOC_BINARY_NONE;
+    }
+    entry->offset = (uint32_t)writer->strings_size;
+    entry->string = writer->string_table+writer->strings_size;
+    memcpy(entry->string, string, len);
+    writer->strings_size += len;
+    HASH_ADD_KEYPTR(hh, writer->strings, entry->string, len-1, entry);
+    return entry->offset;
+}
+
+static uint32_t writer_add_int(binary_writer_t *writer, uint32_t value)
+{
+    if (writer->num_ints == writer->ints_allocated) {
+        uint32_t allocated = writer->ints_allocated ? 2*writer->ints_allocated : 1024;
+        uint32_t *ints = (uint32_t *)realloc(writer->ints, allocated*sizeof(uint32_t));
+        if (!ints) {
+            writer->failed = 1;
+            return 0;
+        }
+        writer->ints = ints;
+        writer->ints_allocated = allocated;
+    }
+    writer->ints[writer->num_ints] = value;
+    return writer->num_ints++;
+}
+
+static uint32_t writer_add_partitions(binary_writer_t *writer, UT_array *partitions,
+        uint32_t *num_partitions)
+{
+    uint32_t first = writer->num_ints;
+    *num_partitions = utarray_len(partitions);
+    for (unsigned int p = 0; p < utarray_len(partitions); p++)
+        writer_add_int(writer, (uint32_t)*(int *)utarray_eltptr(partitions, p));
+    return first;
+}
+
+/* Write a section aligned on 8 bytes, and return its offset */
+static uint64_t write_section(FILE *output, const void *data, size_t size, int *failed)
+{
+    static const char padding[8] = { 0 };
+    long offset = ftell(output);
+    if (offset < 0) {
+        *failed = 1;
+        return 0;
+    }
+    if (offset % 8) {
+        fwrite(padding, 8 - offset % 8, 1, output);
+        offset += 8 - offset % 8;
+    }
+    if (size && fwrite(data, size, 1, output) != 1)
+        *failed = 1;
+    return (uint64_t)offset;
+}
+
+int netloc_topology_write_binary(netloc_topology_t *topology, const char *path)
+{
+    binary_writer_t writer;
+    struct netloc_binary_header header;
+    struct netloc_binary_node *bnodes = NULL;
+    struct netloc_binary_edge *bedges = NULL;
+    struct netloc_binary_link *blinks = NULL;
+    uint32_t *bpartitions = NULL;
+    unsigned char *blfts = NULL;
+    netloc_node_t **nodes = NULL;
+    int *similar = NULL;
+    netloc_node_t *node, *node_tmp;
+    uint32_t num_nodes, num_edges = 0, num_links = 0, num_lfts = 0;
+    int min_edge_id = -1;
+    FILE *output = NULL;
+    int ret = NETLOC_ERROR;
+
+    memset(&writer, 0, sizeof(writer));
+    memset(&header, 0, sizeof(header));
+
+    /* Index everything */
+    num_nodes = HASH_COUNT(topology->nodes);
+    nodes = (netloc_node_t **)malloc(num_nodes*sizeof(netloc_node_t *));
+    similar = (int *)malloc(num_nodes*sizeof(int));
+    if (!nodes || !similar)
+        goto out;
+    uint32_t n = 0;
+    netloc_topology_iter_nodes(topology, node, node_tmp) {
+        if (utarray_len(node->subnodes)) {
+            fprintf(stderr, "Cannot write virtual nodes, the topology must be "
+                    "loaded with NETLOC_TOPOLOGY_LOAD_FLAG_RAW\n");
+            goto out;
+        }
+        nodes[n] = node;
+        writer_set_index(&writer, node, n);
+        n++;
+
+        netloc_edge_t *edge, *edge_tmp;
+        netloc_node_iter_edges(node, edge, edge_tmp) {
+            if (min_edge_id == -1 || edge->id < min_edge_id)
+                min_edge_id = edge->id;
+            writer_set_index(&writer, edge, num_edges++);
+        }
+        for (unsigned int l = 0; l < utarray_len(node->physical_links); l++) {
+            netloc_physical_link_t *link = *(netloc_physical_link_t **)
+                utarray_eltptr(node->physical_links, l);
+            writer_set_index(&writer, link, num_links++);
+        }
+        if (node->lft)
+            num_lfts++;
+    }
+    netloc_topology_get_similar_nodes(nodes, num_nodes, similar);
+
+    bnodes = (struct netloc_binary_node *)calloc(num_nodes, sizeof(*bnodes));
+    bedges = (struct netloc_binary_edge *)calloc(num_edges ? num_edges : 1, sizeof(*bedges));
+    blinks = (struct netloc_binary_link *)calloc(num_links ? num_links : 1, sizeof(*blinks));
+    bpartitions = (uint32_t *)calloc(utarray_len(topology->partitions)+1, sizeof(uint32_t));
+    blfts = (unsigned char *)malloc(num_lfts*topology->num_hosts+1);
+    if (!bnodes || !bedges || !blinks || !bpartitions || !blfts)
+        goto out;
+
+    /* Fill the records */
+    uint32_t e = 0, l = 0, t = 0;
+    for (n = 0; n < num_nodes; n++) {
+        struct netloc_binary_node *bnode = &bnodes[n];
+        node = nodes[n];
+
+        memcpy(bnode->physical_id, node->physical_id, sizeof(bnode->physical_id));
+        bnode->logical_id = node->logical_id;
+        bnode->type = node->type;
+        bnode->description = writer_add_string(&writer, node->description);
+        bnode->hostname = writer_add_string(&writer, node->hostname);
+        bnode->partitions = writer_add_partitions(&writer, node->partitions,
+                &bnode->num_partitions);
+        bnode->first_link = l;
+        bnode->num_links = utarray_len(node->physical_links);
+        bnode->similar = similar[n];
+        bnode->lft = -1;
+        if (node->lft) {
+            memcpy(blfts+t*topology->num_hosts, node->lft, topology->num_hosts);
+            bnode->lft = t++;
+        }
+
+        for (unsigned int i = 0; i < utarray_len(node->physical_links); i++, l++) {
+            netloc_physical_link_t *link = *(netloc_physical_link_t **)
+                utarray_eltptr(node->physical_links, i);
+            struct netloc_binary_link *blink = &blinks[l];
+            blink->id = link->id;
+            blink->src = n;
+            blink->dest = writer_get_index(&writer, link->dest);
+            blink->ports[0] = link->ports[0];
+            blink->ports[1] = link->ports[1];
+            blink->width = writer_add_string(&writer, link->width);
+            blink->speed = writer_add_string(&writer, link->speed);
+            blink->description = writer_add_string(&writer, link->description);
+            blink->gbits = link->gbits;
+            blink->other_way_id = link->other_way_id;
+            blink->partitions = writer_add_partitions(&writer, link->partitions,
+                    &blink->num_partitions);
+        }
+
+        netloc_edge_t *edge, *edge_tmp;
+        netloc_node_iter_edges(node, edge, edge_tmp) {
+            struct netloc_binary_edge *bedge = &bedges[e++];
+            bedge->id = (uint32_t)(edge->id - min_edge_id);
+            bedge->node = n;
+            bedge->dest = writer_get_index(&writer, edge->dest);
+            bedge->reverse = edge->other_way ?
+                writer_get_index(&writer, edge->other_way) : NETLOC_BINARY_NONE;
+            bedge->total_gbits = edge->total_gbits;
+            bedge->partitions = writer_add_partitions(&writer, edge->partitions,
+                    &bedge->num_partitions);
+            bedge->links = writer.num_ints;
+            bedge->num_links = netloc_edge_get_num_links(edge);
+            for (unsigned int i = 0; i < bedge->num_links; i++)
+                writer_add_int(&writer,
+                        writer_get_index(&writer, netloc_edge_get_link(edge, i)));
+        }
+    }
+
+    unsigned int p = 0;
+    char **ppartition;
+    netloc_topology_iter_partitions(topology, ppartition) {
+        bpartitions[p++] = writer_add_string(&writer, *ppartition);
+    }
+
+    memcpy(header.magic, NETLOC_BINARY_MAGIC, sizeof(header.magic));
+    header.version = NETLOC_BINARY_VERSION;
+    header.byte_order = NETLOC_BINARY_BYTE_ORDER;
+    header.subnet = writer_add_string(&writer, topology->subnet_id);
+    header.hwlocpath = writer_add_string(&writer, topology->hwlocpath);
+    header.num_nodes = num_nodes;
+    header.num_edges = num_edges;
+    header.num_links = num_links;
+    header.num_partitions = p;
+    header.num_ints = writer.num_ints;
+    header.num_hosts = topology->num_hosts;
+    header.num_lfts = num_lfts;
+    if (writer.failed) {
+        fprintf(stderr, "Cannot index the topology\n");
+        goto out;
+    }
+
+    /* Write the sections, then the header with their offsets */
+    output = fopen(path, "wb");
+    if (!output) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        goto out;
+    }
+    int failed = 0;
+    write_section(output, &header, sizeof(header), &failed);
+    header.nodes_offset = write_section(output, bnodes, num_nodes*sizeof(*bnodes), &failed);
+    header.edges_offset = write_section(output, bedges, num_edges*sizeof(*bedges), &failed);
+    header.links_offset = write_section(output, blinks, num_links*sizeof(*blinks), &failed);
+    header.partitions_offset = write_section(output, bpartitions,
+            header.num_partitions*sizeof(uint32_t), &failed);
+    header.ints_offset = write_section(output, writer.ints,
+            writer.num_ints*sizeof(uint32_t), &failed);
+    header.lfts_offset = write_section(output, blfts,
+            (size_t)num_lfts*topology->num_hosts, &failed);
+    header.strings_offset = write_section(output, writer.string_table,
+            writer.strings_size, &failed);
+    header.strings_size = writer.strings_size;
+    if (failed || fseek(output, 0, SEEK_SET) < 0
+            || fwrite(&header, sizeof(header), 1, output) != 1) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        fclose(output);
+        goto out;
+    }
+    if (fclose(output)) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        goto out;
+    }
+
+    ret = NETLOC_SUCCESS;
+
+out:
+    {
+        binary_index_t *index, *index_tmp;
+        HASH_ITER(hh, writer.indexes, index, index_tmp) {
+            HASH_DEL(writer.indexes, index);
+            free(index);
+        }
+        binary_string_t *string, *string_tmp;
+        HASH_ITER(hh, writer.strings, string, string_tmp) {
+            HASH_DEL(writer.strings, string);
+            free(string);
+        }
+    }
+    free(writer.string_table);
+    free(writer.ints);
+    free(nodes);
+    free(similar);
+    free(bnodes);
+    free(bedges);
+    free(blinks);
+    free(bpartitions);
+    free(blfts);
+    return ret;
+}
+
+/**********************************************************************
+ *        Reading
+ **********************************************************************/
+
+typedef struct {
+    const struct netloc_binary_header *header;
+    const struct netloc_binary_node *nodes;
+    const struct netloc_binary_edge *edges;
+    const struct netloc_binary_link *links;
+    const uint32_t *partitions;
+    const uint32_t *ints;
+    const unsigned char *lfts;
+    const char *strings;
+    int failed;
+} binary_reader_t;
+
+static int section_is_valid(uint64_t offset, uint64_t num, uint64_t size,
+        size_t file_size)
+{
+    if (offset % 8 || offset > file_size)
+        return 0;
+    if (size && num > (file_size - offset) / size)
+        return 0;
+    return 1;
+}
+
+static const char *reader_get_string(binary_reader_t *reader, uint32_t offset)
+{
+    if (offset == NETLOC_BINARY_NONE)
+        return NULL;
+    if (offset >= reader->header->strings_size) {
+        reader->failed = 1;
+        return "";
+    }
+    return reader->strings+offset;
+}
+
+static char *reader_dup_string(binary_reader_t *reader, uint32_t offset)
+{
+    const char *string = reader_get_string(reader, offset);
+    return strdup(string ? string : "");
+}
+
+static void reader_read_partitions(binary_reader_t *reader, uint32_t first,
+        uint32_t num, UT_array *partitions)
+{
+    if (first > reader->header->num_ints || num > reader->header->num_ints - first) {
+        reader->failed = 1;
+        return;
+    }
+    utarray_reserve(partitions, num);
+    for (uint32_t p = 0; p < num; p++) {
+        int partition = (int)reader->ints[first+p];
+        utarray_push_back(partitions, &partition);
+    }
+}
+
+static void *map_file(const char *path, size_t *size)
+{
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open topology file %s\n", path);
+        perror("open");
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(struct netloc_binary_header)) {
+        fprintf(stderr, "Cannot read the header of %s\n", path);
+        close(fd);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return NULL;
+    }
+#else
+    data = malloc(*size);
+    if (!data || read(fd, data, *size) != (ssize_t)*size) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        free(data);
+        close(fd);
+        return NULL;
+    }
+#endif
+
+    close(fd);
+    return data;
+}
+
+static void unmap_file(void *data, size_t size)
+{
+#ifdef HAVE_SYS_MMAN_H
+    munmap(data, size);
+#else
+    free(data);
+#endif
+}
+
+void netloc_topology_unmap_binary(netloc_topology_t *topology)
+{
+    unmap_file(topology->mapping, topology->mapping_size);
+    topology->mapping = NULL;
+    topology->mapping_size = 0;
+}
+
+netloc_topology_t *netloc_topology_read_binary(char *path, int **psimilar)
+{
+    binary_reader_t reader;
+    const struct netloc_binary_header *header;
+    netloc_topology_t *topology;
+    netloc_node_t **nodes = NULL;
+    netloc_edge_t **edges = NULL;
+    netloc_physical_link_t **links = NULL;
+    int *similar = NULL;
+    size_t size;
+    void *data;
+
+    data = map_file(path, &size);
+    if (!data)
+        return NULL;
+
+    memset(&reader, 0, sizeof(reader));
+    header = reader.header = (const struct netloc_binary_header *)data;
+
+    if (memcmp(header->magic, NETLOC_BINARY_MAGIC, sizeof(header->magic))
+            || header->version != NETLOC_BINARY_VERSION) {
+        fprintf(stderr, "Incorrect version number, "
+                "please convert your input file again\n");
+        unmap_file(data, size);
+        return NULL;
+    }
+    if (header->byte_order != NETLOC_BINARY_BYTE_ORDER) {
+        fprintf(stderr, "Binary topology file %s was written with "
+                "another byte order\n", path);
+        unmap_file(data, size);
+        return NULL;
+    }
+    if (!section_is_valid(header->nodes_offset, header->num_nodes,
+                sizeof(struct netloc_binary_node), size)
+            || !section_is_valid(header->edges_offset, header->num_edges,
+                sizeof(struct netloc_binary_edge), size)
+            || !section_is_valid(header->links_offset, header->num_links,
+                sizeof(struct netloc_binary_link), size)
+            || !section_is_valid(header->partitions_offset, header->num_partitions,
+                sizeof(uint32_t), size)
+            || !section_is_valid(header->ints_offset, header->num_ints,
+                sizeof(uint32_t), size)
+            || !section_is_valid(header->lfts_offset,
+                (uint64_t)header->num_lfts*header->num_hosts, 1, size)
+            || !section_is_valid(header->strings_offset, header->strings_size, 1, size)
+            || !header->strings_size
+            || ((const char *)data)[header->strings_offset+header->strings_size-1]
+            || !header->num_nodes || header->num_hosts > header->num_nodes) {
+        fprintf(stderr, "Corrupted binary topology file %s\n", path);
+        unmap_file(data, size);
+        return NULL;
+    }
+    reader.nodes = (const struct netloc_binary_node *)((const char *)data+header->nodes_offset);
+    reader.edges = (const struct netloc_binary_edge *)((const char *)data+header->edges_offset);
+    reader.links = (const struct netloc_binary_link *)((const char *)data+header->links_offset);
+    reader.partitions = (const uint32_t *)((const char *)data+header->partitions_offset);
+    reader.ints = (const uint32_t *)((const char *)data+header->ints_offset);
+    reader.lfts = (const unsigned char *)data+header->lfts_offset;
+    reader.strings = (const char *)data+header->strings_offset;
+
+    char *subnet = reader_dup_string(&reader, header->subnet);
+    const char *hwlocpath = reader_get_string(&reader, header->hwlocpath);
+    topology = netloc_topology_alloc(path, subnet,
+            hwlocpath && *hwlocpath ? strdup(hwlocpath) : NULL, (int)header->num_nodes);
+    if (!topology) {
+        unmap_file(data, size);
+        return NULL;
+    }
+    topology->mapping = data;
+    topology->mapping_size = size;
+
+    nodes = (netloc_node_t **)malloc(header->num_nodes*sizeof(netloc_node_t *));
+    edges = (netloc_edge_t **)malloc((header->num_edges+1)*sizeof(netloc_edge_t *));
+    links = (netloc_physical_link_t **)
+        malloc((header->num_links+1)*sizeof(netloc_physical_link_t *));
+    similar = (int *)malloc(header->num_nodes*sizeof(int));
+    if (!nodes || !edges || !links || !similar)
+        goto error;
+
+    /* Nodes */
+    for (uint32_t n = 0; n < header->num_nodes; n++) {
+        const struct netloc_binary_node *bnode = &reader.nodes[n];
+        netloc_node_t *node = netloc_node_construct();
+        nodes[n] = node;
+
+        memcpy(node->physical_id, bnode->physical_id, sizeof(node->physical_id));
+        node->physical_id[19] = '\0';
+        node->logical_id = bnode->logical_id;
+        node->type = bnode->type;
+        reader_read_partitions(&reader, bnode->partitions, bnode->num_partitions,
+                node->partitions);
+        node->description = reader_dup_string(&reader, bnode->description);
+        node->hostname = reader_dup_string(&reader, bnode->hostname);
+
+        if (netloc_node_is_host(node)) {
+            node->host_idx = topology->num_hosts;
+            topology->hosts[topology->num_hosts++] = node;
+        }
+        if (bnode->lft >= 0) {
+            if ((uint32_t)bnode->lft >= header->num_lfts)
+                reader.failed = 1;
+            else
+                node->lft = (unsigned char *)reader.lfts
+                    + (size_t)bnode->lft*header->num_hosts;
+        }
+        if (bnode->similar >= (int32_t)n
+                || (bnode->similar < 0 && bnode->similar != -1))
+            reader.failed = 1;
+        similar[n] = bnode->similar;
+
+        HASH_ADD_STR(topology->nodes, physical_id, node);
+        if (strlen(node->hostname) > 0) {
+            HASH_ADD_KEYPTR(hh2, topology->nodesByHostname, node->hostname,
+                    strlen(node->hostname), node);
+        }
+    }
+    if (reader.failed || (uint32_t)topology->num_hosts != header->num_hosts)
+        goto error;
+
+    /* Physical links */
+    for (uint32_t l = 0; l < header->num_links; l++) {
+        const struct netloc_binary_link *blink = &reader.links[l];
+        netloc_physical_link_t *link = netloc_physical_link_construct();
+        links[l] = link;
+
+        if (blink->src >= header->num_nodes || blink->dest >= header->num_nodes) {
+            netloc_physical_link_destruct(link);
+            goto error;
+        }
+        link->id = blink->id;
+        link->src = nodes[blink->src];
+        link->dest = nodes[blink->dest];
+        link->ports[0] = blink->ports[0];
+        link->ports[1] = blink->ports[1];
+        link->width = reader_dup_string(&reader, blink->width);
+        link->speed = reader_dup_string(&reader, blink->speed);
+        link->gbits = blink->gbits;
+        link->description = reader_dup_string(&reader, blink->description);
+        link->other_way_id = blink->other_way_id;
+        reader_read_partitions(&reader, blink->partitions, blink->num_partitions,
+                link->partitions);
+
+        HASH_ADD_INT(topology->physical_links, id, link);
+        utarray_push_back(link->src->physical_links, &link);
+    }
+    if (reader.failed)
+        goto error;
+
+    /* Edges, already sorted by destination */
+    int first_edge_id = -1;
+    for (uint32_t e = 0; e < header->num_edges; e++) {
+        const struct netloc_binary_edge *bedge = &reader.edges[e];
+        netloc_edge_t *edge = netloc_edge_construct();
+        edges[e] = edge;
+
+        /* Keep the ids of the text file */
+        if (first_edge_id == -1)
+            first_edge_id = edge->id;
+        if (bedge->node >= header->num_nodes || bedge->dest >= header->num_nodes
+                || bedge->id >= header->num_edges
+                || (bedge->reverse != NETLOC_BINARY_NONE
+                    && bedge->reverse >= header->num_edges)
+                || bedge->links > header->num_ints
+                || bedge->num_links > header->num_ints - bedge->links) {
+            netloc_edge_destruct(edge);
+            goto error;
+        }
+        edge->id = first_edge_id + (int)bedge->id;
+        edge->node = nodes[bedge->node];
+        edge->dest = nodes[bedge->dest];
+        edge->total_gbits = bedge->total_gbits;
+        reader_read_partitions(&reader, bedge->partitions, bedge->num_partitions,
+                edge->partitions);
+
+        utarray_reserve(edge->physical_links, bedge->num_links);
+        for (uint32_t i = 0; i < bedge->num_links; i++) {
+            uint32_t l = reader.ints[bedge->links+i];
+            if (l >= header->num_links) {
+                reader.failed = 1;
+                break;
+            }
+            links[l]->edge = edge;
+            utarray_push_back(edge->physical_links, &links[l]);
+        }
+
+        HASH_ADD_PTR(edge->node->edges, dest, edge);
+    }
+    if (reader.failed)
+        goto error;
+    for (uint32_t e = 0; e < header->num_edges; e++) {
+        uint32_t reverse = reader.edges[e].reverse;
+        if (reverse != NETLOC_BINARY_NONE)
+            edges[e]->other_way = edges[reverse];
+    }
+
+    /* Partitions */
+    for (uint32_t p = 0; p < header->num_partitions; p++) {
+        const char *partition = reader_get_string(&reader, reader.partitions[p]);
+        if (!partition)
+            partition = "";
+        utarray_push_back(topology->partitions, &partition);
+    }
+
+    for (uint32_t n = 0; n < header->num_nodes; n++)
+        netloc_node_index_ports(nodes[n]);
+
+    if (reader.failed)
+        goto error;
+
+    free(nodes);
+    free(edges);
+    free(links);
+    *psimilar = similar;
+    return topology;
+
+error:
+    fprintf(stderr, "Corrupted binary topology file %s\n", path);
+    free(nodes);
+    free(edges);
+    free(links);
+    free(similar);
+    /* The path belongs to the caller on failure */
+    topology->topopath = NULL;
+    netloc_topology_destruct(topology);
+    return NULL;
+}
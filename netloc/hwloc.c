@@ -19,8 +19,29 @@
 #include <netloc.h>
 #include <hwloc.h>
 
-static UT_icd topos_icd = {sizeof(hwloc_topology_t), NULL, NULL, NULL};
+typedef struct {
+    UT_hash_handle hh;       /* makes this structure hashable with name */
+    char *name;
+    int idx;
+} hwloc_topo_name_t;
 
+static char *get_hwloc_path(netloc_topology_t *topology)
+{
+    char *hwloc_path;
+
+    if (topology->hwlocpath[0] != '/') {
+        char *path_tmp = strdup(topology->topopath);
+        asprintf(&hwloc_path, "%s/%s", dirname(path_tmp), topology->hwlocpath);
+        free(path_tmp);
+    } else {
+        hwloc_path = strdup(topology->hwlocpath);
+    }
+    return hwloc_path;
+}
+
+/* Find the hwloc reference of the nodes, without loading the topologies. The
+ * nodes with the same reference share the same index, and the hwloc topology
+ * is only loaded when needed by netloc_topology_get_node_hwloc() */
 int netloc_topology_read_hwloc(netloc_topology_t *topology, int num_nodes,
         netloc_node_t **node_list)
 {
@@ -34,13 +55,7 @@ int netloc_topology_read_hwloc(netloc_topology_t *topology, int num_nodes,
         return NETLOC_ERROR;
     }
 
-    if (topology->hwlocpath[0] != '/') {
-        char *path_tmp = strdup(topology->topopath);
-        asprintf(&hwloc_path, "%s/%s", dirname(path_tmp), topology->hwlocpath);
-        free(path_tmp);
-    } else {
-        hwloc_path = strdup(topology->hwlocpath);
-    }
+    hwloc_path = get_hwloc_path(topology);
 
     DIR* dir = opendir(hwloc_path);
     /* Directory does not exist */
@@ -54,8 +69,17 @@ int netloc_topology_read_hwloc(netloc_topology_t *topology, int num_nodes,
     }
 
     UT_array *hwloc_topo_names = topology->topos;
-    UT_array *hwloc_topos;
-    utarray_new(hwloc_topos, &topos_icd);
+    hwloc_topo_name_t *names_by_name = NULL;
+    hwloc_topo_name_t *topo_name, *topo_name_tmp;
+
+    /* Index the references found by a previous call */
+    for (unsigned int t = 0; t < utarray_len(hwloc_topo_names); t++) {
+        topo_name = (hwloc_topo_name_t *)malloc(sizeof(hwloc_topo_name_t));
+        topo_name->name = *(char **)utarray_eltptr(hwloc_topo_names, t);
+        topo_name->idx = t;
+        HASH_ADD_KEYPTR(hh, names_by_name, topo_name->name,
+                strlen(topo_name->name), topo_name);
+    }
 
     int num_diffs = 0;
 
@@ -74,6 +98,7 @@ int netloc_topology_read_hwloc(netloc_topology_t *topology, int num_nodes,
         netloc_node_t *node = node_list[n];
         char *hwloc_file;
         char *refname;
+        int missing = 0;
 
         if (netloc_node_is_switch(node))
             continue;
@@ -88,81 +113,58 @@ int netloc_topology_read_hwloc(netloc_topology_t *topology, int num_nodes,
             num_diffs++;
         }
         else {
-            free(hwloc_file);
             /* We try to find a regular file */
-            asprintf(&hwloc_file, "%s/%s.xml", hwloc_path, node->hostname);
-            FILE *fxml;
-            if (!(fxml = fopen(hwloc_file, "r"))) {
-                printf("Missing hwloc file: %s\n", hwloc_file);
-            }
-            else
-                fclose(fxml);
             asprintf(&refname, "%s", node->hostname);
         }
+        free(hwloc_file);
 
         /* Add the hwloc topology */
-        unsigned int t = 0;
-        while (t < utarray_len(hwloc_topo_names) &&
-                strcmp(*(char **)utarray_eltptr(hwloc_topo_names, t), refname)) {
-            t++;
-        }
+        HASH_FIND_STR(names_by_name, refname, topo_name);
         /* Topology not found */
-        if (t == utarray_len(hwloc_topo_names)) {
+        if (!topo_name) {
+            int t = utarray_len(hwloc_topo_names);
+            hwloc_topology_t *hwloc_topos = (hwloc_topology_t *)
+                realloc(topology->hwloc_topos, (t+1)*sizeof(hwloc_topology_t));
+            if (!hwloc_topos) {
+                free(refname);
+                ret = NETLOC_ERROR;
+                goto ERROR;
+            }
+            hwloc_topos[t] = NULL;
+            topology->hwloc_topos = hwloc_topos;
             utarray_push_back(hwloc_topo_names, &refname);
 
-            /* Read the hwloc topology */
-            hwloc_topology_t topology;
-            hwloc_topology_init(&topology);
-            hwloc_topology_set_flags(topology, HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED);
+            topo_name = (hwloc_topo_name_t *)malloc(sizeof(hwloc_topo_name_t));
+            topo_name->name = *(char **)utarray_eltptr(hwloc_topo_names, t);
+            topo_name->idx = t;
+            HASH_ADD_KEYPTR(hh, names_by_name, topo_name->name,
+                    strlen(topo_name->name), topo_name);
 
+            /* Only check that the reference exists, it is read later */
             char *hwloc_ref_path;
             asprintf(&hwloc_ref_path, "%s/%s.xml", hwloc_path, refname);
-            ret = hwloc_topology_set_xml(topology, hwloc_ref_path);
-            free(hwloc_ref_path);
-            if (ret == -1) {
-                void *null = NULL;
-                utarray_push_back(hwloc_topos, &null);
+            FILE *fxml;
+            if (!(fxml = fopen(hwloc_ref_path, "r"))) {
+                printf("Missing hwloc file: %s\n", hwloc_ref_path);
                 fprintf(stdout, "Warning: no topology for %s\n", refname);
-                hwloc_topology_destroy(topology);
-                free(refname); free(hwloc_file);
-                continue;
-            }
-
-            ret = hwloc_topology_set_all_types_filter(topology, HWLOC_TYPE_FILTER_KEEP_STRUCTURE);
-            if (ret == -1) {
-                fprintf(stderr, "hwloc_topology_set_all_types_filter failed\n");
-                free(refname); free(hwloc_file);
-                goto ERROR;
+                missing = 1;
             }
-
-            ret = hwloc_topology_set_io_types_filter(topology, HWLOC_TYPE_FILTER_KEEP_NONE);
-            if (ret == -1) {
-                fprintf(stderr, "hwloc_topology_set_all_types_filter failed\n");
-                free(refname); free(hwloc_file);
-                goto ERROR;
-            }
-
-            ret = hwloc_topology_load(topology);
-            if (ret == -1) {
-                fprintf(stderr, "hwloc_topology_load failed\n");
-                free(refname); free(hwloc_file);
-                goto ERROR;
-            }
-            utarray_push_back(hwloc_topos, &topology);
+            else
+                fclose(fxml);
+            free(hwloc_ref_path);
         }
         free(refname);
-        free(hwloc_file);
-        node->hwlocTopo = *(hwloc_topology_t *)utarray_eltptr(hwloc_topos, t);
-        node->hwlocTopoIdx = t;
+        if (missing)
+            continue;
+        if (topology->hwloc_topos[topo_name->idx] != NETLOC_HWLOC_TOPO_FAILED)
+            node->hwlocTopo = topology->hwloc_topos[topo_name->idx];
+        node->hwlocTopoIdx = topo_name->idx;
     }
 
     if (!num_diffs) {
         printf("Warning: no hwloc diff file found!\n");
     }
 
-    topology->topos = hwloc_topo_names;
-    topology->hwloc_topos = (hwloc_topology_t *)hwloc_topos->d;
-
     printf("%d hwloc topologies found:\n", utarray_len(topology->topos));
     for (unsigned int p = 0; p < utarray_len(topology->topos); p++) {
         printf("\t'%s'\n", *(char **)utarray_eltptr(topology->topos, p));
@@ -171,21 +173,92 @@ int netloc_topology_read_hwloc(netloc_topology_t *topology, int num_nodes,
     ret = NETLOC_SUCCESS;
 
 ERROR:
+    HASH_ITER(hh, names_by_name, topo_name, topo_name_tmp) {
+        HASH_DEL(names_by_name, topo_name);
+        free(topo_name);
+    }
     if (all) {
         free(node_list);
     }
     free(hwloc_path);
-    if (ret == NETLOC_SUCCESS)
-        free(hwloc_topos);
-    else
-        utarray_free(hwloc_topos);
     return ret;
 }
 
+hwloc_topology_t netloc_topology_get_node_hwloc(netloc_topology_t *topology,
+        netloc_node_t *node)
+{
+    int ret;
+    int t = node->hwlocTopoIdx;
+
+    if (node->hwlocTopo)
+        return node->hwlocTopo;
+    if (t == -1)
+        return NULL;
+
+    /* Already failed for another node with the same reference */
+    if (topology->hwloc_topos[t] == NETLOC_HWLOC_TOPO_FAILED)
+        return NULL;
+
+    /* Already loaded for another node with the same reference */
+    if (topology->hwloc_topos[t]) {
+        node->hwlocTopo = topology->hwloc_topos[t];
+        return node->hwlocTopo;
+    }
+
+    char *refname = *(char **)utarray_eltptr(topology->topos, t);
+
+    /* Read the hwloc topology */
+    hwloc_topology_t hwloc_topology;
+    hwloc_topology_init(&hwloc_topology);
+    hwloc_topology_set_flags(hwloc_topology, HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED);
+
+    char *hwloc_path = get_hwloc_path(topology);
+    char *hwloc_ref_path;
+    asprintf(&hwloc_ref_path, "%s/%s.xml", hwloc_path, refname);
+    free(hwloc_path);
+    ret = hwloc_topology_set_xml(hwloc_topology, hwloc_ref_path);
+    free(hwloc_ref_path);
+    if (ret == -1) {
+        fprintf(stdout, "Warning: no topology for %s\n", refname);
+        goto ERROR;
+    }
+
+    ret = hwloc_topology_set_all_types_filter(hwloc_topology, HWLOC_TYPE_FILTER_KEEP_STRUCTURE);
+    if (ret == -1) {
+        fprintf(stderr, "hwloc_topology_set_all_types_filter failed\n");
+        goto ERROR;
+    }
+
+    ret = hwloc_topology_set_io_types_filter(hwloc_topology, HWLOC_TYPE_FILTER_KEEP_NONE);
+    if (ret == -1) {
+        fprintf(stderr, "hwloc_topology_set_all_types_filter failed\n");
+        goto ERROR;
+    }
+
+    ret = hwloc_topology_load(hwloc_topology);
+    if (ret == -1) {
+        fprintf(stderr, "hwloc_topology_load failed\n");
+        goto ERROR;
+    }
+
+    topology->hwloc_topos[t] = hwloc_topology;
+    node->hwlocTopo = hwloc_topology;
+    return hwloc_topology;
+
+ERROR:
+    hwloc_topology_destroy(hwloc_topology);
+    topology->hwloc_topos[t] = NETLOC_HWLOC_TOPO_FAILED;
+    return NULL;
+}
+
 /* Set the info from hwloc of the node in the correspondig arch */
-int netloc_arch_node_get_hwloc_info(netloc_arch_node_t *arch_node)
+int netloc_arch_node_get_hwloc_info(netloc_topology_t *netloc_topology,
+        netloc_arch_node_t *arch_node)
 {
-    hwloc_topology_t topology = arch_node->node->hwlocTopo;
+    hwloc_topology_t topology =
+        netloc_topology_get_node_hwloc(netloc_topology, arch_node->node);
+    if (!topology)
+        return NETLOC_ERROR;
 
     hwloc_obj_t root = hwloc_get_root_obj(topology);
 
@@ -48,7 +48,10 @@ netloc_node_t * netloc_node_construct(void)
     node->userdata     = NULL;
     node->edges        = NULL;
     utarray_new(node->subnodes, &node_physical_nodes_icd);
-    node->paths        = NULL;
+    node->host_idx     = -1;
+    node->lft          = NULL;
+    node->port_links   = NULL;
+    node->num_ports    = 0;
     node->hostname     = NULL;
     utarray_new(node->partitions, &node_partitions_icd);
     node->hwlocTopo = NULL;
@@ -84,12 +87,8 @@ static int node_or_subnode_destruct(netloc_node_t * node, int is_node)
     }
     utarray_free(node->subnodes);
 
-    /* Paths */
-    netloc_path_t *path, *path_tmp;
-    HASH_ITER(hh, node->paths, path, path_tmp) {
-        HASH_DEL(node->paths, path);  /* delete; path advances to next */
-        netloc_path_destruct(path);
-    }
+    /* Links by port, the forwarding table is stored in the topology */
+    free(node->port_links);
 
     /* Hostname */
     free(node->hostname);
@@ -104,6 +103,32 @@ static int node_or_subnode_destruct(netloc_node_t * node, int is_node)
     return NETLOC_SUCCESS;
 }
 
+int netloc_node_index_ports(netloc_node_t *node)
+{
+    for (unsigned int l = 0; l < utarray_len(node->physical_links); l++) {
+        netloc_physical_link_t *link = *(netloc_physical_link_t **)
+            utarray_eltptr(node->physical_links, l);
+        if (link->ports[0] > 0 && (unsigned int)link->ports[0] > node->num_ports)
+            node->num_ports = link->ports[0];
+    }
+    if (!node->num_ports)
+        return NETLOC_SUCCESS;
+
+    node->port_links = (netloc_physical_link_t **)
+        calloc(node->num_ports, sizeof(netloc_physical_link_t *));
+    if (!node->port_links) {
+        node->num_ports = 0;
+        return NETLOC_ERROR;
+    }
+    for (unsigned int l = 0; l < utarray_len(node->physical_links); l++) {
+        netloc_physical_link_t *link = *(netloc_physical_link_t **)
+            utarray_eltptr(node->physical_links, l);
+        if (link->ports[0] > 0)
+            node->port_links[link->ports[0]-1] = link;
+    }
+    return NETLOC_SUCCESS;
+}
+
 char *netloc_node_pretty_print(netloc_node_t* node)
 {
     char * str = NULL;
@@ -1,5 +1,5 @@
 /*
- * Copyright © 2016 Inria.  All rights reserved.
+ * Copyright © 2016-2020 Inria.  All rights reserved.
  *
  * $COPYRIGHT$
  *
@@ -14,18 +14,241 @@
 
 #include <private/netloc.h>
 
-netloc_path_t *netloc_path_construct(void)
+/* Paths longer than that are considered as routing loops */
+#define NETLOC_PATH_MAX_HOPS 64
+
+/* Follow the forwarding tables from src to dest. The links are stored in
+ * links if not NULL, and the length and bottleneck of the route in distance
+ * if not NULL. */
+static int route_walk(netloc_node_t *src, netloc_node_t *dest, UT_array *links,
+        netloc_distance_t *distance)
+{
+    netloc_physical_link_t *link;
+    netloc_node_t *cur;
+    int hops = 0;
+    float gbits = 0;
+
+    if (links)
+        utarray_clear(links);
+
+    if (src == dest || dest->host_idx == -1 || src->num_ports < 1)
+        return NETLOC_ERROR_NOT_FOUND;
+
+    /* Hosts send through their first port */
+    link = src->port_links[0];
+    while (link) {
+        if (links)
+            utarray_push_back(links, &link);
+        if (!hops || link->gbits < gbits)
+            gbits = link->gbits;
+        cur = link->dest;
+        if (cur == dest) {
+            if (distance) {
+                distance->hops = hops+1;
+                distance->gbits = gbits;
+            }
+            return NETLOC_SUCCESS;
+        }
+
+        if (!cur->lft || ++hops > NETLOC_PATH_MAX_HOPS)
+            break;
+        unsigned int port = cur->lft[dest->host_idx];
+        if (port < 1 || port > cur->num_ports)
+            break;
+        link = cur->port_links[port-1];
+    }
+
+    if (links)
+        utarray_clear(links);
+    return NETLOC_ERROR_NOT_FOUND;
+}
+
+int netloc_path_build(netloc_node_t *src, netloc_node_t *dest, UT_array *links)
+{
+    return route_walk(src, dest, links, NULL);
+}
+
+typedef struct {
+    UT_hash_handle hh;
+    netloc_node_t *node;
+    int hops;
+    float gbits;
+} bfs_node_t;
+
+/* Find the shortest paths from src in the graph of the physical links, for
+ * the hosts without a complete route. Among the shortest paths, the one with
+ * the widest bottleneck is kept. Hosts do not forward traffic. */
+static int distances_from_links(netloc_topology_t *topology, netloc_node_t *src,
+        netloc_distance_t *distances)
+{
+    bfs_node_t *visited = NULL;
+    bfs_node_t *bfs_node, *bfs_tmp;
+    UT_array *queue;
+    int ret = NETLOC_SUCCESS;
+
+    utarray_new(queue, &ut_ptr_icd);
+
+    bfs_node = (bfs_node_t *)malloc(sizeof(bfs_node_t));
+    if (!bfs_node) {
+        utarray_free(queue);
+        return NETLOC_ERROR;
+    }
+    bfs_node->node = src;
+    bfs_node->hops = 0;
+    bfs_node->gbits = 0;
+    HASH_ADD_PTR(visited, node, bfs_node);
+    utarray_push_back(queue, &bfs_node);
+
+    /* The queue is processed in order, so that all the nodes at a given
+     * distance are final before the next ones are expanded */
+    for (unsigned int q = 0; q < utarray_len(queue); q++) {
+        bfs_node_t *cur = *(bfs_node_t **)utarray_eltptr(queue, q);
+        if (cur->node != src && netloc_node_is_host(cur->node))
+            continue;
+
+        for (unsigned int l = 0; l < utarray_len(cur->node->physical_links); l++) {
+            netloc_physical_link_t *link = *(netloc_physical_link_t **)
+                utarray_eltptr(cur->node->physical_links, l);
+            float gbits = cur->hops && cur->gbits < link->gbits ?
+                cur->gbits : link->gbits;
+
+            HASH_FIND_PTR(visited, &link->dest, bfs_node);
+            if (bfs_node) {
+                if (bfs_node->hops == cur->hops+1 && gbits > bfs_node->gbits)
+                    bfs_node->gbits = gbits;
+                continue;
+            }
+
+            bfs_node = (bfs_node_t *)malloc(sizeof(bfs_node_t));
+            if (!bfs_node) {
+                ret = NETLOC_ERROR;
+                goto end;
+            }
+            bfs_node->node = link->dest;
+            bfs_node->hops = cur->hops+1;
+            bfs_node->gbits = gbits;
+            HASH_ADD_PTR(visited, node, bfs_node);
+            utarray_push_back(queue, &bfs_node);
+        }
+    }
+
+    for (int h = 0; h < topology->num_hosts; h++) {
+        if (distances[h].hops != -1)
+            continue;
+        HASH_FIND_PTR(visited, &topology->hosts[h], bfs_node);
+        if (bfs_node) {
+            distances[h].hops = bfs_node->hops;
+            distances[h].gbits = bfs_node->gbits;
+        }
+    }
+
+end:
+    HASH_ITER(hh, visited, bfs_node, bfs_tmp) {
+        HASH_DEL(visited, bfs_node);
+        free(bfs_node);
+    }
+    utarray_free(queue);
+    return ret;
+}
+
+int netloc_topology_get_distances(netloc_topology_t *topology,
+        netloc_node_t *src, netloc_distance_t **pdistances)
 {
-    netloc_path_t *path = (netloc_path_t *)
-        malloc(sizeof(netloc_path_t ));
-    utarray_new(path->links, &ut_ptr_icd);
+    int num_hosts = topology->num_hosts;
+    int missing = 0;
+    int ret;
+
+    if (src->host_idx < 0 || src->host_idx >= num_hosts)
+        return NETLOC_ERROR_NOT_FOUND;
+
+    if (!topology->distances) {
+        topology->distances = (netloc_distance_t **)
+            calloc(num_hosts, sizeof(netloc_distance_t *));
+        if (!topology->distances)
+            return NETLOC_ERROR;
+    }
+
+    if (topology->distances[src->host_idx]) {
+        *pdistances = topology->distances[src->host_idx];
+        return NETLOC_SUCCESS;
+    }
 
-    return path;
+    netloc_distance_t *distances = (netloc_distance_t *)
+        malloc(num_hosts*sizeof(netloc_distance_t));
+    if (!distances)
+        return NETLOC_ERROR;
+
+    for (int h = 0; h < num_hosts; h++) {
+        netloc_node_t *dest = topology->hosts[h];
+        if (dest == src) {
+            distances[h].hops = 0;
+            distances[h].gbits = 0;
+        } else if (route_walk(src, dest, NULL, &distances[h]) != NETLOC_SUCCESS) {
+            distances[h].hops = -1;
+            distances[h].gbits = 0;
+            missing++;
+        }
+    }
+
+    /* Without forwarding tables, or with incomplete ones */
+    if (missing) {
+        ret = distances_from_links(topology, src, distances);
+        if (ret != NETLOC_SUCCESS) {
+            free(distances);
+            return ret;
+        }
+    }
+
+    topology->distances[src->host_idx] = distances;
+    *pdistances = distances;
+    return NETLOC_SUCCESS;
 }
 
-int netloc_path_destruct(netloc_path_t *path)
+int netloc_topology_get_distance(netloc_topology_t *topology,
+        netloc_node_t *src, netloc_node_t *dest, netloc_distance_t *distance)
 {
-    utarray_free(path->links);
-    free(path);
+    netloc_distance_t *distances;
+    int ret;
+
+    if (dest->host_idx < 0)
+        return NETLOC_ERROR_NOT_FOUND;
+
+    ret = netloc_topology_get_distances(topology, src, &distances);
+    if (ret != NETLOC_SUCCESS)
+        return ret;
+
+    *distance = distances[dest->host_idx];
+    return distance->hops == -1 ? NETLOC_ERROR_NOT_FOUND : NETLOC_SUCCESS;
+}
+
+int netloc_topology_get_distance_matrix(netloc_topology_t *topology,
+        int num_nodes, netloc_node_t **nodes, netloc_distance_t *matrix)
+{
+    for (int n = 0; n < num_nodes; n++) {
+        if (nodes[n]->host_idx < 0)
+            return NETLOC_ERROR_NOT_FOUND;
+    }
+
+    for (int n1 = 0; n1 < num_nodes; n1++) {
+        netloc_distance_t *distances;
+        int ret = netloc_topology_get_distances(topology, nodes[n1], &distances);
+        if (ret != NETLOC_SUCCESS)
+            return ret;
+        for (int n2 = 0; n2 < num_nodes; n2++) {
+            matrix[n1*num_nodes+n2] = distances[nodes[n2]->host_idx];
+        }
+    }
+
     return NETLOC_SUCCESS;
 }
+
+void netloc_topology_free_distances(netloc_topology_t *topology)
+{
+    if (!topology->distances)
+        return;
+    for (int h = 0; h < topology->num_hosts; h++) {
+        free(topology->distances[h]);
+    }
+    free(topology->distances);
+    topology->distances = NULL;
+}
@@ -86,3 +86,12 @@ char * netloc_link_pretty_print(netloc_physical_link_t* link)
 }
 
 
+
+int netloc_link_is_in_partition(netloc_physical_link_t *link, int partition)
+{
+    for (unsigned int i = 0; i < netloc_get_num_partitions(link); i++) {
+        if (netloc_get_partition(link, i) == partition)
+            return 1;
+    }
+    return NETLOC_SUCCESS;
+}
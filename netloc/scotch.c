@@ -22,6 +22,7 @@
 #include <hwloc.h>
 
 static int arch_tree_to_scotch_arch(netloc_arch_tree_t *tree, SCOTCH_Arch *scotch);
+static int arch_graph_to_scotch_arch(netloc_arch_graph_t *graph, SCOTCH_Arch *scotch);
 static int comm_matrix_to_scotch_graph(double **matrix, int n, SCOTCH_Graph *graph);
 static int netlocscotch_get_mapping_from_graph(SCOTCH_Graph *graph,
         netlocscotch_core_t **pcores);
@@ -64,6 +65,46 @@ int arch_tree_to_scotch_arch(netloc_arch_tree_t *tree, SCOTCH_Arch *scotch)
     return NETLOC_SUCCESS;
 }
 
+/* Convert a netloc graph to a scotch decomposition-defined architecture,
+ * whose terminals are the hosts */
+int arch_graph_to_scotch_arch(netloc_arch_graph_t *graph, SCOTCH_Arch *scotch)
+{
+    int ret;
+    SCOTCH_Graph scotch_graph;
+    SCOTCH_Strat strategy;
+
+    SCOTCH_graphInit(&scotch_graph);
+    ret = SCOTCH_graphBuild(&scotch_graph, 0, graph->num_vertices,
+            graph->verttab, NULL, NULL, NULL, graph->verttab[graph->num_vertices],
+            graph->edgetab, graph->edlotab);
+    if (ret != 0) {
+        fprintf(stderr, "Error: SCOTCH_graphBuild failed\n");
+        SCOTCH_graphExit(&scotch_graph);
+        return NETLOC_ERROR;
+    }
+
+    /* Hosts are the first vertices */
+    SCOTCH_Num *host_list = (SCOTCH_Num *)
+        malloc(graph->num_hosts*sizeof(SCOTCH_Num));
+    for (int h = 0; h < graph->num_hosts; h++) {
+        host_list[h] = h;
+    }
+
+    SCOTCH_stratInit(&strategy);
+    ret = SCOTCH_archBuild(scotch, &scotch_graph, graph->num_hosts, host_list,
+            &strategy);
+    SCOTCH_stratExit(&strategy);
+    SCOTCH_graphExit(&scotch_graph);
+    free(host_list);
+
+    if (ret != 0) {
+        fprintf(stderr, "Error: SCOTCH_archBuild failed\n");
+        return NETLOC_ERROR;
+    }
+
+    return NETLOC_SUCCESS;
+}
+
 static int build_subgraph(SCOTCH_Graph *graph, int *vertices, int num_vertices,
         SCOTCH_Graph *nodegraph)
 {
@@ -186,7 +227,10 @@ static int build_current_arch(SCOTCH_Arch *scotch_arch,
     }
 
     SCOTCH_archInit(scotch_arch);
-    ret = arch_tree_to_scotch_arch(arch->arch.global_tree, scotch_arch);
+    if (arch->type == NETLOC_ARCH_TREE)
+        ret = arch_tree_to_scotch_arch(arch->arch.global_tree, scotch_arch);
+    else
+        ret = arch_graph_to_scotch_arch(arch->graph, scotch_arch);
     if (NETLOC_SUCCESS != ret) {
         return ret;
     }
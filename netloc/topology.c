@@ -22,16 +22,22 @@
 static char *line_get_next_field(char **string);
 static void read_partition_list(char *list, UT_array *array);
 static int edges_sort_by_dest(netloc_edge_t *a, netloc_edge_t *b);
+static netloc_topology_t *topology_read_text(char *path, FILE *input);
 static int find_reverse_edges(netloc_topology_t *topology);
-static int find_similar_nodes(netloc_topology_t *topology);
+static int find_similar_nodes(netloc_topology_t *topology, int *similar);
 static int netloc_node_get_virtual_id(char *id);
 static int edge_merge_into(netloc_edge_t *dest, netloc_edge_t *src, int keep);
 
 netloc_topology_t *netloc_topology_construct(char *path)
+{
+    return netloc_topology_load(path, 0);
+}
+
+netloc_topology_t *netloc_topology_load(char *path, unsigned long flags)
 {
     int ret;
-    char *line = NULL;
-    size_t linesize = 0;
+    int *similar = NULL;
+    char magic[sizeof(NETLOC_BINARY_MAGIC)-1];
 
     netloc_topology_t *topology = NULL;
 
@@ -43,6 +49,107 @@ netloc_topology_t *netloc_topology_construct(char *path)
         exit(-1);
     }
 
+    if (fread(magic, sizeof(magic), 1, input) == 1
+            && !memcmp(magic, NETLOC_BINARY_MAGIC, sizeof(magic))) {
+        fclose(input);
+        topology = netloc_topology_read_binary(path, &similar);
+        if (!topology)
+            return NULL;
+    } else {
+        rewind(input);
+        topology = topology_read_text(path, input);
+        if (!topology)
+            return NULL;
+
+        if (find_reverse_edges(topology) != NETLOC_SUCCESS) {
+            netloc_topology_destruct(topology);
+            return NULL;
+        }
+    }
+
+    if (flags & NETLOC_TOPOLOGY_LOAD_FLAG_RAW) {
+        free(similar);
+        return topology;
+    }
+
+    ret = find_similar_nodes(topology, similar);
+    free(similar);
+    if (ret != NETLOC_SUCCESS) {
+        netloc_topology_destruct(topology);
+        return NULL;
+    }
+
+    return topology;
+}
+
+netloc_topology_t *netloc_topology_alloc(char *path, char *subnet,
+        char *hwlocpath, int num_nodes)
+{
+    netloc_topology_t *topology;
+
+    if (hwlocpath) {
+        DIR *hwlocdir;
+        char *realhwlocpath;
+        if (hwlocpath[0] != '/') {
+            char *path_tmp = strdup(path);
+            asprintf(&realhwlocpath, "%s/%s", dirname(path_tmp), hwlocpath);
+            free(path_tmp);
+        } else {
+            realhwlocpath = strdup(hwlocpath);
+        }
+        if (!(hwlocdir = opendir(realhwlocpath))) {
+            fprintf(stderr, "Couldn't open hwloc directory: \"%s\"\n", realhwlocpath);
+            perror("opendir");
+            free(subnet);
+            free(hwlocpath);
+            free(realhwlocpath);
+            return NULL;
+        } else {
+            closedir(hwlocdir);
+            free(realhwlocpath);
+        }
+    }
+
+    /*
+     * Allocate Memory
+     */
+    topology = (netloc_topology_t *)malloc(sizeof(netloc_topology_t) * 1);
+    if( NULL == topology ) {
+        free(subnet);
+        free(hwlocpath);
+        return NULL;
+    }
+
+    /*
+     * Initialize the structure
+     */
+    topology->topopath = path;
+    topology->hwlocpath = hwlocpath;
+    topology->subnet_id = subnet;
+    topology->nodes          = NULL;
+    topology->physical_links = NULL;
+    topology->type           = NETLOC_TOPOLOGY_TYPE_INVALID ;
+    topology->nodesByHostname = NULL;
+    topology->hwloc_topos = NULL;
+    topology->hosts = (netloc_node_t **)malloc(sizeof(netloc_node_t *)*num_nodes);
+    topology->num_hosts = 0;
+    topology->lfts = NULL;
+    topology->mapping = NULL;
+    topology->mapping_size = 0;
+    topology->distances = NULL;
+    utarray_new(topology->partitions, &ut_str_icd);
+    utarray_new(topology->topos, &ut_str_icd);
+
+    return topology;
+}
+
+static netloc_topology_t *topology_read_text(char *path, FILE *input)
+{
+    char *line = NULL;
+    size_t linesize = 0;
+
+    netloc_topology_t *topology = NULL;
+
     int version;
     if (fscanf(input , "%d\n,", &version) != 1) {
         fprintf(stderr, "Cannot read the version number in %s\n", path);
@@ -80,34 +187,12 @@ netloc_topology_t *netloc_topology_construct(char *path)
         hwlocpath = strdup(line);
     }
 
-    if (hwlocpath) {
-        DIR *hwlocdir;
-        char *realhwlocpath;
-        if (hwlocpath[0] != '/') {
-            char *path_tmp = strdup(path);
-            asprintf(&realhwlocpath, "%s/%s", dirname(path_tmp), hwlocpath);
-            free(path_tmp);
-        } else {
-            realhwlocpath = strdup(hwlocpath);
-        }
-        if (!(hwlocdir = opendir(realhwlocpath))) {
-            fprintf(stderr, "Couldn't open hwloc directory: \"%s\"\n", realhwlocpath);
-            perror("opendir");
-            free(subnet);
-            free(realhwlocpath);
-            fclose(input);
-            return NULL;
-        } else {
-            closedir(hwlocdir);
-            free(realhwlocpath);
-        }
-    }
-
     int num_nodes;
     if (fscanf(input , "%d\n", &num_nodes) != 1) {
         fprintf(stderr, "Cannot read the number of nodes in %s\n", path);
         perror("fscanf");
         free(subnet);
+        free(hwlocpath);
         fclose(input);
         return NULL;
     }
@@ -116,34 +201,17 @@ netloc_topology_t *netloc_topology_construct(char *path)
         fprintf(stderr, "Oups: incorrect number of nodes (%d) in %s\n",
                 num_nodes, path);
         free(subnet);
+        free(hwlocpath);
         fclose(input);
         return NULL;
     }
 
-    /*
-     * Allocate Memory
-     */
-    topology = (netloc_topology_t *)malloc(sizeof(netloc_topology_t) * 1);
-    if( NULL == topology ) {
-        free(subnet);
+    topology = netloc_topology_alloc(path, subnet, hwlocpath, num_nodes);
+    if (!topology) {
         fclose(input);
         return NULL;
     }
 
-    /*
-     * Initialize the structure
-     */
-    topology->topopath = path;
-    topology->hwlocpath = hwlocpath;
-    topology->subnet_id = subnet;
-    topology->nodes          = NULL;
-    topology->physical_links = NULL;
-    topology->type           = NETLOC_TOPOLOGY_TYPE_INVALID ;
-    topology->nodesByHostname = NULL;
-    topology->hwloc_topos = NULL;
-    utarray_new(topology->partitions, &ut_str_icd);
-    utarray_new(topology->topos, &ut_str_icd);
-
     /* Read nodes from file */
     for (int n = 0; n < num_nodes; n++) {
         netloc_node_t *node = netloc_node_construct();
@@ -159,6 +227,11 @@ netloc_topology_t *netloc_topology_construct(char *path)
         node->description = strdup(line_get_next_field(&remain_line));
         node->hostname = strdup(line_get_next_field(&remain_line));
 
+        if (netloc_node_is_host(node)) {
+            node->host_idx = topology->num_hosts;
+            topology->hosts[topology->num_hosts++] = node;
+        }
+
         HASH_ADD_STR(topology->nodes, physical_id, node);
         if (strlen(node->hostname) > 0) {
             HASH_ADD_KEYPTR(hh2, topology->nodesByHostname, node->hostname,
@@ -210,6 +283,7 @@ netloc_topology_t *netloc_topology_construct(char *path)
 
                 link->src = node;
                 link->dest = edge->dest;
+                link->edge = edge;
 
                 link->ports[0] = atoi(line_get_next_field(&remain_line));
                 link->ports[1] = atoi(line_get_next_field(&remain_line));
@@ -231,6 +305,8 @@ netloc_topology_t *netloc_topology_construct(char *path)
 
         }
         HASH_SRT(hh, node->edges, edges_sort_by_dest);
+
+        netloc_node_index_ports(node);
     }
 
     /* Read partitions from file */
@@ -244,47 +320,49 @@ netloc_topology_t *netloc_topology_construct(char *path)
         }
     }
 
-    /* Read paths */
+    /* Read forwarding tables: the output port toward each host. They are
+     * stored in a single block owned by the topology. */
+    UT_array *lft_nodes;
+    utarray_new(lft_nodes, &ut_ptr_icd);
+    size_t lft_size = topology->num_hosts ? topology->num_hosts : 1;
     while (netloc_line_get(&line, &linesize, input) != -1) {
         netloc_node_t *node;
-        netloc_path_t *path;
         char *field;
 
         char *remain_line = line;
-        char *src_id = line_get_next_field(&remain_line);
-        char *dest_id = line_get_next_field(&remain_line);
+        char *node_id = line_get_next_field(&remain_line);
 
-        HASH_FIND_STR(topology->nodes, src_id, node);
-
-        path = netloc_path_construct();
-        strncpy(path->dest_id, dest_id, 20); /* Should be shorter than 20 */
-        path->dest_id[19] = '\0'; /* If a problem occurs */
-
-        while ((field = line_get_next_field(&remain_line))) {
-            int link_id = atoi(field);
-            netloc_physical_link_t *link;
-
-            HASH_FIND_INT(topology->physical_links, &link_id, link);
-            utarray_push_back(path->links, &link);
+        HASH_FIND_STR(topology->nodes, node_id, node);
+        if (!node) {
+            fprintf(stderr, "Node not found: %s\n", node_id);
+            continue;
         }
 
-        HASH_ADD_STR(node->paths, dest_id, path);
+        unsigned int num_lfts = utarray_len(lft_nodes);
+        unsigned char *lfts = (unsigned char *)
+            realloc(topology->lfts, (num_lfts+1)*lft_size);
+        if (!lfts) {
+            fprintf(stderr, "Cannot allocate forwarding tables\n");
+            break;
+        }
+        topology->lfts = lfts;
+        unsigned char *lft = lfts+num_lfts*lft_size;
+        memset(lft, 0, lft_size);
+        for (int h = 0; h < topology->num_hosts &&
+                (field = line_get_next_field(&remain_line)); h++) {
+            lft[h] = (unsigned char)atoi(field);
+        }
+        utarray_push_back(lft_nodes, &node);
     }
+    for (unsigned int l = 0; l < utarray_len(lft_nodes); l++) {
+        netloc_node_t *node = *(netloc_node_t **)utarray_eltptr(lft_nodes, l);
+        node->lft = topology->lfts+l*lft_size;
+    }
+    utarray_free(lft_nodes);
 
     fclose(input);
     free(line);
 
-    if (find_reverse_edges(topology) != NETLOC_SUCCESS) {
-        netloc_topology_destruct(topology);
-        return NULL;
-    }
-
-    ret = find_similar_nodes(topology);
-    if (ret != NETLOC_SUCCESS) {
-        netloc_topology_destruct(topology);
-        return NULL;
-    }
-
     return topology;
 }
 
@@ -316,6 +394,14 @@ int netloc_topology_destruct(netloc_topology_t *topology)
     /** Partition List */
     utarray_free(topology->partitions);
 
+    /** Hosts and forwarding tables */
+    netloc_topology_free_distances(topology);
+    free(topology->hosts);
+    if (topology->mapping)
+        netloc_topology_unmap_binary(topology);
+    else
+        free(topology->lfts);
+
     /** Physical links */
     netloc_physical_link_t *link, *link_tmp;
     HASH_ITER(hh, topology->physical_links, link, link_tmp) {
@@ -325,7 +411,8 @@ int netloc_topology_destruct(netloc_topology_t *topology)
 
     /** Hwloc topology List */
     for (unsigned int t = 0; t < utarray_len(topology->topos); t++) {
-        if (topology->hwloc_topos[t])
+        if (topology->hwloc_topos[t]
+                && topology->hwloc_topos[t] != NETLOC_HWLOC_TOPO_FAILED)
             hwloc_topology_destroy(topology->hwloc_topos[t]);
     }
     free(topology->hwloc_topos);
@@ -406,26 +493,22 @@ static int find_reverse_edges(netloc_topology_t *topology)
     return NETLOC_SUCCESS;
 }
 
-static int find_similar_nodes(netloc_topology_t * topology)
+/* Find the switches connected to the same nodes: similar[idx] is set to the
+ * index of the first node similar to nodes[idx], or -1 */
+int netloc_topology_get_similar_nodes(netloc_node_t **nodes, int num_nodes,
+        int *similar)
 {
-    int ret;
-
     /* Build edge lists by node */
-    int num_nodes = HASH_COUNT(topology->nodes);
-    netloc_node_t **nodes = (netloc_node_t **)malloc(num_nodes*sizeof(netloc_node_t *));
     netloc_node_t ***edgedest_by_node = (netloc_node_t ***)malloc(num_nodes*sizeof(netloc_node_t **));
     int *num_edges_by_node = (int *)malloc(num_nodes*sizeof(int));
-    netloc_node_t *node, *node_tmp;
-    int idx = -1;
-    netloc_topology_iter_nodes(topology, node, node_tmp) {
-        idx++;
+    for (int idx = 0; idx < num_nodes; idx++) {
+        netloc_node_t *node = nodes[idx];
+        similar[idx] = -1;
         if (netloc_node_is_host(node)) {
-            nodes[idx] = NULL;
             edgedest_by_node[idx] = NULL;
             continue;
         }
         int num_edges = HASH_COUNT(node->edges);
-        nodes[idx] = node;
         num_edges_by_node[idx] = num_edges;
         edgedest_by_node[idx] = (netloc_node_t **)malloc(num_edges*sizeof(netloc_node_t *));
 
@@ -438,22 +521,14 @@ static int find_similar_nodes(netloc_topology_t * topology)
     }
 
     /* We compare the edge lists to find similar nodes */
-    UT_array *similar_nodes;
-    utarray_new(similar_nodes, &ut_ptr_icd);
     for (int idx1 = 0; idx1 < num_nodes; idx1++) {
-        netloc_node_t *node1 = nodes[idx1];
-        netloc_node_t *virtual_node = NULL;
-        netloc_edge_t *first_virtual_edge = NULL;
-        if (!node1)
+        if (!edgedest_by_node[idx1] || similar[idx1] != -1)
             continue;
         for (int idx2 = idx1+1; idx2 < num_nodes; idx2++) {
-            netloc_node_t *node2 = nodes[idx2];
-            if (!node2)
+            if (!edgedest_by_node[idx2] || similar[idx2] != -1)
                 continue;
             if (num_edges_by_node[idx2] != num_edges_by_node[idx1])
                 continue;
-            if (idx2 == idx1)
-                continue;
 
             int equal = 1;
             for (int i = 0; i < num_edges_by_node[idx1]; i++) {
@@ -462,114 +537,160 @@ static int find_similar_nodes(netloc_topology_t * topology)
                     break;
                 }
             }
+            if (equal)
+                similar[idx2] = idx1;
+        }
+    }
 
-            /* If we have similar nodes */
-            if (equal) {
-                /* We create a new virtual node to contain all of them */
-                if (!virtual_node) {
-                    virtual_node = netloc_node_construct();
-                    netloc_node_get_virtual_id(virtual_node->physical_id);
-
-                    virtual_node->type = node1->type;
-                    utarray_concat(virtual_node->physical_links, node1->physical_links);
-                    virtual_node->description = strdup(virtual_node->physical_id);
-
-                    utarray_push_back(virtual_node->subnodes, &node1);
-                    utarray_concat(virtual_node->partitions, node1->partitions);
-
-                    // TODO paths
-
-                    /* Set edges */
-                    netloc_edge_t *edge1, *edge_tmp1;
-                    netloc_node_iter_edges(node1, edge1, edge_tmp1) {
-                        netloc_edge_t *virtual_edge = netloc_edge_construct();
-                        if (!first_virtual_edge)
-                            first_virtual_edge = virtual_edge;
-                        virtual_edge->node = virtual_node;
-                        virtual_edge->dest = edge1->dest;
-                        ret = edge_merge_into(virtual_edge, edge1, 0);
-                        if (ret != NETLOC_SUCCESS) {
-                            netloc_edge_destruct(virtual_edge);
-                            goto ERROR;
-                        }
-                        HASH_ADD_PTR(virtual_node->edges, dest, virtual_edge);
-
-                        /* Change the reverse edge of the neighbours (reverse nodes) */
-                        netloc_node_t *reverse_node = edge1->dest;
-                        netloc_edge_t *reverse_edge = edge1->other_way;
-
-                        netloc_edge_t *reverse_virtual_edge =
-                            netloc_edge_construct();
-                        reverse_virtual_edge->dest = virtual_node;
-                        reverse_virtual_edge->node = reverse_node;
-                        reverse_virtual_edge->other_way = virtual_edge;
-                        virtual_edge->other_way = reverse_virtual_edge;
-                        HASH_ADD_PTR(reverse_node->edges, dest, reverse_virtual_edge);
-                        ret = edge_merge_into(reverse_virtual_edge, reverse_edge, 1);
-                        if (ret != NETLOC_SUCCESS) {
-                            goto ERROR;
-                        }
-                        HASH_DEL(reverse_node->edges, reverse_edge);
-                    }
+    for (int idx = 0; idx < num_nodes; idx++) {
+        if (edgedest_by_node[idx])
+            free(edgedest_by_node[idx]);
+    }
+    free(edgedest_by_node);
+    free(num_edges_by_node);
+    return NETLOC_SUCCESS;
+}
 
-                    /* We remove the node from the list of nodes */
-                    HASH_DEL(topology->nodes, node1);
-                    HASH_ADD_STR(topology->nodes, physical_id, virtual_node);
-                    printf("First node found: %s (%s)\n", node1->description, node1->physical_id);
-                }
+/* Merge similar nodes into virtual nodes. If similar is NULL, it is computed
+ * from the current nodes, otherwise it comes from a binary file. */
+static int find_similar_nodes(netloc_topology_t * topology, int *similar)
+{
+    int ret;
 
-                utarray_concat(virtual_node->physical_links, node2->physical_links);
-                utarray_push_back(virtual_node->subnodes, &node2);
-                utarray_concat(virtual_node->partitions, node2->partitions);
+    int num_nodes = HASH_COUNT(topology->nodes);
+    netloc_node_t **nodes = (netloc_node_t **)malloc(num_nodes*sizeof(netloc_node_t *));
+    int *next_similar = (int *)malloc(num_nodes*sizeof(int));
+    int *last_similar = (int *)malloc(num_nodes*sizeof(int));
+    int *computed_similar = NULL;
+    netloc_node_t *node, *node_tmp;
+    int idx = -1;
+    netloc_topology_iter_nodes(topology, node, node_tmp) {
+        idx++;
+        nodes[idx] = node;
+    }
+
+    if (!similar) {
+        computed_similar = (int *)malloc(num_nodes*sizeof(int));
+        netloc_topology_get_similar_nodes(nodes, num_nodes, computed_similar);
+        similar = computed_similar;
+    }
+
+    /* Chain the nodes similar to each first one */
+    for (idx = 0; idx < num_nodes; idx++) {
+        next_similar[idx] = -1;
+        last_similar[idx] = idx;
+        if (similar[idx] != -1) {
+            assert(similar[idx] < idx);
+            next_similar[last_similar[similar[idx]]] = idx;
+            last_similar[similar[idx]] = idx;
+        }
+    }
+
+    for (int idx1 = 0; idx1 < num_nodes; idx1++) {
+        netloc_node_t *node1 = nodes[idx1];
+        netloc_node_t *virtual_node = NULL;
+        netloc_edge_t *first_virtual_edge = NULL;
+        if (similar[idx1] != -1)
+            continue;
+        for (int idx2 = next_similar[idx1]; idx2 != -1; idx2 = next_similar[idx2]) {
+            netloc_node_t *node2 = nodes[idx2];
+
+            /* We create a new virtual node to contain all of them */
+            if (!virtual_node) {
+                virtual_node = netloc_node_construct();
+                netloc_node_get_virtual_id(virtual_node->physical_id);
+
+                virtual_node->type = node1->type;
+                utarray_concat(virtual_node->physical_links, node1->physical_links);
+                virtual_node->description = strdup(virtual_node->physical_id);
+
+                utarray_push_back(virtual_node->subnodes, &node1);
+                utarray_concat(virtual_node->partitions, node1->partitions);
+
+                // TODO paths
 
                 /* Set edges */
-                netloc_edge_t *edge2, *edge_tmp2;
-                netloc_edge_t *virtual_edge = first_virtual_edge;
-                netloc_node_iter_edges(node2, edge2, edge_tmp2) {
-                    /* Merge the edges from the physical node into the virtual node */
-                    ret = edge_merge_into(virtual_edge, edge2, 0);
+                netloc_edge_t *edge1, *edge_tmp1;
+                netloc_node_iter_edges(node1, edge1, edge_tmp1) {
+                    netloc_edge_t *virtual_edge = netloc_edge_construct();
+                    if (!first_virtual_edge)
+                        first_virtual_edge = virtual_edge;
+                    virtual_edge->node = virtual_node;
+                    virtual_edge->dest = edge1->dest;
+                    ret = edge_merge_into(virtual_edge, edge1, 0);
                     if (ret != NETLOC_SUCCESS) {
+                        netloc_edge_destruct(virtual_edge);
                         goto ERROR;
                     }
+                    HASH_ADD_PTR(virtual_node->edges, dest, virtual_edge);
 
                     /* Change the reverse edge of the neighbours (reverse nodes) */
-                    netloc_node_t *reverse_node = edge2->dest;
-                    netloc_edge_t *reverse_edge = edge2->other_way;
-
-                    netloc_edge_t *reverse_virtual_edge;
-                    HASH_FIND_PTR(reverse_node->edges, &virtual_node,
-                            reverse_virtual_edge);
+                    netloc_node_t *reverse_node = edge1->dest;
+                    netloc_edge_t *reverse_edge = edge1->other_way;
+
+                    netloc_edge_t *reverse_virtual_edge =
+                        netloc_edge_construct();
+                    reverse_virtual_edge->dest = virtual_node;
+                    reverse_virtual_edge->node = reverse_node;
+                    reverse_virtual_edge->other_way = virtual_edge;
+                    virtual_edge->other_way = reverse_virtual_edge;
+                    HASH_ADD_PTR(reverse_node->edges, dest, reverse_virtual_edge);
                     ret = edge_merge_into(reverse_virtual_edge, reverse_edge, 1);
                     if (ret != NETLOC_SUCCESS) {
                         goto ERROR;
                     }
                     HASH_DEL(reverse_node->edges, reverse_edge);
-
-                    /* Get the next edge */
-                    virtual_edge = virtual_edge->hh.next;
                 }
 
                 /* We remove the node from the list of nodes */
-                HASH_DEL(topology->nodes, node2);
-                printf("\t node found: %s (%s)\n", node2->description, node2->physical_id);
+                HASH_DEL(topology->nodes, node1);
+                HASH_ADD_STR(topology->nodes, physical_id, virtual_node);
+                printf("First node found: %s (%s)\n", node1->description, node1->physical_id);
+            }
 
-                nodes[idx2] = NULL;
+            utarray_concat(virtual_node->physical_links, node2->physical_links);
+            utarray_push_back(virtual_node->subnodes, &node2);
+            utarray_concat(virtual_node->partitions, node2->partitions);
+
+            /* Set edges */
+            netloc_edge_t *edge2, *edge_tmp2;
+            netloc_edge_t *virtual_edge = first_virtual_edge;
+            netloc_node_iter_edges(node2, edge2, edge_tmp2) {
+                /* Merge the edges from the physical node into the virtual node */
+                ret = edge_merge_into(virtual_edge, edge2, 0);
+                if (ret != NETLOC_SUCCESS) {
+                    goto ERROR;
+                }
+
+                /* Change the reverse edge of the neighbours (reverse nodes) */
+                netloc_node_t *reverse_node = edge2->dest;
+                netloc_edge_t *reverse_edge = edge2->other_way;
+
+                netloc_edge_t *reverse_virtual_edge;
+                HASH_FIND_PTR(reverse_node->edges, &virtual_node,
+                        reverse_virtual_edge);
+                ret = edge_merge_into(reverse_virtual_edge, reverse_edge, 1);
+                if (ret != NETLOC_SUCCESS) {
+                    goto ERROR;
+                }
+                HASH_DEL(reverse_node->edges, reverse_edge);
+
+                /* Get the next edge */
+                virtual_edge = virtual_edge->hh.next;
             }
+
+            /* We remove the node from the list of nodes */
+            HASH_DEL(topology->nodes, node2);
+            printf("\t node found: %s (%s)\n", node2->description, node2->physical_id);
         }
-        utarray_clear(similar_nodes);
     }
 
     ret = NETLOC_SUCCESS;
 ERROR:
     free(nodes);
-
-    for (int idx = 0; idx < num_nodes; idx++) {
-        if (edgedest_by_node[idx])
-            free(edgedest_by_node[idx]);
-    }
-    free(edgedest_by_node);
-    free(num_edges_by_node);
-    free(similar_nodes);
+    free(next_similar);
+    free(last_similar);
+    free(computed_similar);
     return ret;
 }
 
@@ -48,10 +48,15 @@ int main(void)
   obj = NULL;
   while ((obj = hwloc_get_next_pcidev(topology, obj)) != NULL) {
     assert(obj->type == HWLOC_OBJ_PCI_DEVICE);
+    assert(hwloc_get_pcidev_by_busid(topology, obj->attr->pcidev.domain, obj->attr->pcidev.bus,
+				     obj->attr->pcidev.dev, obj->attr->pcidev.func) == obj);
     printf(" Found PCI device class %04x vendor %04x model %04x\n",
 	   obj->attr->pcidev.class_id, obj->attr->pcidev.vendor_id, obj->attr->pcidev.device_id);
   }
 
+  /* PCI functions are between 0 and 7 */
+  assert(!hwloc_get_pcidev_by_busid(topology, 0, 0, 0, 8));
+
   printf("Found %d OS devices\n", hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_OS_DEVICE));
   obj = NULL;
   while ((obj = hwloc_get_next_osdev(topology, obj)) != NULL) {
@@ -1,10 +1,12 @@
 /*
- * Copyright © 2011 inria.  All rights reserved.
+ * Copyright © 2011-2020 Inria.  All rights reserved.
  * See COPYING in top-level directory.
  */
 
 #include "hwloc.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 /* check obj infos */
@@ -16,8 +18,9 @@
 
 int main(void)
 {
-  hwloc_topology_t topology;
-  hwloc_obj_t obj;
+  hwloc_topology_t topology, dup;
+  hwloc_obj_t obj, dupobj;
+  unsigned i;
 
   hwloc_topology_init(&topology);
   hwloc_topology_load(topology);
@@ -37,6 +40,47 @@ int main(void)
   if (strcmp(hwloc_obj_get_info_by_name(obj, NAME2), VALUE2))
     assert(0);
 
+  /* add more infos, first match is returned */
+  hwloc_obj_add_info(obj, "PCIVendor", "Intel Corporation");
+  hwloc_obj_add_info(obj, "HWQueue3CPUSet", "0x0000000f");
+  hwloc_obj_add_info(obj, NAME1, "1");
+  assert(!strcmp(hwloc_obj_get_info_by_name(obj, "PCIVendor"), "Intel Corporation"));
+  assert(!strcmp(hwloc_obj_get_info_by_name(obj, "HWQueue3CPUSet"), "0x0000000f"));
+  assert(!strcmp(hwloc_obj_get_info_by_name(obj, NAME1), VALUE1));
+  assert(!hwloc_obj_get_info_by_name(obj, "PCIDevice"));
+  assert(!hwloc_obj_get_info_by_name(obj, "HWQueue4CPUSet"));
+
+  /* info values belong to the object, applications may replace them */
+  for(i=0; i<obj->infos_count; i++)
+    if (!strcmp(obj->infos[i].name, "HWQueue3CPUSet")) {
+      free(obj->infos[i].value);
+      obj->infos[i].value = strdup("0x000000f0");
+    }
+  assert(!strcmp(hwloc_obj_get_info_by_name(obj, "HWQueue3CPUSet"), "0x000000f0"));
+  hwloc_obj_remove_infos(obj, "HWQueue3CPUSet");
+  assert(!hwloc_obj_get_info_by_name(obj, "HWQueue3CPUSet"));
+  assert(!strcmp(hwloc_obj_get_info_by_name(obj, "PCIVendor"), "Intel Corporation"));
+
+  /* duplicated topologies have their own copies */
+  hwloc_topology_dup(&dup, topology);
+  dupobj = hwloc_get_root_obj(dup);
+  assert(!strcmp(hwloc_obj_get_info_by_name(dupobj, "PCIVendor"), "Intel Corporation"));
+  assert(!strcmp(hwloc_obj_get_info_by_name(dupobj, NAME2), VALUE2));
+
+  /* remove infos by name, then all of them */
+  hwloc_obj_remove_infos(obj, NAME1);
+  assert(!hwloc_obj_get_info_by_name(obj, NAME1));
+  assert(!strcmp(hwloc_obj_get_info_by_name(obj, NAME2), VALUE2));
+  assert(!strcmp(hwloc_obj_get_info_by_name(obj, "PCIVendor"), "Intel Corporation"));
+  hwloc_obj_remove_infos(obj, NULL);
+  assert(!obj->infos_count);
+  assert(!hwloc_obj_get_info_by_name(obj, "PCIVendor"));
+
+  /* the duplicate isn't modified */
+  assert(!strcmp(hwloc_obj_get_info_by_name(dupobj, NAME1), VALUE1));
+  assert(!strcmp(hwloc_obj_get_info_by_name(dupobj, "PCIVendor"), "Intel Corporation"));
+
+  hwloc_topology_destroy(dup);
   hwloc_topology_destroy(topology);
 
   return 0;
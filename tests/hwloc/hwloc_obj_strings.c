@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ * See COPYING in top-level directory.
+ */
+
+#include "hwloc.h"
+
+#include <assert.h>
+#include <string.h>
+
+/* check cached obj type and attribute strings against the snprintf variants */
+
+static void check_obj(hwloc_topology_t topology, hwloc_obj_t obj)
+{
+  char buffer[1024];
+  const char *string;
+  int verbose;
+
+  for(verbose=0; verbose<2; verbose++) {
+    hwloc_obj_type_snprintf(buffer, sizeof(buffer), obj, verbose);
+    string = hwloc_obj_get_type_string(topology, obj, verbose);
+    assert(string);
+    assert(!strcmp(string, buffer));
+    /* second call returns the cached string */
+    assert(hwloc_obj_get_type_string(topology, obj, verbose) == string);
+
+    hwloc_obj_attr_snprintf(buffer, sizeof(buffer), obj, " ", verbose);
+    string = hwloc_obj_get_attr_string(topology, obj, " ", verbose);
+    assert(string);
+    assert(!strcmp(string, buffer));
+    assert(hwloc_obj_get_attr_string(topology, obj, " ", verbose) == string);
+
+    hwloc_obj_attr_snprintf(buffer, sizeof(buffer), obj, ", ", verbose);
+    string = hwloc_obj_get_attr_string(topology, obj, ", ", verbose);
+    assert(string);
+    assert(!strcmp(string, buffer));
+  }
+}
+
+int main(void)
+{
+  hwloc_topology_t topology, dup;
+  hwloc_obj_t obj, core0, core1;
+  const char *string;
+  int depth;
+
+  hwloc_topology_init(&topology);
+  hwloc_topology_set_synthetic(topology, "pack:2 [numa(memory=1GB)] l3:1(size=8MB) core:4 l1d:1 pu:2");
+  hwloc_topology_load(topology);
+
+  for(depth=0; depth<hwloc_topology_get_depth(topology); depth++) {
+    obj = NULL;
+    while ((obj = hwloc_get_next_obj_by_depth(topology, depth, obj)) != NULL)
+      check_obj(topology, obj);
+  }
+  obj = NULL;
+  while ((obj = hwloc_get_next_obj_by_type(topology, HWLOC_OBJ_NUMANODE, obj)) != NULL)
+    check_obj(topology, obj);
+
+  /* identical strings are shared between objects */
+  core0 = hwloc_get_obj_by_type(topology, HWLOC_OBJ_CORE, 0);
+  core1 = hwloc_get_obj_by_type(topology, HWLOC_OBJ_CORE, 1);
+  assert(hwloc_obj_get_type_string(topology, core0, 0) == hwloc_obj_get_type_string(topology, core1, 0));
+
+  /* adding infos invalidates the attribute string */
+  obj = hwloc_get_root_obj(topology);
+  string = hwloc_obj_get_attr_string(topology, obj, " ", 1);
+  assert(!strstr(string, "foo=bar"));
+  hwloc_obj_add_info(obj, "foo", "bar");
+  string = hwloc_obj_get_attr_string(topology, obj, " ", 1);
+  assert(strstr(string, "foo=bar"));
+  check_obj(topology, obj);
+
+  /* removing and replacing infos invalidates it too, even with the same count */
+  hwloc_obj_remove_infos(obj, "foo");
+  hwloc_obj_add_info(obj, "foo", "baz");
+  string = hwloc_obj_get_attr_string(topology, obj, " ", 1);
+  assert(!strstr(string, "foo=bar"));
+  assert(strstr(string, "foo=baz"));
+  check_obj(topology, obj);
+
+  /* duplicates have their own cache */
+  hwloc_topology_dup(&dup, topology);
+  obj = hwloc_get_root_obj(dup);
+  string = hwloc_obj_get_attr_string(dup, obj, " ", 1);
+  assert(strstr(string, "foo=baz"));
+  check_obj(dup, obj);
+  hwloc_topology_destroy(dup);
+
+  /* restricting frees objects and drops the cache */
+  obj = hwloc_get_obj_by_type(topology, HWLOC_OBJ_PACKAGE, 0);
+  hwloc_topology_restrict(topology, obj->cpuset, 0);
+  for(depth=0; depth<hwloc_topology_get_depth(topology); depth++) {
+    obj = NULL;
+    while ((obj = hwloc_get_next_obj_by_depth(topology, depth, obj)) != NULL)
+      check_obj(topology, obj);
+  }
+
+  hwloc_topology_destroy(topology);
+
+  return 0;
+}
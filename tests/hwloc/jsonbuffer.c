@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ * See COPYING in top-level directory.
+ */
+
+#include "private/autogen/config.h"
+#include "hwloc.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#ifndef HAVE_MKSTEMP
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "private/misc.h" /* for S_IRWXU */
+static inline int mkstemp(char *name)
+{
+  mktemp(name);
+  return open(name, O_RDWR|O_CREAT, S_IRWXU);
+}
+#endif
+
+/* check that the JSON buffer and file exports work and match */
+
+int main(void)
+{
+  hwloc_topology_t topology;
+  hwloc_obj_t obj;
+  char *buffer, *filebuffer;
+  int buflen, err;
+  char filename[] = "hwloc_jsonbuffer.tmp.XXXXXX";
+  FILE *file;
+  long filelen;
+  int fd;
+
+  err = hwloc_topology_init(&topology);
+  assert(!err);
+  err = hwloc_topology_set_synthetic(topology, "pack:2 [numa] core:2 l1d:1 pu:2");
+  assert(!err);
+  err = hwloc_topology_load(topology);
+  assert(!err);
+
+  obj = hwloc_get_obj_by_type(topology, HWLOC_OBJ_CORE, 1);
+  assert(obj);
+  err = hwloc_obj_add_info(obj, "Foo", "a \"quoted\"\tvalue\\");
+  assert(!err);
+
+  /* invalid flags */
+  err = hwloc_topology_export_jsonbuffer(topology, &buffer, &buflen, 1UL);
+  assert(err == -1);
+  assert(errno == EINVAL);
+
+  err = hwloc_topology_export_jsonbuffer(topology, &buffer, &buflen, 0);
+  assert(!err);
+  assert(buflen == (int) strlen(buffer) + 1);
+  printf("%s", buffer);
+
+  assert(!strncmp(buffer, "{\"hwloc_version\":\"", 18));
+  assert(strstr(buffer, "\"allowed_cpuset\":\"0-7\""));
+  assert(strstr(buffer, "{\"type\":\"Package\""));
+  assert(strstr(buffer, "{\"type\":\"NUMANode\""));
+  assert(strstr(buffer, "{\"type\":\"L1Cache\""));
+  assert(strstr(buffer, "\"cpuset\":\"6-7\""));
+  assert(strstr(buffer, "[\"Foo\",\"a \\\"quoted\\\"\\u0009value\\\\\"]"));
+  assert(buffer[buflen-2] == '\n');
+
+  /* the file export must be identical */
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  close(fd);
+  err = hwloc_topology_export_json(topology, filename, 0);
+  assert(!err);
+
+  file = fopen(filename, "r");
+  assert(file);
+  fseek(file, 0, SEEK_END);
+  filelen = ftell(file);
+  assert(filelen == (long) buflen - 1);
+  fseek(file, 0, SEEK_SET);
+  filebuffer = malloc(filelen + 1);
+  assert(filebuffer);
+  assert(fread(filebuffer, 1, filelen, file) == (size_t) filelen);
+  filebuffer[filelen] = '\0';
+  fclose(file);
+  unlink(filename);
+  assert(!strcmp(buffer, filebuffer));
+  free(filebuffer);
+
+  hwloc_free_jsonbuffer(topology, buffer);
+  hwloc_topology_destroy(topology);
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ * See COPYING in top-level directory.
+ */
+
+#include "hwloc.h"
+#include "hwloc/linux.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+
+/* check the update of allowed resources from a fake cgroup2 hierarchy */
+
+static void
+write_file(const char *dir, const char *name, const char *content)
+{
+  char path[512];
+  FILE *file;
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  file = fopen(path, "w");
+  assert(file);
+  fputs(content, file);
+  fclose(file);
+}
+
+int main(void)
+{
+  hwloc_topology_t topology;
+  hwloc_bitmap_t set;
+  char fsroot[] = "/tmp/hwloc-allowed-XXXXXX";
+  char path[512], cmd[600];
+  struct pollfd pfd;
+  int fd, err;
+
+  if (!mkdtemp(fsroot)) {
+    perror("mkdtemp");
+    return EXIT_FAILURE;
+  }
+  snprintf(path, sizeof(path), "%s/proc/self", fsroot);
+  snprintf(cmd, sizeof(cmd), "mkdir -p %s %s/sys/fs/cgroup/pod", path, fsroot);
+  err = system(cmd);
+  assert(!err);
+  write_file(path, "cgroup", "0::/pod\n");
+  snprintf(path, sizeof(path), "%s/proc", fsroot);
+  write_file(path, "mounts", "cgroup2 /sys/fs/cgroup cgroup2 rw,nosuid,nodev,noexec,relatime 0 0\n");
+  snprintf(path, sizeof(path), "%s/sys/fs/cgroup", fsroot);
+  write_file(path, "cgroup.controllers", "cpuset cpu io memory pids\n");
+  snprintf(path, sizeof(path), "%s/sys/fs/cgroup/pod", fsroot);
+  write_file(path, "cpuset.cpus", "0-3\n");
+  write_file(path, "cpuset.cpus.effective", "0-3\n");
+  write_file(path, "cpuset.mems", "0\n");
+  write_file(path, "cpuset.mems.effective", "0\n");
+
+  setenv("HWLOC_FSROOT", fsroot, 1);
+  setenv("HWLOC_THISSYSTEM", "1", 1);
+
+  /* the notifier requires a loaded topology */
+  hwloc_topology_init(&topology);
+  fd = hwloc_linux_open_allowed_resources_notifier(topology);
+  assert(fd == -1 && errno == EINVAL);
+  hwloc_topology_set_synthetic(topology, "node:2 core:4 pu:1");
+  hwloc_topology_set_flags(topology, HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED);
+  hwloc_topology_load(topology);
+  assert(hwloc_topology_is_thissystem(topology));
+  assert(hwloc_bitmap_weight(hwloc_topology_get_allowed_cpuset(topology)) == 8);
+
+  /* first update reads the initial cgroup */
+  err = hwloc_linux_update_allowed_resources(topology, -1);
+  assert(err == 1);
+  set = hwloc_bitmap_alloc();
+  hwloc_bitmap_set_range(set, 0, 3);
+  assert(hwloc_bitmap_isequal(hwloc_topology_get_allowed_cpuset(topology), set));
+  hwloc_bitmap_only(set, 0);
+  assert(hwloc_bitmap_isequal(hwloc_topology_get_allowed_nodeset(topology), set));
+  err = hwloc_linux_update_allowed_resources(topology, -1);
+  assert(err == 0);
+
+  fd = hwloc_linux_open_allowed_resources_notifier(topology);
+  if (fd < 0 && errno == ENOSYS) {
+    printf("inotify not supported, skipping notification checks\n");
+  } else {
+    assert(fd >= 0);
+    /* nothing happened yet */
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    err = poll(&pfd, 1, 0);
+    assert(err == 0);
+
+    /* move to the second NUMA node, like a CPU manager would do */
+    write_file(path, "cpuset.cpus", "4-7\n");
+    write_file(path, "cpuset.cpus.effective", "4-7\n");
+    write_file(path, "cpuset.mems", "1\n");
+    write_file(path, "cpuset.mems.effective", "1\n");
+    err = poll(&pfd, 1, 1000);
+    assert(err == 1);
+
+    err = hwloc_linux_update_allowed_resources(topology, fd);
+    assert(err == 1);
+    hwloc_bitmap_zero(set);
+    hwloc_bitmap_set_range(set, 4, 7);
+    assert(hwloc_bitmap_isequal(hwloc_topology_get_allowed_cpuset(topology), set));
+    hwloc_bitmap_only(set, 1);
+    assert(hwloc_bitmap_isequal(hwloc_topology_get_allowed_nodeset(topology), set));
+
+    /* notifications were consumed */
+    err = poll(&pfd, 1, 0);
+    assert(err == 0);
+    err = hwloc_linux_update_allowed_resources(topology, fd);
+    assert(err == 0);
+
+    close(fd);
+  }
+
+  hwloc_bitmap_free(set);
+  hwloc_topology_destroy(topology);
+
+  snprintf(cmd, sizeof(cmd), "rm -rf %s", fsroot);
+  err = system(cmd);
+  assert(!err);
+  return 0;
+}
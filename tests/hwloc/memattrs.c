@@ -30,6 +30,85 @@ check_memattr(hwloc_topology_t topology, const char *name, hwloc_memattr_id_t id
   assert(gotflags == flags);
 }
 
+static void
+check_pci_paths(void)
+{
+  hwloc_topology_t topology;
+  hwloc_memattr_id_t bwid, hopsid;
+  struct hwloc_location loc;
+  hwloc_obj_t node0, node1, nic, gpu, sata, best;
+  hwloc_uint64_t bw;
+  unsigned hops;
+  int err;
+
+  /* 2 packages with 1 NUMA node each, NUMA latencies 10/20, PCI link speeds */
+  err = hwloc_topology_init(&topology);
+  assert(!err);
+  err = hwloc_topology_set_xml(topology, XMLTESTDIR "/24em64t-2n6c2t-pci.xml");
+  assert(!err);
+  hwloc_topology_set_io_types_filter(topology, HWLOC_TYPE_FILTER_KEEP_ALL);
+  err = hwloc_topology_load(topology);
+  assert(!err);
+
+  node0 = hwloc_get_numanode_obj_by_os_index(topology, 0);
+  node1 = hwloc_get_numanode_obj_by_os_index(topology, 1);
+  nic = hwloc_get_pcidev_by_busid(topology, 0, 0x04, 0, 0); /* 0.2GB/s behind a 0.4GB/s bridge near node0 */
+  gpu = hwloc_get_pcidev_by_busid(topology, 0, 0x14, 0, 0); /* 4GB/s behind a 4GB/s bridge near node1 */
+  sata = hwloc_get_pcidev_by_busid(topology, 0, 0, 0x1f, 2); /* 0.1GB/s below the host bridge near node0 */
+  assert(node0 && node1 && nic && gpu && sata);
+
+  err = hwloc_get_pci_path_to_numanode(topology, nic, node0, 0, &bw, &hops);
+  assert(!err);
+  assert(bw == 190);
+  assert(hops == 2);
+  err = hwloc_get_pci_path_to_numanode(topology, nic, node1, 0, &bw, &hops);
+  assert(!err);
+  assert(bw == 95);
+  assert(hops == 3);
+  err = hwloc_get_pci_path_to_numanode(topology, gpu, node1, 0, &bw, &hops);
+  assert(!err);
+  assert(bw == 3814);
+  assert(hops == 2);
+  err = hwloc_get_pci_path_to_numanode(topology, sata, node0, 0, &bw, &hops);
+  assert(!err);
+  assert(bw == 95);
+  assert(hops == 1);
+  /* invalid objects */
+  err = hwloc_get_pci_path_to_numanode(topology, node0, node0, 0, &bw, &hops);
+  assert(err == -1);
+  err = hwloc_get_pci_path_to_numanode(topology, nic, nic, 0, &bw, &hops);
+  assert(err == -1);
+
+  err = hwloc_memattr_register_pci_paths(topology, 0, &bwid, &hopsid);
+  assert(!err);
+  check_memattr(topology, "PCIBandwidth", bwid, HWLOC_MEMATTR_FLAG_HIGHER_FIRST|HWLOC_MEMATTR_FLAG_NEED_INITIATOR);
+  check_memattr(topology, "PCIHops", hopsid, HWLOC_MEMATTR_FLAG_LOWER_FIRST|HWLOC_MEMATTR_FLAG_NEED_INITIATOR);
+  /* registering again reuses the same attributes */
+  err = hwloc_memattr_register_pci_paths(topology, 0, &bwid, &hopsid);
+  assert(!err);
+  check_memattr(topology, "PCIBandwidth", bwid, HWLOC_MEMATTR_FLAG_HIGHER_FIRST|HWLOC_MEMATTR_FLAG_NEED_INITIATOR);
+
+  loc.type = HWLOC_LOCATION_TYPE_OBJECT;
+  loc.location.object = gpu;
+  err = hwloc_memattr_get_value(topology, bwid, node0, &loc, 0, &bw);
+  assert(!err);
+  assert(bw == 1907);
+  err = hwloc_memattr_get_best_target(topology, bwid, &loc, 0, &best, &bw);
+  assert(!err);
+  assert(best == node1);
+  assert(bw == 3814);
+  err = hwloc_memattr_get_best_target(topology, hopsid, &loc, 0, &best, NULL);
+  assert(!err);
+  assert(best == node1);
+  err = hwloc_memattr_get_best_initiator(topology, bwid, node1, 0, &loc, &bw);
+  assert(!err);
+  assert(loc.type == HWLOC_LOCATION_TYPE_OBJECT);
+  assert(loc.location.object->type == HWLOC_OBJ_PCI_DEVICE);
+  assert(bw == 3814);
+
+  hwloc_topology_destroy(topology);
+}
+
 int
 main(void)
 {
@@ -504,6 +583,8 @@ main(void)
   assert(targets[2] == hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, 0));
 
   hwloc_topology_destroy(topology);
+
+  check_pci_paths();
   return 0;
 }
 
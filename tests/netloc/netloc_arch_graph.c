@@ -0,0 +1,81 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ * See COPYING in top-level directory.
+ */
+
+#include <private/netloc.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/* Check the graph built for the dragonfly dataset: 3 groups of 2 switches
+ * with 2 hosts each. Links inside groups run at 8Gb/s, links between groups
+ * at 4Gb/s and cost twice as much.
+ * Hosts are named n<group><switch><host>.
+ */
+
+#define NUM_HOSTS 12
+#define NUM_SWITCHES 6
+
+int main(void)
+{
+    netloc_arch_t *arch;
+    netloc_arch_graph_t *graph;
+    netloc_arch_node_t *node, *node_tmp;
+    int group[NUM_HOSTS+NUM_SWITCHES];
+    int num_costs[3] = { 0, 0, 0 };
+    int ret;
+
+    arch = netloc_arch_construct();
+    /* slots are not supported on graphs, they must be disabled */
+    ret = netloc_arch_build(arch, 1);
+    assert(ret == NETLOC_SUCCESS);
+    assert(arch->type == NETLOC_ARCH_GRAPH);
+    assert(!arch->has_slots);
+
+    graph = arch->graph;
+    assert(graph->num_vertices == NUM_HOSTS+NUM_SWITCHES);
+    assert(graph->num_hosts == NUM_HOSTS);
+    assert(graph->verttab[0] == 0);
+    assert(graph->verttab[graph->num_vertices] == 2*(NUM_HOSTS+NUM_SWITCHES));
+
+    /* hosts are the first vertices, find their group from their name */
+    assert(HASH_COUNT(arch->nodes_by_name) == NUM_HOSTS);
+    HASH_ITER(hh, arch->nodes_by_name, node, node_tmp) {
+        assert(node->idx_in_topo >= 0 && node->idx_in_topo < NUM_HOSTS);
+        group[node->idx_in_topo] = node->name[1] - '0';
+    }
+
+    /* each host is connected to a single switch of its group */
+    for (int v = 0; v < NUM_HOSTS; v++) {
+        NETLOC_int e = graph->verttab[v];
+        assert(graph->verttab[v+1] == e+1);
+        assert(graph->edgetab[e] >= NUM_HOSTS);
+        assert(graph->edlotab[e] == 1);
+        group[graph->edgetab[e]] = group[v];
+    }
+
+    /* each switch has 2 hosts, a switch of its group and one of another group */
+    for (int v = NUM_HOSTS; v < NUM_HOSTS+NUM_SWITCHES; v++) {
+        assert(graph->verttab[v+1] - graph->verttab[v] == 4);
+        for (NETLOC_int e = graph->verttab[v]; e < graph->verttab[v+1]; e++) {
+            NETLOC_int dest = graph->edgetab[e];
+            NETLOC_int cost = graph->edlotab[e];
+            int found = 0;
+            assert(dest != v);
+            assert(cost == (group[dest] == group[v] ? 1 : 2));
+            num_costs[cost]++;
+            /* edges are symmetric */
+            for (NETLOC_int f = graph->verttab[dest]; f < graph->verttab[dest+1]; f++)
+                if (graph->edgetab[f] == v && graph->edlotab[f] == cost)
+                    found++;
+            assert(found == 1);
+        }
+    }
+    assert(num_costs[1] == NUM_HOSTS+2*3);
+    assert(num_costs[2] == 2*3);
+
+    netloc_arch_destruct(arch);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ * See COPYING in top-level directory.
+ */
+
+#include <private/netloc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* Check the distances between the hosts of the dragonfly dataset. Its 6
+ * switches form a ring sw1-sw2-sw6-sw5-sw4-sw3, with 2 hosts each, and the
+ * links between groups (sw1-sw3, sw2-sw6, sw4-sw5) run at 4Gb/s instead of
+ * 8Gb/s. The forwarding tables of sw1 and sw2 send the traffic toward the
+ * hosts of sw3 the long way around the ring, and sw1 has no route toward the
+ * hosts of sw6, whose distances come from the shortest path instead.
+ */
+
+#define NUM_HOSTS 12
+
+static const char *hostnames[NUM_HOSTS] = {
+    "n000", "n001", "n010", "n011", "n100", "n101",
+    "n110", "n111", "n200", "n201", "n210", "n211"
+};
+
+/* from n000, by host_idx */
+static const netloc_distance_t expected[NUM_HOSTS] = {
+    { 0, 0 }, /* itself */
+    { 2, 8 }, /* same switch */
+    { 3, 8 }, { 3, 8 }, /* sw2, in the same group */
+    { 7, 4 }, { 7, 4 }, /* sw3, through sw2, sw6, sw5 and sw4 */
+    { 4, 4 }, { 4, 4 }, /* sw4, through sw3 */
+    { 5, 4 }, { 5, 4 }, /* sw5, through sw2 and sw6 */
+    { 4, 4 }, { 4, 4 }  /* sw6, no route, shortest path through sw2 */
+};
+
+int main(void)
+{
+    netloc_topology_t *topology;
+    netloc_distance_t *distances, distance;
+    netloc_distance_t matrix[3*3];
+    netloc_node_t *nodes[3];
+    char *topopath;
+    int ret;
+
+    topopath = getenv("NETLOC_TOPOFILE");
+    assert(topopath);
+    topology = netloc_topology_construct(strdup(topopath));
+    assert(topology);
+
+    assert(topology->num_hosts == NUM_HOSTS);
+    for (int h = 0; h < NUM_HOSTS; h++) {
+        assert(topology->hosts[h]->host_idx == h);
+        assert(!strcmp(topology->hosts[h]->hostname, hostnames[h]));
+    }
+
+    ret = netloc_topology_get_distances(topology, topology->hosts[0], &distances);
+    assert(ret == NETLOC_SUCCESS);
+    for (int h = 0; h < NUM_HOSTS; h++) {
+        assert(distances[h].hops == expected[h].hops);
+        assert(distances[h].gbits == expected[h].gbits);
+    }
+
+    /* distances are cached */
+    netloc_distance_t *distances2;
+    ret = netloc_topology_get_distances(topology, topology->hosts[0], &distances2);
+    assert(ret == NETLOC_SUCCESS);
+    assert(distances2 == distances);
+
+    /* forwarding tables */
+    ret = netloc_topology_get_distance(topology, topology->hosts[0], topology->hosts[4], &distance);
+    assert(ret == NETLOC_SUCCESS);
+    assert(distance.hops == 7 && distance.gbits == 4);
+    /* shortest path */
+    ret = netloc_topology_get_distance(topology, topology->hosts[0], topology->hosts[11], &distance);
+    assert(ret == NETLOC_SUCCESS);
+    assert(distance.hops == 4 && distance.gbits == 4);
+    /* switches are not hosts */
+    ret = netloc_topology_get_distance(topology, topology->hosts[0],
+            topology->hosts[0]->port_links[0]->dest, &distance);
+    assert(ret == NETLOC_ERROR_NOT_FOUND);
+
+    /* n010 to n100 follows the long route of sw2, n100 to n010 the short one */
+    nodes[0] = topology->hosts[2];
+    nodes[1] = topology->hosts[4];
+    nodes[2] = topology->hosts[10];
+    ret = netloc_topology_get_distance_matrix(topology, 3, nodes, matrix);
+    assert(ret == NETLOC_SUCCESS);
+    for (int i = 0; i < 3; i++)
+        assert(matrix[i*3+i].hops == 0);
+    assert(matrix[0*3+1].hops == 6 && matrix[0*3+1].gbits == 4);
+    assert(matrix[1*3+0].hops == 4 && matrix[1*3+0].gbits == 4);
+    assert(matrix[0*3+2].hops == 3 && matrix[0*3+2].gbits == 4);
+    assert(matrix[2*3+1].hops == 5 && matrix[2*3+1].gbits == 4);
+
+    netloc_topology_destruct(topology);
+    return 0;
+}
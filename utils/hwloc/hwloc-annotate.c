@@ -11,11 +11,19 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#if (defined HAVE_FORK) && (defined HAVE_SYS_WAIT_H)
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 
 void usage(const char *callname __hwloc_attribute_unused, FILE *where)
 {
 	fprintf(where, "Usage: hwloc-annotate [options] <input.xml> <output.xml> -- <location1> <location2> ... -- <annotation>\n");
 	fprintf(where, "Usage: hwloc-annotate [options] <input.xml> <output.xml> <location> <annotation>\n");
+	fprintf(where, "Usage: hwloc-annotate [options] --file <annotations> <input.xml> <output.xml>\n");
+	fprintf(where, "Usage: hwloc-annotate [options] --file <annotations> --output-dir <dir> <input1.xml> <input2.xml> ...\n");
 	fprintf(where, "  <location> may be:\n");
 	fprintf(where, "    all, root, <type>:<logicalindex>, <type>:all\n");
 	fprintf(where, "  <annotation> may be:\n");
@@ -30,107 +38,94 @@ void usage(const char *callname __hwloc_attribute_unused, FILE *where)
 	fprintf(where, "  --ri\tReplace or remove existing infos with same name (annotation must be info)\n");
 	fprintf(where, "  --cu\tClear existing userdata\n");
 	fprintf(where, "  --cd\tClear existing distances\n");
+	fprintf(where, "  --file <annotations>\n"
+		       "      \tRead one annotation per line (with optional --ci, --ri, --cu or --cd)\n"
+		       "      \tfrom file <annotations> (- for stdin) and apply all of them\n");
+	fprintf(where, "  --output-dir <dir>\n"
+		       "      \tAnnotate multiple input XML files into files of the same name in <dir>\n");
+	fprintf(where, "  -j <n> --jobs <n>\n"
+		       "      \tProcess up to <n> input files in parallel with --output-dir\n");
 }
 
-static char *infoname = NULL, *infovalue = NULL;
-static char *miscname = NULL;
-static char *distancesfilename = NULL;
+struct annotation {
+	/* options */
+	int clearinfos;
+	int replaceinfos;
+	int clearuserdata;
+	int cleardistances;
 
-static char *maname = NULL;
-static unsigned long maflags;
-
-static char *mavname = NULL;
-static hwloc_memattr_id_t mavid;
-static hwloc_cpuset_t mavicpuset = NULL;
-static char *maviobjstr = NULL;
-static hwloc_obj_t maviobj = NULL;
-static hwloc_uint64_t mavvalue;
-
-static unsigned long distancesflags = 0;
-
-static int clearinfos = 0;
-static int replaceinfos = 0;
-static int clearuserdata = 0;
-static int cleardistances = 0;
+	char **locations;
+	int nr_locations;
 
-static void apply(hwloc_topology_t topology, hwloc_obj_t obj)
+	char *infoname, *infovalue;
+	char *miscname;
+	char *distancesfilename;
+	unsigned long distancesflags;
+
+	char *maname;
+	unsigned long maflags;
+
+	char *mavname;
+	hwloc_cpuset_t mavicpuset;
+	char *maviobjstr;
+	hwloc_uint64_t mavvalue;
+	/* memattr value id and initiator, resolved in the current topology */
+	hwloc_memattr_id_t mavid;
+	hwloc_obj_t maviobj;
+
+	/* arguments tokenized from an annotations file, or NULL */
+	char **args;
+	unsigned nr_args;
+	/* line number in the annotations file, or 0 */
+	unsigned line;
+};
+
+static void apply(hwloc_topology_t topology, struct annotation *a, hwloc_obj_t obj)
 {
-	unsigned i,j;
-	if (clearinfos) {
-		/* this may be considered dangerous, applications should not modify objects directly */
-		for(i=0; i<obj->infos_count; i++) {
-			struct hwloc_info_s *info = &obj->infos[i];
-			free(info->name);
-			free(info->value);
-		}
-		free(obj->infos);
-		obj->infos = NULL;
-		obj->infos_count = 0;
-	}
-	if (clearuserdata) {
+	if (a->clearinfos)
+		hwloc_obj_remove_infos(obj, NULL);
+	if (a->clearuserdata) {
 		hwloc_utils_userdata_free(obj);
 	}
-	if (infoname) {
-		if (replaceinfos) {
-			/* this may be considered dangerous, applications should not modify objects directly */
-			for(i=0, j=0; i<obj->infos_count; i++) {
-				struct hwloc_info_s *info = &obj->infos[i];
-				if (!strcmp(infoname, info->name)) {
-					/* remove info */
-					free(info->name);
-					info->name = NULL;
-					free(info->value);
-				} else {
-					if (i != j) {
-						/* shift info to where it belongs */
-						obj->infos[j].name = info->name;
-						obj->infos[j].value = info->value;
-					}
-					j++;
-				}
-			}
-			obj->infos_count = j;
-			if (!j) {
-				free(obj->infos);
-				obj->infos = NULL;
-			}
-		}
-		if (infovalue)
-			hwloc_obj_add_info(obj, infoname, infovalue);
+	if (a->infoname) {
+		if (a->replaceinfos)
+			hwloc_obj_remove_infos(obj, a->infoname);
+		if (a->infovalue)
+			hwloc_obj_add_info(obj, a->infoname, a->infovalue);
 	}
-	if (miscname)
-		hwloc_topology_insert_misc_object(topology, obj, miscname);
-        if (mavname) {
+	if (a->miscname)
+		hwloc_topology_insert_misc_object(topology, obj, a->miscname);
+        if (a->mavname) {
           struct hwloc_location loc, *locp = NULL;
-          if (maviobj) {
+          if (a->maviobj) {
             loc.type = HWLOC_LOCATION_TYPE_OBJECT;
-            loc.location.object = maviobj;
+            loc.location.object = a->maviobj;
             locp = &loc;
-          } else if (mavicpuset) {
+          } else if (a->mavicpuset) {
             loc.type = HWLOC_LOCATION_TYPE_CPUSET;
-            loc.location.cpuset = mavicpuset;
+            loc.location.cpuset = a->mavicpuset;
             locp = &loc;
           }
-          if (hwloc_memattr_set_value(topology, mavid, obj, locp, 0, mavvalue) < 0) {
+          if (hwloc_memattr_set_value(topology, a->mavid, obj, locp, 0, a->mavvalue) < 0) {
             fprintf(stderr, "Failed to add memattr value (%s)\n", strerror(errno));
           }
         }
 }
 
-static void apply_recursive(hwloc_topology_t topology, hwloc_obj_t obj)
+static void apply_recursive(hwloc_topology_t topology, struct annotation *a, hwloc_obj_t obj)
 {
 	hwloc_obj_t child = NULL;
 	while ((child = hwloc_get_next_child(topology, obj, child)) != NULL)
-		apply_recursive(topology, child);
-	apply(topology, obj);
+		apply_recursive(topology, a, child);
+	apply(topology, a, obj);
 }
 
 static void
 hwloc_calc_process_location_annotate_cb(struct hwloc_calc_location_context_s *lcontext,
-					void *_data __hwloc_attribute_unused,
+					void *_data,
 					hwloc_obj_t obj)
 {
-	apply(lcontext->topology, obj);
+	apply(lcontext->topology, _data, obj);
 }
 
 static void
@@ -179,7 +174,7 @@ get_unique_obj(hwloc_topology_t topology, int topodepth, char *str,
 
 
 static void
-add_distances(hwloc_topology_t topology, int topodepth)
+add_distances(hwloc_topology_t topology, struct annotation *a, int topodepth)
 {
 	unsigned long kind = 0;
 	unsigned nbobjs = 0;
@@ -190,9 +185,9 @@ add_distances(hwloc_topology_t topology, int topodepth)
 	unsigned i, x, y, z;
 	int err;
 
-	file = fopen(distancesfilename, "r");
+	file = fopen(a->distancesfilename, "r");
 	if (!file) {
-		fprintf(stderr, "Failed to open distances file %s\n", distancesfilename);
+		fprintf(stderr, "Failed to open distances file %s\n", a->distancesfilename);
 		return;
 	}
 
@@ -276,7 +271,7 @@ add_distances(hwloc_topology_t topology, int topodepth)
 		}
 	}
 
-	err = hwloc_distances_add(topology, nbobjs, objs, values, kind, distancesflags);
+	err = hwloc_distances_add(topology, nbobjs, objs, values, kind, a->distancesflags);
 	if (err < 0) {
 		fprintf(stderr, "Failed to add distances\n");
 		goto out;
@@ -289,133 +284,99 @@ out:
 	return;
 }
 
-int main(int argc, char *argv[])
+/* Parse an annotation (options, locations and annotation) from an argument array.
+ * Options found before are kept (they come from the command-line in bulk mode).
+ * Return 0 on success, -1 on error.
+ */
+static int
+parse_annotation(struct annotation *a, int argc, char *argv[])
 {
-	hwloc_topology_t topology;
-	char *callname, *input, *output;
-	char **locations;
-	int nr_locations;
-	int topodepth;
-	int err;
-
-	callname = argv[0];
-	/* skip argv[0], handle options */
-	argc--;
-	argv++;
-
-	hwloc_utils_check_api_version(callname);
-
-	if (!getenv("HWLOC_XML_VERBOSE"))
-		putenv((char *) "HWLOC_XML_VERBOSE=1");
-
-	while (argc && *argv[0] == '-') {
+	while (argc && *argv[0] == '-' && strcmp(argv[0], "--")) {
 		if (!strcmp(argv[0], "--ci"))
-			clearinfos = 1;
+			a->clearinfos = 1;
 		else if (!strcmp(argv[0], "--ri"))
-			replaceinfos = 1;
+			a->replaceinfos = 1;
 		else if (!strcmp(argv[0], "--cu"))
-			clearuserdata = 1;
+			a->clearuserdata = 1;
 		else if (!strcmp(argv[0], "--cd"))
-			cleardistances = 1;
-		else if (!strcmp(argv[0], "-h") || !strcmp(argv[0], "--help")) {
-			usage(callname, stdout);
-			exit(EXIT_SUCCESS);
-		} else {
-			fprintf(stderr, "Unrecognized options: %s\n", argv[0]);
-			usage(callname, stderr);
-			exit(EXIT_FAILURE);
+			a->cleardistances = 1;
+		else {
+			fprintf(stderr, "Unrecognized annotation option: %s\n", argv[0]);
+			return -1;
 		}
 		argc--;
 		argv++;
 	}
 
-	if (argc < 3) {
-		usage(callname, stderr);
-		exit(EXIT_FAILURE);
-	}
-	input = argv[0];
-	output = argv[1];
-	argc -= 2;
-	argv += 2;
+	if (argc < 1)
+		return -1;
 
 	if (!strcmp(argv[0], "--")) {
 	  /* modern syntax with locations between "--" */
 	  argc--;
 	  argv++;
-	  locations = &argv[0];
-	  nr_locations = 0;
-	  while (nr_locations < argc && strcmp(argv[nr_locations], "--"))
-	    nr_locations++;
+	  a->locations = &argv[0];
+	  a->nr_locations = 0;
+	  while (a->nr_locations < argc && strcmp(argv[a->nr_locations], "--"))
+	    a->nr_locations++;
 	  /* check we have an ending "--" */
-	  if (nr_locations == argc || strcmp(argv[nr_locations], "--")) {
-	    usage(callname, stderr);
-	    exit(EXIT_FAILURE);
-	  }
+	  if (a->nr_locations == argc || strcmp(argv[a->nr_locations], "--"))
+	    return -1;
 	  /* skip those locations and the ending "--" */
-	  argc -= nr_locations+1;
-	  argv += nr_locations+1;
+	  argc -= a->nr_locations+1;
+	  argv += a->nr_locations+1;
 	} else {
 	  /* old syntax with a single location without "--" before and after */
-	  locations = &argv[0];
-	  nr_locations = 1;
+	  a->locations = &argv[0];
+	  a->nr_locations = 1;
 	  argc--;
 	  argv++;
 	}
 
-	if (argc < 1) {
-		usage(callname, stderr);
-		exit(EXIT_FAILURE);
-	}
+	if (argc < 1)
+		return -1;
 	if (!strcmp(argv[0], "info")) {
-		if (argc < 2 || (!replaceinfos && argc < 3)) {
-			usage(callname, stderr);
-			exit(EXIT_FAILURE);
-		}
-		infoname = argv[1];
-		infovalue = argc >= 3 ? argv[2] : NULL;
+		if (argc < 2 || (!a->replaceinfos && argc < 3))
+			return -1;
+		a->infoname = argv[1];
+		a->infovalue = argc >= 3 ? argv[2] : NULL;
 
 	} else if (!strcmp(argv[0], "misc")) {
-		if (argc < 2) {
-			usage(callname, stderr);
-			exit(EXIT_FAILURE);
-		}
-		miscname = argv[1];
+		if (argc < 2)
+			return -1;
+		a->miscname = argv[1];
 
 	} else if (!strcmp(argv[0], "distances")) {
-		if (argc < 2) {
-			usage(callname, stderr);
-			exit(EXIT_FAILURE);
-		}
-		distancesfilename = argv[1];
+		if (argc < 2)
+			return -1;
+		a->distancesfilename = argv[1];
 		if (argc >= 3) {
-			distancesflags = hwloc_utils_parse_distances_add_flags(argv[2]);
-                        if(distancesflags == (unsigned long)-1)
-                                goto out;
+			a->distancesflags = hwloc_utils_parse_distances_add_flags(argv[2]);
+                        if(a->distancesflags == (unsigned long)-1)
+                                return -1;
                 }
 
         } else if (!strcmp(argv[0], "memattr")) {
-                if (argc < 3) {
-                        usage(callname, stderr);
-                        exit(EXIT_FAILURE);
-                }
+                if (argc < 3)
+                        return -1;
                 if (argc == 3) {
-                        maname = argv[1];
-                        maflags = hwloc_utils_parse_memattr_flags(argv[2]);
+                        a->maname = argv[1];
+                        a->maflags = hwloc_utils_parse_memattr_flags(argv[2]);
                 } else {
-                        mavname = argv[1];
-                        mavvalue = strtoull(argv[3], NULL, 0);
+                        a->mavname = argv[1];
+                        a->mavvalue = strtoull(argv[3], NULL, 0);
                         if (strcmp(argv[2], "none")) {
                           if (!strncmp(argv[2], "0x", 2)) {
                             /* parse a cpuset */
-                            mavicpuset = hwloc_bitmap_alloc();
-                            if (!mavicpuset) {
+                            a->mavicpuset = hwloc_bitmap_alloc();
+                            if (!a->mavicpuset) {
                               fprintf(stderr, "Failed to allocate cpuset for memattr initiator\n");
-                              goto out;
+                              return -1;
                             }
-                            hwloc_bitmap_sscanf(mavicpuset, argv[2]);
+                            hwloc_bitmap_sscanf(a->mavicpuset, argv[2]);
                           } else {
                             /* parse an object */
-                            maviobjstr = argv[2];
+                            a->maviobjstr = argv[2];
                           }
                         }
                 }
@@ -424,79 +385,244 @@ int main(int argc, char *argv[])
 		/* do nothing (maybe clear) */
 	} else {
 		fprintf(stderr, "Unrecognized annotation type: %s\n", argv[0]);
-		usage(callname, stderr);
-		exit(EXIT_FAILURE);
+		return -1;
 	}
 
-	if (replaceinfos && !infoname) {
+	if (a->replaceinfos && !a->infoname) {
 		fprintf(stderr, "--ri missing a info name\n");
-		usage(callname, stderr);
-		exit(EXIT_FAILURE);
+		return -1;
 	}
 
-	hwloc_topology_init(&topology);
-	hwloc_topology_set_all_types_filter(topology, HWLOC_TYPE_FILTER_KEEP_ALL);
-	hwloc_topology_set_flags(topology, HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED | HWLOC_TOPOLOGY_FLAG_IMPORT_SUPPORT);
-	err = hwloc_topology_set_xml(topology, input);
-	if (err < 0)
-		goto out_with_topology;
+	return 0;
+}
 
-	putenv((char *) "HWLOC_XML_USERDATA_NOT_DECODED=1");
-	hwloc_topology_set_userdata_import_callback(topology, hwloc_utils_userdata_import_cb);
-	hwloc_topology_set_userdata_export_callback(topology, hwloc_utils_userdata_export_cb);
+static void
+free_annotation(struct annotation *a)
+{
+	unsigned i;
+	hwloc_bitmap_free(a->mavicpuset);
+	for(i=0; i<a->nr_args; i++)
+		free(a->args[i]);
+	free(a->args);
+}
 
-	err = hwloc_topology_load(topology);
-	if (err < 0)
-		goto out_with_topology;
+/* Read a whole line, return NULL at end of file */
+static char *
+read_line(FILE *file)
+{
+	size_t len = 0, allocated = 256;
+	char *line = malloc(allocated);
+	if (!line)
+		return NULL;
+	while (fgets(line+len, (int)(allocated-len), file)) {
+		len += strlen(line+len);
+		if (len && line[len-1] == '\n') {
+			line[--len] = '\0';
+			return line;
+		}
+		if (len+1 == allocated) {
+			char *tmp = realloc(line, 2*allocated);
+			if (!tmp)
+				break;
+			line = tmp;
+			allocated *= 2;
+		}
+	}
+	if (len)
+		return line;
+	free(line);
+	return NULL;
+}
 
-	topodepth = hwloc_topology_get_depth(topology);
+/* Split a line into arguments separated by spaces.
+ * Single or double quotes may be used around arguments containing spaces.
+ * Return the number of arguments, or -1 on error.
+ */
+static int
+tokenize_line(char *line, char ***argsp)
+{
+	char **args = NULL;
+	int nr = 0;
+	char *cur = line;
+
+	while (1) {
+		char *arg, *out, **tmp;
+		cur += strspn(cur, " \t\r");
+		if (!*cur)
+			break;
+		arg = out = cur;
+		while (*cur && *cur != ' ' && *cur != '\t' && *cur != '\r') {
+			if (*cur == '"' || *cur == '\'') {
+				char quote = *(cur++);
+				while (*cur && *cur != quote)
+					*(out++) = *(cur++);
+				if (!*cur)
+					goto out_with_args;
+				cur++;
+			} else {
+				*(out++) = *(cur++);
+			}
+		}
+		if (*cur)
+			cur++;
+		*out = '\0';
+
+		tmp = realloc(args, (nr+1) * sizeof(*args));
+		if (!tmp)
+			goto out_with_args;
+		args = tmp;
+		args[nr] = strdup(arg);
+		if (!args[nr])
+			goto out_with_args;
+		nr++;
+	}
+	*argsp = args;
+	return nr;
+
+ out_with_args:
+	while (nr)
+		free(args[--nr]);
+	free(args);
+	return -1;
+}
+
+/* Read annotations from a file, one per line.
+ * Empty lines and lines starting with # are ignored.
+ * Options given on the command-line are applied to each annotation.
+ */
+static int
+read_annotations(const char *filename, const struct annotation *defaults,
+		 struct annotation **annotationsp, unsigned *nrp)
+{
+	struct annotation *annotations = NULL;
+	unsigned nr = 0, linenr = 0;
+	FILE *file;
+	char *line;
+	int err = 0;
+
+	if (!strcmp(filename, "-"))
+		file = stdin;
+	else
+		file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "Failed to open annotations file %s (%s)\n", filename, strerror(errno));
+		return -1;
+	}
+
+	while ((line = read_line(file)) != NULL) {
+		struct annotation *tmp, *a;
+		char **args;
+		int nr_args;
+
+		linenr++;
+		nr_args = tokenize_line(line, &args);
+		free(line);
+		if (nr_args < 0) {
+			fprintf(stderr, "Failed to parse annotations line #%u\n", linenr);
+			err = -1;
+			break;
+		}
+		if (!nr_args || args[0][0] == '#') {
+			while (nr_args)
+				free(args[--nr_args]);
+			free(args);
+			continue;
+		}
+
+		tmp = realloc(annotations, (nr+1) * sizeof(*annotations));
+		if (!tmp) {
+			while (nr_args)
+				free(args[--nr_args]);
+			free(args);
+			err = -1;
+			break;
+		}
+		annotations = tmp;
+		a = &annotations[nr++];
+		*a = *defaults;
+		a->args = args;
+		a->nr_args = nr_args;
+		a->line = linenr;
+		if (parse_annotation(a, nr_args, args) < 0) {
+			fprintf(stderr, "Invalid annotation on line #%u of %s\n", linenr, filename);
+			err = -1;
+			break;
+		}
+	}
+
+	if (file != stdin)
+		fclose(file);
+
+	if (err < 0) {
+		while (nr)
+			free_annotation(&annotations[--nr]);
+		free(annotations);
+		return -1;
+	}
+	*annotationsp = annotations;
+	*nrp = nr;
+	return 0;
+}
 
-	if (cleardistances) {
+/* Apply a single annotation to a loaded topology */
+static int
+annotate_topology(hwloc_topology_t topology, struct annotation *a)
+{
+	int topodepth = hwloc_topology_get_depth(topology);
+	int err;
+
+	if (a->cleardistances) {
 		hwloc_distances_remove(topology);
 	}
 
-	if (distancesfilename) {
+	if (a->distancesfilename) {
 	  /* ignore locations */
-	  add_distances(topology, topodepth);
+	  add_distances(topology, a, topodepth);
 
-        } else if (maname) {
+        } else if (a->maname) {
           hwloc_memattr_id_t id;
-          err = hwloc_memattr_register(topology, maname, maflags, &id);
+          err = hwloc_memattr_register(topology, a->maname, a->maflags, &id);
           if (err < 0) {
             fprintf(stderr, "Failed to register new memattr (%s)\n", strerror(errno));
-            goto out_with_topology;
+            return -1;
           }
 
 	} else {
 	  int i;
           unsigned long mavflags = 0;
 
-          if (mavname) {
-            if (hwloc_memattr_get_by_name(topology, mavname, &mavid) < 0) {
-              fprintf(stderr, "Failed to find memattr by name %s\n", mavname);
-              goto out_with_topology;
+          if (a->mavname) {
+            if (hwloc_memattr_get_by_name(topology, a->mavname, &a->mavid) < 0) {
+              fprintf(stderr, "Failed to find memattr by name %s\n", a->mavname);
+              return -1;
             }
-            hwloc_memattr_get_flags(topology, mavid, &mavflags);
+            hwloc_memattr_get_flags(topology, a->mavid, &mavflags);
           }
 
-          if (maviobjstr && (mavflags & HWLOC_MEMATTR_FLAG_NEED_INITIATOR)) {
+          a->maviobj = NULL;
+          if (a->maviobjstr && (mavflags & HWLOC_MEMATTR_FLAG_NEED_INITIATOR)) {
             int ignored_multiple;
-            maviobj = get_unique_obj(topology, topodepth, maviobjstr, &ignored_multiple);
-            if (!maviobj) {
-              fprintf(stderr, "Failed to find memattr initiator object %s\n", maviobjstr);
-              goto out_with_topology;
+            /* get_unique_obj() modifies the string, keep the original for next topologies */
+            char *objstr = strdup(a->maviobjstr);
+            if (!objstr)
+              return -1;
+            a->maviobj = get_unique_obj(topology, topodepth, objstr, &ignored_multiple);
+            free(objstr);
+            if (!a->maviobj) {
+              fprintf(stderr, "Failed to find memattr initiator object %s\n", a->maviobjstr);
+              return -1;
             }
             if (ignored_multiple) {
               fprintf(stderr, "Only the first object specified is used as a memattr initiator.\n");
             }
           }
 
-	  for(i=0; i<nr_locations; i++) {
-	    char *location = locations[i];
+	  for(i=0; i<a->nr_locations; i++) {
+	    char *location = a->locations[i];
 	    if (!strcmp(location, "all")) {
-	      apply_recursive(topology, hwloc_get_root_obj(topology));
+	      apply_recursive(topology, a, hwloc_get_root_obj(topology));
 	    } else if (!strcmp(location, "root")) {
-	      apply(topology, hwloc_get_root_obj(topology));
+	      apply(topology, a, hwloc_get_root_obj(topology));
 	    } else {
 		size_t typelen;
 		typelen = strspn(location, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789");
@@ -508,24 +634,239 @@ int main(int argc, char *argv[])
 			lcontext.logical = 1;
 			lcontext.verbose = 0;
 			err = hwloc_calc_process_location(&lcontext, location, typelen,
-							  hwloc_calc_process_location_annotate_cb, NULL);
+							  hwloc_calc_process_location_annotate_cb, a);
 		}
 	    }
 	  }
 	}
 
-	err = hwloc_topology_export_xml(topology, output, 0);
+	return 0;
+}
+
+/* Load an input XML, apply all annotations and export once */
+static int
+annotate_file(const char *input, const char *output, struct annotation *annotations, unsigned nr_annotations)
+{
+	hwloc_topology_t topology;
+	unsigned i;
+	int err;
+
+	hwloc_topology_init(&topology);
+	hwloc_topology_set_all_types_filter(topology, HWLOC_TYPE_FILTER_KEEP_ALL);
+	hwloc_topology_set_flags(topology, HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED | HWLOC_TOPOLOGY_FLAG_IMPORT_SUPPORT);
+	err = hwloc_topology_set_xml(topology, input);
 	if (err < 0)
-		goto out;
+		goto out_with_topology;
 
-	hwloc_utils_userdata_free_recursive(hwloc_get_root_obj(topology));
-	hwloc_topology_destroy(topology);
-	exit(EXIT_SUCCESS);
+	hwloc_topology_set_userdata_import_callback(topology, hwloc_utils_userdata_import_cb);
+	hwloc_topology_set_userdata_export_callback(topology, hwloc_utils_userdata_export_cb);
 
-out_with_topology:
+	err = hwloc_topology_load(topology);
+	if (err < 0)
+		goto out_with_topology;
+
+	for(i=0; i<nr_annotations; i++) {
+		err = annotate_topology(topology, &annotations[i]);
+		if (err < 0) {
+			if (annotations[i].line)
+				fprintf(stderr, "Failed to apply annotation from line #%u to %s\n", annotations[i].line, input);
+			goto out_with_userdata;
+		}
+	}
+
+	err = hwloc_topology_export_xml(topology, output, 0);
+
+ out_with_userdata:
 	hwloc_utils_userdata_free_recursive(hwloc_get_root_obj(topology));
+ out_with_topology:
 	hwloc_topology_destroy(topology);
-out:
-	hwloc_bitmap_free(mavicpuset);
-	exit(EXIT_FAILURE);
+	return err;
+}
+
+static int
+annotate_file_to_dir(const char *input, const char *outputdir, struct annotation *annotations, unsigned nr_annotations)
+{
+	const char *basename;
+	char *output;
+	int err;
+
+	basename = strrchr(input, '/');
+	basename = basename ? basename+1 : input;
+	output = malloc(strlen(outputdir) + strlen(basename) + 2);
+	if (!output)
+		return -1;
+	sprintf(output, "%s/%s", outputdir, basename);
+	err = annotate_file(input, output, annotations, nr_annotations);
+	if (err < 0)
+		fprintf(stderr, "Failed to annotate %s into %s\n", input, output);
+	free(output);
+	return err;
+}
+
+/* Annotate multiple files into outputdir, with up to jobs child processes if supported.
+ * Return the number of failures.
+ */
+static unsigned
+annotate_files(int nr_inputs, char *inputs[], const char *outputdir, unsigned jobs,
+	       struct annotation *annotations, unsigned nr_annotations)
+{
+	unsigned failed = 0;
+	int i;
+
+#if (defined HAVE_FORK) && (defined HAVE_SYS_WAIT_H)
+	if (jobs > 1) {
+		unsigned running = 0;
+		i = 0;
+		while (i < nr_inputs || running) {
+			int status;
+			pid_t pid;
+			if (i < nr_inputs && running < jobs) {
+				pid = fork();
+				if (!pid)
+					_exit(annotate_file_to_dir(inputs[i], outputdir, annotations, nr_annotations) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+				if (pid > 0) {
+					running++;
+					i++;
+					continue;
+				}
+				/* fork failed, process this file here */
+				if (annotate_file_to_dir(inputs[i], outputdir, annotations, nr_annotations) < 0)
+					failed++;
+				i++;
+				continue;
+			}
+			pid = wait(&status);
+			if (pid < 0)
+				break;
+			running--;
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+				failed++;
+		}
+		return failed;
+	}
+#else
+	if (jobs > 1)
+		fprintf(stderr, "Parallel jobs are not supported on this platform, processing files sequentially.\n");
+#endif
+
+	for(i=0; i<nr_inputs; i++)
+		if (annotate_file_to_dir(inputs[i], outputdir, annotations, nr_annotations) < 0)
+			failed++;
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	struct annotation defaults, *annotations = NULL;
+	unsigned nr_annotations = 0, i;
+	char *callname, *input, *output;
+	char *annotationsfile = NULL, *outputdir = NULL;
+	unsigned jobs = 1;
+	int ret = EXIT_FAILURE;
+
+	callname = argv[0];
+	/* skip argv[0], handle options */
+	argc--;
+	argv++;
+
+	hwloc_utils_check_api_version(callname);
+
+	if (!getenv("HWLOC_XML_VERBOSE"))
+		putenv((char *) "HWLOC_XML_VERBOSE=1");
+
+	memset(&defaults, 0, sizeof(defaults));
+	while (argc && *argv[0] == '-' && strcmp(argv[0], "--")) {
+		if (!strcmp(argv[0], "--ci"))
+			defaults.clearinfos = 1;
+		else if (!strcmp(argv[0], "--ri"))
+			defaults.replaceinfos = 1;
+		else if (!strcmp(argv[0], "--cu"))
+			defaults.clearuserdata = 1;
+		else if (!strcmp(argv[0], "--cd"))
+			defaults.cleardistances = 1;
+		else if (!strcmp(argv[0], "--file")) {
+			if (argc < 2) {
+				usage(callname, stderr);
+				exit(EXIT_FAILURE);
+			}
+			annotationsfile = argv[1];
+			argc--;
+			argv++;
+		} else if (!strcmp(argv[0], "--output-dir")) {
+			if (argc < 2) {
+				usage(callname, stderr);
+				exit(EXIT_FAILURE);
+			}
+			outputdir = argv[1];
+			argc--;
+			argv++;
+		} else if (!strcmp(argv[0], "-j") || !strcmp(argv[0], "--jobs")) {
+			if (argc < 2) {
+				usage(callname, stderr);
+				exit(EXIT_FAILURE);
+			}
+			jobs = atoi(argv[1]);
+			if (!jobs)
+				jobs = 1;
+			argc--;
+			argv++;
+		} else if (!strcmp(argv[0], "-h") || !strcmp(argv[0], "--help")) {
+			usage(callname, stdout);
+			exit(EXIT_SUCCESS);
+		} else {
+			fprintf(stderr, "Unrecognized options: %s\n", argv[0]);
+			usage(callname, stderr);
+			exit(EXIT_FAILURE);
+		}
+		argc--;
+		argv++;
+	}
+
+	if (outputdir && !annotationsfile) {
+		fprintf(stderr, "--output-dir requires annotations from --file\n");
+		usage(callname, stderr);
+		exit(EXIT_FAILURE);
+	}
+
+	if (annotationsfile) {
+		if (outputdir ? argc < 1 : argc != 2) {
+			usage(callname, stderr);
+			exit(EXIT_FAILURE);
+		}
+		if (read_annotations(annotationsfile, &defaults, &annotations, &nr_annotations) < 0)
+			exit(EXIT_FAILURE);
+	} else {
+		if (argc < 3) {
+			usage(callname, stderr);
+			exit(EXIT_FAILURE);
+		}
+		annotations = malloc(sizeof(*annotations));
+		if (!annotations)
+			exit(EXIT_FAILURE);
+		annotations[0] = defaults;
+		nr_annotations = 1;
+		if (parse_annotation(&annotations[0], argc-2, argv+2) < 0) {
+			free_annotation(&annotations[0]);
+			free(annotations);
+			usage(callname, stderr);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	putenv((char *) "HWLOC_XML_USERDATA_NOT_DECODED=1");
+
+	if (outputdir) {
+		if (!annotate_files(argc, argv, outputdir, jobs, annotations, nr_annotations))
+			ret = EXIT_SUCCESS;
+	} else {
+		input = argv[0];
+		output = argv[1];
+		if (!annotate_file(input, output, annotations, nr_annotations))
+			ret = EXIT_SUCCESS;
+	}
+
+	for(i=0; i<nr_annotations; i++)
+		free_annotation(&annotations[i]);
+	free(annotations);
+	return ret;
 }
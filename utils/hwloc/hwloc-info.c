@@ -28,6 +28,7 @@ static int show_ancestor_depth = HWLOC_TYPE_DEPTH_UNKNOWN;
 static int show_children = 0;
 static int show_descendants_depth = HWLOC_TYPE_DEPTH_UNKNOWN;
 static int show_index_prefix = 0;
+static int show_json = 0;
 static int show_local_memory = 0;
 static int show_local_memory_flags = HWLOC_LOCAL_NUMANODE_FLAG_SMALLER_LOCALITY | HWLOC_LOCAL_NUMANODE_FLAG_LARGER_LOCALITY;
 static hwloc_memattr_id_t best_memattr_id = (hwloc_memattr_id_t) -1;
@@ -40,6 +41,10 @@ void usage(const char *name, FILE *where)
   fprintf (where, "  --objects             Report information about specific objects\n");
   fprintf (where, "  --topology            Report information the topology\n");
   fprintf (where, "  --support             Report information about supported features\n");
+  fprintf (where, "  --query               Report objects matching selectors such as\n"
+		  "                        PCIDev[vendor=0x15b3] or OSDev[Port1State=4],\n"
+		  "                        or read selectors from the standard input with -\n");
+  fprintf (where, "  --json                Report the whole topology in JSON\n");
   fprintf (where, "  -v --verbose          Include additional details\n");
   fprintf (where, "  -s --silent           Reduce the amount of details to show\n");
   fprintf (where, "  --ancestors           Display the chain of ancestor objects up to the root\n");
@@ -454,6 +459,703 @@ hwloc_calc_process_location_info_cb(struct hwloc_calc_location_context_s *lconte
   current_obj++;
 }
 
+/*******************
+ * Query mode
+ *
+ * Each selector is <head>[<pred>,<pred>,...] where <head> is "all", a depth,
+ * a type or a subtype, and each predicate is <name>[<op><value>] with <name>
+ * either a builtin attribute or an info name.
+ * Objects are looked up in the levels directly, or in info-name and subtype
+ * indexes built once when the first selector needs them.
+ */
+
+enum hwloc_info_query_op {
+  HWLOC_INFO_QUERY_OP_EXISTS,
+  HWLOC_INFO_QUERY_OP_EQ,
+  HWLOC_INFO_QUERY_OP_NE,
+  HWLOC_INFO_QUERY_OP_LT,
+  HWLOC_INFO_QUERY_OP_GT,
+  HWLOC_INFO_QUERY_OP_LE,
+  HWLOC_INFO_QUERY_OP_GE
+};
+
+enum hwloc_info_query_attr {
+  HWLOC_INFO_QUERY_ATTR_INFO, /* not a builtin attribute, look in infos */
+  HWLOC_INFO_QUERY_ATTR_OS_INDEX,
+  HWLOC_INFO_QUERY_ATTR_GP_INDEX,
+  HWLOC_INFO_QUERY_ATTR_DEPTH,
+  HWLOC_INFO_QUERY_ATTR_ARITY,
+  HWLOC_INFO_QUERY_ATTR_MEMORY,
+  HWLOC_INFO_QUERY_ATTR_LOCAL_MEMORY,
+  HWLOC_INFO_QUERY_ATTR_SIZE,
+  HWLOC_INFO_QUERY_ATTR_LINESIZE,
+  HWLOC_INFO_QUERY_ATTR_ASSOCIATIVITY,
+  HWLOC_INFO_QUERY_ATTR_VENDOR,
+  HWLOC_INFO_QUERY_ATTR_DEVICE,
+  HWLOC_INFO_QUERY_ATTR_SUBVENDOR,
+  HWLOC_INFO_QUERY_ATTR_SUBDEVICE,
+  HWLOC_INFO_QUERY_ATTR_CLASS,
+  HWLOC_INFO_QUERY_ATTR_DOMAIN,
+  HWLOC_INFO_QUERY_ATTR_BUS,
+  HWLOC_INFO_QUERY_ATTR_DEV,
+  HWLOC_INFO_QUERY_ATTR_FUNC,
+  /* string attributes below */
+  HWLOC_INFO_QUERY_ATTR_NAME,
+  HWLOC_INFO_QUERY_ATTR_SUBTYPE,
+  HWLOC_INFO_QUERY_ATTR_BUSID
+};
+
+static const struct {
+  const char *name;
+  enum hwloc_info_query_attr attr;
+} hwloc_info_query_attrs[] = {
+  { "os_index", HWLOC_INFO_QUERY_ATTR_OS_INDEX },
+  { "gp_index", HWLOC_INFO_QUERY_ATTR_GP_INDEX },
+  { "depth", HWLOC_INFO_QUERY_ATTR_DEPTH },
+  { "arity", HWLOC_INFO_QUERY_ATTR_ARITY },
+  { "memory", HWLOC_INFO_QUERY_ATTR_MEMORY },
+  { "local_memory", HWLOC_INFO_QUERY_ATTR_LOCAL_MEMORY },
+  { "size", HWLOC_INFO_QUERY_ATTR_SIZE },
+  { "linesize", HWLOC_INFO_QUERY_ATTR_LINESIZE },
+  { "associativity", HWLOC_INFO_QUERY_ATTR_ASSOCIATIVITY },
+  { "vendor", HWLOC_INFO_QUERY_ATTR_VENDOR },
+  { "device", HWLOC_INFO_QUERY_ATTR_DEVICE },
+  { "subvendor", HWLOC_INFO_QUERY_ATTR_SUBVENDOR },
+  { "subdevice", HWLOC_INFO_QUERY_ATTR_SUBDEVICE },
+  { "class", HWLOC_INFO_QUERY_ATTR_CLASS },
+  { "domain", HWLOC_INFO_QUERY_ATTR_DOMAIN },
+  { "bus", HWLOC_INFO_QUERY_ATTR_BUS },
+  { "dev", HWLOC_INFO_QUERY_ATTR_DEV },
+  { "func", HWLOC_INFO_QUERY_ATTR_FUNC },
+  { "name", HWLOC_INFO_QUERY_ATTR_NAME },
+  { "subtype", HWLOC_INFO_QUERY_ATTR_SUBTYPE },
+  { "busid", HWLOC_INFO_QUERY_ATTR_BUSID }
+};
+
+struct hwloc_info_query_pred {
+  char *name;
+  enum hwloc_info_query_attr attr;
+  enum hwloc_info_query_op op;
+  char *value;
+  int value_is_number;
+  unsigned long long number;
+};
+
+struct hwloc_info_query_selector {
+  const char *string;
+  /* depths of the levels where objects may be found */
+  int *depths;
+  unsigned nr_depths;
+  int osdevtype; /* -1 if unspecified */
+  char *subtype; /* NULL if unspecified */
+  struct hwloc_info_query_pred *preds;
+  unsigned nr_preds;
+};
+
+/* list of objects in level order, in an info-name or subtype index bucket */
+struct hwloc_info_query_bucket {
+  char *key;
+  hwloc_obj_t *objs;
+  unsigned nr, allocated;
+};
+
+struct hwloc_info_query_index {
+  struct hwloc_info_query_bucket *buckets;
+  unsigned size, count; /* size is a power of 2 */
+};
+
+struct hwloc_info_query_context {
+  hwloc_topology_t topology;
+  int *all_depths;
+  unsigned nr_all_depths;
+  int indexes_built;
+  struct hwloc_info_query_index infos;
+  struct hwloc_info_query_index subtypes;
+};
+
+static unsigned
+hwloc_info_query_hash(const char *key)
+{
+  /* case-insensitive FNV-1a since subtypes are matched with strcasecmp() */
+  unsigned hash = 2166136261U;
+  while (*key) {
+    hash ^= (unsigned char) tolower((unsigned char) *key++);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static struct hwloc_info_query_bucket *
+hwloc_info_query_index_find(struct hwloc_info_query_index *index, const char *key, int create)
+{
+  unsigned i;
+
+  if (create && (index->count+1)*2 > index->size) {
+    /* grow at 50% load */
+    struct hwloc_info_query_index new;
+    new.size = index->size ? index->size*2 : 64;
+    new.count = index->count;
+    new.buckets = calloc(new.size, sizeof(*new.buckets));
+    if (!new.buckets)
+      return NULL;
+    for(i=0; i<index->size; i++) {
+      struct hwloc_info_query_bucket *old = &index->buckets[i];
+      unsigned j;
+      if (!old->key)
+	continue;
+      j = hwloc_info_query_hash(old->key) & (new.size-1);
+      while (new.buckets[j].key)
+	j = (j+1) & (new.size-1);
+      new.buckets[j] = *old;
+    }
+    free(index->buckets);
+    *index = new;
+  }
+
+  if (!index->size)
+    return NULL;
+
+  i = hwloc_info_query_hash(key) & (index->size-1);
+  while (index->buckets[i].key) {
+    if (!strcasecmp(index->buckets[i].key, key))
+      return &index->buckets[i];
+    i = (i+1) & (index->size-1);
+  }
+  if (!create)
+    return NULL;
+
+  index->buckets[i].key = strdup(key);
+  if (!index->buckets[i].key)
+    return NULL;
+  index->count++;
+  return &index->buckets[i];
+}
+
+static int
+hwloc_info_query_index_add(struct hwloc_info_query_index *index, const char *key, hwloc_obj_t obj)
+{
+  struct hwloc_info_query_bucket *bucket = hwloc_info_query_index_find(index, key, 1);
+  if (!bucket)
+    return -1;
+  if (bucket->nr && bucket->objs[bucket->nr-1] == obj)
+    /* the same info name appears several times in this object */
+    return 0;
+  if (bucket->nr == bucket->allocated) {
+    unsigned allocated = bucket->allocated ? bucket->allocated*2 : 8;
+    hwloc_obj_t *objs = realloc(bucket->objs, allocated * sizeof(*objs));
+    if (!objs)
+      return -1;
+    bucket->objs = objs;
+    bucket->allocated = allocated;
+  }
+  bucket->objs[bucket->nr++] = obj;
+  return 0;
+}
+
+static void
+hwloc_info_query_index_destroy(struct hwloc_info_query_index *index)
+{
+  unsigned i;
+  for(i=0; i<index->size; i++) {
+    free(index->buckets[i].key);
+    free(index->buckets[i].objs);
+  }
+  free(index->buckets);
+}
+
+static int
+hwloc_info_query_build_indexes(struct hwloc_info_query_context *context)
+{
+  unsigned i, j, k;
+
+  if (context->indexes_built)
+    return 0;
+  context->indexes_built = 1;
+
+  for(i=0; i<context->nr_all_depths; i++) {
+    int depth = context->all_depths[i];
+    unsigned n = hwloc_get_nbobjs_by_depth(context->topology, depth);
+    for(j=0; j<n; j++) {
+      hwloc_obj_t obj = hwloc_get_obj_by_depth(context->topology, depth, j);
+      for(k=0; k<obj->infos_count; k++)
+	if (hwloc_info_query_index_add(&context->infos, obj->infos[k].name, obj) < 0)
+	  return -1;
+      if (obj->subtype)
+	if (hwloc_info_query_index_add(&context->subtypes, obj->subtype, obj) < 0)
+	  return -1;
+    }
+  }
+  return 0;
+}
+
+static void
+hwloc_info_query_context_init(struct hwloc_info_query_context *context, hwloc_topology_t topology)
+{
+  static const int special_depths[] = {
+    HWLOC_TYPE_DEPTH_NUMANODE, HWLOC_TYPE_DEPTH_MEMCACHE,
+    HWLOC_TYPE_DEPTH_BRIDGE, HWLOC_TYPE_DEPTH_PCI_DEVICE, HWLOC_TYPE_DEPTH_OS_DEVICE,
+    HWLOC_TYPE_DEPTH_MISC
+  };
+  int topodepth = hwloc_topology_get_depth(topology);
+  unsigned i;
+
+  memset(context, 0, sizeof(*context));
+  context->topology = topology;
+  context->all_depths = malloc((topodepth + sizeof(special_depths)/sizeof(*special_depths)) * sizeof(int));
+  if (!context->all_depths)
+    return;
+  for(i=0; i<(unsigned) topodepth; i++)
+    context->all_depths[context->nr_all_depths++] = i;
+  for(i=0; i<sizeof(special_depths)/sizeof(*special_depths); i++)
+    context->all_depths[context->nr_all_depths++] = special_depths[i];
+}
+
+static void
+hwloc_info_query_context_destroy(struct hwloc_info_query_context *context)
+{
+  hwloc_info_query_index_destroy(&context->infos);
+  hwloc_info_query_index_destroy(&context->subtypes);
+  free(context->all_depths);
+}
+
+static void
+hwloc_info_query_selector_free(struct hwloc_info_query_selector *sel)
+{
+  unsigned i;
+  for(i=0; i<sel->nr_preds; i++) {
+    free(sel->preds[i].name);
+    free(sel->preds[i].value);
+  }
+  free(sel->preds);
+  free(sel->subtype);
+  free(sel->depths);
+}
+
+static int
+hwloc_info_query_parse_pred(struct hwloc_info_query_pred *pred, const char *string, size_t len)
+{
+  static const char *ops[] = { "<=", ">=", "!=", "=", "<", ">" };
+  static const enum hwloc_info_query_op opvalues[] = {
+    HWLOC_INFO_QUERY_OP_LE, HWLOC_INFO_QUERY_OP_GE, HWLOC_INFO_QUERY_OP_NE,
+    HWLOC_INFO_QUERY_OP_EQ, HWLOC_INFO_QUERY_OP_LT, HWLOC_INFO_QUERY_OP_GT
+  };
+  size_t namelen = strcspn(string, "=!<>");
+  unsigned i;
+
+  if (namelen > len)
+    namelen = len;
+  if (!namelen)
+    return -1;
+  pred->name = malloc(namelen+1);
+  if (!pred->name)
+    return -1;
+  memcpy(pred->name, string, namelen);
+  pred->name[namelen] = '\0';
+
+  pred->attr = HWLOC_INFO_QUERY_ATTR_INFO;
+  for(i=0; i<sizeof(hwloc_info_query_attrs)/sizeof(*hwloc_info_query_attrs); i++)
+    if (!strcmp(pred->name, hwloc_info_query_attrs[i].name)) {
+      pred->attr = hwloc_info_query_attrs[i].attr;
+      break;
+    }
+
+  pred->op = HWLOC_INFO_QUERY_OP_EXISTS;
+  if (namelen == len)
+    return 0;
+
+  string += namelen;
+  len -= namelen;
+  for(i=0; i<sizeof(ops)/sizeof(*ops); i++) {
+    size_t oplen = strlen(ops[i]);
+    if (len >= oplen && !strncmp(string, ops[i], oplen)) {
+      pred->op = opvalues[i];
+      string += oplen;
+      len -= oplen;
+      break;
+    }
+  }
+  if (pred->op == HWLOC_INFO_QUERY_OP_EXISTS)
+    return -1;
+
+  pred->value = malloc(len+1);
+  if (!pred->value)
+    return -1;
+  memcpy(pred->value, string, len);
+  pred->value[len] = '\0';
+
+  if (*pred->value) {
+    char *end;
+    pred->number = strtoull(pred->value, &end, 0);
+    pred->value_is_number = !*end;
+  }
+
+  if (pred->attr >= HWLOC_INFO_QUERY_ATTR_NAME) {
+    /* string attributes only support equality */
+    if (pred->op != HWLOC_INFO_QUERY_OP_EQ && pred->op != HWLOC_INFO_QUERY_OP_NE)
+      return -1;
+  } else if (pred->attr != HWLOC_INFO_QUERY_ATTR_INFO) {
+    /* numeric attributes need a numeric value */
+    if (!pred->value_is_number)
+      return -1;
+  }
+  return 0;
+}
+
+static int
+hwloc_info_query_parse_selector(struct hwloc_info_query_context *context,
+				struct hwloc_info_query_selector *sel,
+				const char *string)
+{
+  hwloc_topology_t topology = context->topology;
+  size_t headlen = strcspn(string, "[");
+  char *head;
+  unsigned i;
+
+  memset(sel, 0, sizeof(*sel));
+  sel->string = string;
+  sel->osdevtype = -1;
+  sel->depths = malloc(context->nr_all_depths * sizeof(*sel->depths));
+  head = malloc(headlen+1);
+  if (!sel->depths || !head)
+    goto failed;
+  memcpy(head, string, headlen);
+  head[headlen] = '\0';
+
+  if (!strcmp(head, "all")) {
+    memcpy(sel->depths, context->all_depths, context->nr_all_depths * sizeof(*sel->depths));
+    sel->nr_depths = context->nr_all_depths;
+
+  } else if (*head && strspn(head, "0123456789") == headlen) {
+    int depth = atoi(head);
+    if (depth >= hwloc_topology_get_depth(topology))
+      goto failed;
+    sel->depths[sel->nr_depths++] = depth;
+
+  } else {
+    union hwloc_obj_attr_u attr;
+    hwloc_obj_type_t type;
+    int depth;
+
+    if (hwloc_type_sscanf(head, &type, &attr, sizeof(attr)) == 0) {
+      if (hwloc_type_sscanf_as_depth(head, NULL, topology, &depth) < 0)
+	goto failed;
+      if (depth == HWLOC_TYPE_DEPTH_MULTIPLE) {
+	/* Groups at several depths */
+	for(i=0; i<context->nr_all_depths; i++)
+	  if (hwloc_get_depth_type(topology, context->all_depths[i]) == type)
+	    sel->depths[sel->nr_depths++] = context->all_depths[i];
+      } else if (depth != HWLOC_TYPE_DEPTH_UNKNOWN) {
+	sel->depths[sel->nr_depths++] = depth;
+      }
+      if (type == HWLOC_OBJ_OS_DEVICE)
+	sel->osdevtype = (int) attr.osdev.type;
+    } else if (*head) {
+      /* not a type, try a subtype */
+      memcpy(sel->depths, context->all_depths, context->nr_all_depths * sizeof(*sel->depths));
+      sel->nr_depths = context->nr_all_depths;
+      sel->subtype = head;
+      head = NULL;
+    } else {
+      goto failed;
+    }
+  }
+  free(head);
+  head = NULL;
+
+  if (string[headlen] == '[') {
+    const char *current = string + headlen + 1;
+    const char *end = strchr(current, ']');
+    if (!end || end[1] != '\0' || end == current)
+      goto failed;
+    while (current <= end) {
+      size_t len = strcspn(current, ",]");
+      struct hwloc_info_query_pred *tmp = realloc(sel->preds, (sel->nr_preds+1) * sizeof(*sel->preds));
+      if (!tmp)
+	goto failed;
+      sel->preds = tmp;
+      memset(&sel->preds[sel->nr_preds], 0, sizeof(*sel->preds));
+      sel->nr_preds++;
+      if (hwloc_info_query_parse_pred(&sel->preds[sel->nr_preds-1], current, len) < 0)
+	goto failed;
+      current += len + 1;
+    }
+  } else if (string[headlen] != '\0') {
+    goto failed;
+  }
+  return 0;
+
+ failed:
+  free(head);
+  hwloc_info_query_selector_free(sel);
+  return -1;
+}
+
+/* returns 1 if the object has a numeric value for this attribute, 2 if it has a string, 0 otherwise */
+static int
+hwloc_info_query_get_attr(hwloc_obj_t obj, enum hwloc_info_query_attr attr,
+			  unsigned long long *number, const char **string, char *buffer, size_t buflen)
+{
+  int ispci = obj->type == HWLOC_OBJ_PCI_DEVICE
+    || (obj->type == HWLOC_OBJ_BRIDGE && obj->attr->bridge.upstream_type == HWLOC_OBJ_BRIDGE_PCI);
+  int iscache = hwloc_obj_type_is_cache(obj->type);
+
+  switch (attr) {
+  case HWLOC_INFO_QUERY_ATTR_OS_INDEX:
+    if (obj->os_index == (unsigned) -1)
+      return 0;
+    *number = obj->os_index;
+    return 1;
+  case HWLOC_INFO_QUERY_ATTR_GP_INDEX: *number = obj->gp_index; return 1;
+  case HWLOC_INFO_QUERY_ATTR_DEPTH: *number = obj->depth; return 1;
+  case HWLOC_INFO_QUERY_ATTR_ARITY: *number = obj->arity; return 1;
+  case HWLOC_INFO_QUERY_ATTR_MEMORY: *number = obj->total_memory; return 1;
+  case HWLOC_INFO_QUERY_ATTR_LOCAL_MEMORY:
+    if (obj->type != HWLOC_OBJ_NUMANODE)
+      return 0;
+    *number = obj->attr->numanode.local_memory;
+    return 1;
+  case HWLOC_INFO_QUERY_ATTR_SIZE:
+    if (!iscache)
+      return 0;
+    *number = obj->attr->cache.size;
+    return 1;
+  case HWLOC_INFO_QUERY_ATTR_LINESIZE:
+    if (!iscache)
+      return 0;
+    *number = obj->attr->cache.linesize;
+    return 1;
+  case HWLOC_INFO_QUERY_ATTR_ASSOCIATIVITY:
+    if (!iscache)
+      return 0;
+    *number = (unsigned long long) obj->attr->cache.associativity;
+    return 1;
+  case HWLOC_INFO_QUERY_ATTR_VENDOR:
+  case HWLOC_INFO_QUERY_ATTR_DEVICE:
+  case HWLOC_INFO_QUERY_ATTR_SUBVENDOR:
+  case HWLOC_INFO_QUERY_ATTR_SUBDEVICE:
+  case HWLOC_INFO_QUERY_ATTR_CLASS:
+  case HWLOC_INFO_QUERY_ATTR_DOMAIN:
+  case HWLOC_INFO_QUERY_ATTR_BUS:
+  case HWLOC_INFO_QUERY_ATTR_DEV:
+  case HWLOC_INFO_QUERY_ATTR_FUNC:
+    if (!ispci)
+      return 0;
+    switch (attr) {
+    case HWLOC_INFO_QUERY_ATTR_VENDOR: *number = obj->attr->pcidev.vendor_id; break;
+    case HWLOC_INFO_QUERY_ATTR_DEVICE: *number = obj->attr->pcidev.device_id; break;
+    case HWLOC_INFO_QUERY_ATTR_SUBVENDOR: *number = obj->attr->pcidev.subvendor_id; break;
+    case HWLOC_INFO_QUERY_ATTR_SUBDEVICE: *number = obj->attr->pcidev.subdevice_id; break;
+    case HWLOC_INFO_QUERY_ATTR_CLASS: *number = obj->attr->pcidev.class_id; break;
+    case HWLOC_INFO_QUERY_ATTR_DOMAIN: *number = obj->attr->pcidev.domain; break;
+    case HWLOC_INFO_QUERY_ATTR_BUS: *number = obj->attr->pcidev.bus; break;
+    case HWLOC_INFO_QUERY_ATTR_DEV: *number = obj->attr->pcidev.dev; break;
+    default: *number = obj->attr->pcidev.func; break;
+    }
+    return 1;
+  case HWLOC_INFO_QUERY_ATTR_NAME:
+    if (!obj->name)
+      return 0;
+    *string = obj->name;
+    return 2;
+  case HWLOC_INFO_QUERY_ATTR_SUBTYPE:
+    if (!obj->subtype)
+      return 0;
+    *string = obj->subtype;
+    return 2;
+  case HWLOC_INFO_QUERY_ATTR_BUSID:
+    if (!ispci)
+      return 0;
+    snprintf(buffer, buflen, "%04x:%02x:%02x.%01x",
+	     obj->attr->pcidev.domain, obj->attr->pcidev.bus, obj->attr->pcidev.dev, obj->attr->pcidev.func);
+    *string = buffer;
+    return 2;
+  case HWLOC_INFO_QUERY_ATTR_INFO:
+    break;
+  }
+  return 0;
+}
+
+static int
+hwloc_info_query_compare_number(enum hwloc_info_query_op op, unsigned long long a, unsigned long long b)
+{
+  switch (op) {
+  case HWLOC_INFO_QUERY_OP_EXISTS: return 1;
+  case HWLOC_INFO_QUERY_OP_EQ: return a == b;
+  case HWLOC_INFO_QUERY_OP_NE: return a != b;
+  case HWLOC_INFO_QUERY_OP_LT: return a < b;
+  case HWLOC_INFO_QUERY_OP_GT: return a > b;
+  case HWLOC_INFO_QUERY_OP_LE: return a <= b;
+  case HWLOC_INFO_QUERY_OP_GE: return a >= b;
+  }
+  return 0;
+}
+
+static int
+hwloc_info_query_compare_string(const struct hwloc_info_query_pred *pred, const char *value)
+{
+  if (pred->op == HWLOC_INFO_QUERY_OP_EXISTS)
+    return 1;
+  if (pred->op == HWLOC_INFO_QUERY_OP_EQ)
+    return !strcmp(value, pred->value);
+  if (pred->op == HWLOC_INFO_QUERY_OP_NE)
+    return !!strcmp(value, pred->value);
+  /* ordering, compare as numbers */
+  if (pred->value_is_number) {
+    char *end;
+    unsigned long long number = strtoull(value, &end, 0);
+    if (end != value && !*end)
+      return hwloc_info_query_compare_number(pred->op, number, pred->number);
+  }
+  return 0;
+}
+
+static int
+hwloc_info_query_match_pred(hwloc_obj_t obj, const struct hwloc_info_query_pred *pred)
+{
+  unsigned long long number;
+  const char *string;
+  char buffer[16];
+  unsigned i;
+
+  switch (hwloc_info_query_get_attr(obj, pred->attr, &number, &string, buffer, sizeof(buffer))) {
+  case 1:
+    return hwloc_info_query_compare_number(pred->op, number, pred->number);
+  case 2:
+    return hwloc_info_query_compare_string(pred, string);
+  default:
+    if (pred->attr != HWLOC_INFO_QUERY_ATTR_INFO)
+      return 0;
+  }
+
+  /* the same info name may appear several times, match any of them,
+   * but != doesn't match if the name doesn't exist at all */
+  for(i=0; i<obj->infos_count; i++)
+    if (!strcmp(obj->infos[i].name, pred->name)
+	&& hwloc_info_query_compare_string(pred, obj->infos[i].value))
+      return 1;
+  return 0;
+}
+
+static int
+hwloc_info_query_match(const struct hwloc_info_query_selector *sel, hwloc_obj_t obj, int check_head)
+{
+  unsigned i;
+
+  if (check_head) {
+    for(i=0; i<sel->nr_depths; i++)
+      if (obj->depth == sel->depths[i])
+	break;
+    if (i == sel->nr_depths)
+      return 0;
+  }
+  if (sel->osdevtype != -1 && (int) obj->attr->osdev.type != sel->osdevtype)
+    return 0;
+  if (sel->subtype && (!obj->subtype || strcasecmp(obj->subtype, sel->subtype)))
+    return 0;
+  for(i=0; i<sel->nr_preds; i++)
+    if (!hwloc_info_query_match_pred(obj, &sel->preds[i]))
+      return 0;
+  return 1;
+}
+
+static void
+hwloc_info_query_show(hwloc_topology_t topology, const struct hwloc_info_query_selector *sel,
+		      hwloc_obj_t obj, unsigned *nr, int verbose)
+{
+  char objs[128];
+  char prefix[32];
+
+  hwloc_obj_type_snprintf(objs, sizeof(objs), obj, 1);
+  if (verbose > 0) {
+    prefix[0] = '\0';
+    if (show_index_prefix)
+      snprintf(prefix, sizeof(prefix), "%u.%u: ", current_obj, *nr);
+    printf("%s%s L#%u = match #%u of %s\n", prefix, objs, obj->logical_index, *nr, sel->string);
+    hwloc_info_show_obj(topology, obj, objs, prefix, verbose);
+  } else {
+    printf("%s%s:%u", verbose < 0 && !*nr ? "" : " ", objs, obj->logical_index);
+  }
+  (*nr)++;
+}
+
+static int
+hwloc_info_query_run(struct hwloc_info_query_context *context, const char *string, int verbose)
+{
+  hwloc_topology_t topology = context->topology;
+  struct hwloc_info_query_selector sel;
+  struct hwloc_info_query_bucket *bucket = NULL;
+  unsigned long nr_candidates = 0;
+  unsigned i, j, nr = 0;
+
+  if (hwloc_info_query_parse_selector(context, &sel, string) < 0) {
+    fprintf(stderr, "invalid query selector %s\n", string);
+    return -1;
+  }
+
+  for(i=0; i<sel.nr_depths; i++)
+    nr_candidates += hwloc_get_nbobjs_by_depth(topology, sel.depths[i]);
+
+  /* use the smallest index bucket if any, objects of a bucket are in level order too */
+  if (sel.subtype || sel.nr_preds) {
+    if (hwloc_info_query_build_indexes(context) < 0) {
+      fprintf(stderr, "Failed to build query indexes\n");
+      hwloc_info_query_selector_free(&sel);
+      return -1;
+    }
+    if (sel.subtype) {
+      bucket = hwloc_info_query_index_find(&context->subtypes, sel.subtype, 0);
+      if (!bucket)
+	nr_candidates = 0;
+      else if (bucket->nr < nr_candidates)
+	nr_candidates = bucket->nr;
+    }
+    for(i=0; i<sel.nr_preds && nr_candidates; i++) {
+      struct hwloc_info_query_bucket *infobucket;
+      if (sel.preds[i].attr != HWLOC_INFO_QUERY_ATTR_INFO
+	  || (sel.preds[i].op != HWLOC_INFO_QUERY_OP_EXISTS && sel.preds[i].op != HWLOC_INFO_QUERY_OP_EQ))
+	continue;
+      infobucket = hwloc_info_query_index_find(&context->infos, sel.preds[i].name, 0);
+      if (!infobucket) {
+	nr_candidates = 0;
+      } else if (infobucket->nr < nr_candidates) {
+	nr_candidates = infobucket->nr;
+	bucket = infobucket;
+      }
+    }
+  }
+
+  if (verbose <= 0) {
+    if (show_index_prefix)
+      printf("%u: ", current_obj);
+    if (verbose == 0)
+      printf("%s =", sel.string);
+  }
+
+  if (!nr_candidates) {
+    /* nothing */
+  } else if (bucket) {
+    for(j=0; j<bucket->nr; j++)
+      if (hwloc_info_query_match(&sel, bucket->objs[j], 1))
+	hwloc_info_query_show(topology, &sel, bucket->objs[j], &nr, verbose);
+  } else {
+    for(i=0; i<sel.nr_depths; i++) {
+      unsigned n = hwloc_get_nbobjs_by_depth(topology, sel.depths[i]);
+      for(j=0; j<n; j++) {
+	hwloc_obj_t obj = hwloc_get_obj_by_depth(topology, sel.depths[i], j);
+	if (hwloc_info_query_match(&sel, obj, 0))
+	  hwloc_info_query_show(topology, &sel, obj, &nr, verbose);
+      }
+    }
+  }
+
+  if (verbose <= 0)
+    printf("\n");
+
+  hwloc_info_query_selector_free(&sel);
+  current_obj++;
+  return 0;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -471,7 +1173,7 @@ main (int argc, char *argv[])
   char *restrictstring = NULL;
   size_t typelen;
   int opt;
-  enum hwloc_info_mode { HWLOC_INFO_MODE_UNKNOWN, HWLOC_INFO_MODE_TOPOLOGY, HWLOC_INFO_MODE_OBJECTS, HWLOC_INFO_MODE_SUPPORT } mode = HWLOC_INFO_MODE_UNKNOWN;
+  enum hwloc_info_mode { HWLOC_INFO_MODE_UNKNOWN, HWLOC_INFO_MODE_TOPOLOGY, HWLOC_INFO_MODE_OBJECTS, HWLOC_INFO_MODE_SUPPORT, HWLOC_INFO_MODE_QUERY } mode = HWLOC_INFO_MODE_UNKNOWN;
 
   callname = strrchr(argv[0], '/');
   if (!callname)
@@ -499,13 +1201,19 @@ main (int argc, char *argv[])
 
   while (argc >= 1) {
     opt = 0;
-    if (*argv[0] == '-') {
+    if (*argv[0] == '-' && strcmp(argv[0], "-")) {
       if (!strcmp (argv[0], "--objects"))
 	mode = HWLOC_INFO_MODE_OBJECTS;
       else if (!strcmp (argv[0], "--topology"))
 	mode = HWLOC_INFO_MODE_TOPOLOGY;
       else if (!strcmp (argv[0], "--support"))
 	mode = HWLOC_INFO_MODE_SUPPORT;
+      else if (!strcmp (argv[0], "--query"))
+	mode = HWLOC_INFO_MODE_QUERY;
+      else if (!strcmp (argv[0], "--json")) {
+	mode = HWLOC_INFO_MODE_TOPOLOGY;
+	show_json = 1;
+      }
       else if (!strcmp (argv[0], "-v") || !strcmp (argv[0], "--verbose"))
         verbose_mode++;
       else if (!strcmp (argv[0], "-s") || !strcmp (argv[0], "--silent"))
@@ -772,7 +1480,14 @@ main (int argc, char *argv[])
   }
 
   if (mode == HWLOC_INFO_MODE_TOPOLOGY) {
-    hwloc_lstopo_show_summary(stdout, topology);
+    if (show_json) {
+      if (hwloc_topology_export_json(topology, "-", 0) < 0) {
+        fprintf(stderr, "Failed to export topology to JSON (%s)\n", strerror(errno));
+        return EXIT_FAILURE;
+      }
+    } else {
+      hwloc_lstopo_show_summary(stdout, topology);
+    }
 
   } else if (mode == HWLOC_INFO_MODE_SUPPORT) {
     const struct hwloc_topology_support *support = hwloc_topology_get_support(topology);
@@ -847,6 +1562,42 @@ main (int argc, char *argv[])
       argc--; argv++;
     }
 
+  } else if (mode == HWLOC_INFO_MODE_QUERY) {
+    struct hwloc_info_query_context context;
+    int failed = 0;
+
+    if (!argc) {
+      usage(callname, stderr);
+      return EXIT_FAILURE;
+    }
+    hwloc_info_query_context_init(&context, topology);
+    if (!context.all_depths) {
+      fprintf(stderr, "Failed to allocate query context\n");
+      return EXIT_FAILURE;
+    }
+    current_obj = 0;
+    while (argc >= 1) {
+      if (!strcmp(argv[0], "-")) {
+	char line[1024];
+	while (fgets(line, sizeof(line), stdin)) {
+	  size_t len = strcspn(line, "\r\n");
+	  line[len] = '\0';
+	  if (!len || line[0] == '#')
+	    continue;
+	  if (hwloc_info_query_run(&context, line, verbose_mode) < 0)
+	    failed = 1;
+	}
+      } else if (hwloc_info_query_run(&context, argv[0], verbose_mode) < 0) {
+	failed = 1;
+      }
+      argc--; argv++;
+    }
+    hwloc_info_query_context_destroy(&context);
+    if (failed) {
+      hwloc_topology_destroy(topology);
+      return EXIT_FAILURE;
+    }
+
   } else assert(0);
 
   hwloc_topology_destroy (topology);
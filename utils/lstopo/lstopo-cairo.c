@@ -22,6 +22,10 @@
 #include <cairo-svg.h>
 #endif /* CAIRO_HAS_SVG_SURFACE */
 
+#if (defined CAIRO_HAS_PNG_FUNCTIONS) && (defined HWLOC_HAVE_LIBPNG)
+#include <png.h>
+#endif /* CAIRO_HAS_PNG_FUNCTIONS && HWLOC_HAVE_LIBPNG */
+
 #ifdef LSTOPO_HAVE_X11
 /* configure should enable X11 only if Cairo has XLIB SURFACE and there are X11 headers */
 # ifndef HWLOC_HAVE_X11_KEYSYM
@@ -36,6 +40,8 @@
 # include <X11/Xresource.h>
 # include <X11/keysym.h>
 # include <X11/cursorfont.h>
+# include <sys/time.h>
+# include <sys/select.h>
 /* Avoid Xwindow's definition conflict with Windows' use for fields names.  */
 # undef Status
 #else /* LSTOPO_HAVE_X11 */
@@ -57,8 +63,22 @@ struct lstopo_cairo_output {
   struct lstopo_output *loutput;
   cairo_surface_t *surface;
   cairo_t *context;
+  /* region of the drawing covered by the surface when drawing tile by tile,
+   * tile_width is 0 when the surface covers the whole drawing.
+   */
+  unsigned tile_x, tile_y, tile_width, tile_height;
 };
 
+/* Return 1 if the given area doesn't intersect the current tile (with a margin for strokes) */
+static int
+topo_cairo_outside_tile(struct lstopo_cairo_output *coutput, unsigned x, unsigned width, unsigned y, unsigned height)
+{
+  if (!coutput->tile_width)
+    return 0;
+  return x > coutput->tile_x + coutput->tile_width || x + width + 1 < coutput->tile_x
+    || y > coutput->tile_y + coutput->tile_height || y + height + 1 < coutput->tile_y;
+}
+
 /* Cairo methods */
 static void
 topo_cairo_box(struct lstopo_output *loutput, const struct lstopo_color *lcolor, unsigned depth __hwloc_attribute_unused, unsigned x, unsigned width, unsigned y, unsigned height, hwloc_obj_t obj __hwloc_attribute_unused, unsigned box_id __hwloc_attribute_unused)
@@ -67,6 +87,9 @@ topo_cairo_box(struct lstopo_output *loutput, const struct lstopo_color *lcolor,
   cairo_t *c = coutput->context;
   int r = lcolor->r, g = lcolor->g, b = lcolor->b;
 
+  if (topo_cairo_outside_tile(coutput, x, width, y, height))
+    return;
+
   cairo_rectangle(c, x, y, width, height);
   cairo_set_source_rgb(c, (float)r / 255, (float) g / 255, (float) b / 255);
   cairo_fill(c);
@@ -84,6 +107,11 @@ topo_cairo_line(struct lstopo_output *loutput, const struct lstopo_color *lcolor
   cairo_t *c = coutput->context;
   int r = lcolor->r, g = lcolor->g, b = lcolor->b;
 
+  if (topo_cairo_outside_tile(coutput,
+			      x1 < x2 ? x1 : x2, x1 < x2 ? x2-x1 : x1-x2,
+			      y1 < y2 ? y1 : y2, y1 < y2 ? y2-y1 : y1-y2))
+    return;
+
   cairo_move_to(c, x1, y1);
   cairo_set_source_rgb(c, (float) r / 255, (float) g / 255, (float) b / 255);
   cairo_set_line_width(c, 1);
@@ -98,6 +126,10 @@ topo_cairo_text(struct lstopo_output *loutput, const struct lstopo_color *lcolor
   cairo_t *c = coutput->context;
   int r = lcolor->r, g = lcolor->g, b = lcolor->b;
 
+  /* the text width isn't known without measuring, only skip lines that are above or below the tile */
+  if (topo_cairo_outside_tile(coutput, 0, loutput->width, y, 2*fontsize))
+    return;
+
   cairo_move_to(c, x, y + fontsize);
   cairo_set_source_rgb(c, (float)r / 255, (float) g / 255, (float) b / 255);
   cairo_show_text(c, text);
@@ -130,6 +162,8 @@ topo_cairo_paint(struct lstopo_cairo_output *coutput)
   cairo_surface_t *cs = coutput->surface;
   cairo_t *c = cairo_create(cs);
   coutput->context = c;
+  if (coutput->tile_width)
+    cairo_translate(c, -(double) coutput->tile_x, -(double) coutput->tile_y);
   cairo_set_font_size(c, fontsize);
   output_draw(coutput->loutput);
   cairo_show_page(c);
@@ -184,6 +218,38 @@ x11_destroy(struct lstopo_x11_output *disp)
   XDestroyWindow(disp->dpy, disp->win);
 }
 
+/* wait for the next X event until the next utilization sample is due.
+ * returns 0 if the sample is due first, and schedule the next one.
+ */
+static int
+x11_wait_event(struct lstopo_x11_output *disp, struct timeval *next_sample)
+{
+  struct lstopo_output *loutput = disp->coutput.loutput;
+  int fd = ConnectionNumber(disp->dpy);
+  struct timeval now, timeout;
+  fd_set fds;
+
+  XFlush(disp->dpy);
+
+  gettimeofday(&now, NULL);
+  if (timercmp(&now, next_sample, <)) {
+    timersub(next_sample, &now, &timeout);
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    if (select(fd+1, &fds, NULL, NULL, &timeout) > 0)
+      return 1;
+    gettimeofday(&now, NULL);
+  }
+
+  next_sample->tv_sec = now.tv_sec + loutput->utilization_interval / 1000;
+  next_sample->tv_usec = now.tv_usec + (loutput->utilization_interval % 1000) * 1000;
+  if (next_sample->tv_usec >= 1000000) {
+    next_sample->tv_sec++;
+    next_sample->tv_usec -= 1000000;
+  }
+  return 0;
+}
+
 /** Clip coordinates of the visible part. */
 static void
 move_x11(struct lstopo_x11_output *disp)
@@ -277,6 +343,7 @@ output_x11(struct lstopo_output *loutput, const char *dummy __hwloc_attribute_un
   int state = 0;
   int x = 0, y = 0; /* shut warning down */
   int lastx, lasty;
+  struct timeval next_sample = { 0, 0 };
   char *resources;
 
   coutput = &disp->coutput;
@@ -386,6 +453,12 @@ output_x11(struct lstopo_output *loutput, const char *dummy __hwloc_attribute_un
 	lastx = disp->x;
 	lasty = disp->y;
       }
+      if (loutput->show_utilization && !x11_wait_event(disp, &next_sample)) {
+	/* no event before the next sample, only colors change, no need to prepare again */
+	lstopo_update_utilization(loutput);
+	topo_cairo_paint(coutput);
+	continue;
+      }
     }
     XNextEvent(disp->dpy, &e);
     switch (e.type) {
@@ -639,12 +712,119 @@ static struct draw_methods png_draw_methods = {
   topo_cairo_textsize,
 };
 
+#ifdef HWLOC_HAVE_LIBPNG
+/* Draw the image in horizontal bands that fit in loutput->tile_memory
+ * and stream their rows to libpng so that the whole image is never allocated.
+ */
+static int
+output_png_tiled(struct lstopo_cairo_output *coutput, FILE *output)
+{
+  struct lstopo_output *loutput = coutput->loutput;
+  unsigned width = loutput->width, height = loutput->height;
+  unsigned band_height, y;
+  png_structp png;
+  png_infop info;
+  png_bytep row;
+  cairo_surface_t *cs;
+  int stride;
+
+  stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+  band_height = loutput->tile_memory / stride;
+  if (!band_height)
+    band_height = 1;
+  if (band_height > height)
+    band_height = height;
+
+  cs = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, band_height);
+  if (cairo_surface_status(cs) != CAIRO_STATUS_SUCCESS) {
+    fprintf(stderr, "Failed to create a %ux%u PNG band surface\n", width, band_height);
+    cairo_surface_destroy(cs);
+    return -1;
+  }
+  row = malloc(4 * width);
+  if (!row) {
+    cairo_surface_destroy(cs);
+    return -1;
+  }
+  png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  info = png ? png_create_info_struct(png) : NULL;
+  if (!info) {
+    png_destroy_write_struct(&png, NULL);
+    free(row);
+    cairo_surface_destroy(cs);
+    return -1;
+  }
+  if (setjmp(png_jmpbuf(png))) {
+    fprintf(stderr, "Failed to write PNG\n");
+    png_destroy_write_struct(&png, &info);
+    free(row);
+    cairo_surface_destroy(cs);
+    return -1;
+  }
+
+  png_init_io(png, output);
+  png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+	       PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+
+  coutput->surface = cs;
+  coutput->tile_x = 0;
+  coutput->tile_width = width;
+  for(y = 0; y < height; y += band_height) {
+    unsigned rows = height - y < band_height ? height - y : band_height;
+    unsigned char *data;
+    unsigned i, j;
+    cairo_t *c;
+
+    /* clear the previous band */
+    c = cairo_create(cs);
+    cairo_set_operator(c, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(c);
+    cairo_destroy(c);
+
+    coutput->tile_y = y;
+    coutput->tile_height = rows;
+    topo_cairo_paint(coutput);
+    cairo_surface_flush(cs);
+
+    /* convert premultiplied native-endian ARGB into RGBA bytes like cairo_surface_write_to_png() */
+    data = cairo_image_surface_get_data(cs);
+    for(i = 0; i < rows; i++) {
+      uint32_t *pixels = (uint32_t *) (data + i * stride);
+      for(j = 0; j < width; j++) {
+	uint32_t pixel = pixels[j];
+	unsigned a = pixel >> 24;
+	png_bytep out = &row[4*j];
+	if (!a) {
+	  out[0] = out[1] = out[2] = out[3] = 0;
+	} else {
+	  out[0] = (((pixel >> 16) & 0xff) * 255 + a/2) / a;
+	  out[1] = (((pixel >> 8) & 0xff) * 255 + a/2) / a;
+	  out[2] = ((pixel & 0xff) * 255 + a/2) / a;
+	  out[3] = a;
+	}
+      }
+      png_write_row(png, row);
+    }
+  }
+  coutput->tile_width = coutput->tile_height = 0;
+
+  png_write_end(png, info);
+  png_destroy_write_struct(&png, &info);
+  free(row);
+  cairo_surface_destroy(cs);
+  return 0;
+}
+#endif /* HWLOC_HAVE_LIBPNG */
+
 int
 output_png(struct lstopo_output *loutput, const char *filename)
 {
   struct lstopo_cairo_output coutput;
   FILE *output;
   cairo_surface_t *fakecs, *cs;
+  int tiled = 0;
+  int err = 0;
 
   output = open_output(filename, loutput->overwrite);
   if (!output) {
@@ -668,23 +848,35 @@ output_png(struct lstopo_output *loutput, const char *filename)
   loutput->drawing = LSTOPO_DRAWING_DRAW;
   cairo_surface_destroy(fakecs);
 
-  /* create the actual surface with the right size */
-  cs = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, loutput->width, loutput->height);
-  coutput.surface = cs;
-
   /* ready */
   declare_colors(loutput);
   lstopo_prepare_custom_styles(loutput);
 
-  topo_cairo_paint(&coutput);
-  cairo_surface_write_to_png_stream(coutput.surface, topo_cairo_write, output);
-  cairo_surface_destroy(coutput.surface);
+  if (loutput->tile_memory
+      && (unsigned long long) cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, loutput->width) * loutput->height > loutput->tile_memory) {
+#ifdef HWLOC_HAVE_LIBPNG
+    err = output_png_tiled(&coutput, output);
+    tiled = 1;
+#else
+    fprintf(stderr, "PNG drawing needs more than --tile-memory but lstopo was built without libpng, drawing it at once.\n");
+#endif
+  }
+
+  if (!tiled) {
+    /* create the actual surface with the right size */
+    cs = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, loutput->width, loutput->height);
+    coutput.surface = cs;
+
+    topo_cairo_paint(&coutput);
+    cairo_surface_write_to_png_stream(coutput.surface, topo_cairo_write, output);
+    cairo_surface_destroy(coutput.surface);
+  }
 
   if (output != stdout)
     fclose(output);
 
   destroy_colors();
-  return 0;
+  return err;
 }
 #endif /* CAIRO_HAS_PNG_FUNCTIONS */
 
@@ -692,6 +884,9 @@ output_png(struct lstopo_output *loutput, const char *filename)
 #ifdef CAIRO_HAS_PDF_SURFACE
 /* PDF back-end */
 
+/* most PDF viewers don't support pages larger than 200 inches */
+#define LSTOPO_PDF_MAX_PAGE_SIZE 14400
+
 static struct draw_methods pdf_draw_methods = {
   NULL,
   topo_cairo_box,
@@ -706,6 +901,7 @@ output_pdf(struct lstopo_output *loutput, const char *filename)
   struct lstopo_cairo_output coutput;
   FILE *output;
   cairo_surface_t *fakecs, *cs;
+  unsigned pages_x, pages_y, page_width, page_height;
 
   output = open_output(filename, loutput->overwrite);
   if (!output) {
@@ -729,15 +925,40 @@ output_pdf(struct lstopo_output *loutput, const char *filename)
   loutput->drawing = LSTOPO_DRAWING_DRAW;
   cairo_surface_destroy(fakecs);
 
+  /* viewers don't support pages larger than LSTOPO_PDF_MAX_PAGE_SIZE, split huge drawings into pages */
+  pages_x = (loutput->width + LSTOPO_PDF_MAX_PAGE_SIZE - 1) / LSTOPO_PDF_MAX_PAGE_SIZE;
+  pages_y = (loutput->height + LSTOPO_PDF_MAX_PAGE_SIZE - 1) / LSTOPO_PDF_MAX_PAGE_SIZE;
+  if (!pages_x)
+    pages_x = 1;
+  if (!pages_y)
+    pages_y = 1;
+  page_width = (loutput->width + pages_x - 1) / pages_x;
+  page_height = (loutput->height + pages_y - 1) / pages_y;
+
   /* create the actual surface with the right size */
-  cs = cairo_pdf_surface_create_for_stream(topo_cairo_write, loutput->file, loutput->width, loutput->height);
+  cs = cairo_pdf_surface_create_for_stream(topo_cairo_write, loutput->file, page_width, page_height);
   coutput.surface = cs;
 
   /* ready */
   declare_colors(loutput);
   lstopo_prepare_custom_styles(loutput);
 
-  topo_cairo_paint(&coutput);
+  if (pages_x > 1 || pages_y > 1) {
+    unsigned i, j;
+    /* each page is written to the stream once drawn */
+    for(j=0; j<pages_y; j++)
+      for(i=0; i<pages_x; i++) {
+	coutput.tile_x = i * page_width;
+	coutput.tile_y = j * page_height;
+	coutput.tile_width = loutput->width - coutput.tile_x < page_width ? loutput->width - coutput.tile_x : page_width;
+	coutput.tile_height = loutput->height - coutput.tile_y < page_height ? loutput->height - coutput.tile_y : page_height;
+	cairo_pdf_surface_set_size(cs, coutput.tile_width, coutput.tile_height);
+	topo_cairo_paint(&coutput);
+      }
+    coutput.tile_width = coutput.tile_height = 0;
+  } else {
+    topo_cairo_paint(&coutput);
+  }
   cairo_surface_flush(coutput.surface);
   cairo_surface_destroy(coutput.surface);
 
@@ -56,6 +56,10 @@ struct lstopo_color BRIDGE_COLOR = { 0xff, 0xff, 0xff, 0 };
 
 static struct lstopo_color *colors = NULL;
 
+/* utilization overlay colors, from white (idle) to red (busy) */
+#define LSTOPO_UTILIZATION_LEVELS 10
+static struct lstopo_color *utilization_colors[LSTOPO_UTILIZATION_LEVELS+1];
+
 static struct lstopo_color *
 declare_color(struct lstopo_output *loutput, struct lstopo_color *color)
 {
@@ -139,22 +143,210 @@ find_or_declare_rgb_color(struct lstopo_output *loutput, int r, int g, int b)
   return tmp;
 }
 
+/*****************************************
+ * Memoized text widths and layout
+ */
+
+/* everything that may change the size and placement of objects.
+ * the layout computed during the last prepare pass remains valid
+ * as long as none of these changed.
+ */
+struct lstopo_layout_key {
+  hwloc_topology_t topology;
+  struct draw_methods *methods;
+  unsigned gridsize, fontsize, linespacing;
+  float text_xscale;
+  unsigned no_half_lines;
+  unsigned plain_children_order;
+  enum lstopo_index_type_e index_type;
+  int ignore_pus, ignore_numanodes;
+  int pci_collapse_enabled, factorize_enabled;
+  unsigned factorize_min[HWLOC_OBJ_TYPE_MAX];
+  int show_text_enabled, show_attrs_enabled;
+  int show_indexes[HWLOC_OBJ_TYPE_MAX];
+  int show_text[HWLOC_OBJ_TYPE_MAX];
+  int show_attrs[HWLOC_OBJ_TYPE_MAX];
+  enum lstopo_orient_e force_orient[HWLOC_OBJ_TYPE_MAX];
+};
+
+struct lstopo_textwidth_entry {
+  char *text; /* NULL if unused */
+  unsigned length;
+  unsigned fontsize;
+  unsigned width; /* before text_xscale */
+};
+
+struct lstopo_draw_cache {
+  /* open-addressing hash table of text widths */
+  struct lstopo_textwidth_entry *textwidths;
+  unsigned textwidths_size; /* power of 2 */
+  unsigned textwidths_used;
+  struct draw_methods *textwidths_methods; /* widths depend on the backend */
+
+  int layout_valid;
+  struct lstopo_layout_key layout_key;
+};
+
+#define LSTOPO_TEXTWIDTH_CACHE_INITIAL_SIZE 256
+
+static struct lstopo_draw_cache *
+get_draw_cache(struct lstopo_output *loutput)
+{
+  if (!loutput->draw_cache)
+    loutput->draw_cache = calloc(1, sizeof(*loutput->draw_cache));
+  return loutput->draw_cache; /* may be NULL, caching is then disabled */
+}
+
+static void
+textwidth_cache_flush(struct lstopo_draw_cache *cache)
+{
+  unsigned i;
+  for(i=0; i<cache->textwidths_size; i++)
+    free(cache->textwidths[i].text);
+  free(cache->textwidths);
+  cache->textwidths = NULL;
+  cache->textwidths_size = 0;
+  cache->textwidths_used = 0;
+}
+
+static unsigned
+textwidth_hash(const char *text, unsigned length, unsigned fontsize)
+{
+  /* FNV-1a */
+  unsigned hash = 2166136261U ^ fontsize;
+  unsigned i;
+  for(i=0; i<length; i++) {
+    hash ^= (unsigned char) text[i];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static struct lstopo_textwidth_entry *
+textwidth_cache_lookup(struct lstopo_textwidth_entry *entries, unsigned size,
+		       const char *text, unsigned length, unsigned fontsize)
+{
+  unsigned i = textwidth_hash(text, length, fontsize) & (size-1);
+  while (entries[i].text) {
+    if (entries[i].length == length && entries[i].fontsize == fontsize
+	&& !memcmp(entries[i].text, text, length))
+      break;
+    i = (i+1) & (size-1);
+  }
+  return &entries[i];
+}
+
+static int
+textwidth_cache_grow(struct lstopo_draw_cache *cache)
+{
+  unsigned newsize = cache->textwidths_size ? 2*cache->textwidths_size : LSTOPO_TEXTWIDTH_CACHE_INITIAL_SIZE;
+  struct lstopo_textwidth_entry *newentries;
+  unsigned i;
+
+  newentries = calloc(newsize, sizeof(*newentries));
+  if (!newentries)
+    return -1;
+  for(i=0; i<cache->textwidths_size; i++) {
+    struct lstopo_textwidth_entry *old = &cache->textwidths[i];
+    if (old->text)
+      *textwidth_cache_lookup(newentries, newsize, old->text, old->length, old->fontsize) = *old;
+  }
+  free(cache->textwidths);
+  cache->textwidths = newentries;
+  cache->textwidths_size = newsize;
+  return 0;
+}
+
+/* many objects have the same text (caches, factorized boxes, collapsed PCI, legend, etc),
+ * and the backend textsize() callback may be expensive (cairo, windows),
+ * hence remember widths across objects and prepare passes.
+ */
 static unsigned
 get_textwidth(void *output,
 	      const char *text, unsigned length,
 	      unsigned fontsize)
 {
   struct lstopo_output *loutput = output;
+  struct lstopo_draw_cache *cache = get_draw_cache(loutput);
+  struct lstopo_textwidth_entry *entry = NULL;
   unsigned width;
 
 #ifdef HWLOC_DEBUG
   assert(loutput->methods->textsize);
 #endif
+
+  if (cache) {
+    if (cache->textwidths_methods != loutput->methods) {
+      textwidth_cache_flush(cache);
+      cache->textwidths_methods = loutput->methods;
+    }
+    if (2*(cache->textwidths_used+1) > cache->textwidths_size)
+      textwidth_cache_grow(cache);
+    if (cache->textwidths_size) {
+      entry = textwidth_cache_lookup(cache->textwidths, cache->textwidths_size, text, length, fontsize);
+      if (entry->text) {
+	width = entry->width;
+	goto out;
+      }
+    }
+  }
+
   loutput->methods->textsize(output, text, length, fontsize, &width);
+
+  if (entry && 2*(cache->textwidths_used+1) <= cache->textwidths_size) {
+    entry->text = malloc(length+1);
+    if (entry->text) {
+      memcpy(entry->text, text, length);
+      entry->text[length] = '\0';
+      entry->length = length;
+      entry->fontsize = fontsize;
+      entry->width = width;
+      cache->textwidths_used++;
+    }
+  }
+
+ out:
   width = loutput->text_xscale * ((float)width);
   return width;
 }
 
+static void
+get_layout_key(struct lstopo_output *loutput, struct lstopo_layout_key *key)
+{
+  memset(key, 0, sizeof(*key)); /* clear padding for memcmp() */
+  key->topology = loutput->topology;
+  key->methods = loutput->methods;
+  key->gridsize = loutput->gridsize;
+  key->fontsize = loutput->fontsize;
+  key->linespacing = loutput->linespacing;
+  key->text_xscale = loutput->text_xscale;
+  key->no_half_lines = loutput->no_half_lines;
+  key->plain_children_order = loutput->plain_children_order;
+  key->index_type = loutput->index_type;
+  key->ignore_pus = loutput->ignore_pus;
+  key->ignore_numanodes = loutput->ignore_numanodes;
+  key->pci_collapse_enabled = loutput->pci_collapse_enabled;
+  key->factorize_enabled = loutput->factorize_enabled;
+  key->show_text_enabled = loutput->show_text_enabled;
+  key->show_attrs_enabled = loutput->show_attrs_enabled;
+  memcpy(key->factorize_min, loutput->factorize_min, sizeof(key->factorize_min));
+  memcpy(key->show_indexes, loutput->show_indexes, sizeof(key->show_indexes));
+  memcpy(key->show_text, loutput->show_text, sizeof(key->show_text));
+  memcpy(key->show_attrs, loutput->show_attrs, sizeof(key->show_attrs));
+  memcpy(key->force_orient, loutput->force_orient, sizeof(key->force_orient));
+}
+
+void
+output_draw_clear_cache(struct lstopo_output *loutput)
+{
+  struct lstopo_draw_cache *cache = loutput->draw_cache;
+  if (!cache)
+    return;
+  textwidth_cache_flush(cache);
+  free(cache);
+  loutput->draw_cache = NULL;
+}
+
 /*
  * foo_draw functions take a OBJ, computes which size it needs, recurse into
  * sublevels with drawing=PREPARE to recursively compute the needed size
@@ -715,10 +907,9 @@ lstopo_obj_snprintf(struct lstopo_output *loutput, char *text, size_t textlen, h
   enum lstopo_index_type_e index_type = loutput->index_type;
   unsigned idx;
   const char *indexprefix;
-  char typestr[32];
+  const char *typestr, *attrstr;
   char indexstr[32]= "";
   char index2str[32] = "";
-  char attrstr[256];
   char totmemstr[64] = "";
   int attrlen;
 
@@ -729,19 +920,23 @@ lstopo_obj_snprintf(struct lstopo_output *loutput, char *text, size_t textlen, h
   /* For OSDev, OSDev-type+name replaces type+index+attrs */
   if (obj->type == HWLOC_OBJ_OS_DEVICE) {
     /* consider the name as an index and remove it if LSTOPO_INDEX_TYPE_NONE */
+    typestr = hwloc_obj_get_type_string(loutput->topology, obj, 0);
+    if (!typestr)
+      typestr = "";
     if (index_type != LSTOPO_INDEX_TYPE_NONE) {
-      hwloc_obj_type_snprintf(typestr, sizeof(typestr), obj, 0);
       return snprintf(text, textlen, "%s %s", typestr, obj->name);
     } else {
-      return hwloc_obj_type_snprintf(text, textlen, obj, 0);
+      return snprintf(text, textlen, "%s", typestr);
     }
   }
 
   /* subtype replaces the basic type name */
   if (obj->subtype) {
-    snprintf(typestr, sizeof(typestr), "%s", obj->subtype);
+    typestr = obj->subtype;
   } else {
-    hwloc_obj_type_snprintf(typestr, sizeof(typestr), obj, 0);
+    typestr = hwloc_obj_get_type_string(loutput->topology, obj, 0);
+    if (!typestr)
+      typestr = "";
   }
 
   if (index_type == LSTOPO_INDEX_TYPE_DEFAULT) {
@@ -782,7 +977,8 @@ lstopo_obj_snprintf(struct lstopo_output *loutput, char *text, size_t textlen, h
     snprintf(index2str, sizeof(index2str), " P#%u", obj->os_index);
 
   if (loutput->show_attrs_enabled && loutput->show_attrs[obj->type]) {
-    attrlen = hwloc_obj_attr_snprintf(attrstr, sizeof(attrstr), obj, " ", 0);
+    attrstr = hwloc_obj_get_attr_string(loutput->topology, obj, " ", 0);
+    attrlen = attrstr ? (int) strlen(attrstr) : 0;
     /* display the root total_memory (cannot be local_memory since root cannot be a NUMA node) */
     if (!obj->parent && obj->total_memory)
       snprintf(totmemstr, sizeof(totmemstr), " (%lu%s total)",
@@ -856,7 +1052,15 @@ lstopo__prepare_custom_styles(struct lstopo_output *loutput, hwloc_obj_t obj)
 void
 lstopo_prepare_custom_styles(struct lstopo_output *loutput)
 {
+  unsigned i;
+
   lstopo__prepare_custom_styles(loutput, hwloc_get_root_obj(loutput->topology));
+
+  /* declare utilization colors now since some backends need all colors before drawing */
+  for(i=0; i<=LSTOPO_UTILIZATION_LEVELS; i++) {
+    int gb = 0xff - (0xff * i) / LSTOPO_UTILIZATION_LEVELS;
+    utilization_colors[i] = loutput->show_utilization || loutput->show_heatmap ? find_or_declare_rgb_color(loutput, 0xff, gb, gb) : NULL;
+  }
 }
 
 static void
@@ -954,6 +1158,24 @@ lstopo_set_object_color(struct lstopo_output *loutput,
     assert(0);
   }
 
+  /* utilization overlay, except if the PU is already colored for disallowed or binding */
+  if (loutput->show_utilization && lud->utilization >= 0.f
+      && (obj->type == HWLOC_OBJ_PU || obj->type == HWLOC_OBJ_CORE || hwloc_obj_type_is_cache(obj->type))
+      && s->bg != &DISALLOWED_COLOR && s->bg != &BINDING_COLOR) {
+    struct lstopo_color *ucolor = utilization_colors[(unsigned) (lud->utilization * LSTOPO_UTILIZATION_LEVELS + .5f)];
+    if (ucolor)
+      s->bg = ucolor;
+  }
+
+  /* process heatmap, replaces binding colors since the process is usually bound where it runs */
+  if (loutput->show_heatmap && lud->heat >= 0.f
+      && (obj->type == HWLOC_OBJ_PU || obj->type == HWLOC_OBJ_CORE || obj->type == HWLOC_OBJ_NUMANODE || hwloc_obj_type_is_cache(obj->type))
+      && s->bg != &DISALLOWED_COLOR) {
+    struct lstopo_color *hcolor = utilization_colors[(unsigned) (lud->heat * LSTOPO_UTILIZATION_LEVELS + .5f)];
+    if (hcolor)
+      s->bg = hcolor;
+  }
+
   if (lud->style_set & LSTOPO_STYLE_BG)
     s->bg = lud->style.bg;
   if (lud->style_set & LSTOPO_STYLE_T)
@@ -1002,6 +1224,13 @@ prepare_text(struct lstopo_output *loutput, hwloc_obj_t obj)
     snprintf(lud->text[lud->ntext++].text, sizeof(lud->text[0].text), "P#%u", obj->os_index);
   }
 
+  if (HWLOC_OBJ_NUMANODE == obj->type && loutput->show_heatmap && lud->heat_memory) {
+    /* memory of the --pid process on second line */
+    snprintf(lud->text[lud->ntext++].text, sizeof(lud->text[0].text), "Process: %lu%s",
+	     (unsigned long) hwloc_memory_size_printf_value(lud->heat_memory, 0),
+	     hwloc_memory_size_printf_unit(lud->heat_memory, 0));
+  }
+
   if (loutput->show_attrs_enabled && loutput->show_attrs[obj->type]) {
     if (HWLOC_OBJ_OS_DEVICE == obj->type) {
       if (HWLOC_OBJ_OSDEV_COPROC == obj->attr->osdev.type && obj->subtype) {
@@ -1407,7 +1636,7 @@ output_draw(struct lstopo_output *loutput)
   unsigned depth = 100;
   unsigned totwidth, totheight, offset, i, j;
   time_t t;
-  char text[3][128];
+  char text[5][128];
   unsigned ntext = 0;
   char hostname[122] = "";
   const char *forcedhostname = NULL;
@@ -1469,6 +1698,28 @@ output_draw(struct lstopo_output *loutput)
     if (textwidth > maxtextwidth)
       maxtextwidth = textwidth;
     ntext++;
+
+    /* Explain utilization colors */
+    if (loutput->show_utilization) {
+      snprintf(text[ntext], sizeof(text[ntext]), "Utilization: white=idle red=busy (sampled every %u ms)", loutput->utilization_interval);
+      textwidth = get_textwidth(loutput, text[ntext], (unsigned) strlen(text[ntext]), fontsize);
+      if (textwidth > maxtextwidth)
+	maxtextwidth = textwidth;
+      ntext++;
+    }
+
+    /* Explain heatmap colors */
+    if (loutput->show_heatmap) {
+      snprintf(text[ntext], sizeof(text[ntext]), "Process %d: %u threads, %lu%s resident (white=none red=most)",
+	       loutput->pid_number,
+	       loutput->heatmap_threads,
+	       (unsigned long) hwloc_memory_size_printf_value(loutput->heatmap_memory, 0),
+	       hwloc_memory_size_printf_unit(loutput->heatmap_memory, 0));
+      textwidth = get_textwidth(loutput, text[ntext], (unsigned) strlen(text[ntext]), fontsize);
+      if (textwidth > maxtextwidth)
+	maxtextwidth = textwidth;
+      ntext++;
+    }
   }
 
   if (loutput->show_legend != LSTOPO_SHOW_LEGEND_NONE) {
@@ -1490,10 +1741,23 @@ output_draw(struct lstopo_output *loutput)
 
   if (loutput->drawing == LSTOPO_DRAWING_PREPARE) {
     /* compute root size, our size, and save it */
+    struct lstopo_draw_cache *cache = get_draw_cache(loutput);
+    struct lstopo_layout_key key;
 
-    output_align_PU_textwidth(loutput);
+    /* interactive backends prepare again after each event,
+     * only place objects again if something that matters changed.
+     */
+    get_layout_key(loutput, &key);
+    if (!cache || !cache->layout_valid || memcmp(&key, &cache->layout_key, sizeof(key))) {
+      output_align_PU_textwidth(loutput);
 
-    get_type_fun(root->type)(loutput, root, depth, 0, 0);
+      get_type_fun(root->type)(loutput, root, depth, 0, 0);
+
+      if (cache) {
+	cache->layout_key = key;
+	cache->layout_valid = 1;
+      }
+    }
 
     /* loutput width is max(root, legend) */
     totwidth = rlud->width;
@@ -0,0 +1,34 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ * See COPYING in top-level directory.
+ */
+
+#include "private/autogen/config.h"
+#include "hwloc.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lstopo.h"
+
+int
+output_json(struct lstopo_output *loutput, const char *filename)
+{
+  struct stat st;
+
+  if (!filename || !strcasecmp(filename, "-.json"))
+    filename = "-";
+  /* hwloc_topology_export_json() writes to stdout if "-" is given */
+
+  if (strcmp(filename, "-") && !stat(filename, &st) && !loutput->overwrite) {
+    fprintf(stderr, "Failed to export JSON to %s (%s)\n", filename, strerror(EEXIST));
+    return -1;
+  }
+
+  if (hwloc_topology_export_json(loutput->topology, filename, 0) < 0) {
+    fprintf(stderr, "Failed to export JSON to %s (%s)\n", filename, strerror(errno));
+    return -1;
+  }
+
+  return 0;
+}
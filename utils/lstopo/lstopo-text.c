@@ -24,10 +24,9 @@
  * Console fashion text output
  */
 
-static void
-output_console_obj (struct lstopo_output *loutput, hwloc_obj_t l, int collapse)
+void
+output_console_obj (struct lstopo_output *loutput, FILE *output, hwloc_obj_t l, int collapse)
 {
-  FILE *output = loutput->file;
   enum lstopo_index_type_e index_type = loutput->index_type;
   int verbose_mode = loutput->verbose_mode;
   char pidxstr[16];
@@ -45,9 +44,11 @@ output_console_obj (struct lstopo_output *loutput, hwloc_obj_t l, int collapse)
     lstopo_busid_snprintf(loutput, busidstr, sizeof(busidstr), l, collapse, loutput->need_pci_domain);
 
   if (loutput->show_cpuset < 2) {
-    char type[64], *attr, phys[32] = "";
-    int len;
-    hwloc_obj_type_snprintf (type, sizeof(type), l, verbose_mode-1);
+    const char *type, *attr;
+    char phys[32] = "";
+    type = hwloc_obj_get_type_string(loutput->topology, l, verbose_mode-1);
+    if (!type)
+      type = "";
     if (l->subtype)
       fprintf(output, "%s(%s)", type, l->subtype);
     else
@@ -71,10 +72,9 @@ output_console_obj (struct lstopo_output *loutput, hwloc_obj_t l, int collapse)
       fprintf(output, " %s (%s)",
 	      busidstr, hwloc_pci_class_string(l->attr->pcidev.class_id));
     /* display attributes */
-    len = hwloc_obj_attr_snprintf (NULL, 0, l, " ", verbose_mode-1);
-    attr = malloc(len+1);
-    *attr = '\0';
-    hwloc_obj_attr_snprintf (attr, len+1, l, " ", verbose_mode-1);
+    attr = hwloc_obj_get_attr_string(loutput->topology, l, " ", verbose_mode-1);
+    if (!attr)
+      attr = "";
     if (*phys || *attr) {
       fprintf(output, " (");
       if (*phys)
@@ -91,7 +91,6 @@ output_console_obj (struct lstopo_output *loutput, hwloc_obj_t l, int collapse)
       }
       fprintf(output, ")");
     }
-    free(attr);
     /* display the root total_memory if not verbose (already shown)
      * (cannot be local_memory since root cannot be a NUMA node) */
     if (verbose_mode == 1 && !l->parent && l->total_memory)
@@ -131,6 +130,24 @@ output_console_obj (struct lstopo_output *loutput, hwloc_obj_t l, int collapse)
 	fprintf(output, " (binding)");
     }
   }
+
+  /* annotate with the sampled utilization */
+  if (loutput->show_utilization && hwloc_obj_type_is_normal(l->type)) {
+    struct lstopo_obj_userdata *lud = l->userdata;
+    if (lud->utilization >= 0.f)
+      fprintf(output, " (utilization %u%%)", (unsigned) (lud->utilization * 100 + .5f));
+  }
+
+  /* annotate with the process heatmap */
+  if (loutput->show_heatmap) {
+    struct lstopo_obj_userdata *lud = l->userdata;
+    if (l->type == HWLOC_OBJ_NUMANODE && lud->heat_memory)
+      fprintf(output, " (process memory %lu%s)",
+	      (unsigned long) hwloc_memory_size_printf_value(lud->heat_memory, verbose_mode >= 2),
+	      hwloc_memory_size_printf_unit(lud->heat_memory, verbose_mode >= 2));
+    else if (hwloc_obj_type_is_normal(l->type) && lud->heat_threads)
+      fprintf(output, " (%u process thread%s)", lud->heat_threads, lud->heat_threads > 1 ? "s" : "");
+  }
 }
 
 /* Recursively output topology in a console fashion */
@@ -161,7 +178,7 @@ output_topology (struct lstopo_output *loutput, hwloc_obj_t l, hwloc_obj_t paren
 
   if (collapse > 1)
     fprintf(output, "%d x { ", collapse);
-  output_console_obj(loutput, l, collapse);
+  output_console_obj(loutput, output, l, collapse);
   if (collapse > 1)
     fprintf(output, " }");
 
@@ -184,7 +201,7 @@ output_only (struct lstopo_output *loutput, hwloc_obj_t l)
   FILE *output = loutput->file;
   hwloc_obj_t child;
   if (loutput->show_only == l->type) {
-    output_console_obj (loutput, l, 0);
+    output_console_obj (loutput, output, l, 0);
     fprintf (output, "\n");
   }
   /* there can be anything below normal children */
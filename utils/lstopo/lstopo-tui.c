@@ -0,0 +1,751 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ * See COPYING in top-level directory.
+ */
+
+#include "private/autogen/config.h"
+#include "hwloc.h"
+
+#include "lstopo.h"
+
+#ifdef LSTOPO_HAVE_TUI
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+/*
+ * Interactive text UI.
+ *
+ * All objects are listed once in console order, each entry knowing where its subtree ends.
+ * Rows are the entries that aren't inside a folded subtree, folding or unfolding
+ * only recomputes the rows after the modified one.
+ * Only rows within the terminal are converted to text (and cached),
+ * and only modified lines are redrawn when the cursor moves within the screen.
+ */
+
+struct lstopo_tui_entry {
+  hwloc_obj_t obj;
+  unsigned indent;
+  unsigned end; /* index of the first entry after this subtree */
+  int collapse; /* number of identical PCI devices shown in this entry */
+  char *text; /* console description, generated when first needed */
+};
+
+struct lstopo_tui {
+  struct lstopo_output *loutput;
+
+  struct lstopo_tui_entry *entries;
+  unsigned nr_entries, allocated_entries;
+  unsigned *rows; /* indexes of visible entries, sorted */
+  unsigned nr_rows;
+
+  unsigned lines, columns; /* terminal size */
+  char *line; /* buffer for one line of the terminal */
+  unsigned first; /* first row on screen */
+  unsigned cursor; /* selected row */
+
+  /* what needs to be redrawn */
+  int redraw_all;
+  unsigned redraw_from; /* rows after this one changed, UINT_MAX if none */
+  unsigned drawn_first, drawn_cursor;
+
+  char search[64];
+  char message[128];
+};
+
+#define TUI_KEY_NONE   -1
+#define TUI_KEY_EOF    -2
+#define TUI_KEY_UP     256
+#define TUI_KEY_DOWN   257
+#define TUI_KEY_LEFT   258
+#define TUI_KEY_RIGHT  259
+#define TUI_KEY_PGUP   260
+#define TUI_KEY_PGDOWN 261
+#define TUI_KEY_HOME   262
+#define TUI_KEY_END    263
+#define TUI_KEY_CTRL(c) ((c) & 0x1f)
+
+#define TUI_HELP "Enter:fold/unfold E:unfold all /:search n/N:next/prev c:PCI collapsing q:quit"
+
+static struct termios tui_saved_termios;
+static volatile sig_atomic_t tui_resized = 0;
+static unsigned char tui_input[16];
+static unsigned tui_input_nr = 0;
+
+static void
+tui_sigwinch(int sig __hwloc_attribute_unused)
+{
+  tui_resized = 1;
+}
+
+static int
+tui_folded(struct lstopo_tui *tui, unsigned entry)
+{
+  return ((struct lstopo_obj_userdata *) tui->entries[entry].obj->userdata)->folded;
+}
+
+static void
+tui_set_folded(struct lstopo_tui *tui, unsigned entry, int folded)
+{
+  ((struct lstopo_obj_userdata *) tui->entries[entry].obj->userdata)->folded = folded;
+}
+
+static int
+tui_has_children(struct lstopo_tui *tui, unsigned entry)
+{
+  return tui->entries[entry].end > entry+1;
+}
+
+/*************************
+ * Entries and rows
+ */
+
+static int
+tui_add_entries(struct lstopo_tui *tui, hwloc_obj_t obj, unsigned indent)
+{
+  struct lstopo_output *loutput = tui->loutput;
+  struct lstopo_tui_entry *entry;
+  hwloc_obj_t child;
+  unsigned idx;
+  int collapse = loutput->pci_collapse_enabled ? ((struct lstopo_obj_userdata *) obj->userdata)->pci_collapsed : 0;
+
+  if (obj->type == HWLOC_OBJ_PCI_DEVICE && collapse == -1)
+    return 0;
+
+  if (tui->nr_entries == tui->allocated_entries) {
+    unsigned allocated = tui->allocated_entries ? 2*tui->allocated_entries : 256;
+    struct lstopo_tui_entry *tmp = realloc(tui->entries, allocated * sizeof(*tui->entries));
+    if (!tmp)
+      return -1;
+    tui->entries = tmp;
+    tui->allocated_entries = allocated;
+  }
+  idx = tui->nr_entries++;
+  entry = &tui->entries[idx];
+  entry->obj = obj;
+  entry->indent = indent;
+  entry->collapse = collapse;
+  entry->text = NULL;
+
+  /* same order as the console output */
+  for_each_memory_child(child, obj)
+    if (child->type != HWLOC_OBJ_NUMANODE || !loutput->ignore_numanodes)
+      if (tui_add_entries(tui, child, indent+1) < 0)
+	return -1;
+  for_each_child(child, obj)
+    if (child->type != HWLOC_OBJ_PU || !loutput->ignore_pus)
+      if (tui_add_entries(tui, child, indent+1) < 0)
+	return -1;
+  for_each_io_child(child, obj)
+    if (tui_add_entries(tui, child, indent+1) < 0)
+      return -1;
+  for_each_misc_child(child, obj)
+    if (tui_add_entries(tui, child, indent+1) < 0)
+      return -1;
+
+  /* entries may have been reallocated */
+  tui->entries[idx].end = tui->nr_entries;
+  return 0;
+}
+
+static void
+tui_free_entries(struct lstopo_tui *tui)
+{
+  unsigned i;
+  for(i=0; i<tui->nr_entries; i++)
+    free(tui->entries[i].text);
+  free(tui->entries);
+  tui->entries = NULL;
+  tui->nr_entries = tui->allocated_entries = 0;
+  free(tui->rows);
+  tui->rows = NULL;
+  tui->nr_rows = 0;
+}
+
+/* (re)compute visible rows starting at the given row */
+static void
+tui_update_rows(struct lstopo_tui *tui, unsigned from)
+{
+  unsigned entry;
+
+  if (from >= tui->nr_rows)
+    from = 0;
+  entry = tui->nr_rows ? tui->rows[from] : 0;
+  tui->nr_rows = from;
+  while (entry < tui->nr_entries) {
+    tui->rows[tui->nr_rows++] = entry;
+    entry = tui_folded(tui, entry) ? tui->entries[entry].end : entry+1;
+  }
+
+  if (tui->cursor >= tui->nr_rows)
+    tui->cursor = tui->nr_rows ? tui->nr_rows-1 : 0;
+  if (from < tui->redraw_from)
+    tui->redraw_from = from;
+}
+
+static int
+tui_build(struct lstopo_tui *tui)
+{
+  tui_free_entries(tui);
+  if (tui_add_entries(tui, hwloc_get_root_obj(tui->loutput->topology), 0) < 0)
+    return -1;
+  tui->rows = malloc(tui->nr_entries * sizeof(*tui->rows));
+  if (!tui->rows)
+    return -1;
+  tui_update_rows(tui, 0);
+  tui->redraw_all = 1;
+  return 0;
+}
+
+/* find the row of an entry, or the last row before it */
+static unsigned
+tui_entry_to_row(struct lstopo_tui *tui, unsigned entry)
+{
+  unsigned low = 0, high = tui->nr_rows;
+  while (high - low > 1) {
+    unsigned mid = (low + high) / 2;
+    if (tui->rows[mid] <= entry)
+      low = mid;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+static const char *
+tui_get_text(struct lstopo_tui *tui, unsigned entry)
+{
+  struct lstopo_tui_entry *e = &tui->entries[entry];
+  char *text = NULL;
+  size_t length = 0;
+  FILE *output;
+
+  if (e->text)
+    return e->text;
+
+  output = open_memstream(&text, &length);
+  if (!output)
+    return "";
+  if (e->collapse > 1)
+    fprintf(output, "%d x { ", e->collapse);
+  output_console_obj(tui->loutput, output, e->obj, e->collapse);
+  if (e->collapse > 1)
+    fprintf(output, " }");
+  fclose(output);
+
+  e->text = text;
+  return text ? text : "";
+}
+
+/*************************
+ * Drawing
+ */
+
+static unsigned
+tui_view_lines(struct lstopo_tui *tui)
+{
+  return tui->lines - 1; /* last line is the status */
+}
+
+static void
+tui_get_size(struct lstopo_tui *tui)
+{
+  struct winsize ws;
+  unsigned lines = 24, columns = 80;
+  char *tmp;
+
+  if (!ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) && ws.ws_row && ws.ws_col) {
+    lines = ws.ws_row;
+    columns = ws.ws_col;
+  }
+  if (lines < 2)
+    lines = 2;
+
+  tmp = realloc(tui->line, columns+1);
+  if (tmp) {
+    tui->line = tmp;
+    tui->columns = columns;
+  }
+  tui->lines = lines;
+  tui->redraw_all = 1;
+}
+
+static void
+tui_draw_row(struct lstopo_tui *tui, unsigned row)
+{
+  printf("\033[%u;1H", row - tui->first + 1);
+  if (row < tui->nr_rows) {
+    unsigned entry = tui->rows[row];
+    const char *marker = !tui_has_children(tui, entry) ? "  " : tui_folded(tui, entry) ? "+ " : "- ";
+    snprintf(tui->line, tui->columns+1, "%*s%s%s",
+	     (int) (2*tui->entries[entry].indent), "", marker, tui_get_text(tui, entry));
+    if (row == tui->cursor)
+      printf("\033[7m%s\033[0m", tui->line);
+    else
+      fputs(tui->line, stdout);
+  }
+  fputs("\033[K", stdout);
+}
+
+static void
+tui_draw_status(struct lstopo_tui *tui)
+{
+  snprintf(tui->line, tui->columns+1, " %u/%u  %s",
+	   tui->nr_rows ? tui->cursor+1 : 0, tui->nr_rows,
+	   *tui->message ? tui->message : TUI_HELP);
+  printf("\033[%u;1H\033[7m%-*s\033[0m", tui->lines, (int) tui->columns, tui->line);
+}
+
+static void
+tui_refresh(struct lstopo_tui *tui)
+{
+  unsigned view = tui_view_lines(tui);
+  unsigned row;
+
+  /* keep the cursor visible and the screen full */
+  if (tui->cursor < tui->first)
+    tui->first = tui->cursor;
+  else if (tui->cursor >= tui->first + view)
+    tui->first = tui->cursor - view + 1;
+  if (tui->first + view > tui->nr_rows)
+    tui->first = tui->nr_rows > view ? tui->nr_rows - view : 0;
+
+  if (tui->redraw_all || tui->first != tui->drawn_first) {
+    fputs("\033[H\033[2J", stdout);
+    for(row = tui->first; row < tui->first + view; row++)
+      tui_draw_row(tui, row);
+  } else {
+    unsigned from = tui->redraw_from < tui->first ? tui->first : tui->redraw_from;
+    for(row = from; row < tui->first + view; row++)
+      tui_draw_row(tui, row);
+    if (tui->drawn_cursor != tui->cursor) {
+      if (tui->drawn_cursor < from)
+	tui_draw_row(tui, tui->drawn_cursor);
+      if (tui->cursor < from)
+	tui_draw_row(tui, tui->cursor);
+    }
+  }
+  tui_draw_status(tui);
+  fflush(stdout);
+
+  tui->drawn_first = tui->first;
+  tui->drawn_cursor = tui->cursor;
+  tui->redraw_all = 0;
+  tui->redraw_from = UINT_MAX;
+}
+
+/*************************
+ * Search
+ */
+
+static int
+tui_match_busid(struct lstopo_tui *tui, unsigned entry, unsigned domain, unsigned bus, unsigned dev, unsigned func)
+{
+  hwloc_obj_t obj = tui->entries[entry].obj;
+  int i, collapse = tui->entries[entry].collapse > 1 ? tui->entries[entry].collapse : 1;
+
+  if (obj->type == HWLOC_OBJ_BRIDGE) {
+    if (obj->attr->bridge.upstream_type != HWLOC_OBJ_BRIDGE_PCI)
+      return 0;
+    collapse = 1;
+  } else if (obj->type != HWLOC_OBJ_PCI_DEVICE) {
+    return 0;
+  }
+
+  for(i=0; i<collapse && obj; i++, obj = obj->next_cousin)
+    if (obj->attr->pcidev.domain == domain && obj->attr->pcidev.bus == bus
+	&& obj->attr->pcidev.dev == dev && obj->attr->pcidev.func == func)
+      return 1;
+  return 0;
+}
+
+static int
+tui_match_index(struct lstopo_tui *tui, unsigned entry, hwloc_obj_type_t type, int physical, unsigned idx)
+{
+  hwloc_obj_t obj = tui->entries[entry].obj;
+  int collapse = tui->entries[entry].collapse;
+
+  if (obj->type != type)
+    return 0;
+  if (physical)
+    return obj->os_index == idx;
+  if (collapse > 1)
+    return idx >= obj->logical_index && idx < obj->logical_index + collapse;
+  return obj->logical_index == idx;
+}
+
+static int
+tui_match_text(struct lstopo_tui *tui, unsigned entry, const char *string)
+{
+  const char *text = tui_get_text(tui, entry);
+  size_t len = strlen(string);
+  for( ; *text; text++)
+    if (!hwloc_strncasecmp(text, string, len))
+      return 1;
+  return 0;
+}
+
+/* search the entry matching tui->search after (or before) the current one.
+ * the search string may be a PCI busid, a type, a type and index (logical, or physical with -p or P#),
+ * or any part of the console description.
+ */
+static int
+tui_search(struct lstopo_tui *tui, int backward)
+{
+  struct lstopo_output *loutput = tui->loutput;
+  const char *search = tui->search;
+  unsigned domain = 0, bus, dev, func;
+  int isbusid = 0, istype = 0, hasindex = 0, physical = loutput->index_type == LSTOPO_INDEX_TYPE_PHYSICAL;
+  hwloc_obj_type_t type = HWLOC_OBJ_TYPE_NONE;
+  unsigned idx = 0;
+  unsigned start, entry, i;
+  char typestr[64];
+  const char *colon;
+
+  if (!*search || !tui->nr_rows)
+    return -1;
+
+  if (sscanf(search, "%x:%x:%x.%x", &domain, &bus, &dev, &func) == 4) {
+    isbusid = 1;
+  } else if (sscanf(search, "%x:%x.%x", &bus, &dev, &func) == 3) {
+    domain = 0;
+    isbusid = 1;
+  } else {
+    colon = strchr(search, ':');
+    snprintf(typestr, sizeof(typestr), "%.*s", colon ? (int) (colon - search) : (int) strlen(search), search);
+    if (!hwloc_type_sscanf(typestr, &type, NULL, 0)) {
+      istype = 1;
+      if (colon) {
+	const char *index = colon+1;
+	char *end;
+	if (!hwloc_strncasecmp(index, "P#", 2)) {
+	  physical = 1;
+	  index += 2;
+	} else if (!hwloc_strncasecmp(index, "L#", 2)) {
+	  physical = 0;
+	  index += 2;
+	}
+	idx = strtoul(index, &end, 0);
+	if (end == index || *end)
+	  istype = 0; /* fallback to text matching */
+	else
+	  hasindex = 1;
+      }
+    }
+  }
+
+  start = tui->rows[tui->cursor];
+  for(i=1; i<=tui->nr_entries; i++) {
+    int match;
+    if (backward)
+      entry = (start + tui->nr_entries - i) % tui->nr_entries;
+    else
+      entry = (start + i) % tui->nr_entries;
+
+    if (isbusid)
+      match = tui_match_busid(tui, entry, domain, bus, dev, func);
+    else if (istype && hasindex)
+      match = tui_match_index(tui, entry, type, physical, idx);
+    else if (istype)
+      match = tui->entries[entry].obj->type == type;
+    else
+      match = tui_match_text(tui, entry, search);
+
+    if (match) {
+      /* unfold ancestors and move there */
+      hwloc_obj_t parent;
+      for(parent = tui->entries[entry].obj->parent; parent; parent = parent->parent)
+	((struct lstopo_obj_userdata *) parent->userdata)->folded = 0;
+      tui_update_rows(tui, 0);
+      tui->cursor = tui_entry_to_row(tui, entry);
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+/* read the search string on the status line */
+static int tui_get_key(void);
+
+static int
+tui_prompt(struct lstopo_tui *tui)
+{
+  char search[sizeof(tui->search)] = "";
+  size_t len = 0;
+
+  while (1) {
+    int key;
+    snprintf(tui->line, tui->columns+1, "/%s", search);
+    printf("\033[%u;1H%s\033[K", tui->lines, tui->line);
+    fflush(stdout);
+
+    key = tui_get_key();
+    if (key == TUI_KEY_EOF)
+      return -1;
+    if (key == '\r' || key == '\n')
+      break;
+    if (key == 27 || key == TUI_KEY_CTRL('c') || key == TUI_KEY_CTRL('g'))
+      return -1;
+    if ((key == 127 || key == TUI_KEY_CTRL('h')) && len)
+      search[--len] = '\0';
+    else if (key >= 32 && key < 127 && len < sizeof(search)-1) {
+      search[len++] = (char) key;
+      search[len] = '\0';
+    }
+  }
+
+  if (len)
+    strcpy(tui->search, search);
+  return 0;
+}
+
+/*************************
+ * Terminal
+ */
+
+static int
+tui_get_key(void)
+{
+  unsigned char *b = tui_input;
+  unsigned used = 1;
+  int key;
+
+  if (!tui_input_nr) {
+    ssize_t n = read(STDIN_FILENO, tui_input, sizeof(tui_input));
+    if (n < 0 && errno == EINTR)
+      return TUI_KEY_NONE;
+    if (n <= 0)
+      return TUI_KEY_EOF;
+    tui_input_nr = n;
+  }
+
+  key = b[0];
+  if (b[0] == 27 && tui_input_nr >= 3 && (b[1] == '[' || b[1] == 'O')) {
+    used = 3;
+    switch (b[2]) {
+    case 'A': key = TUI_KEY_UP; break;
+    case 'B': key = TUI_KEY_DOWN; break;
+    case 'C': key = TUI_KEY_RIGHT; break;
+    case 'D': key = TUI_KEY_LEFT; break;
+    case 'H': key = TUI_KEY_HOME; break;
+    case 'F': key = TUI_KEY_END; break;
+    default:
+      key = TUI_KEY_NONE;
+      if (isdigit(b[2]) && tui_input_nr >= 4 && b[3] == '~') {
+	used = 4;
+	switch (b[2]) {
+	case '1': case '7': key = TUI_KEY_HOME; break;
+	case '4': case '8': key = TUI_KEY_END; break;
+	case '5': key = TUI_KEY_PGUP; break;
+	case '6': key = TUI_KEY_PGDOWN; break;
+	}
+      } else {
+	/* ignore unknown sequences */
+	used = tui_input_nr;
+      }
+    }
+  }
+
+  memmove(tui_input, tui_input+used, tui_input_nr-used);
+  tui_input_nr -= used;
+  return key;
+}
+
+static int
+tui_setup_terminal(void)
+{
+  struct termios raw;
+  struct sigaction sa;
+
+  if (tcgetattr(STDIN_FILENO, &tui_saved_termios) < 0)
+    return -1;
+  raw = tui_saved_termios;
+  raw.c_lflag &= ~(ICANON|ECHO|ISIG|IEXTEN);
+  raw.c_iflag &= ~(IXON|ICRNL);
+  raw.c_cc[VMIN] = 1;
+  raw.c_cc[VTIME] = 0;
+  if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) < 0)
+    return -1;
+
+  /* no SA_RESTART so that read() returns on resize */
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = tui_sigwinch;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGWINCH, &sa, NULL);
+
+  /* alternate screen, hidden cursor */
+  fputs("\033[?1049h\033[?25l", stdout);
+  return 0;
+}
+
+static void
+tui_restore_terminal(void)
+{
+  signal(SIGWINCH, SIG_DFL);
+  fputs("\033[0m\033[?25h\033[?1049l", stdout);
+  fflush(stdout);
+  tcsetattr(STDIN_FILENO, TCSAFLUSH, &tui_saved_termios);
+}
+
+/*************************
+ * Main loop
+ */
+
+static void
+tui_fold(struct lstopo_tui *tui, int folded)
+{
+  unsigned entry = tui->rows[tui->cursor];
+  if (!tui_has_children(tui, entry) || tui_folded(tui, entry) == folded)
+    return;
+  tui_set_folded(tui, entry, folded);
+  tui_update_rows(tui, tui->cursor);
+}
+
+int
+output_tui(struct lstopo_output *loutput, const char *filename __hwloc_attribute_unused)
+{
+  struct lstopo_tui tui;
+  int ret = -1;
+
+  if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+    fprintf(stderr, "The tui output requires a terminal.\n");
+    return -1;
+  }
+
+  memset(&tui, 0, sizeof(tui));
+  tui.loutput = loutput;
+  tui.redraw_from = UINT_MAX;
+  if (tui_build(&tui) < 0) {
+    fprintf(stderr, "Failed to allocate the list of objects.\n");
+    goto out;
+  }
+  tui_get_size(&tui);
+  if (!tui.line)
+    goto out;
+
+  if (tui_setup_terminal() < 0) {
+    fprintf(stderr, "Failed to configure the terminal (%s).\n", strerror(errno));
+    goto out;
+  }
+
+  while (1) {
+    unsigned view;
+    int key;
+
+    if (tui_resized) {
+      tui_resized = 0;
+      tui_get_size(&tui);
+    }
+    tui_refresh(&tui);
+    view = tui_view_lines(&tui);
+
+    key = tui_get_key();
+    if (key == TUI_KEY_NONE)
+      continue;
+    if (key == TUI_KEY_EOF || key == 'q' || key == 'Q' || key == TUI_KEY_CTRL('c'))
+      break;
+
+    *tui.message = '\0';
+
+    switch (key) {
+    case TUI_KEY_DOWN: case 'j': case TUI_KEY_CTRL('n'):
+      if (tui.cursor+1 < tui.nr_rows)
+	tui.cursor++;
+      break;
+    case TUI_KEY_UP: case 'k': case TUI_KEY_CTRL('p'):
+      if (tui.cursor)
+	tui.cursor--;
+      break;
+    case TUI_KEY_PGDOWN: case ' ': case TUI_KEY_CTRL('f'):
+      tui.cursor = tui.cursor + view < tui.nr_rows ? tui.cursor + view : tui.nr_rows-1;
+      break;
+    case TUI_KEY_PGUP: case 'b': case TUI_KEY_CTRL('b'):
+      tui.cursor = tui.cursor > view ? tui.cursor - view : 0;
+      break;
+    case TUI_KEY_HOME: case 'g':
+      tui.cursor = 0;
+      break;
+    case TUI_KEY_END: case 'G':
+      tui.cursor = tui.nr_rows-1;
+      break;
+    case TUI_KEY_RIGHT: case 'l': case '+':
+      tui_fold(&tui, 0);
+      break;
+    case TUI_KEY_LEFT: case 'h': case '-': {
+      unsigned entry = tui.rows[tui.cursor];
+      if (tui_has_children(&tui, entry) && !tui_folded(&tui, entry)) {
+	tui_fold(&tui, 1);
+      } else if (tui.cursor) {
+	/* move to the parent entry */
+	unsigned indent = tui.entries[entry].indent;
+	while (tui.cursor && tui.entries[tui.rows[tui.cursor]].indent >= indent)
+	  tui.cursor--;
+      }
+      break;
+    }
+    case '\r': case '\n':
+      tui_fold(&tui, !tui_folded(&tui, tui.rows[tui.cursor]));
+      break;
+    case 'E': {
+      unsigned i;
+      for(i=0; i<tui.nr_entries; i++)
+	tui_set_folded(&tui, i, 0);
+      tui_update_rows(&tui, 0);
+      break;
+    }
+    case 'c': {
+      unsigned entry = tui.rows[tui.cursor];
+      hwloc_obj_t obj = tui.entries[entry].obj;
+      loutput->pci_collapse_enabled = !loutput->pci_collapse_enabled;
+      if (tui_build(&tui) < 0)
+	goto out_with_terminal;
+      /* stay on the same object, or on the one collapsing it */
+      while (obj->type == HWLOC_OBJ_PCI_DEVICE && obj->prev_cousin
+	     && loutput->pci_collapse_enabled && ((struct lstopo_obj_userdata *) obj->userdata)->pci_collapsed == -1)
+	obj = obj->prev_cousin;
+      for(entry=0; entry<tui.nr_entries; entry++)
+	if (tui.entries[entry].obj == obj)
+	  break;
+      tui.cursor = entry < tui.nr_entries ? tui_entry_to_row(&tui, entry) : 0;
+      snprintf(tui.message, sizeof(tui.message), "PCI collapsing %s", loutput->pci_collapse_enabled ? "enabled" : "disabled");
+      break;
+    }
+    case '/':
+      if (!tui_prompt(&tui) && tui_search(&tui, 0) < 0)
+	snprintf(tui.message, sizeof(tui.message), "Pattern not found: %s", tui.search);
+      break;
+    case 'n': case 'N':
+      if (!*tui.search)
+	snprintf(tui.message, sizeof(tui.message), "No previous search");
+      else if (tui_search(&tui, key == 'N') < 0)
+	snprintf(tui.message, sizeof(tui.message), "Pattern not found: %s", tui.search);
+      break;
+    case TUI_KEY_CTRL('l'):
+      tui.redraw_all = 1;
+      break;
+    case '?':
+      snprintf(tui.message, sizeof(tui.message), "%s", TUI_HELP);
+      break;
+    }
+  }
+
+  ret = 0;
+
+ out_with_terminal:
+  tui_restore_terminal();
+ out:
+  tui_free_entries(&tui);
+  free(tui.line);
+  return ret;
+}
+
+#endif /* LSTOPO_HAVE_TUI */
@@ -11,6 +11,7 @@
 #include "hwloc.h"
 #ifdef HWLOC_LINUX_SYS
 #include "hwloc/linux.h"
+#include <unistd.h>
 #endif /* HWLOC_LINUX_SYS */
 #include "hwloc/shmem.h"
 
@@ -19,6 +20,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #ifdef HAVE_DIRENT_H
 #include <dirent.h>
 #endif
@@ -158,6 +160,326 @@ static void add_process_objects(hwloc_topology_t topology)
 			   HWLOC_PS_FLAG_THREADS | HWLOC_PS_FLAG_SHORTNAME, NULL, HWLOC_PS_ALL_UIDS, NULL);
 }
 
+/* average the utilization of PUs in each normal object */
+static void
+lstopo_aggregate_utilization(hwloc_obj_t obj, float *sump, unsigned *nrp)
+{
+  struct lstopo_obj_userdata *lud = obj->userdata;
+  float sum = 0.f;
+  unsigned nr = 0;
+  hwloc_obj_t child;
+
+  if (obj->type == HWLOC_OBJ_PU) {
+    if (lud->utilization >= 0.f) {
+      sum = lud->utilization;
+      nr = 1;
+    }
+  } else {
+    for_each_child(child, obj)
+      lstopo_aggregate_utilization(child, &sum, &nr);
+    lud->utilization = nr ? sum / nr : -1.f;
+  }
+
+  *sump += sum;
+  *nrp += nr;
+}
+
+int
+lstopo_update_utilization(struct lstopo_output *loutput)
+{
+#ifdef HWLOC_LINUX_SYS
+  hwloc_topology_t topology = loutput->topology;
+  hwloc_obj_t root = hwloc_get_root_obj(topology);
+  float *values = NULL;
+  unsigned nr_values = 0;
+  char line[256];
+  hwloc_obj_t pu;
+  float sum = 0.f;
+  unsigned nr = 0;
+  FILE *file;
+
+  if (!hwloc_topology_is_thissystem(topology)) {
+    errno = ENOSYS;
+    return -1;
+  }
+
+  file = fopen("/proc/stat", "r");
+  if (!file)
+    return -1;
+
+  while (fgets(line, sizeof(line), file)) {
+    unsigned long long user, nice, system, idle, iowait = 0, irq = 0, softirq = 0, steal = 0;
+    unsigned long long busy, total, *prev;
+    unsigned cpu;
+
+    /* only cpuN lines, the first "cpu" line is the sum of all of them */
+    if (strncmp(line, "cpu", 3) || line[3] < '0' || line[3] > '9')
+      continue;
+    if (sscanf(line+3, "%u %llu %llu %llu %llu %llu %llu %llu %llu",
+	       &cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal) < 5)
+      continue;
+    busy = user + nice + system + irq + softirq + steal;
+    total = busy + idle + iowait;
+
+    if (cpu >= loutput->utilization_prev_nr) {
+      unsigned new_nr = cpu + 1;
+      unsigned long long *tmp = realloc(loutput->utilization_prev, 2 * new_nr * sizeof(*tmp));
+      if (!tmp)
+	continue;
+      memset(tmp + 2 * loutput->utilization_prev_nr, 0, 2 * (new_nr - loutput->utilization_prev_nr) * sizeof(*tmp));
+      loutput->utilization_prev = tmp;
+      loutput->utilization_prev_nr = new_nr;
+    }
+    if (cpu >= nr_values) {
+      unsigned new_nr = cpu + 1;
+      float *tmp = realloc(values, new_nr * sizeof(*tmp));
+      if (!tmp)
+	continue;
+      while (nr_values < new_nr)
+	tmp[nr_values++] = -1.f;
+      values = tmp;
+    }
+
+    /* compare with the previous sample, if any */
+    prev = &loutput->utilization_prev[2*cpu];
+    if (prev[1] && total > prev[1] && busy >= prev[0]) {
+      float value = (float) (busy - prev[0]) / (total - prev[1]);
+      values[cpu] = value > 1.f ? 1.f : value;
+    }
+    prev[0] = busy;
+    prev[1] = total;
+  }
+  fclose(file);
+
+  pu = NULL;
+  while ((pu = hwloc_get_next_obj_by_type(topology, HWLOC_OBJ_PU, pu)) != NULL) {
+    struct lstopo_obj_userdata *lud = pu->userdata;
+    lud->utilization = pu->os_index < nr_values ? values[pu->os_index] : -1.f;
+  }
+  free(values);
+
+  lstopo_aggregate_utilization(root, &sum, &nr);
+  return 0;
+
+#else /* !HWLOC_LINUX_SYS */
+  errno = ENOSYS;
+  return -1;
+#endif /* !HWLOC_LINUX_SYS */
+}
+
+/* sample utilization twice with the configured interval in between,
+ * for outputs that are not refreshed later.
+ */
+static int
+lstopo_sample_utilization(struct lstopo_output *loutput, int interactive)
+{
+  hwloc_obj_t root = hwloc_get_root_obj(loutput->topology);
+  int err;
+
+  err = lstopo_update_utilization(loutput);
+  if (err < 0)
+    return err;
+  if (interactive || ((struct lstopo_obj_userdata *)root->userdata)->utilization >= 0.f)
+    /* interactive outputs update utilization later, or we already had a previous sample */
+    return 0;
+
+#ifdef HWLOC_LINUX_SYS
+  usleep(loutput->utilization_interval * 1000);
+#endif
+  return lstopo_update_utilization(loutput);
+}
+
+static void
+lstopo_clear_heatmap(hwloc_obj_t obj)
+{
+  struct lstopo_obj_userdata *lud = obj->userdata;
+  hwloc_obj_t child;
+
+  lud->heat_threads = 0;
+  lud->heat_memory = 0;
+  lud->heat = -1.f;
+
+  for_each_child(child, obj)
+    lstopo_clear_heatmap(child);
+  for_each_memory_child(child, obj)
+    lstopo_clear_heatmap(child);
+}
+
+#ifdef HWLOC_LINUX_SYS
+/* count threads of the process by their last CPU location */
+static int
+lstopo_heatmap_read_threads(struct lstopo_output *loutput, int pid)
+{
+  hwloc_topology_t topology = loutput->topology;
+  hwloc_bitmap_t set;
+  struct dirent *dirent;
+  char path[64];
+  DIR *dir;
+
+  snprintf(path, sizeof(path), "/proc/%d/task", pid);
+  dir = opendir(path);
+  if (!dir)
+    return -1;
+  set = hwloc_bitmap_alloc();
+  if (!set) {
+    closedir(dir);
+    return -1;
+  }
+
+  while ((dirent = readdir(dir)) != NULL) {
+    hwloc_obj_t obj;
+    char *end;
+    long tid = strtol(dirent->d_name, &end, 10);
+    if (*end || tid <= 0)
+      continue;
+    if (hwloc_linux_get_tid_last_cpu_location(topology, (pid_t) tid, set) < 0)
+      continue; /* the thread exited */
+    obj = hwloc_get_pu_obj_by_os_index(topology, (unsigned) hwloc_bitmap_first(set));
+    if (!obj)
+      continue;
+    loutput->heatmap_threads++;
+    for( ; obj; obj = obj->parent)
+      ((struct lstopo_obj_userdata *) obj->userdata)->heat_threads++;
+  }
+
+  hwloc_bitmap_free(set);
+  closedir(dir);
+  return 0;
+}
+
+/* add resident pages of the process to their NUMA nodes.
+ * each line of numa_maps contains N<node>=<pages> tokens and kernelpagesize_kB=<size>.
+ */
+static void
+lstopo_heatmap_read_memory(struct lstopo_output *loutput, int pid)
+{
+  hwloc_topology_t topology = loutput->topology;
+  unsigned long long *pages = NULL, pagesize = 4096;
+  unsigned nr_nodes = 0, i;
+  char path[64], token[64];
+  unsigned tokenlen = 0;
+  FILE *file;
+  int c;
+
+  snprintf(path, sizeof(path), "/proc/%d/numa_maps", pid);
+  file = fopen(path, "r");
+  if (!file)
+    return; /* no NUMA support in the kernel, or not allowed */
+
+  do {
+    c = getc(file);
+    if (c != EOF && !isspace(c)) {
+      if (tokenlen < sizeof(token)-1)
+	token[tokenlen++] = (char) c;
+      continue;
+    }
+
+    /* end of token */
+    if (tokenlen) {
+      unsigned node;
+      unsigned long long value;
+      token[tokenlen] = '\0';
+      tokenlen = 0;
+      if (sscanf(token, "N%u=%llu", &node, &value) == 2) {
+	if (node >= nr_nodes) {
+	  unsigned long long *tmp = realloc(pages, 2 * (node+1) * sizeof(*pages));
+	  if (tmp) {
+	    memset(tmp + 2*nr_nodes, 0, 2 * (node+1-nr_nodes) * sizeof(*pages));
+	    pages = tmp;
+	    nr_nodes = node+1;
+	  }
+	}
+	/* pages of the current mapping are kept apart until we know their size */
+	if (node < nr_nodes)
+	  pages[2*node+1] += value;
+      } else if (sscanf(token, "kernelpagesize_kB=%llu", &value) == 1) {
+	pagesize = value * 1024;
+      }
+    }
+
+    /* end of mapping */
+    if (c == '\n' || c == EOF) {
+      for(i=0; i<nr_nodes; i++) {
+	pages[2*i] += pages[2*i+1] * pagesize;
+	pages[2*i+1] = 0;
+      }
+      pagesize = 4096;
+    }
+  } while (c != EOF);
+  fclose(file);
+
+  for(i=0; i<nr_nodes; i++) {
+    hwloc_obj_t obj = hwloc_get_numanode_obj_by_os_index(topology, i);
+    if (!obj || !pages[2*i])
+      continue;
+    loutput->heatmap_memory += pages[2*i];
+    for( ; obj; obj = obj->parent)
+      ((struct lstopo_obj_userdata *) obj->userdata)->heat_memory += pages[2*i];
+  }
+  free(pages);
+}
+#endif /* HWLOC_LINUX_SYS */
+
+int
+lstopo_update_heatmap(struct lstopo_output *loutput)
+{
+#ifdef HWLOC_LINUX_SYS
+  hwloc_topology_t topology = loutput->topology;
+  int pid = loutput->pid_number > 0 ? loutput->pid_number : (int) getpid();
+  int depth, topodepth = hwloc_topology_get_depth(topology);
+  unsigned i, n;
+
+  if (!hwloc_topology_is_thissystem(topology)) {
+    errno = ENOSYS;
+    return -1;
+  }
+
+  lstopo_clear_heatmap(hwloc_get_root_obj(topology));
+  loutput->heatmap_threads = 0;
+  loutput->heatmap_memory = 0;
+
+  if (lstopo_heatmap_read_threads(loutput, pid) < 0)
+    return -1;
+  lstopo_heatmap_read_memory(loutput, pid);
+
+  /* threads relative to the busiest object of each normal level */
+  for(depth=0; depth<topodepth; depth++) {
+    unsigned max = 0;
+    n = hwloc_get_nbobjs_by_depth(topology, depth);
+    for(i=0; i<n; i++) {
+      struct lstopo_obj_userdata *lud = hwloc_get_obj_by_depth(topology, depth, i)->userdata;
+      if (lud->heat_threads > max)
+	max = lud->heat_threads;
+    }
+    for(i=0; i<n; i++) {
+      struct lstopo_obj_userdata *lud = hwloc_get_obj_by_depth(topology, depth, i)->userdata;
+      lud->heat = max ? (float) lud->heat_threads / max : 0.f;
+    }
+  }
+
+  /* memory relative to the NUMA node containing most of it */
+  {
+    hwloc_uint64_t max = 0;
+    n = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NUMANODE);
+    for(i=0; i<n; i++) {
+      struct lstopo_obj_userdata *lud = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, i)->userdata;
+      if (lud->heat_memory > max)
+	max = lud->heat_memory;
+    }
+    for(i=0; i<n; i++) {
+      struct lstopo_obj_userdata *lud = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, i)->userdata;
+      lud->heat = max ? (float) lud->heat_memory / max : 0.f;
+    }
+  }
+
+  return 0;
+
+#else /* !HWLOC_LINUX_SYS */
+  errno = ENOSYS;
+  return -1;
+#endif /* !HWLOC_LINUX_SYS */
+}
+
 static __hwloc_inline void lstopo_update_factorize_bounds(unsigned min, unsigned *first, unsigned *last)
 {
   switch (min) {
@@ -185,6 +507,28 @@ static __hwloc_inline void lstopo_update_factorize_alltypes_bounds(struct lstopo
     lstopo_update_factorize_bounds(loutput->factorize_min[type], &loutput->factorize_first[type], &loutput->factorize_last[type]);
 }
 
+/* large topologies only keep the first and last children of factorized objects,
+ * that's enough to see what's factorized and it divides the number of drawn objects
+ * at each factorized level.
+ */
+static void
+lstopo_tune_factorize_bounds(struct lstopo_output *loutput)
+{
+  hwloc_obj_type_t type;
+
+  if (!loutput->factorize_auto)
+    return;
+
+  lstopo_update_factorize_alltypes_bounds(loutput);
+  if (hwloc_get_nbobjs_by_type(loutput->topology, HWLOC_OBJ_PU) <= FACTORIZE_AUTO_NBPUS_MIN)
+    return;
+
+  for(type = HWLOC_OBJ_TYPE_MIN; type < HWLOC_OBJ_TYPE_MAX; type++) {
+    loutput->factorize_first[type] = 1;
+    loutput->factorize_last[type] = 1;
+  }
+}
+
 static void
 lstopo_add_factorized_attributes(struct lstopo_output *loutput, hwloc_obj_t obj)
 {
@@ -288,6 +632,11 @@ lstopo_populate_userdata(hwloc_obj_t parent)
   save->common.next = parent->userdata;
   save->factorized = 0;
   save->pci_collapsed = 0;
+  save->folded = 0;
+  save->utilization = -1.f;
+  save->heat_threads = 0;
+  save->heat_memory = 0;
+  save->heat = -1.f;
   parent->userdata = save;
 
   for_each_child(child, parent)
@@ -358,7 +707,10 @@ void usage(const char *name, FILE *where)
 #if !(defined LSTOPO_HAVE_GRAPHICS) || !(defined CAIRO_HAS_SVG_SURFACE)
 		  ", svg(native)"
 #endif
-		  ", xml, synthetic"
+		  ", xml, json, synthetic"
+#ifdef LSTOPO_HAVE_TUI
+		  ", tui"
+#endif
 		  "\n");
   fprintf (where, "\nFormatting options:\n");
   fprintf (where, "  -l --logical          Display hwloc logical object indexes\n");
@@ -431,11 +783,17 @@ void usage(const char *name, FILE *where)
   fprintf (where, "  --binding-color none    Do not colorize PU and NUMA nodes according to the binding\n");
   fprintf (where, "  --disallowed-color none Do not colorize disallowed PU and NUMA nodes\n");
   fprintf (where, "  --top-color <none|#xxyyzz> Change task background color for --top\n");
+  fprintf (where, "  --utilization[=<ms>]  Colorize PUs, cores and caches according to their utilization\n"
+		  "                        sampled every <ms> milliseconds (1000 by default)\n");
+  fprintf (where, "  --heatmap             Colorize objects where threads of the --pid process run\n"
+		  "                        and NUMA nodes where its memory is allocated\n");
   fprintf (where, "Miscellaneous options:\n");
   fprintf (where, "  --export-xml-flags <n>\n"
 		  "                        Set flags during the XML topology export\n");
   fprintf (where, "  --export-synthetic-flags <n>\n"
 		  "                        Set flags during the synthetic topology export\n");
+  fprintf (where, "  --tile-memory <MB>    Draw large PNG outputs in bands of at most <MB> megabytes\n"
+		  "                        (256 by default, 0 to draw at once)\n");
   /* --shmem-output-addr is undocumented on purpose */
   fprintf (where, "  --ps --top            Display processes within the hierarchy\n");
   fprintf (where, "  --version             Report version and exit\n");
@@ -530,6 +888,8 @@ enum output_format {
   LSTOPO_OUTPUT_CAIROSVG,
   LSTOPO_OUTPUT_NATIVESVG,
   LSTOPO_OUTPUT_XML,
+  LSTOPO_OUTPUT_JSON,
+  LSTOPO_OUTPUT_TUI,
   LSTOPO_OUTPUT_SHMEM,
   LSTOPO_OUTPUT_ERROR
 };
@@ -564,6 +924,10 @@ parse_output_format(const char *name, char *callname __hwloc_attribute_unused)
     return LSTOPO_OUTPUT_NATIVESVG;
   else if (!strcasecmp(name, "xml"))
     return LSTOPO_OUTPUT_XML;
+  else if (!strcasecmp(name, "json"))
+    return LSTOPO_OUTPUT_JSON;
+  else if (!strcasecmp(name, "tui"))
+    return LSTOPO_OUTPUT_TUI;
   else if (!strcasecmp(name, "shmem"))
     return LSTOPO_OUTPUT_SHMEM;
   else
@@ -655,6 +1019,7 @@ main (int argc, char *argv[])
 #endif
   char *env;
   int top = 0;
+  int interactive = 0;
   int opt;
   unsigned i;
 
@@ -681,6 +1046,14 @@ main (int argc, char *argv[])
   loutput.pid_number = -1;
   loutput.pid = 0;
   loutput.need_pci_domain = 0;
+  loutput.draw_cache = NULL;
+  loutput.show_utilization = 0;
+  loutput.utilization_interval = LSTOPO_UTILIZATION_INTERVAL_DEFAULT;
+  loutput.utilization_prev = NULL;
+  loutput.utilization_prev_nr = 0;
+  loutput.show_heatmap = 0;
+  loutput.heatmap_threads = 0;
+  loutput.heatmap_memory = 0;
 
   init_type_filters();
 
@@ -688,10 +1061,12 @@ main (int argc, char *argv[])
   for(i=HWLOC_OBJ_TYPE_MIN; i<HWLOC_OBJ_TYPE_MAX; i++)
     loutput.factorize_min[i] = FACTORIZE_MIN_DEFAULT;
   lstopo_update_factorize_alltypes_bounds(&loutput);
+  loutput.factorize_auto = 1;
 
   loutput.export_synthetic_flags = 0;
   loutput.export_xml_flags = 0;
   loutput.shmem_output_addr = 0;
+  loutput.tile_memory = 256UL<<20;
 
   loutput.show_legend = LSTOPO_SHOW_LEGEND_ALL;
   loutput.legend_append = NULL;
@@ -916,10 +1291,12 @@ main (int argc, char *argv[])
 	loutput.pci_collapse_enabled = 0;
 
       else if (!strcmp (argv[0], "--no-factorize")) {
+	loutput.factorize_auto = 0;
 	for(i=HWLOC_OBJ_TYPE_MIN; i<HWLOC_OBJ_TYPE_MAX; i++)
 	  loutput.factorize_min[i] = FACTORIZE_MIN_DISABLED;
       }
       else if (!strncmp (argv[0], "--no-factorize=", 15)) {
+	loutput.factorize_auto = 0;
 	hwloc_obj_type_t type;
 	const char *tmp = argv[0]+15;
 	if (hwloc_type_sscanf(tmp, &type, NULL, 0) < 0) {
@@ -929,11 +1306,13 @@ main (int argc, char *argv[])
 	loutput.factorize_min[type] = FACTORIZE_MIN_DISABLED;
       }
       else if (!strcmp (argv[0], "--factorize")) {
+	loutput.factorize_auto = 0;
 	for(i=HWLOC_OBJ_TYPE_MIN; i<HWLOC_OBJ_TYPE_MAX; i++)
 	  loutput.factorize_min[i] = FACTORIZE_MIN_DEFAULT;
 	lstopo_update_factorize_alltypes_bounds(&loutput);
       }
       else if (!strncmp (argv[0], "--factorize=", 12)) {
+	loutput.factorize_auto = 0;
 	hwloc_obj_type_t type, type_min, type_max;
 	unsigned min, first, last;
 	const char *tmp = argv[0]+12;
@@ -1067,6 +1446,21 @@ main (int argc, char *argv[])
 	  fprintf(stderr, "Unsupported color `%s' passed to %s, ignoring.\n", argv[1], argv[0]);
 	opt = 1;
       }
+      else if (!strcmp (argv[0], "--utilization")) {
+	loutput.show_utilization = 1;
+      }
+      else if (!strncmp (argv[0], "--utilization=", 14)) {
+	int interval = atoi(argv[0]+14);
+	if (interval <= 0) {
+	  fprintf(stderr, "Unsupported interval `%s' passed to %s, ignoring.\n", argv[0]+14, argv[0]);
+	  goto out_usagefailure;
+	}
+	loutput.show_utilization = 1;
+	loutput.utilization_interval = interval;
+      }
+      else if (!strcmp (argv[0], "--heatmap")) {
+	loutput.show_heatmap = 1;
+      }
       else if (!strcmp (argv[0], "--top-color")) {
 	if (argc < 2)
 	  goto out_usagefailure;
@@ -1177,6 +1571,20 @@ main (int argc, char *argv[])
 	opt = 1;
       }
 
+      else if (!strcmp (argv[0], "--tile-memory")) {
+	unsigned long mb;
+	char *end;
+	if (argc < 2)
+	  goto out_usagefailure;
+	mb = strtoul(argv[1], &end, 0);
+	if (end == argv[1] || *end || mb > ULONG_MAX >> 20) {
+	  fprintf(stderr, "Invalid --tile-memory value `%s', expecting a number of megabytes.\n", argv[1]);
+	  goto out_usagefailure;
+	}
+	loutput.tile_memory = mb << 20;
+	opt = 1;
+      }
+
       else if (!strcmp (argv[0], "--shmem-output-addr")) {
 	if (argc < 2)
 	  goto out_usagefailure;
@@ -1242,6 +1650,11 @@ main (int argc, char *argv[])
   if (output_format == LSTOPO_OUTPUT_ERROR)
     goto out_usagefailure;
 
+  if (loutput.show_heatmap && loutput.pid_number == -1) {
+    fprintf(stderr, "--heatmap requires --pid.\n");
+    goto out_usagefailure;
+  }
+
   /* if  the output format wasn't enforced, think a bit about what the user probably want */
   if (output_format == LSTOPO_OUTPUT_DEFAULT) {
     if (loutput.show_cpuset
@@ -1258,11 +1671,13 @@ main (int argc, char *argv[])
 #if (defined LSTOPO_HAVE_X11)
     if (getenv("DISPLAY")) {
       output_func = output_x11;
+      interactive = 1;
     } else
 #endif /* LSTOPO_HAVE_X11 */
 #ifdef HWLOC_WIN_SYS
     {
       output_func = output_windows;
+      interactive = 1;
     }
 #endif
 #endif /* !LSTOPO_HAVE_GRAPHICS */
@@ -1320,6 +1735,14 @@ main (int argc, char *argv[])
   case LSTOPO_OUTPUT_XML:
     output_func = output_xml;
     break;
+  case LSTOPO_OUTPUT_JSON:
+    output_func = output_json;
+    break;
+#ifdef LSTOPO_HAVE_TUI
+  case LSTOPO_OUTPUT_TUI:
+    output_func = output_tui;
+    break;
+#endif
 #ifndef HWLOC_WIN_SYS
   case LSTOPO_OUTPUT_SHMEM:
     output_func = output_shmem;
@@ -1491,11 +1914,21 @@ main (int argc, char *argv[])
   loutput.depth = hwloc_topology_get_depth(topology);
   loutput.file = NULL;
 
-  if (output_format != LSTOPO_OUTPUT_XML) {
+  if (output_format != LSTOPO_OUTPUT_XML && output_format != LSTOPO_OUTPUT_JSON) {
     /* there might be some xml-imported userdata in objects, add lstopo-specific userdata in front of them */
     lstopo_populate_userdata(hwloc_get_root_obj(topology));
+    lstopo_tune_factorize_bounds(&loutput);
     lstopo_add_factorized_attributes(&loutput, hwloc_get_root_obj(topology));
     lstopo_add_collapse_attributes(topology);
+
+    if (loutput.show_utilization && lstopo_sample_utilization(&loutput, interactive) < 0) {
+      fprintf(stderr, "Failed to sample utilization (%s), disabling.\n", strerror(errno));
+      loutput.show_utilization = 0;
+    }
+    if (loutput.show_heatmap && lstopo_update_heatmap(&loutput) < 0) {
+      fprintf(stderr, "Failed to sample process threads and memory (%s), disabling heatmap.\n", strerror(errno));
+      loutput.show_heatmap = 0;
+    }
   }
 
   /******************
@@ -1503,10 +1936,12 @@ main (int argc, char *argv[])
    */
   err = output_func(&loutput, filename);
 
-  if (output_format != LSTOPO_OUTPUT_XML) {
+  if (output_format != LSTOPO_OUTPUT_XML && output_format != LSTOPO_OUTPUT_JSON) {
     /* remove lstopo-specific userdata in front of the list of userdata */
     lstopo_destroy_userdata(hwloc_get_root_obj(topology));
   }
+  /* memoized layout and text widths refer to these objects */
+  output_draw_clear_cache(&loutput);
   /* remove the remaining lists of xml-imported userdata */
   hwloc_utils_userdata_free_recursive(hwloc_get_root_obj(topology));
 
@@ -1523,6 +1958,7 @@ main (int argc, char *argv[])
 
   hwloc_bitmap_free(loutput.cpubind_set);
   hwloc_bitmap_free(loutput.membind_set);
+  free(loutput.utilization_prev);
 
   return err ? EXIT_FAILURE : EXIT_SUCCESS;
 
@@ -1532,6 +1968,7 @@ main (int argc, char *argv[])
 
  out_with_topology:
   lstopo_destroy_userdata(hwloc_get_root_obj(topology));
+  output_draw_clear_cache(&loutput);
   hwloc_topology_destroy(topology);
  out:
   hwloc_bitmap_free(allow_cpuset);
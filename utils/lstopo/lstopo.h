@@ -14,6 +14,10 @@
 #include "hwloc.h"
 #include "misc.h"
 
+#if !defined HWLOC_WIN_SYS && defined HAVE_TERMIOS_H && defined HAVE_OPEN_MEMSTREAM
+#define LSTOPO_HAVE_TUI 1
+#endif
+
 enum lstopo_drawing_e {
   LSTOPO_DRAWING_PREPARE,
   LSTOPO_DRAWING_DRAW
@@ -42,6 +46,7 @@ enum lstopo_show_legend_e {
 FILE *open_output(const char *filename, int overwrite) __hwloc_attribute_malloc;
 
 struct draw_methods;
+struct lstopo_draw_cache;
 
 /* if embedded in backend-specific output structure, must be at the beginning */
 struct lstopo_output {
@@ -68,10 +73,23 @@ struct lstopo_output {
   int need_pci_domain;
   hwloc_bitmap_t cpubind_set, membind_set;
 
+  /* utilization overlay */
+  int show_utilization;
+  unsigned utilization_interval; /* sampling interval in milliseconds */
+#define LSTOPO_UTILIZATION_INTERVAL_DEFAULT 1000
+  unsigned long long *utilization_prev; /* busy and total times of each PU (by os_index) during the previous sample */
+  unsigned utilization_prev_nr;
+
+  /* process heatmap */
+  int show_heatmap; /* show where threads of the --pid process last ran and where its memory is */
+  unsigned heatmap_threads; /* number of threads found during the last sample */
+  hwloc_uint64_t heatmap_memory; /* resident bytes found during the last sample */
+
   /* export config */
   unsigned long export_synthetic_flags;
   unsigned long export_xml_flags;
   uint64_t shmem_output_addr;
+  unsigned long tile_memory; /* maximal size of PNG image surfaces before drawing in bands, 0 for unlimited */
 
   /* legend */
   enum lstopo_show_legend_e show_legend;
@@ -105,12 +123,15 @@ struct lstopo_output {
 #define FACTORIZE_MIN_DISABLED UINT_MAX
   unsigned factorize_first[HWLOC_OBJ_TYPE_MAX]; /* number of first children to keep before factorizing */
   unsigned factorize_last[HWLOC_OBJ_TYPE_MAX]; /* number of last children to keep after factorizing */
+  int factorize_auto; /* keep fewer children on large topologies, unless factorizing was configured on the command-line */
+#define FACTORIZE_AUTO_NBPUS_MIN 256 /* number of PUs above which factorizing keeps fewer children */
 
   /* draw internal data */
   void *backend_data;
   struct draw_methods *methods;
   enum lstopo_drawing_e drawing;
   unsigned width, height; /* total output size */
+  struct lstopo_draw_cache *draw_cache; /* memoized text widths and layout, private to lstopo-draw.c */
 };
 
 struct lstopo_color {
@@ -159,6 +180,17 @@ struct lstopo_obj_userdata {
   int pci_collapsed; /* 0 if no collapsing, -1 if collapsed with a previous one, >1 if collapsed with several next */
   int factorized; /* 0 if no factorizing, -1 if hidden, 1 if replaced with dots */
 
+  /* interactive text UI */
+  int folded; /* 1 if children are hidden */
+
+  /* utilization overlay */
+  float utilization; /* between 0 and 1 during the last sampling interval, average of PUs for non-PU objects, <0 if unknown */
+
+  /* process heatmap */
+  unsigned heat_threads; /* threads of the --pid process that last ran inside this object */
+  hwloc_uint64_t heat_memory; /* resident bytes of the --pid process in NUMA nodes inside this object */
+  float heat; /* threads (bytes for NUMA nodes) relative to the maximum at this depth, <0 if unknown */
+
   /* custom style */
   struct lstopo_style style;
 #define LSTOPO_STYLE_BG  0x1
@@ -205,7 +237,10 @@ struct lstopo_obj_userdata {
 };
 
 typedef int output_method (struct lstopo_output *output, const char *filename);
-extern output_method output_console, output_synthetic, output_ascii, output_tikz, output_fig, output_png, output_pdf, output_ps, output_nativesvg, output_cairosvg, output_x11, output_windows, output_xml, output_shmem;
+extern output_method output_console, output_synthetic, output_ascii, output_tikz, output_fig, output_png, output_pdf, output_ps, output_nativesvg, output_cairosvg, output_x11, output_windows, output_xml, output_json, output_shmem, output_tui;
+
+/* print the console description of a single object, without children or newline */
+extern void output_console_obj(struct lstopo_output *loutput, FILE *output, hwloc_obj_t l, int collapse);
 
 extern int lstopo_shmem_adopt(const char *input, hwloc_topology_t *topologyp);
 
@@ -220,6 +255,8 @@ struct draw_methods {
 };
 
 extern void output_draw(struct lstopo_output *output);
+/* must be called when objects are destroyed or modified outside of output_draw() */
+extern void output_draw_clear_cache(struct lstopo_output *output);
 
 extern void lstopo_prepare_custom_styles(struct lstopo_output *loutput);
 extern void declare_colors(struct lstopo_output *output);
@@ -289,6 +326,14 @@ static __hwloc_inline int lstopo_busid_snprintf(struct lstopo_output *loutput, c
 		  lastobj->attr->pcidev.func);
 }
 
+/* sample the utilization of PUs since the previous call and update objects.
+ * the first call only records a sample, objects remain unknown.
+ */
+extern int lstopo_update_utilization(struct lstopo_output *loutput);
+
+/* sample where the threads of the --pid process last ran and where its memory is allocated */
+extern int lstopo_update_heatmap(struct lstopo_output *loutput);
+
 extern void lstopo_show_interactive_cli_options(const struct lstopo_output *loutput);
 extern void lstopo_show_interactive_help(void);
 
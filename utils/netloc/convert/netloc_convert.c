@@ -0,0 +1,53 @@
+/*
+ * Copyright © 2020 Inria.  All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ * See COPYING in top-level directory.
+ *
+ * $HEADER$
+ */
+
+#define _GNU_SOURCE         /* See feature_test_macros(7) */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libgen.h>
+
+#include <private/netloc.h>
+
+void help(char *name, FILE *f)
+{
+    fprintf(f, "Usage: %s <input topology file> <output binary file>\n"
+            "\tThe output file is usually named like the input file "
+            "with -nodes.bin instead of -nodes.txt\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    char *prog_name = basename(argv[0]);
+    netloc_topology_t *topology;
+    int ret;
+
+    if (argc == 2 && !strcmp(argv[1], "--help")) {
+        help(prog_name, stdout);
+        return 0;
+    }
+    if (argc != 3) {
+        help(prog_name, stderr);
+        return 1;
+    }
+
+    /* Keep the raw nodes, similar nodes are stored as indexes */
+    topology = netloc_topology_load(strdup(argv[1]), NETLOC_TOPOLOGY_LOAD_FLAG_RAW);
+    if (!topology) {
+        fprintf(stderr, "Error: Cannot load topology %s\n", argv[1]);
+        return 1;
+    }
+
+    ret = netloc_topology_write_binary(topology, argv[2]);
+    netloc_topology_destruct(topology);
+
+    return ret == NETLOC_SUCCESS ? 0 : 1;
+}
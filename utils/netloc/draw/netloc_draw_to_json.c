@@ -415,7 +415,8 @@ static int handle_node(netloc_node_t *node, json_t *json_nodes,
     return 0;
 }
 
-static int handle_path(netloc_node_t *node, json_t *json_paths)
+static int handle_path(netloc_topology_t *topology, netloc_node_t *node,
+        json_t *json_paths, UT_array *links)
 {
     char *id = node->physical_id;
 
@@ -424,16 +425,20 @@ static int handle_path(netloc_node_t *node, json_t *json_paths)
 
     /* Paths */
     json_t *json_path_list = json_array_new();
-    netloc_path_t *path, *path_tmp;
-    netloc_node_iter_paths(node, path, path_tmp) {
+    for (int h = 0; netloc_node_is_host(node) && h < topology->num_hosts; h++) {
+        netloc_node_t *dest = topology->hosts[h];
+        if (netloc_path_build(node, dest, links) != NETLOC_SUCCESS)
+            continue;
+
         json_t *json_node_path = json_dict_new();
         json_dict_add(json_node_path, JSON_DRAW_FILE_PATH_ID,
-                json_string_new(path->dest_id));
+                json_string_new(dest->physical_id));
 
         json_t *json_links = json_array_new();
-        netloc_physical_link_t **plink;
-        netloc_path_iter_links(path,plink) {
-            json_array_add(json_links, json_int_new((*plink)->id));
+        for (unsigned int l = 0; l < utarray_len(links); l++) {
+            netloc_physical_link_t *link = *(netloc_physical_link_t **)
+                utarray_eltptr(links, l);
+            json_array_add(json_links, json_int_new(link->id));
         }
         json_dict_add(json_node_path, JSON_DRAW_FILE_PATH_LINKS,
                 json_links);
@@ -491,9 +496,12 @@ static int write_json(netloc_topology_t *topology, FILE *output)
 
     /* Paths */
     json_t *json_paths = json_array_new();
+    UT_array *path_links;
+    utarray_new(path_links, &ut_ptr_icd);
     HASH_ITER(hh, topology->nodes, node, node_tmp) {
-        handle_path(node, json_paths);
+        handle_path(topology, node, json_paths, path_links);
     }
+    utarray_free(path_links);
     json_dict_add(json_root, JSON_DRAW_FILE_PATHS, json_paths);
 
     /* Partitions */
@@ -601,8 +609,9 @@ int main(int argc, char **argv)
         }
 #endif
 
-        /* Skip if does not end in .txt extension */
-        if( NULL == strstr(dir_entry->d_name, "-nodes.txt") ) {
+        /* Skip if does not end in .txt or .bin extension */
+        if( NULL == strstr(dir_entry->d_name, "-nodes.txt")
+                && NULL == strstr(dir_entry->d_name, "-nodes.bin") ) {
             continue;
         }
 
@@ -29,6 +29,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <string.h>
+#include <limits.h>
 
 int global_link_idx = 0;
 
@@ -51,6 +52,9 @@ typedef struct {
     char *hostname;
     int *partitions;
     UT_array *physical_links;
+    int idx;
+    int host_idx;
+    unsigned char *lft;
 } node_t;
 node_t *nodes = NULL;
 
@@ -76,33 +80,20 @@ const int NODE_TYPE_HOST = 0;
 const int NODE_TYPE_SWITH = 1;
 const int NODE_TYPE_UNKNOWN = 2;
 
-/* Route tables */
-typedef struct {
-    UT_hash_handle hh;       /* makes this structure hashable */
-    char physical_id[20];    /* key */
-    int port;
-} route_dest_t;
-typedef struct {
-    UT_hash_handle hh;       /* makes this structure hashable */
-    char physical_id[20];    /* key */
-    route_dest_t *dest;
-} route_source_t;
-route_source_t *routes = NULL;
+/* Hosts, in the order they are written into the file. The forwarding
+ * tables (lft) of switches are indexed by the position of the destination in
+ * this array (host_idx) and store the output port (0 if no route).
+ */
+node_t **hosts = NULL;
+int num_hosts = 0;
 
-/* Paths tables */
-typedef struct {
-    UT_hash_handle hh;       /* makes this structure hashable */
-    char physical_id[20];    /* key */
-    node_t *node;
-    UT_array *links;
-} path_dest_t;
-typedef struct {
-    UT_hash_handle hh;       /* makes this structure hashable */
-    char physical_id[20];    /* key */
-    node_t *node;
-    path_dest_t *dest;
-} path_source_t;
-path_source_t *paths = NULL;
+/* Route state of switches toward the current destination */
+enum {
+    ROUTE_UNKNOWN = 0,
+    ROUTE_VISITING,
+    ROUTE_REACHES,
+    ROUTE_FAILS
+};
 
 int read_routes(char *subnet, char *path, char *route_filename);
 int read_discover(char *subnet, char *discover_path, char *filename);
@@ -177,7 +168,10 @@ node_t *get_node(node_t **nodes, char *type, char *lid,
         node->hostname = node_find_hostname(node);
         node->main_partition = -1;
         node->partitions = NULL;
-        
+        node->idx = -1;
+        node->host_idx = -1;
+        node->lft = NULL;
+
         utarray_new(node->physical_links, &physical_link_icd);
 
         HASH_ADD_STR(*nodes, physical_id, node);  /* guid: name of key field */
@@ -241,75 +235,96 @@ static float compute_gbits(char *speed, char *width)
     return x*gb_per_x;
 }
 
-int build_paths(void)
+/* Number the nodes, and save the hosts in the order of the hash table, which
+ * is also the order of the nodes in the output file.
+ */
+int index_nodes(void)
 {
-    node_t *node_src, *node_dest, *node_tmp1, *node_tmp2;
-    HASH_ITER(hh, nodes, node_src, node_tmp1) {
-        if (node_src->type != NODE_TYPE_HOST)
-            continue;
-        char *id_src = node_src->physical_id;
+    int n = 0;
+    node_t *node, *node_tmp;
 
-        path_source_t *path = (path_source_t *)
-            malloc(sizeof(path_source_t));
-        sprintf(path->physical_id, "%s", id_src);
-        path->node = node_src;
-        path->dest = NULL;
-        HASH_ADD_STR(paths, physical_id, path);
+    hosts = (node_t **)malloc(HASH_COUNT(nodes)*sizeof(node_t *));
+    num_hosts = 0;
+    HASH_ITER(hh, nodes, node, node_tmp) {
+        node->idx = n++;
+        if (node->type != NODE_TYPE_HOST)
+            continue;
+        node->host_idx = num_hosts;
+        hosts[num_hosts++] = node;
+    }
+    return 0;
+}
 
-        HASH_ITER(hh, nodes, node_dest, node_tmp2) {
-            if (node_dest->type != NODE_TYPE_HOST)
-                continue;
+static physical_link_t *node_get_link_by_port(node_t *node, unsigned int port)
+{
+    physical_link_t *link;
 
-            if (node_dest == node_src) {
-                continue;
-            }
+    if (port < 1 || port > utarray_len(node->physical_links))
+        return NULL;
+    link = (physical_link_t *)utarray_eltptr(node->physical_links, port-1);
+    return link->dest ? link : NULL;
+}
 
-            UT_array *found_links = NULL;
-            utarray_new(found_links, &ut_ptr_icd);
-            int completed = 1;
+static void link_set_partition(physical_link_t *link, int partition)
+{
+    if (!link->partitions) {
+        link->partitions = (int *)
+            calloc(utarray_len(partitions), sizeof(int));
+    }
+    link->partitions[partition] = 1;
+    link->parent_node->partitions[partition] = 1;
+    link->parent_edge->partitions[partition] = 1;
+}
 
-            char *id_dest = node_dest->physical_id;
+/* Follow the forwarding tables from link toward dest, and set the partition
+ * in the links of the route if it reaches dest. The switches traversed get
+ * the state of the route so that the routes from other sources stop as soon
+ * as they join a known one.
+ */
+static void route_set_partition(physical_link_t *link, node_t *dest,
+        int partition, unsigned char *states,
+        physical_link_t **chain_links, node_t **chain_nodes)
+{
+    int num_links = 0, num_chain_nodes = 0;
+    int state;
+    node_t *cur;
+
+    chain_links[num_links++] = link;
+    cur = link->dest;
+    while (1) {
+        if (cur == dest) {
+            state = ROUTE_REACHES;
+            break;
+        }
+        state = states[cur->idx];
+        if (state == ROUTE_REACHES || state == ROUTE_FAILS)
+            break;
+        if (state == ROUTE_VISITING) {
+            fprintf(stderr, "Warning: routing loop toward %s at %s\n",
+                    dest->physical_id, cur->physical_id);
+            state = ROUTE_FAILS;
+            break;
+        }
+        states[cur->idx] = ROUTE_VISITING;
+        chain_nodes[num_chain_nodes++] = cur;
 
-            physical_link_t *link = (physical_link_t *)
-                utarray_eltptr(node_src->physical_links, 0);
-            utarray_push_back(found_links, &link);
-
-            node_t *node_cur = link->dest;
-            while (node_cur != node_dest) {
-                route_source_t *route_source;
-                route_dest_t *route_dest;
-                char *id_cur = node_cur->physical_id;
-                HASH_FIND_STR(routes, id_cur, route_source);
-                if (!route_source) {
-                    completed = 0;
-                    break;
-                }
-                HASH_FIND_STR(route_source->dest, id_dest, route_dest);
-                if (!route_dest) {
-                    completed = 0;
-                    break;
-                }
+        if (!cur->lft ||
+                !(link = node_get_link_by_port(cur, cur->lft[dest->host_idx]))) {
+            state = ROUTE_FAILS;
+            break;
+        }
+        chain_links[num_links++] = link;
+        cur = link->dest;
+    }
 
-                unsigned int port = route_dest->port;
-                link = (physical_link_t *)
-                    utarray_eltptr(node_cur->physical_links, port-1);
-                utarray_push_back(found_links, &link);
-                node_cur = link->dest;
-            }
+    for (int n = 0; n < num_chain_nodes; n++)
+        states[chain_nodes[n]->idx] = state;
 
-            if (completed) {
-                path_dest_t *path_dest = (path_dest_t *)
-                    malloc(sizeof(path_dest_t));
-                sprintf(path_dest->physical_id, "%s", id_dest);
-                path_dest->node = node_dest;
-                path_dest->links = found_links;
-                HASH_ADD_STR(path->dest, physical_id, path_dest);
-            } else {
-                utarray_free(found_links);
-            }
-        }
+    /* When joining a known route, the rest of it is already set */
+    if (state == ROUTE_REACHES) {
+        for (int l = 0; l < num_links; l++)
+            link_set_partition(chain_links[l], partition);
     }
-    return 0;
 }
 
 /* We suppose the hostname of nodes is like that: ([a-z]*).*
@@ -348,27 +363,17 @@ int netloc_topology_find_partitions(void)
     int ret = 0;
     int num_nodes;
     char **partition_names;
-    node_t **hosts;
 
     num_nodes = HASH_COUNT(nodes);
     partition_names = (char **)malloc(num_nodes*sizeof(char *));
-    hosts = (node_t **)malloc(num_nodes*sizeof(node_t *));
 
     /* Save all the partition names */
-    int n = 0;
-    node_t *node, *node_tmp;
-    HASH_ITER(hh, nodes, node, node_tmp) {
-        if (node->type != NODE_TYPE_HOST)
-            continue;
-        partition_names[n] = node_find_partition_name(node);
-        hosts[n] = node;
-        n++;
-    }
+    for (int n = 0; n < num_hosts; n++)
+        partition_names[n] = node_find_partition_name(hosts[n]);
 
     /* Associate the field partition in the nodes to the correct partition
      * index
      */
-    int num_hosts = n;
     int num_partitions = 0;
     for (int n1 = 0; n1 < num_hosts; n1++) {
         if (!partition_names[n1])
@@ -397,7 +402,6 @@ int netloc_topology_find_partitions(void)
         utarray_push_back(partitions, partition_names+p);
     }
     free(partition_names);
-    free(hosts);
 
     return ret;
 }
@@ -422,30 +426,34 @@ int netloc_topology_set_partitions(void)
     }
 
     /* Set the partitions for the physical links considering if there is in a
-     * path between two nodes of a partition */
-    path_source_t *path_src, *path_src_tmp;
-    HASH_ITER(hh, paths, path_src, path_src_tmp) {
-        node_t *node_src = path_src->node;
-        int partition = node_src->main_partition;
-        path_dest_t *path_dest, *path_dest_tmp;
-        HASH_ITER(hh, path_src->dest, path_dest, path_dest_tmp) {
-            node_t *node_dest = path_dest->node;
-            if (node_dest->main_partition != partition)
+     * path between two nodes of a partition. The routes toward a destination
+     * are walked from every source, sharing the switches already visited. */
+    int num_nodes = HASH_COUNT(nodes);
+    unsigned char *states = (unsigned char *)malloc(num_nodes*sizeof(char));
+    physical_link_t **chain_links = (physical_link_t **)
+        malloc((num_nodes+1)*sizeof(physical_link_t *));
+    node_t **chain_nodes = (node_t **)malloc(num_nodes*sizeof(node_t *));
+    for (int d = 0; d < num_hosts; d++) {
+        node_t *node_dest = hosts[d];
+        int partition = node_dest->main_partition;
+
+        memset(states, ROUTE_UNKNOWN, num_nodes*sizeof(char));
+        for (int s = 0; s < num_hosts; s++) {
+            node_t *node_src = hosts[s];
+            if (node_src == node_dest || node_src->main_partition != partition)
                 continue;
 
-            for (unsigned int l = 0; l < utarray_len(path_dest->links); l++) {
-                physical_link_t *link = *(physical_link_t **)
-                    utarray_eltptr(path_dest->links, l);
-                if (!link->partitions) {
-                    link->partitions = (int *)
-                        calloc(utarray_len(partitions), sizeof(int));
-                }
-                link->partitions[partition] = 1;
-                link->parent_node->partitions[partition] = 1;
-                link->parent_edge->partitions[partition] = 1;
-            }
+            physical_link_t *link = node_get_link_by_port(node_src, 1);
+            if (!link)
+                continue;
+            route_set_partition(link, node_dest, partition, states,
+                    chain_links, chain_nodes);
         }
     }
+    free(states);
+    free(chain_links);
+    free(chain_nodes);
+
     return 0;
 }
 
@@ -555,6 +563,7 @@ int main(int argc, char **argv)
 
             discover_filename = filename;
             read_discover(subnet, inpath, discover_filename);
+            index_nodes();
 
             asprintf(&route_filename, "%s/ibroutes-%s", inpath, subnet);
             struct stat s;
@@ -578,7 +587,6 @@ int main(int argc, char **argv)
             }
             free(route_filename);
 
-            build_paths();
             netloc_topology_set_partitions();
 
             write_into_file(subnet, outpath, hwlocpath);
@@ -602,6 +610,7 @@ int main(int argc, char **argv)
 
                 free(node->hostname);
                 free(node->partitions);
+                free(node->lft);
 
                 /* Physical links */
                 for (unsigned int l = 0; l < utarray_len(node->physical_links); l++) {
@@ -625,32 +634,10 @@ int main(int argc, char **argv)
             }
             utarray_free(partitions);
 
-            /* Free Routes */
-            route_source_t *route, *route_tmp;
-            HASH_ITER(hh, routes, route, route_tmp) {
-                HASH_DEL(routes, route);
-
-                route_dest_t *routed, *routed_tmp;
-                HASH_ITER(hh, route->dest, routed, routed_tmp) {
-                    HASH_DEL(route->dest, routed);
-                    free(routed);
-                }
-                free(route);
-            }
-
-            /* Free Paths */
-            path_source_t *path, *path_tmp;
-            HASH_ITER(hh, paths, path, path_tmp) {
-                HASH_DEL(paths, path);
-
-                path_dest_t *pathd, *pathd_tmp;
-                HASH_ITER(hh, path->dest, pathd, pathd_tmp) {
-                    HASH_DEL(path->dest, pathd);
-                    utarray_free(pathd->links);
-                    free(pathd);
-                }
-                free(path);
-            }
+            /* Free Hosts */
+            free(hosts);
+            hosts = NULL;
+            num_hosts = 0;
 
             free(subnet);
         }
@@ -988,22 +975,15 @@ int write_into_file(char *subnet, char *path, char *hwlocpath)
                 utarray_next(partitions, ppartition)? ",": "");
     fprintf(output, "\n");
 
-    /* Write paths into file */
-    path_source_t *path_src, *path_src_tmp;
-    HASH_ITER(hh, paths, path_src, path_src_tmp) {
-        node_t *node_src = path_src->node;
-        path_dest_t *path_dest, *path_dest_tmp;
-        HASH_ITER(hh, path_src->dest, path_dest, path_dest_tmp) {
-            node_t *node_dest = path_dest->node;
-            fprintf(output, "%s,%s",
-                    node_src->physical_id, node_dest->physical_id);
-            for (unsigned int l = 0; l < utarray_len(path_dest->links); l++) {
-                physical_link_t *link = *(physical_link_t **)
-                    utarray_eltptr(path_dest->links, l);
-                fprintf(output, ",%d", link->int_id);
-            }
-            fprintf(output, "\n");
-        }
+    /* Write forwarding tables into file: the output port toward each host,
+     * in the order of the nodes */
+    HASH_ITER(hh, nodes, node, node_tmp) {
+        if (!node->lft)
+            continue;
+        fprintf(output, "%s", node->physical_id);
+        for (int h = 0; h < num_hosts; h++)
+            fprintf(output, ",%u", node->lft[h]);
+        fprintf(output, "\n");
     }
 
     fclose(output);
@@ -1058,7 +1038,8 @@ int read_routes(char *subnet, char *path, char *route_dirname)
 
                 int read;
 
-                route_source_t *route = NULL;
+                int header_found = 0;
+                node_t *route_node = NULL;
                 while ((read = getline(&line, &size, route_file)) > 0) {
                     regmatch_t pmatch[5];
                     char *matches[5];
@@ -1074,20 +1055,19 @@ int read_routes(char *subnet, char *path, char *route_dirname)
                             free(matches[m]);
                         }
 
-                        HASH_FIND_STR(routes, guid, route);
-                        if (!route) {
-                            route = (route_source_t *) malloc(sizeof(route_source_t));
-                            sprintf(route->physical_id, "%s", guid);
-                            route->dest = NULL;
-                            HASH_ADD_STR(routes, physical_id, route);
+                        header_found = 1;
+                        HASH_FIND_STR(nodes, guid, route_node);
+                        if (route_node && !route_node->lft) {
+                            route_node->lft = (unsigned char *)
+                                calloc(num_hosts ? num_hosts : 1, sizeof(char));
                         }
                     }
                     else if (!regexec(&route_re, line, (size_t)5, pmatch, 0)) {
-                        if (!route) {
+                        if (!header_found) {
                             fprintf(stderr, "Malformed route file %s\n", filename);
                             exit(-1);
                         }
-                        route_dest_t *route_dest;
+                        node_t *dest_node;
                         get_match(line, 5, pmatch, matches);
                         port = atoi(matches[2]);
                         sprintf(dest_guid, "%.4s:%.4s:%.4s:%.4s",
@@ -1096,10 +1076,19 @@ int read_routes(char *subnet, char *path, char *route_dirname)
                             free(matches[m]);
                         }
 
-                        route_dest = (route_dest_t *) malloc(sizeof(route_dest_t));
-                        sprintf(route_dest->physical_id, "%s", dest_guid);
-                        route_dest->port = port;
-                        HASH_ADD_STR(route->dest, physical_id, route_dest);
+                        /* Only the routes toward hosts are kept, the last
+                         * one wins if a host has several lids */
+                        if (!route_node)
+                            continue;
+                        HASH_FIND_STR(nodes, dest_guid, dest_node);
+                        if (!dest_node || dest_node->host_idx == -1)
+                            continue;
+                        if (port <= 0 || port > UCHAR_MAX) {
+                            fprintf(stderr, "Invalid port %d in route file %s\n",
+                                    port, filename);
+                            continue;
+                        }
+                        route_node->lft[dest_node->host_idx] = (unsigned char)port;
                     }
                 }
                 fclose(route_file);